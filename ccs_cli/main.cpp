@@ -5,6 +5,7 @@
 #include <boost/timer.hpp>
 #include "ccs_opencv.h"
 #include "io_util.h"
+#include "batch_processing.h"
 #include "superpixel_tools.h"
 #include "visualization.h"
 
@@ -31,13 +32,17 @@ int main(int argc, const char** argv) {
     boost::program_options::options_description desc("Allowed options");
     desc.add_options()
         ("help,h", "produce help message")
-        ("input,i", boost::program_options::value<std::string>(), "input picture")
+        ("input,i", boost::program_options::value<std::string>(), "image, directory, glob pattern or image list (.txt) to process")
         ("superpixels,s", boost::program_options::value<int>()->default_value(400), "number of superpixels")
         ("compactness,c", boost::program_options::value<int>()->default_value(500), "compactness weight")
         ("iterations,t", boost::program_options::value<int>()->default_value(20), "number of iterations to perform")
         ("color-space,r", boost::program_options::value<int>()->default_value(0), "0 = RGB, >0 = Lab")
-        ("oc", boost::program_options::value<std::string>()->default_value("output"), "name of the contour picture")
-        ("om", boost::program_options::value<std::string>()->default_value("output"), "name of the mean picture");
+        ("oc", boost::program_options::value<std::string>()->default_value("output"), "name of the contour picture (directory for batches)")
+        ("om", boost::program_options::value<std::string>()->default_value("output"), "name of the mean picture (directory for batches)")
+        ("ol", boost::program_options::value<std::string>()->default_value(""), "name of the label file (.csv, .bin or .rle; directory for batches)")
+        ("format", boost::program_options::value<std::string>()->default_value("csv"), "format of the label files for batches: csv, bin or rle")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of images to process in parallel for batches (0 for all cores)")
+        ("prefetch", boost::program_options::value<int>()->default_value(4), "number of images to read ahead for batches");
 
     boost::program_options::positional_options_description positionals;
     positionals.add("input", 1);
@@ -53,6 +58,7 @@ int main(int argc, const char** argv) {
 
     std::string inputfile = parameters["input"].as<std::string>();
     std::string store_contour = parameters["oc"].as<std::string>();
+    std::string store_labels = parameters["ol"].as<std::string>();
     std::string store_mean = parameters["om"].as<std::string>();
     int superpixels = parameters["superpixels"].as<int>();
     int compactness = parameters["compactness"].as<int>();
@@ -64,28 +70,22 @@ int main(int argc, const char** argv) {
         lab = true;
     }
         
-    cv::Mat image = cv::imread(inputfile);
-    cv::Mat labels;
-        
-    int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
-                superpixels);
-        
-    CCS_OpenCV::computeSuperpixels(image, region_size,
-                iterations, compactness, lab, labels);
-        
-    int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
-    int merged_components = SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, labels, unconnected_components);
-    merged_components += SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, labels, unconnected_components);
-      
-    cv::Mat blackima = cv::Mat::zeros(cv::Size(image.cols, image.rows), CV_8UC3);
+    BatchProcessing batch_processing(store_contour, store_mean, "", store_labels);
+    batch_processing.setFormat(parameters["format"].as<std::string>());
+    batch_processing.setThreads(parameters["threads"].as<int>());
+    batch_processing.setPrefetch(parameters["prefetch"].as<int>());
     
-    cv::Mat image_contours;
-    Visualization::drawContours(blackima, labels, image_contours);
-    cv::imwrite(store_contour, image_contours);
+    batch_processing.process(inputfile, [&](cv::Mat &image, cv::Mat &labels) {
+        int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image,
+                    superpixels);
 
-    cv::Mat image_means;
-    Visualization::drawMeans(image, labels, image_means);
-    cv::imwrite(store_mean, image_means);
-            
+        CCS_OpenCV::computeSuperpixels(image, region_size,
+                    iterations, compactness, lab, labels);
+
+        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
+        int merged_components = SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, labels, unconnected_components);
+        merged_components += SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, labels, unconnected_components);
+    });
+    
     return 0;
 }
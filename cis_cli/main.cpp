@@ -55,6 +55,7 @@
  *     -g [ --sigma ] arg (=2)         sigma for gaussian kernel of edge weights
  *     -r [ --color-space ] arg (=0)   0 = GRAY, >0 = RGB
  *     -o [ --csv ] arg                save segmentation as CSV file
+ *     --format arg (=csv)             label format: csv, bin or rle
  *     -v [ --vis ] arg                visualize contours
  *     -x [ --prefix ] arg             output file prefix
  *     -w [ --wordy ]                  verbose/wordy/debug
@@ -74,6 +75,7 @@ int main (int argc, char ** argv) {
         ("sigma,g", boost::program_options::value<float>()->default_value(2.f), "sigma for gaussian kernel of edge weights")
         ("color-space,r", boost::program_options::value<int>()->default_value(0), "0 = GRAY, >0 = RGB")
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "save segmentation as CSV file")
+        ("format", boost::program_options::value<std::string>()->default_value("csv"), "label format: csv, bin or rle")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
         ("wordy,w", "verbose/wordy/debug");
@@ -90,6 +92,8 @@ int main (int argc, char ** argv) {
         return 1;
     }
     
+    std::string label_extension = IOUtil::getLabelExtension(parameters["format"].as<std::string>());
+    
     boost::filesystem::path output_dir(parameters["csv"].as<std::string>());
     if (!output_dir.empty()) {
         if (!boost::filesystem::is_directory(output_dir)) {
@@ -165,8 +169,8 @@ int main (int argc, char ** argv) {
         
         if (!output_dir.empty()) {
             boost::filesystem::path csv_file(output_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+                    / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+            IOUtil::writeLabels(csv_file, labels);
         }
         
         if (!vis_dir.empty()) {
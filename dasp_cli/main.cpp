@@ -74,6 +74,7 @@
  *     -t [ --iterations ] arg (=5)          iterations
  *     -o [ --csv ] arg                      specify the output directory (default 
  *                                           is ./output)
+ *     --format arg (=csv)                   label format: csv, bin or rle
  *     -v [ --vis ] arg                      visualize contours
  *     -x [ --prefix ] arg                   output file prefix
  *     -w [ --wordy ]                        verbose/wordy/debug
@@ -100,6 +101,7 @@ int main(int argc, const char** argv) {
         ("normal-weight,n", boost::program_options::value<float>()->default_value(0.2f), "normal weight")
         ("iterations,t", boost::program_options::value<int>()->default_value(5), "iterations")
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "specify the output directory (default is ./output)")
+        ("format", boost::program_options::value<std::string>()->default_value("csv"), "label format: csv, bin or rle")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
         ("wordy,w", "verbose/wordy/debug");
@@ -117,6 +119,8 @@ int main(int argc, const char** argv) {
         return 1;
     }
     
+    std::string label_extension = IOUtil::getLabelExtension(parameters["format"].as<std::string>());
+    
     boost::filesystem::path output_dir(parameters["csv"].as<std::string>());
     if (!output_dir.empty()) {
         if (!boost::filesystem::is_directory(output_dir)) {
@@ -257,8 +261,8 @@ int main(int argc, const char** argv) {
         
         if (!output_dir.empty()) {
             boost::filesystem::path csv_file(output_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+                    / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+            IOUtil::writeLabels(csv_file, labels);
         }
         
         if (!vis_dir.empty()) {
@@ -37,6 +37,7 @@
 #include <boost/timer.hpp>
 #include "ers_opencv.h"
 #include "io_util.h"
+#include "batch_processing.h"
 #include "superpixel_tools.h"
 #include "visualization.h"
 
@@ -63,13 +64,17 @@ int main(int argc, const char** argv) {
     boost::program_options::options_description desc("Allowed options");
     desc.add_options()
         ("help,h", "produce help message")
-        ("input,i", boost::program_options::value<std::string>(), "the folder to process")
+        ("input,i", boost::program_options::value<std::string>(), "image, directory, glob pattern or image list (.txt) to process")
         ("lambda,l", boost::program_options::value<double>()->default_value(0.5), "lambda")
         ("sigma,g", boost::program_options::value<double>()->default_value(5.0), "sigma")
         ("eight-connected,f", "use 8-connected")
         ("superpixels,s", boost::program_options::value<int>()->default_value(400), "number of superpixels")
-        ("oc", boost::program_options::value<std::string>()->default_value("output"), "name of the contour picture")
-        ("om", boost::program_options::value<std::string>()->default_value("output"), "name of the mean picture");
+        ("oc", boost::program_options::value<std::string>()->default_value("output"), "name of the contour picture (directory for batches)")
+        ("om", boost::program_options::value<std::string>()->default_value("output"), "name of the mean picture (directory for batches)")
+        ("ol", boost::program_options::value<std::string>()->default_value(""), "name of the label file (.csv, .bin or .rle; directory for batches)")
+        ("format", boost::program_options::value<std::string>()->default_value("csv"), "format of the label files for batches: csv, bin or rle")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of images to process in parallel for batches (0 for all cores)")
+        ("prefetch", boost::program_options::value<int>()->default_value(4), "number of images to read ahead for batches");
 
     boost::program_options::positional_options_description positionals;
     positionals.add("input", 1);
@@ -90,31 +95,26 @@ int main(int argc, const char** argv) {
 
     std::string inputfile = parameters["input"].as<std::string>();
     std::string store_contour = parameters["oc"].as<std::string>();
+    std::string store_labels = parameters["ol"].as<std::string>();
     std::string store_mean = parameters["om"].as<std::string>();
     int superpixels = parameters["superpixels"].as<int>();
     double lambda = parameters["lambda"].as<double>();
     double sigma = parameters["sigma"].as<double>();
     
-     cv::Mat image = cv::imread(inputfile);
-        
-    cv::Mat labels;
-    ERS_OpenCV::computeSuperpixels(image, superpixels, lambda, sigma, 
-            four_connected, labels);
-        
-    int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
+    BatchProcessing batch_processing(store_contour, store_mean, "", store_labels);
+    batch_processing.setFormat(parameters["format"].as<std::string>());
+    batch_processing.setThreads(parameters["threads"].as<int>());
+    batch_processing.setPrefetch(parameters["prefetch"].as<int>());
+    
+    batch_processing.process(inputfile, [&](cv::Mat &image, cv::Mat &labels) {
+        ERS_OpenCV::computeSuperpixels(image, superpixels, lambda, sigma,
+                four_connected, labels);
+
+        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
 //        int merged_components = SuperpixelTools::enforceMinimumSuperpixelSize(image, labels, 5);
 //        int merged_components = SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, labels, unconnected_components);
 //        SuperpixelTools::relabelSuperpixels(labels);
-    
-    cv::Mat blackima = cv::Mat::zeros(cv::Size(image.cols, image.rows), CV_8UC3);
-    
-    cv::Mat image_contours;
-    Visualization::drawContours(blackima, labels, image_contours);
-    cv::imwrite(store_contour, image_contours);
-
-    cv::Mat image_means;
-    Visualization::drawMeans(image, labels, image_means);
-    cv::imwrite(store_mean, image_means); 
+    });
     
     return 0;
 }
@@ -35,8 +35,10 @@
 #include <boost/timer.hpp>
 #include <boost/program_options.hpp>
 #include <boost/timer.hpp>
+#include <glog/logging.h>
 #include "etps_opencv.h"
 #include "io_util.h"
+#include "batch_processing.h"
 #include "superpixel_tools.h"
 #include "visualization.h"
 
@@ -47,12 +49,24 @@
  *   Allowed options:
  *     -h [ --help ]                         produce help message
  *     -i [ --input ] arg                    the folder to process
+ *     -r [ --right ] arg                    right image (directory for batches, 
+ *                                           same file names) for depth-aware 
+ *                                           superpixels on rectified stereo 
+ *                                           pairs; the input are the left images
  *     -s [ --superpixels ] arg (=400)       number of superpixels
  *     -c [ --regularization-weight ] arg (=1)
  *                                           regularization weight
  *     -l [ --length-weight ] arg (=1)       length weight
  *     -n [ --size-weight ] arg (=1)         size weight
  *     -t [ --iterations ] arg (=1)          number of iterations
+ *     --etps-threads arg (=1)               number of threads used by ETPS for 
+ *                                           each image (0 for all cores); with 
+ *                                           --right, the threads used by SGM
+ *     --op arg                              name of the per-level performance 
+ *                                           file (.json or .csv; directory for 
+ *                                           batches)
+ *     --perf-format arg (=json)             format of the performance files for 
+ *                                           batches: json or csv
  *     -o [ --csv ] arg                      save segmentation as CSV file
  *     -v [ --vis ] arg                      visualize contours
  *     -x [ --prefix ] arg                   output file prefix
@@ -65,14 +79,22 @@ int main(int argc, const char** argv) {
     boost::program_options::options_description desc("Allowed options");
     desc.add_options()
         ("help,h", "produce help message")
-        ("input,i", boost::program_options::value<std::string>(), "the folder to process")
+        ("input,i", boost::program_options::value<std::string>(), "image, directory, glob pattern or image list (.txt) to process")
+        ("right,r", boost::program_options::value<std::string>()->default_value(""), "right image (directory for batches, same file names) for depth-aware superpixels on rectified stereo pairs; the input are the left images")
         ("superpixels,s", boost::program_options::value<int>()->default_value(400), "number of superpixels")
         ("regularization-weight,c", boost::program_options::value<double>()->default_value(1.0), "regularization weight")
         ("length-weight,l", boost::program_options::value<double>()->default_value(1.0), "length weight")
         ("size-weight,n", boost::program_options::value<double>()->default_value(1.0), "size weight")
         ("iterations,t", boost::program_options::value<int>()->default_value(1), "number of iterations")
-        ("oc", boost::program_options::value<std::string>()->default_value("output"), "name of the contour picture")
-        ("om", boost::program_options::value<std::string>()->default_value("output"), "name of the mean picture");
+        ("etps-threads", boost::program_options::value<int>()->default_value(1), "number of threads used by ETPS for each image (0 for all cores); with --right, the threads used by SGM")
+        ("oc", boost::program_options::value<std::string>()->default_value("output"), "name of the contour picture (directory for batches)")
+        ("om", boost::program_options::value<std::string>()->default_value("output"), "name of the mean picture (directory for batches)")
+        ("ol", boost::program_options::value<std::string>()->default_value(""), "name of the label file (.csv, .bin or .rle; directory for batches)")
+        ("format", boost::program_options::value<std::string>()->default_value("csv"), "format of the label files for batches: csv, bin or rle")
+        ("op", boost::program_options::value<std::string>()->default_value(""), "name of the per-level performance file (.json or .csv; directory for batches)")
+        ("perf-format", boost::program_options::value<std::string>()->default_value("json"), "format of the performance files for batches: json or csv")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of images to process in parallel for batches (0 for all cores)")
+        ("prefetch", boost::program_options::value<int>()->default_value(4), "number of images to read ahead for batches");
 
     boost::program_options::positional_options_description positionals;
     positionals.add("input", 1);
@@ -87,35 +109,66 @@ int main(int argc, const char** argv) {
     }
     
     std::string inputfile = parameters["input"].as<std::string>();
+    std::string right = parameters["right"].as<std::string>();
     std::string store_contour = parameters["oc"].as<std::string>();
+    std::string store_labels = parameters["ol"].as<std::string>();
     std::string store_mean = parameters["om"].as<std::string>();
     int superpixels = parameters["superpixels"].as<int>();
     double regularization_weight = parameters["regularization-weight"].as<double>();
     double length_weight = parameters["length-weight"].as<double>();
     double size_weight = parameters["size-weight"].as<double>();
     int iterations = parameters["iterations"].as<int>();
-        
-    cv::Mat image = cv::imread(inputfile);
-        
-    // Same conversion for all algorithms.
-    int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
-            superpixels);
-        
-    cv::Mat labels;
-    ETPS_OpenCV::computeSuperpixels(image, region_size, regularization_weight, 
-                length_weight, size_weight, iterations, labels);
-        
-    int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
+    int etps_threads = parameters["etps-threads"].as<int>();
+    std::string store_perf = parameters["op"].as<std::string>();
+    std::string perf_extension = "." + parameters["perf-format"].as<std::string>();
     
-    cv::Mat blackima = cv::Mat::zeros(cv::Size(image.cols, image.rows), CV_8UC3);
+    bool batch = BatchProcessing::isBatch(inputfile);
+    if (!store_perf.empty() && batch && !boost::filesystem::is_directory(store_perf)) {
+        boost::filesystem::create_directories(store_perf);
+    }
+        
+    BatchProcessing batch_processing(store_contour, store_mean, "", store_labels);
+    batch_processing.setFormat(parameters["format"].as<std::string>());
+    batch_processing.setThreads(parameters["threads"].as<int>());
+    batch_processing.setPrefetch(parameters["prefetch"].as<int>());
     
-    cv::Mat image_contours;
-    Visualization::drawContours(blackima, labels, image_contours);
-    cv::imwrite(store_contour, image_contours);
+    batch_processing.process(inputfile, [&](const boost::filesystem::path &file, 
+            cv::Mat &image, cv::Mat &labels) {
+        // Same conversion for all algorithms.
+        int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image,
+                superpixels);
 
-    cv::Mat image_means;
-    Visualization::drawMeans(image, labels, image_means);
-    cv::imwrite(store_mean, image_means);    
+        ETPS_OpenCV::PerformanceInfo info;
+        if (right.empty()) {
+            info = ETPS_OpenCV::computeSuperpixels(image, region_size, 
+                    regularization_weight, length_weight, size_weight, 
+                    iterations, labels, etps_threads);
+        }
+        else {
+            boost::filesystem::path right_file(right);
+            if (batch) {
+                right_file /= file.filename();
+            }
+            
+            cv::Mat right_image = cv::imread(right_file.string());
+            LOG_IF(FATAL, right_image.empty()) << "Could not read right image: " << right_file.string() << ".";
+            LOG_IF(FATAL, right_image.size() != image.size()) << "Left and right image differ in size: " << right_file.string() << ".";
+            
+            info = ETPS_OpenCV::computeSuperpixelsStereo(image, right_image, 
+                    region_size, regularization_weight, length_weight, size_weight, 
+                    iterations, labels, etps_threads);
+        }
+
+        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
+        
+        if (!store_perf.empty()) {
+            boost::filesystem::path perf_file = BatchProcessing::getOutputFile(store_perf, 
+                    file, perf_extension, batch);
+            if (!ETPS_OpenCV::writePerformanceInfo(info, perf_file.string())) {
+                std::cout << "Could not write " << perf_file.string() << "." << std::endl;
+            }
+        }
+    });
     
     return 0;
 }
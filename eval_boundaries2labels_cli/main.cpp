@@ -47,6 +47,7 @@
  *                                process
  *     -r [ --overwrite ]         Overwrite original files
  *     -o [ --csv ] arg (=output) save segmentation as CSV file
+ *     --format arg (=csv)        label format: csv, bin or rle
  *     -w [ --wordy ]             wordy/verbose
  * \endcode
  * \author David Stutz
@@ -60,6 +61,7 @@ int main (int argc, char ** argv) {
         ("input-images,m", boost::program_options::value<std::string>(), "folder containing the corresponding images to process")
         ("overwrite,r", "Overwrite original files")
         ("csv,o", boost::program_options::value<std::string>()->default_value("output"), "save segmentation as CSV file")
+        ("format", boost::program_options::value<std::string>()->default_value("csv"), "label format: csv, bin or rle")
         ("wordy,w", "wordy/verbose");
     
     boost::program_options::positional_options_description positionals;
@@ -75,6 +77,8 @@ int main (int argc, char ** argv) {
         return 1;
     }
     
+    std::string label_extension = IOUtil::getLabelExtension(parameters["format"].as<std::string>());
+    
     boost::filesystem::path output_dir(parameters["csv"].as<std::string>());
     if (!output_dir.empty() && parameters.find("overwrite") == parameters.end()) {
         if (!boost::filesystem::is_directory(output_dir)) {
@@ -106,7 +110,7 @@ int main (int argc, char ** argv) {
     
     std::multimap<std::string, boost::filesystem::path> boundaries;
     std::vector<std::string> extensions;
-    IOUtil::getCSVExtensions(extensions);
+    IOUtil::getLabelExtensions(extensions);
     IOUtil::readDirectory(boundaries_dir, extensions, boundaries);
     
     for(std::multimap<std::string, boost::filesystem::path>::iterator it = boundaries.begin(); 
@@ -126,7 +130,7 @@ int main (int argc, char ** argv) {
         
         cv::Mat boundaries;
         cv::Mat labels;
-        IOUtil::readMatCSVInt(it->second, boundaries);
+        IOUtil::readLabels(it->second, boundaries);
         SuperpixelTools::computeLabelsFromBoundaries(image, boundaries, labels);
         int superpixels = SuperpixelTools::countSuperpixels(labels);
         
@@ -136,13 +140,13 @@ int main (int argc, char ** argv) {
         
         if (parameters.find("overwrite") != parameters.end()) {
             boost::filesystem::path label_file(boundaries_dir 
-                    / boost::filesystem::path(it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(label_file, labels);
+                    / boost::filesystem::path(it->second.stem().string() + label_extension));
+            IOUtil::writeLabels(label_file, labels);
         }
         else {
             boost::filesystem::path label_file(output_dir 
-                    / boost::filesystem::path(it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(label_file, labels);
+                    / boost::filesystem::path(it->second.stem().string() + label_extension));
+            IOUtil::writeLabels(label_file, labels);
         }
     }
     
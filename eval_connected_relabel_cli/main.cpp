@@ -47,6 +47,7 @@
  *     -m [ --input-images ] arg  dummy option!
  *     -r [ --overwrite ]         Overwrite original files
  *     -o [ --csv ] arg (=output) save segmentation as CSV file
+ *     --format arg (=csv)        label format: csv, bin or rle
  *     -w [ --wordy ]             wordy/verbose
  * \endcode
  * \author David Stutz
@@ -60,6 +61,7 @@ int main (int argc, char ** argv) {
         ("input-images,m", boost::program_options::value<std::string>()->default_value(""), "dummy option!")
         ("overwrite,r", "Overwrite original files")
         ("csv,o", boost::program_options::value<std::string>()->default_value("output"), "save segmentation as CSV file")
+        ("format", boost::program_options::value<std::string>()->default_value("csv"), "label format: csv, bin or rle")
         ("wordy,w", "wordy/verbose");
     
     boost::program_options::positional_options_description positionals;
@@ -74,6 +76,8 @@ int main (int argc, char ** argv) {
         return 1;
     }
     
+    std::string label_extension = IOUtil::getLabelExtension(parameters["format"].as<std::string>());
+    
     boost::filesystem::path output_dir(parameters["csv"].as<std::string>());
     if (!output_dir.empty() && parameters.find("overwrite") == parameters.end()) {
         if (!boost::filesystem::is_directory(output_dir)) {
@@ -99,14 +103,14 @@ int main (int argc, char ** argv) {
     
     std::multimap<std::string, boost::filesystem::path> labels;
     std::vector<std::string> extensions;
-    IOUtil::getCSVExtensions(extensions);
+    IOUtil::getLabelExtensions(extensions);
     IOUtil::readDirectory(labels_dir, extensions, labels);
     
     for(std::multimap<std::string, boost::filesystem::path>::iterator it = labels.begin(); 
             it != labels.end(); ++it) {
         
         cv::Mat labels;
-        IOUtil::readMatCSVInt(it->second, labels);
+        IOUtil::readLabels(it->second, labels);
         
         int superpixels = SuperpixelTools::countSuperpixels(labels);
         int components = SuperpixelTools::relabelConnectedSuperpixels(labels);
@@ -118,14 +122,13 @@ int main (int argc, char ** argv) {
         
         if (components > 0) {
             if (parameters.find("overwrite") != parameters.end()) {
-                boost::filesystem::path label_file(labels_dir 
-                        / boost::filesystem::path(it->second.stem().string() + ".csv"));
-                IOUtil::writeMatCSV<int>(label_file, labels);
+                // Keep the format of the original file when overwriting.
+                IOUtil::writeLabels(it->second, labels);
             }
             else {
                 boost::filesystem::path label_file(output_dir 
-                        / boost::filesystem::path(it->second.stem().string() + ".csv"));
-                IOUtil::writeMatCSV<int>(label_file, labels);
+                        / boost::filesystem::path(it->second.stem().string() + label_extension));
+                IOUtil::writeLabels(label_file, labels);
             }
         }
     }
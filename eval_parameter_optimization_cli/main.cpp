@@ -36,13 +36,107 @@
 #include <glog/logging.h>
 
 #include "io_util.h"
+#include "superpixel_tools.h"
 #include "parameter_optimization_tool.h"
 
+#ifdef WITH_SLIC
+#include "slic_opencv.h"
+#endif
+#ifdef WITH_FH
+#include "fh_opencv.h"
+#endif
+#ifdef WITH_ETPS
+#include "etps_opencv.h"
+#endif
+#ifdef WITH_ERS
+#include "ers_opencv.h"
+#endif
+
 // Dirty but simple ...
 std::string FAIR = "-f ";
 std::string RELATIVE_PATH = ".";
 std::string MATLAB_EXECUTABLE = "/home/david/MATLAB/R2014b/bin/matlab";
 std::string JAVA_EXECUTABLE = "/home/david/jdk-1.8.0_45/release/java";
+bool IN_PROCESS = false;
+int THREADS = 1;
+int STRATEGY = ParameterOptimizationTool::GRID_SEARCH;
+int BUDGET = 0;
+int HALVING_RATE = 3;
+int HALVING_IMAGES = 10;
+int SLIC_CACHE_IMAGES = 100;
+
+////////////////////////////////////////////////////////////////////////////////
+// registerAlgorithms
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Register the algorithms built alongside this tool for in-process
+ * optimization; the parameter names match those used by the connectors below.
+ */
+void registerAlgorithms() {
+#ifdef WITH_SLIC
+    ParameterOptimizationTool::registerAlgorithm("slic", [](const cv::Mat &image, 
+            const std::map<std::string, float> &parameters, cv::Mat &labels) {
+        // The Lab planes and edges only depend on the image and color space,
+        // so they are computed once per image and shared by all combinations;
+        // memory is bounded by keeping at most SLIC_CACHE_IMAGES images.
+        static SLICCache_OpenCV cache(SLIC_CACHE_IMAGES);
+        thread_local SLICContext_OpenCV context;
+        context.setCache(&cache);
+        
+        int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
+                parameters.at("superpixels"));
+        context.computeSuperpixels(image, region_size, parameters.at("compactness"), 
+                parameters.at("iterations"), parameters.at("perturb-seeds") > 0, 
+                parameters.at("color-space"), labels);
+    });
+#endif
+#ifdef WITH_FH
+    ParameterOptimizationTool::registerAlgorithm("fh", [](const cv::Mat &image, 
+            const std::map<std::string, float> &parameters, cv::Mat &labels) {
+        FH_OpenCV::computeSuperpixels(image, parameters.at("sigma"), 
+                parameters.at("threshold"), parameters.at("minimum-size"), labels);
+    });
+#endif
+#ifdef WITH_ETPS
+    ParameterOptimizationTool::registerAlgorithm("etps", [](const cv::Mat &image, 
+            const std::map<std::string, float> &parameters, cv::Mat &labels) {
+        int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
+                parameters.at("superpixels"));
+        ETPS_OpenCV::computeSuperpixels(image, region_size, parameters.at("regularization-weight"), 
+                parameters.at("length-weight"), parameters.at("size-weight"), 
+                parameters.at("iterations"), labels);
+    });
+#endif
+#ifdef WITH_ERS
+    ParameterOptimizationTool::registerAlgorithm("ers", [](const cv::Mat &image, 
+            const std::map<std::string, float> &parameters, cv::Mat &labels) {
+        ERS_OpenCV::computeSuperpixels(image, parameters.at("superpixels"), 
+                parameters.at("lambda"), parameters.at("sigma"), 1, labels);
+    });
+#endif
+}
+
+/** \brief Switch the tool to in-process optimization if requested and the
+ * algorithm is available.
+ * \param[in] tool parameter optimization tool
+ * \param[in] name name of the algorithm
+ */
+void useInProcess(ParameterOptimizationTool &tool, std::string name) {
+    if (IN_PROCESS) {
+        LOG_IF(FATAL, !ParameterOptimizationTool::isAlgorithmRegistered(name)) 
+                << "Algorithm not available in-process (not built?): " << name << ".";
+        tool.useAlgorithm(name);
+    }
+}
+
+/** \brief Apply the threads and search strategy given on the command line.
+ * \param[in] tool parameter optimization tool
+ */
+void configureSearch(ParameterOptimizationTool &tool) {
+    tool.setThreads(THREADS);
+    tool.setStrategy(STRATEGY, BUDGET);
+    tool.setSuccessiveHalving(HALVING_RATE, HALVING_IMAGES);
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 // CCS
@@ -69,6 +163,7 @@ void connector_CCS(boost::filesystem::path img_directory,
         tool.addFloatParameter("iterations", "--iterations", std::vector<float>{1, 5, 25, 50}); // 4
         tool.addIntegerParameter("color-space", "--color-space", std::vector<int>{0, 1}); // 2
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -99,6 +194,7 @@ void connector_CIS(boost::filesystem::path img_directory,
         tool.addIntegerParameter("iterations", "--iterations", std::vector<int>{1, 3}); // 2
         tool.addIntegerParameter("color-space", "--color-space", std::vector<int>{0, 1}); // 2
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -129,6 +225,7 @@ void connector_CRS(boost::filesystem::path img_directory,
         tool.addIntegerParameter("iterations", "--iterations", std::vector<int>{1, 3}); // 2
         tool.addIntegerParameter("color-space", "--color-space", std::vector<int>{0, 1}); // 2
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -156,6 +253,7 @@ void connector_CW(boost::filesystem::path img_directory,
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addFloatParameter("compactness", "--compactness", std::vector<float>{0.01f, 0.05f, 0.1f, 0.5f, 1.0f, 5.0f, 10.0f}); // 7
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -194,6 +292,7 @@ void connector_DASP(boost::filesystem::path img_directory,
         tool.addFloatParameter("normal-weight", "--normal-weight", std::vector<float>{0.0f, 0.25f, 0.5f}); // 3
         tool.addIntegerParameter("iterations", "--iterations", std::vector<int>{5, 10, 25}); // 3
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -225,6 +324,7 @@ void connector_EAMS(boost::filesystem::path img_directory,
         tool.addIntegerParameter("minimum-size", "-m", std::vector<int>{10, 25, 50, 250}); // 4
         tool.addIntegerParameter("color-space", "-r", std::vector<int>{0, 1}); // 2
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -254,6 +354,7 @@ void connector_ERGC(boost::filesystem::path img_directory,
         tool.addIntegerParameter("color-space", "--color-space", std::vector<int>{0, 1}); // 2
         tool.addIntegerParameter("compacity", "--compacity", std::vector<int>{0, 1, 2, 5, 10, 25}); // 6
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -282,6 +383,9 @@ void connector_ERS(boost::filesystem::path img_directory,
         tool.addFloatParameter("lambda", "--lambda", std::vector<float>{0.1f, 0.5f, 1.0f, 2.5f, 5.0f, 10.0f}); // 6
         tool.addFloatParameter("sigma", "--sigma", std::vector<float>{0.1f, 0.5f, 1.0f, 2.5f, 5.0f, 10.0f}); // 6
 
+        useInProcess(tool, "ers");
+
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -312,6 +416,9 @@ void connector_ETPS(boost::filesystem::path img_directory,
         tool.addFloatParameter("size-weight", "--size-weight", std::vector<float>{1.f}); // 1
         tool.addIntegerParameter("iterations", "--iterations", std::vector<int>{1, 5, 10, 25}); // 4
 
+        useInProcess(tool, "etps");
+
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -337,6 +444,9 @@ void connector_FH(boost::filesystem::path img_directory,
     tool.addIntegerParameter("minimum-size", "--minimum-size", std::vector<int>{10, 15, 30, 60, 90, 120, 180}); // 7
     tool.addFloatParameter("threshold", "--threshold", std::vector<float>{5, 10, 15, 30, 60, 90}); // 6
 
+    useInProcess(tool, "fh");
+
+    configureSearch(tool);
     tool.optimize();
 }
 
@@ -366,6 +476,7 @@ void connector_MSS(boost::filesystem::path img_directory,
         tool.addFloatParameter("tolerance", "--tolerance", std::vector<float>{1.0f, 5.0f, 10.0f, 25.0f}); // 4
         tool.addIntegerParameter("iterations", "--iterations", std::vector<int>{1});
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -394,6 +505,7 @@ void connector_PB(boost::filesystem::path img_directory,
         tool.addFloatParameter("sigma", "--sigma", std::vector<float>{1.0f, 2.5f, 5.0f, 7.5f, 10.0f, 20.0f}); // 6
         tool.addIntegerParameter("max-flow", "--max-flow", std::vector<int>{0, 1}); // 2
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -425,6 +537,7 @@ void connector_POISE(boost::filesystem::path img_directory,
         tool.addFloatParameter("color-modifier", "-c", std::vector<float>{0.3f, 0.6f, 2.f}); // 3
         tool.addFloatParameter("threshold", "-t", std::vector<float>{0.01f, 0.03f, 0.1f}); // 3
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -455,6 +568,7 @@ void connector_preSLIC(boost::filesystem::path img_directory,
         tool.addIntegerParameter("perturb-seeds", "--perturb-seeds", std::vector<int>{0, 1}); // 2
         tool.addIntegerParameter("color-space", "--color-space", std::vector<int>{0, 1}); // 2
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -489,6 +603,7 @@ void connector_reSEEDS(boost::filesystem::path img_directory,
         tool.addIntegerParameter("iterations", "--iterations", std::vector<int>{1, 10, 25}); // 3
         tool.addIntegerParameter("color-space", "--color-space", std::vector<int>{0, 1, 2}); // 3
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -527,6 +642,7 @@ void connector_SEAW(boost::filesystem::path img_directory,
         tool.addFloatParameter("sigma", "-g", std::vector<float>{1.0f, 5.0f, 10.0f}); // 3
         tool.addIntegerParameter("dist-func", "-c", std::vector<int>{0, 1}); // 2
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -559,6 +675,7 @@ void connector_SEEDS(boost::filesystem::path img_directory,
         tool.addIntegerParameter("color-space", "--color-space", std::vector<int>{0, 1, 2}); // 3
         tool.addIntegerParameter("means", "--means", std::vector<int>{1}); // 1
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -589,6 +706,9 @@ void connector_SLIC(boost::filesystem::path img_directory,
         tool.addIntegerParameter("perturb-seeds", "--perturb-seeds", std::vector<int>{0, 1}); // 2
         tool.addIntegerParameter("color-space", "--color-space", std::vector<int>{0, 1}); // 2
 
+        useInProcess(tool, "slic");
+
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -620,6 +740,7 @@ void connector_TP(boost::filesystem::path img_directory,
         tool.addFloatParameter("sigma", "-g", std::vector<float>{1.0f, 2.5f, 5.0f, 10.0f, 15.0f}); // 5
         tool.addIntegerParameter("max-iterations", "-t", std::vector<int>{50, 100, 250, 500}); // 4
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -650,6 +771,7 @@ void connector_TPS(boost::filesystem::path img_directory,
         tool.addFloatParameter("gamma", "-m", std::vector<float>{0.25f, 0.5f, 0.75f}); // 3
         tool.addFloatParameter("sigma", "-g", std::vector<float>{0.25f, 0.5f, 0.75f}); // 3
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -679,6 +801,7 @@ void connector_vlSLIC(boost::filesystem::path img_directory,
         tool.addFloatParameter("compactness", "--compactness", std::vector<float>{1.0f, 5.0f, 10.0f, 20.0f, 40.0f, 80.0f, 160.0f}); // 9
         tool.addIntegerParameter("iterations", "--iterations", std::vector<int>{1, 5, 10, 25, 50}); // 5
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -705,6 +828,7 @@ void connector_W(boost::filesystem::path img_directory,
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -733,6 +857,7 @@ void connector_WP(boost::filesystem::path img_directory,
         tool.addIntegerParameter("superpixels", "-s", std::vector<int>{superpixels[k]});
         tool.addFloatParameter("weight", "-w", std::vector<float>{0.1f, 1.0f, 2.5f, 5.0f, 10.0f, 25.0f, 50.0f}); // 7
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -762,6 +887,7 @@ void connector_PF(boost::filesystem::path img_directory,
         tool.addIntegerParameter("superpixels", "-s", std::vector<int>{superpixels[k]});
         tool.addIntegerParameter("radius", "-r", std::vector<int>{1, 3, 5, 7, 9, 11, 31, 51}); // 8
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -792,6 +918,7 @@ void connector_LSC(boost::filesystem::path img_directory,
         tool.addIntegerParameter("threshold", "--threshold", std::vector<int>{10}); // 1
         tool.addIntegerParameter("color-space", "--color-space", std::vector<int>{0, 1}); // 2
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -820,6 +947,7 @@ void connector_RW(boost::filesystem::path img_directory,
         tool.addIntegerParameter("superpixels", "-s", std::vector<int>{superpixels[k]});
         tool.addFloatParameter("beta", "-b", std::vector<float>{1, 5, 25, 50, 100, 250}); // 6
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -852,6 +980,7 @@ void connector_QS(boost::filesystem::path img_directory,
         tool.addIntegerParameter("max-distance", "-k", std::vector<int>{6, 10, 14}); // 3
         tool.addIntegerParameter("color-space", "-r", std::vector<int>{0, 1}); // 2
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -881,6 +1010,7 @@ void connector_NC(boost::filesystem::path img_directory,
         tool.addIntegerParameter("coarse-superpixels", "-c", std::vector<int>{0, superpixels[k]/4, superpixels[k]/2}); // 3
         tool.addIntegerParameter("eigenvectors", "-g", std::vector<int>{40, 200}); // 2
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -928,6 +1058,7 @@ void connector_VCCS(boost::filesystem::path img_directory,
         tool.addFloatParameter("spatial-weight", "--spatial-weight", std::vector<float>{0.0f, 0.25f, 0.5f}); // 3
         tool.addFloatParameter("normal-weight", "--normal-weight", std::vector<float>{0.0f, 0.5f}); // 2
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -960,6 +1091,7 @@ void connector_VC(boost::filesystem::path img_directory,
         tool.addIntegerParameter("neighboring-clusters", "--neighboring-clusters", std::vector<int>{200, 400}); // 2
         tool.addIntegerParameter("direct-neighbors", "--direct-neighbors", std::vector<int>{4, 16}); // 2
 
+        configureSearch(tool);
         tool.optimize();
     }
 }
@@ -980,6 +1112,25 @@ void connector_VC(boost::filesystem::path img_directory,
  *     --java-executable arg (=../../jdk-1.8.0_45/release/java)
  *                                           java executable
  *     --not-fair                            do not use fair parameters
+ *     --threads arg (=1)                    number of parameter combinations to 
+ *                                           evaluate in parallel (0 for all 
+ *                                           cores)
+ *     --strategy arg (=grid)                search strategy: grid, halving, 
+ *                                           coordinate or random
+ *     --budget arg (=0)                     maximum number of combinations to 
+ *                                           evaluate (0 for no limit, required 
+ *                                           for random)
+ *     --halving-rate arg (=3)               successive halving: factor by which 
+ *                                           combinations are reduced and images 
+ *                                           increased
+ *     --halving-images arg (=10)            successive halving: number of images 
+ *                                           in the first round
+ *     --in-process                          run the algorithm in-process instead 
+ *                                           of the command line tool (slic, fh, 
+ *                                           etps, ers)
+ *     --slic-cache-images arg (=100)        in-process SLIC: maximum number of 
+ *                                           preprocessed images kept in memory 
+ *                                           (0 for no limit)
  *     --help                                produce help message
  * \endcode
  * \author David Stutz
@@ -997,6 +1148,13 @@ int main(int argc, const char** argv) {
         ("matlab-executable", boost::program_options::value<std::string>()->default_value("../../MATLAB/R2014b/release/matlab"), "matlab executable path")
         ("java-executable", boost::program_options::value<std::string>()->default_value("../../jdk-1.8.0_45/release/java"), "java executable")
         ("not-fair", "do not use fair parameters")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of parameter combinations to evaluate in parallel (0 for all cores)")
+        ("strategy", boost::program_options::value<std::string>()->default_value("grid"), "search strategy: grid, halving, coordinate or random")
+        ("budget", boost::program_options::value<int>()->default_value(0), "maximum number of combinations to evaluate (0 for no limit, required for random)")
+        ("halving-rate", boost::program_options::value<int>()->default_value(3), "successive halving: factor by which combinations are reduced and images increased")
+        ("halving-images", boost::program_options::value<int>()->default_value(10), "successive halving: number of images in the first round")
+        ("in-process", "run the algorithm in-process instead of the command line tool (slic, fh, etps, ers)")
+        ("slic-cache-images", boost::program_options::value<int>()->default_value(100), "in-process SLIC: maximum number of preprocessed images kept in memory (0 for no limit)")
         ("help", "produce help message");
 
     boost::program_options::positional_options_description positionals;
@@ -1053,6 +1211,35 @@ int main(int argc, const char** argv) {
     if (parameters.find("not-fair") != parameters.end()) {
         FAIR = "";
     }
+    
+    if (parameters.find("in-process") != parameters.end()) {
+        IN_PROCESS = true;
+    }
+    
+    THREADS = parameters["threads"].as<int>();
+    BUDGET = parameters["budget"].as<int>();
+    HALVING_RATE = parameters["halving-rate"].as<int>();
+    HALVING_IMAGES = parameters["halving-images"].as<int>();
+    SLIC_CACHE_IMAGES = parameters["slic-cache-images"].as<int>();
+    
+    std::string strategy = parameters["strategy"].as<std::string>();
+    if (strategy == "grid") {
+        STRATEGY = ParameterOptimizationTool::GRID_SEARCH;
+    }
+    else if (strategy == "halving") {
+        STRATEGY = ParameterOptimizationTool::SUCCESSIVE_HALVING;
+    }
+    else if (strategy == "coordinate") {
+        STRATEGY = ParameterOptimizationTool::COORDINATE_DESCENT;
+    }
+    else if (strategy == "random") {
+        STRATEGY = ParameterOptimizationTool::RANDOM_SEARCH;
+    }
+    else {
+        LOG(FATAL) << "Invalid search strategy: " << strategy << ".";
+    }
+    
+    registerAlgorithms();
         
     std::string algorithm = parameters["algorithm"].as<std::string>();
     std::transform(algorithm.begin(), algorithm.end(), algorithm.begin(), 
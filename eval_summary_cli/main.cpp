@@ -47,6 +47,7 @@
  *     --img-directory arg   image directory
  *     --gt-directory arg    ground truth directory
  *     --append-file arg     append file
+ *     --threads arg (=1)    number of threads to evaluate images with, 0 to use all cores
  *     --vis                 visualize results
  *     --help                produce help message
  * \endcode
@@ -60,6 +61,7 @@ int main(int argc, const char** argv) {
         ("img-directory", boost::program_options::value<std::string>(), "image directory")
         ("gt-directory", boost::program_options::value<std::string>(), "ground truth directory")
         ("append-file", boost::program_options::value<std::string>()->default_value(""), "append file")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of threads to evaluate images with, 0 to use all cores")
         ("vis", "visualize results")
         ("help", "produce help message");
 
@@ -110,6 +112,7 @@ int main(int argc, const char** argv) {
     EvaluationSummary summary(sp_directory, gt_directory, img_directory,
             metrics, statistics, visualizations);
     summary.setComputeCorrelation(true);
+    summary.setThreads(parameters["threads"].as<int>());
     
     boost::filesystem::path append_file(parameters["append-file"].as<std::string>());
     if (!append_file.empty()) {
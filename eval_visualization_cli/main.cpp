@@ -112,7 +112,7 @@ int main(int argc, const char** argv) {
     
     std::multimap<std::string, boost::filesystem::path> files;
     std::vector<std::string> extensions;
-    IOUtil::getCSVExtensions(extensions);
+    IOUtil::getLabelExtensions(extensions);
     std::vector<std::string> exclude;
     exclude.push_back("correlation");
     exclude.push_back("results");
@@ -127,7 +127,7 @@ int main(int argc, const char** argv) {
             it != files.end(); it++) {
         
         cv::Mat sp_segmentation;
-        IOUtil::readMatCSVInt(it->second, sp_segmentation);
+        IOUtil::readLabels(it->second, sp_segmentation);
         
         std::string filename = it->second.stem().string().substr(prefix.length(), 
                 it->second.stem().string().length() - prefix.length() + 1);
@@ -99,6 +99,9 @@ int main(int argc, char** argv) {
     float ue_np = Evaluation::computeNPUndersegmentationError(segmentation, groundTruth);
     float ue_levin = Evaluation::computeLevinUndersegmentationError(segmentation, groundTruth);
     float rec = Evaluation::computeBoundaryRecall(segmentation, groundTruth);
+    float rec_reference = Evaluation::computeBoundaryRecallReference(segmentation, groundTruth);
+    float pre = Evaluation::computeBoundaryPrecision(segmentation, groundTruth);
+    float pre_reference = Evaluation::computeBoundaryPrecisionReference(segmentation, groundTruth);
     float ev = Evaluation::computeExplainedVariation(segmentation, image);
     float icv = Evaluation::computeIntraClusterVariation(segmentation, image);
     float sse_rgb = Evaluation::computeSumOfSquaredErrorRGB(segmentation, image);
@@ -112,7 +115,8 @@ int main(int argc, char** argv) {
     std::cout << "Achievable Segmentation Accuracy (ASA): " << asa << std::endl;
     std::cout << "Undersegmentation Error of Neubert, Protzel (UE_NP): " << ue_np << std::endl;
     std::cout << "Undersegmentation Error of Levinshtein (UE_Levin): " << ue_levin << std::endl;
-    std::cout << "Boundary Recall (Rec): " << rec << std::endl;
+    std::cout << "Boundary Recall (Rec): " << rec << " (reference: " << rec_reference << ")" << std::endl;
+    std::cout << "Boundary Precision (Pre): " << pre << " (reference: " << pre_reference << ")" << std::endl;
     std::cout << "Explained Variation (EV): " << ev << std::endl;
     std::cout << "Intra-Cluster Variation (ICV): " << icv << std::endl;
     std::cout << "Sum-of-squared Error RGB (SSE_RGB): " << sse_rgb << std::endl;
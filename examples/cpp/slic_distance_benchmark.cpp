@@ -0,0 +1,143 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cfloat>
+#include <chrono>
+#include <random>
+#include "slic_distance.h"
+
+/** \brief Time one SLIC assignment step (all seeds, 2S x 2S windows) on a
+ * synthetic image using the given instruction set.
+ * \param[in] width width of the image
+ * \param[in] height height of the image
+ * \param[in] superpixels number of superpixels
+ * \param[in] instruction_set SCALAR, SSE or AVX2
+ * \param[in] repetitions number of assignment steps to average over
+ * \param[out] labels labels after the last step
+ * \return average time per assignment step in milliseconds
+ */
+double benchmark(int width, int height, int superpixels, int instruction_set,
+        int repetitions, std::vector<int> &labels) {
+    
+    int size = width*height;
+    std::vector<float> l(size), a(size), b(size);
+    
+    std::mt19937 generator(0);
+    std::uniform_real_distribution<float> distribution(0, 100);
+    for (int i = 0; i < size; ++i) {
+        l[i] = distribution(generator);
+        a[i] = distribution(generator) - 50;
+        b[i] = distribution(generator) - 50;
+    }
+    
+    int step = std::sqrt((float) size/superpixels) + 0.5;
+    std::vector<float> seedsx, seedsy;
+    for (int y = step/2; y < height; y += step) {
+        for (int x = step/2; x < width; x += step) {
+            seedsx.push_back(x);
+            seedsy.push_back(y);
+        }
+    }
+    
+    float invwt = 1.f/((step/10.f)*(step/10.f));
+    std::vector<float> distvec(size);
+    labels.assign(size, -1);
+    
+    std::chrono::high_resolution_clock::time_point start 
+            = std::chrono::high_resolution_clock::now();
+    
+    for (int r = 0; r < repetitions; ++r) {
+        distvec.assign(size, FLT_MAX);
+        
+        for (unsigned int n = 0; n < seedsx.size(); ++n) {
+            int y1 = std::max(0, (int) (seedsy[n] - step));
+            int y2 = std::min(height, (int) (seedsy[n] + step));
+            int x1 = std::max(0, (int) (seedsx[n] - step));
+            int x2 = std::min(width, (int) (seedsx[n] + step));
+            
+            int seed = (int) seedsy[n]*width + (int) seedsx[n];
+            for (int y = y1; y < y2; ++y) {
+                int i = y*width;
+                SLICDistance::assignRow(&l[i], &a[i], &b[i], x1, x2, y, 
+                        l[seed], a[seed], b[seed], seedsx[n], seedsy[n], 
+                        invwt, n, &distvec[i], &labels[i], instruction_set);
+            }
+        }
+    }
+    
+    std::chrono::high_resolution_clock::time_point end 
+            = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count()/repetitions;
+}
+
+/** \brief Microbenchmark of the SLIC distance kernel: compares the scalar, SSE
+ * and AVX2 variants per assignment step on BSDS500-sized (481x321) and
+ * 1920x1080 images and checks that all variants yield identical labels.
+ * Usage:
+ * $ ../bin/example_slic_distance_benchmark
+ * \author David Stutz
+ */
+int main(int argc, char** argv) {
+    
+    const int sizes[2][2] = {{481, 321}, {1920, 1080}};
+    const char* names[3] = {"scalar", "SSE", "AVX2"};
+    const int superpixels = 1200;
+    const int repetitions = 20;
+    
+    std::cout << "Detected instruction set: " 
+            << names[SLICDistance::getInstructionSet()] << std::endl;
+    
+    for (int s = 0; s < 2; ++s) {
+        std::vector<int> reference;
+        double reference_time = benchmark(sizes[s][0], sizes[s][1], superpixels, 
+                SLICDistance::SCALAR, repetitions, reference);
+        
+        std::cout << sizes[s][0] << "x" << sizes[s][1] << ":" << std::endl;
+        std::cout << "  " << names[0] << ": " << reference_time << "ms" << std::endl;
+        
+        for (int instruction_set = SLICDistance::SSE; 
+                instruction_set <= SLICDistance::getInstructionSet(); ++instruction_set) {
+            
+            std::vector<int> labels;
+            double time = benchmark(sizes[s][0], sizes[s][1], superpixels, 
+                    instruction_set, repetitions, labels);
+            
+            std::cout << "  " << names[instruction_set] << ": " << time << "ms (" 
+                    << reference_time/time << "x, labels " 
+                    << (labels == reference ? "identical" : "DIFFERENT") << ")" << std::endl;
+        }
+    }
+    
+    return 0;
+}
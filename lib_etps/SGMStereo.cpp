@@ -20,7 +20,12 @@
 #include <stack>
 #include <algorithm>
 #include <nmmintrin.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 #include <stdexcept>
+#include <thread>
+#include <vector>
 
 // Default parameters
 const int SGMSTEREO_DEFAULT_DISPARITY_TOTAL = 256;
@@ -32,6 +37,7 @@ const int SGMSTEREO_DEFAULT_AGGREGATION_WINDOW_RADIUS = 2;
 const int SGMSTEREO_DEFAULT_SMOOTHNESS_PENALTY_SMALL = 100;
 const int SGMSTEREO_DEFAULT_SMOOTHNESS_PENALTY_LARGE = 1600;
 const int SGMSTEREO_DEFAULT_CONSISTENCY_THRESHOLD = 1;
+const int SGMSTEREO_DEFAULT_THREAD_TOTAL = 1;
 
 
 SGMStereo::SGMStereo() : disparityTotal_(SGMSTEREO_DEFAULT_DISPARITY_TOTAL),
@@ -42,7 +48,8 @@ SGMStereo::SGMStereo() : disparityTotal_(SGMSTEREO_DEFAULT_DISPARITY_TOTAL),
 						 aggregationWindowRadius_(SGMSTEREO_DEFAULT_AGGREGATION_WINDOW_RADIUS),
 						 smoothnessPenaltySmall_(SGMSTEREO_DEFAULT_SMOOTHNESS_PENALTY_SMALL),
 						 smoothnessPenaltyLarge_(SGMSTEREO_DEFAULT_SMOOTHNESS_PENALTY_LARGE),
-						 consistencyThreshold_(SGMSTEREO_DEFAULT_CONSISTENCY_THRESHOLD) {}
+						 consistencyThreshold_(SGMSTEREO_DEFAULT_CONSISTENCY_THRESHOLD),
+						 threadTotal_(SGMSTEREO_DEFAULT_THREAD_TOTAL) {}
 
 void SGMStereo::setDisparityTotal(const int disparityTotal) {
 	if (disparityTotal <= 0 || disparityTotal%16 != 0) {
@@ -100,6 +107,13 @@ void SGMStereo::setConsistencyThreshold(const int consistencyThreshold) {
 	consistencyThreshold_ = consistencyThreshold;
 }
 
+void SGMStereo::setThreadTotal(const int threadTotal) {
+	if (threadTotal < 1) {
+		throw std::invalid_argument("[SGMStereo::setThreadTotal] the number of threads must be positive");
+	}
+	threadTotal_ = threadTotal;
+}
+
 void SGMStereo::compute(const png::image<png::rgb_pixel>& leftImage,
 						const png::image<png::rgb_pixel>& rightImage,
 						float* disparityImage)
@@ -152,17 +166,18 @@ void SGMStereo::allocateDataBuffer() {
 	rowAggregatedCost_ = reinterpret_cast<unsigned short*>(_mm_malloc(rowAggregatedCostBufferSize*sizeof(unsigned short), 16));
 	halfPixelRightMin_ = reinterpret_cast<unsigned char*>(_mm_malloc(halfPixelRightBufferSize*sizeof(unsigned char), 16));
 	halfPixelRightMax_ = reinterpret_cast<unsigned char*>(_mm_malloc(halfPixelRightBufferSize*sizeof(unsigned char), 16));
+	reversedRightCensusRow_ = reinterpret_cast<int*>(_mm_malloc(width_*sizeof(int), 16));
+
+	// Census codes have at most 25 bits, the weighted Hamming distances are looked up
+	for (int hammingDistance = 0; hammingDistance < 32; ++hammingDistance) {
+		censusWeightTable_[hammingDistance] = static_cast<unsigned char>(hammingDistance*censusWeightFactor_);
+	}
 
-	pathRowBufferTotal_ = 2;
 	disparitySize_ = disparityTotal_ + 16;
-	pathTotal_ = 8;
-	pathDisparitySize_ = pathTotal_*disparitySize_;
 
 	costSumBufferRowSize_ = width_*disparityTotal_;
 	costSumBufferSize_ = costSumBufferRowSize_*height_;
-	pathMinCostBufferSize_ = (width_ + 2)*pathTotal_;
-	pathCostBufferSize_ = pathMinCostBufferSize_*disparitySize_;
-	totalBufferSize_ = (pathMinCostBufferSize_ + pathCostBufferSize_)*pathRowBufferTotal_ + costSumBufferSize_ + 16;
+	totalBufferSize_ = costSumBufferSize_ + 16;
 
 	sgmBuffer_ = reinterpret_cast<short*>(_mm_malloc(totalBufferSize_*sizeof(short), 16));
 }
@@ -174,6 +189,7 @@ void SGMStereo::freeDataBuffer() {
 	_mm_free(rowAggregatedCost_);
 	_mm_free(halfPixelRightMin_);
 	_mm_free(halfPixelRightMax_);
+	_mm_free(reversedRightCensusRow_);
 	_mm_free(sgmBuffer_);
 }
 
@@ -448,7 +464,8 @@ void SGMStereo::calcPixelwiseSAD(const unsigned char* leftSobelRow, const unsign
 		__m128i registerLeftMinValue = _mm_set1_epi8(static_cast<char>(leftMinValue));
 		__m128i registerLeftMaxValue = _mm_set1_epi8(static_cast<char>(leftMaxValue));
 
-		for (int d = 0; d < x/16; d += 16) {
+		int d = 0;
+		for (; d + 15 <= x; d += 16) {
 			__m128i registerRightCenterValue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rightSobelRow + width_ - 1 - x + d));
 			__m128i registerRightMinValue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(halfPixelRightMin_ + width_ - 1 - x + d));
 			__m128i registerRightMaxValue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(halfPixelRightMax_ + width_ - 1 - x + d));
@@ -461,7 +478,7 @@ void SGMStereo::calcPixelwiseSAD(const unsigned char* leftSobelRow, const unsign
 
 			_mm_store_si128(reinterpret_cast<__m128i*>(pixelwiseCostRow_ + disparityTotal_*x + d), registerCost);
 		}
-		for (int d = x/16; d <= x; ++d) {
+		for (; d <= x; ++d) {
 			int rightCenterValue = rightSobelRow[width_ - 1 - x + d];
 			int rightMinValue = halfPixelRightMin_[width_ - 1 - x + d];
 			int rightMaxValue = halfPixelRightMax_[width_ - 1 - x + d];
@@ -536,196 +553,239 @@ void SGMStereo::addPixelwiseHamming(const int* leftCensusRow, const int* rightCe
 			pixelwiseCostRow_[disparityTotal_*x + d] += hammingDistance;
 		}
 	}
-	for (int x = disparityTotal_; x < width_; ++x) {
-		int leftCencusCode = leftCensusRow[x];
-		for (int d = 0; d < disparityTotal_; ++d) {
-			int rightCensusCode = rightCensusRow[x - d];
-			int hammingDistance = static_cast<int>(_mm_popcnt_u32(static_cast<unsigned int>(leftCencusCode^rightCensusCode)));
-			pixelwiseCostRow_[disparityTotal_*x + d] += static_cast<unsigned char>(hammingDistance*censusWeightFactor_);
-		}
+
+	// rightCensusRow[x - d] = reversedRightCensusRow_[width_ - 1 - x + d] is contiguous in d
+	for (int x = 0; x < width_; ++x) {
+		reversedRightCensusRow_[x] = rightCensusRow[width_ - 1 - x];
 	}
-}
 
-void SGMStereo::computeRightCostImage() {
-	const int widthStepCost = width_*disparityTotal_;
+	const __m128i registerNibbleMask = _mm_set1_epi8(0x0f);
+	const __m128i registerNibbleBitCount = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m128i registerOnes8 = _mm_set1_epi8(1);
+	const __m128i registerOnes16 = _mm_set1_epi16(1);
+	const __m128i registerFifteen = _mm_set1_epi8(15);
+	const __m128i registerWeightLow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(censusWeightTable_));
+	const __m128i registerWeightHigh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(censusWeightTable_ + 16));
 
-	for (int y = 0; y < height_; ++y) {
-		unsigned short* leftCostRow = leftCostImage_ + widthStepCost*y;
-		unsigned short* rightCostRow = rightCostImage_ + widthStepCost*y;
-
-		for (int x = 0; x < disparityTotal_; ++x) {
-			unsigned short* leftCostPointer = leftCostRow + disparityTotal_*x;
-			unsigned short* rightCostPointer = rightCostRow + disparityTotal_*x;
-			for (int d = 0; d <= x; ++d) {
-				*(rightCostPointer) = *(leftCostPointer);
-				rightCostPointer -= disparityTotal_ - 1;
-				++leftCostPointer;
-			}
-		}
+	for (int x = disparityTotal_; x < width_; ++x) {
+		__m128i registerLeftCensusCode = _mm_set1_epi32(leftCensusRow[x]);
+		const int* rightCensusCodes = reversedRightCensusRow_ + width_ - 1 - x;
 
-		for (int x = disparityTotal_; x < width_; ++x) {
-			unsigned short* leftCostPointer = leftCostRow + disparityTotal_*x;
-			unsigned short* rightCostPointer = rightCostRow + disparityTotal_*x;
-			for (int d = 0; d < disparityTotal_; ++d) {
-				*(rightCostPointer) = *(leftCostPointer);
-				rightCostPointer -= disparityTotal_ - 1;
-				++leftCostPointer;
+		for (int d = 0; d < disparityTotal_; d += 16) {
+			__m128i registerHamming[4];
+			for (int i = 0; i < 4; ++i) {
+				__m128i registerXor = _mm_xor_si128(registerLeftCensusCode,
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(rightCensusCodes + d + 4*i)));
+				// Bit count per byte using a nibble table, then summed per 32 bit code
+				__m128i registerByteCount = _mm_add_epi8(
+					_mm_shuffle_epi8(registerNibbleBitCount, _mm_and_si128(registerXor, registerNibbleMask)),
+					_mm_shuffle_epi8(registerNibbleBitCount, _mm_and_si128(_mm_srli_epi16(registerXor, 4), registerNibbleMask)));
+				registerHamming[i] = _mm_madd_epi16(_mm_maddubs_epi16(registerByteCount, registerOnes8), registerOnes16);
 			}
-		}
+			__m128i registerHammingDistance = _mm_packus_epi16(_mm_packs_epi32(registerHamming[0], registerHamming[1]),
+															   _mm_packs_epi32(registerHamming[2], registerHamming[3]));
 
-		for (int x = width_ - disparityTotal_ + 1; x < width_; ++x) {
-			int maxDisparityIndex = width_ - x;
-			unsigned short lastValue = *(rightCostRow + disparityTotal_*x + maxDisparityIndex - 1);
+			__m128i registerHighMask = _mm_cmpgt_epi8(registerHammingDistance, registerFifteen);
+			__m128i registerWeightedDistance = _mm_or_si128(
+				_mm_andnot_si128(registerHighMask, _mm_shuffle_epi8(registerWeightLow, registerHammingDistance)),
+				_mm_and_si128(registerHighMask, _mm_shuffle_epi8(registerWeightHigh, registerHammingDistance)));
 
-			unsigned short* rightCostPointer = rightCostRow + disparityTotal_*x + maxDisparityIndex;
-			for (int d = maxDisparityIndex; d < disparityTotal_; ++d) {
-				*(rightCostPointer) = lastValue;
-				++rightCostPointer;
-			}
+			__m128i* pixelwiseCost = reinterpret_cast<__m128i*>(pixelwiseCostRow_ + disparityTotal_*x + d);
+			_mm_store_si128(pixelwiseCost, _mm_add_epi8(_mm_load_si128(pixelwiseCost), registerWeightedDistance));
 		}
 	}
 }
 
-void SGMStereo::performSGM(unsigned short* costImage, unsigned short* disparityImage) {
-	const short costMax = SHRT_MAX;
-
-	int widthStepCostImage = width_*disparityTotal_;
+void SGMStereo::computeRightCostImage() {
+	const int widthStepCost = width_*disparityTotal_;
 
-	short* costSums = sgmBuffer_;
-	memset(costSums, 0, costSumBufferSize_*sizeof(short));
-
-	short** pathCosts = new short*[pathRowBufferTotal_];
-	short** pathMinCosts = new short*[pathRowBufferTotal_];
-
-	const int processPassTotal = 2;
-	for (int processPassCount = 0; processPassCount < processPassTotal; ++processPassCount) {
-		int startX, endX, stepX;
-		int startY, endY, stepY;
-		if (processPassCount == 0) {
-			startX = 0; endX = width_; stepX = 1;
-			startY = 0; endY = height_; stepY = 1;
-		} else {
-			startX = width_ - 1; endX = -1; stepX = -1;
-			startY = height_ - 1; endY = -1; stepY = -1;
-		}
+	// Rows are independent; within a row, the right costs are written contiguously
+	// while reading the left costs along the diagonal x + d
+	runParallel(height_, [&](int startY, int endY) {
+		for (int y = startY; y < endY; ++y) {
+			const unsigned short* leftCostRow = leftCostImage_ + widthStepCost*y;
+			unsigned short* rightCostRow = rightCostImage_ + widthStepCost*y;
+
+			for (int x = 0; x < width_; ++x) {
+				const unsigned short* leftCostPointer = leftCostRow + disparityTotal_*x;
+				unsigned short* rightCostPointer = rightCostRow + disparityTotal_*x;
+
+				int maxDisparityIndex = std::min(disparityTotal_, width_ - x);
+				for (int d = 0; d < maxDisparityIndex; ++d) {
+					rightCostPointer[d] = *(leftCostPointer);
+					leftCostPointer += disparityTotal_ + 1;
+				}
 
-		for (int i = 0; i < pathRowBufferTotal_; ++i) {
-			pathCosts[i] = costSums + costSumBufferSize_ + pathCostBufferSize_*i + pathDisparitySize_ + 8;
-			memset(pathCosts[i] - pathDisparitySize_ - 8, 0, pathCostBufferSize_*sizeof(short));
-			pathMinCosts[i] = costSums + costSumBufferSize_ + pathCostBufferSize_*pathRowBufferTotal_
-				+ pathMinCostBufferSize_*i + pathTotal_*2;
-			memset(pathMinCosts[i] - pathTotal_, 0, pathMinCostBufferSize_*sizeof(short));
+				unsigned short lastValue = rightCostPointer[maxDisparityIndex - 1];
+				for (int d = maxDisparityIndex; d < disparityTotal_; ++d) {
+					rightCostPointer[d] = lastValue;
+				}
+			}
 		}
+	});
+}
 
-		for (int y = startY; y != endY; y += stepY) {
-			unsigned short* pixelCostRow = costImage + widthStepCostImage*y;
-			short* costSumRow = costSums + costSumBufferRowSize_*y;
+namespace {
 
-			memset(pathCosts[0] - pathDisparitySize_ - 8, 0, pathDisparitySize_*sizeof(short));
-			memset(pathCosts[0] + width_*pathDisparitySize_ - 8, 0, pathDisparitySize_*sizeof(short));
-			memset(pathMinCosts[0] - pathTotal_, 0, pathTotal_*sizeof(short));
-			memset(pathMinCosts[0] + width_*pathTotal_, 0, pathTotal_*sizeof(short));
+// Updates the costs of one path at one pixel from the path costs L' at the previous pixel,
+//   L(d) = C(d) + min(L'(d), L'(d-1) + P1, L'(d+1) + P1, min L' + P2) - (min L' + P2),
+// where L'(-1) = L'(disparityTotal) = SHRT_MAX. Adds L to the cost sums and returns min L.
+inline short updatePathCost(const short* previousPathCosts, const int previousPathMin,
+							const unsigned short* pixelCosts, const int disparityTotal,
+							const int smoothnessPenaltySmall, const int smoothnessPenaltyLarge,
+							short* pathCosts, short* costSums)
+{
+#ifdef __AVX2__
+	__m256i regPenaltySmall = _mm256_set1_epi16(static_cast<short>(smoothnessPenaltySmall));
+	__m256i regPathMin = _mm256_set1_epi16(static_cast<short>(previousPathMin + smoothnessPenaltyLarge));
+	__m256i regNewPathMin = _mm256_set1_epi16(SHRT_MAX);
+
+	for (int d = 0; d < disparityTotal; d += 16) {
+		__m256i regPathCost = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(previousPathCosts + d));
+		regPathCost = _mm256_min_epi16(regPathCost,
+									   _mm256_adds_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(previousPathCosts + d - 1)),
+									   regPenaltySmall));
+		regPathCost = _mm256_min_epi16(regPathCost,
+									   _mm256_adds_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(previousPathCosts + d + 1)),
+									   regPenaltySmall));
+
+		regPathCost = _mm256_min_epi16(regPathCost, regPathMin);
+		regPathCost = _mm256_adds_epi16(_mm256_subs_epi16(regPathCost, regPathMin),
+										_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixelCosts + d)));
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(pathCosts + d), regPathCost);
+		regNewPathMin = _mm256_min_epi16(regNewPathMin, regPathCost);
+
+		__m256i regCostSum = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(costSums + d));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(costSums + d), _mm256_adds_epi16(regCostSum, regPathCost));
+	}
 
-			for (int x = startX; x != endX; x += stepX) {
-				int pathMinX = x*pathTotal_;
-				int pathX = pathMinX*disparitySize_;
+	__m128i regMin = _mm_min_epi16(_mm256_castsi256_si128(regNewPathMin), _mm256_extracti128_si256(regNewPathMin, 1));
+#else
+	__m128i regPenaltySmall = _mm_set1_epi16(static_cast<short>(smoothnessPenaltySmall));
+	__m128i regPathMin = _mm_set1_epi16(static_cast<short>(previousPathMin + smoothnessPenaltyLarge));
+	__m128i regMin = _mm_set1_epi16(SHRT_MAX);
+
+	for (int d = 0; d < disparityTotal; d += 8) {
+		__m128i regPathCost = _mm_load_si128(reinterpret_cast<const __m128i*>(previousPathCosts + d));
+		regPathCost = _mm_min_epi16(regPathCost,
+									_mm_adds_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previousPathCosts + d - 1)),
+									regPenaltySmall));
+		regPathCost = _mm_min_epi16(regPathCost,
+									_mm_adds_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previousPathCosts + d + 1)),
+									regPenaltySmall));
+
+		regPathCost = _mm_min_epi16(regPathCost, regPathMin);
+		regPathCost = _mm_adds_epi16(_mm_subs_epi16(regPathCost, regPathMin),
+									 _mm_load_si128(reinterpret_cast<const __m128i*>(pixelCosts + d)));
+
+		_mm_store_si128(reinterpret_cast<__m128i*>(pathCosts + d), regPathCost);
+		regMin = _mm_min_epi16(regMin, regPathCost);
+
+		__m128i regCostSum = _mm_load_si128(reinterpret_cast<const __m128i*>(costSums + d));
+		_mm_store_si128(reinterpret_cast<__m128i*>(costSums + d), _mm_adds_epi16(regCostSum, regPathCost));
+	}
+#endif
 
-				int previousPathMin0 = pathMinCosts[0][pathMinX - stepX*pathTotal_] + smoothnessPenaltyLarge_;
-				int previousPathMin2 = pathMinCosts[1][pathMinX + 2] + smoothnessPenaltyLarge_;
+	regMin = _mm_min_epi16(regMin, _mm_srli_si128(regMin, 8));
+	regMin = _mm_min_epi16(regMin, _mm_srli_si128(regMin, 4));
+	regMin = _mm_min_epi16(regMin, _mm_srli_si128(regMin, 2));
+	return static_cast<short>(_mm_extract_epi16(regMin, 0));
+}
 
-				short* previousPathCosts0 = pathCosts[0] + pathX - stepX*pathDisparitySize_;
-				short* previousPathCosts2 = pathCosts[1] + pathX + disparitySize_*2;
+}
 
-				previousPathCosts0[-1] = previousPathCosts0[disparityTotal_] = costMax;
-				previousPathCosts2[-1] = previousPathCosts2[disparityTotal_] = costMax;
+void SGMStereo::performSGM(unsigned short* costImage, unsigned short* disparityImage) {
+	short* costSums = sgmBuffer_;
 
-				short* pathCostCurrent = pathCosts[0] + pathX;
-				const unsigned short* pixelCostCurrent = pixelCostRow + disparityTotal_*x;
-				short* costSumCurrent = costSumRow + disparityTotal_*x;
+	// Horizontal paths are independent between rows and vertical paths between columns,
+	// the disparities are selected once the last (vertical) path has been added
+	runParallel(height_, [&](int startY, int endY) {
+		aggregateHorizontalPaths(costImage, costSums, startY, endY);
+	});
+	runParallel(width_, [&](int startX, int endX) {
+		aggregateVerticalPaths(costImage, costSums, disparityImage, startX, endX);
+	});
 
-				__m128i regPenaltySmall = _mm_set1_epi16(static_cast<short>(smoothnessPenaltySmall_));
+	speckleFilter(100, static_cast<int>(2*disparityFactor_), disparityImage);
+}
 
-				__m128i regPathMin0, regPathMin2;
-				regPathMin0 = _mm_set1_epi16(static_cast<short>(previousPathMin0));
-				regPathMin2 = _mm_set1_epi16(static_cast<short>(previousPathMin2));
-				__m128i regNewPathMin = _mm_set1_epi16(costMax);
+void SGMStereo::aggregateHorizontalPaths(const unsigned short* costImage, short* costSums,
+										 const int startY, const int endY) const
+{
+	const short costMax = SHRT_MAX;
+	const int widthStepCostImage = width_*disparityTotal_;
 
-				for (int d = 0; d < disparityTotal_; d += 8) {
-					__m128i regPixelCost = _mm_load_si128(reinterpret_cast<const __m128i*>(pixelCostCurrent + d));
+	// Path costs at the previous and current pixel, padded with costMax at d = -1 and d = disparityTotal_
+	short* pathCostBuffer = reinterpret_cast<short*>(_mm_malloc(2*disparitySize_*sizeof(short), 32));
+	short* pathCosts[2] = { pathCostBuffer + 8, pathCostBuffer + disparitySize_ + 8 };
+	for (int i = 0; i < 2; ++i) {
+		pathCosts[i][-1] = pathCosts[i][disparityTotal_] = costMax;
+	}
 
-					__m128i regPathCost0, regPathCost2;
-					regPathCost0 = _mm_load_si128(reinterpret_cast<const __m128i*>(previousPathCosts0 + d));
-					regPathCost2 = _mm_load_si128(reinterpret_cast<const __m128i*>(previousPathCosts2 + d));
+	memset(costSums + costSumBufferRowSize_*startY, 0, costSumBufferRowSize_*(endY - startY)*sizeof(short));
 
-					regPathCost0 = _mm_min_epi16(regPathCost0,
-												 _mm_adds_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previousPathCosts0 + d - 1)),
-												 regPenaltySmall));
-					regPathCost0 = _mm_min_epi16(regPathCost0,
-												 _mm_adds_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previousPathCosts0 + d + 1)),
-												 regPenaltySmall));
-					regPathCost2 = _mm_min_epi16(regPathCost2,
-												 _mm_adds_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previousPathCosts2 + d - 1)),
-												 regPenaltySmall));
-					regPathCost2 = _mm_min_epi16(regPathCost2,
-												 _mm_adds_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previousPathCosts2 + d + 1)),
-												 regPenaltySmall));
+	for (int y = startY; y < endY; ++y) {
+		const unsigned short* pixelCostRow = costImage + widthStepCostImage*y;
+		short* costSumRow = costSums + costSumBufferRowSize_*y;
 
-					regPathCost0 = _mm_min_epi16(regPathCost0, regPathMin0);
-					regPathCost0 = _mm_adds_epi16(_mm_subs_epi16(regPathCost0, regPathMin0), regPixelCost);
-					regPathCost2 = _mm_min_epi16(regPathCost2, regPathMin2);
-					regPathCost2 = _mm_adds_epi16(_mm_subs_epi16(regPathCost2, regPathMin2), regPixelCost);
+		for (int stepX = 1; stepX >= -1; stepX -= 2) {
+			int startX = stepX > 0 ? 0 : width_ - 1;
+			int endX = stepX > 0 ? width_ : -1;
 
-					_mm_store_si128(reinterpret_cast<__m128i*>(pathCostCurrent + d), regPathCost0);
-					_mm_store_si128(reinterpret_cast<__m128i*>(pathCostCurrent + d + disparitySize_*2), regPathCost2);
+			memset(pathCosts[1], 0, disparityTotal_*sizeof(short));
+			int previousPathMin = 0;
 
-					__m128i regMin02 = _mm_min_epi16(_mm_unpacklo_epi16(regPathCost0, regPathCost2),
-													 _mm_unpackhi_epi16(regPathCost0, regPathCost2));
-					regMin02 = _mm_min_epi16(_mm_unpacklo_epi16(regMin02, regMin02),
-											 _mm_unpackhi_epi16(regMin02, regMin02));
-					regNewPathMin = _mm_min_epi16(regNewPathMin, regMin02);
+			for (int x = startX; x != endX; x += stepX) {
+				previousPathMin = updatePathCost(pathCosts[1], previousPathMin, pixelCostRow + disparityTotal_*x, disparityTotal_,
+												 smoothnessPenaltySmall_, smoothnessPenaltyLarge_,
+												 pathCosts[0], costSumRow + disparityTotal_*x);
+				std::swap(pathCosts[0], pathCosts[1]);
+			}
+		}
+	}
 
-					__m128i regCostSum = _mm_load_si128(reinterpret_cast<const __m128i*>(costSumCurrent + d));
+	_mm_free(pathCostBuffer);
+}
 
-					regCostSum = _mm_adds_epi16(regCostSum, regPathCost0);
-					regCostSum = _mm_adds_epi16(regCostSum, regPathCost2);
+void SGMStereo::aggregateVerticalPaths(const unsigned short* costImage, short* costSums, unsigned short* disparityImage,
+									   const int startX, const int endX) const
+{
+	const short costMax = SHRT_MAX;
+	const int widthStepCostImage = width_*disparityTotal_;
+	const int bandWidth = endX - startX;
+
+	// Path costs of the previous and current row of the band, padded as in aggregateHorizontalPaths
+	short* pathCostBuffer = reinterpret_cast<short*>(_mm_malloc(2*bandWidth*disparitySize_*sizeof(short), 32));
+	std::vector<short> pathMinCostBuffer(2*bandWidth);
+
+	for (int stepY = 1; stepY >= -1; stepY -= 2) {
+		int startY = stepY > 0 ? 0 : height_ - 1;
+		int endY = stepY > 0 ? height_ : -1;
+
+		short* pathCosts[2] = { pathCostBuffer + 8, pathCostBuffer + bandWidth*disparitySize_ + 8 };
+		short* pathMinCosts[2] = { &pathMinCostBuffer[0], &pathMinCostBuffer[bandWidth] };
+		memset(pathCostBuffer, 0, 2*bandWidth*disparitySize_*sizeof(short));
+		std::fill(pathMinCostBuffer.begin(), pathMinCostBuffer.end(), 0);
+		for (int i = 0; i < 2*bandWidth; ++i) {
+			pathCosts[0][disparitySize_*i - 1] = pathCosts[0][disparitySize_*i + disparityTotal_] = costMax;
+		}
 
-					_mm_store_si128(reinterpret_cast<__m128i*>(costSumCurrent + d), regCostSum);
-				}
+		for (int y = startY; y != endY; y += stepY) {
+			const unsigned short* pixelCostRow = costImage + widthStepCostImage*y;
+			short* costSumRow = costSums + costSumBufferRowSize_*y;
 
-				regNewPathMin = _mm_min_epi16(regNewPathMin, _mm_srli_si128(regNewPathMin, 8));
-				_mm_storel_epi64(reinterpret_cast<__m128i*>(&pathMinCosts[0][pathMinX]), regNewPathMin);
+			for (int x = startX; x < endX; ++x) {
+				int i = x - startX;
+				pathMinCosts[0][i] = updatePathCost(pathCosts[1] + disparitySize_*i, pathMinCosts[1][i],
+													pixelCostRow + disparityTotal_*x, disparityTotal_,
+													smoothnessPenaltySmall_, smoothnessPenaltyLarge_,
+													pathCosts[0] + disparitySize_*i, costSumRow + disparityTotal_*x);
 			}
 
-			if (processPassCount == processPassTotal - 1) {
-				unsigned short* disparityRow = disparityImage + width_*y;
-
-				for (int x = 0; x < width_; ++x) {
-					short* costSumCurrent = costSumRow + disparityTotal_*x;
-					int bestSumCost = costSumCurrent[0];
-					int bestDisparity = 0;
-					for (int d = 1; d < disparityTotal_; ++d) {
-						if (costSumCurrent[d] < bestSumCost) {
-							bestSumCost = costSumCurrent[d];
-							bestDisparity = d;
-						}
-					}
-
-					if (bestDisparity > 0 && bestDisparity < disparityTotal_ - 1) {
-						int centerCostValue = costSumCurrent[bestDisparity];
-						int leftCostValue = costSumCurrent[bestDisparity - 1];
-						int rightCostValue = costSumCurrent[bestDisparity + 1];
-						if (rightCostValue < leftCostValue) {
-							bestDisparity = static_cast<int>(bestDisparity*disparityFactor_
-															 + static_cast<double>(rightCostValue - leftCostValue)/(centerCostValue - leftCostValue)/2.0*disparityFactor_ + 0.5);
-						} else {
-							bestDisparity = static_cast<int>(bestDisparity*disparityFactor_
-															 + static_cast<double>(rightCostValue - leftCostValue)/(centerCostValue - rightCostValue)/2.0*disparityFactor_ + 0.5);
-						}
-					} else {
-						bestDisparity = static_cast<int>(bestDisparity*disparityFactor_);
-					}
-
-					disparityRow[x] = static_cast<unsigned short>(bestDisparity);
+			if (stepY < 0) {
+				for (int x = startX; x < endX; ++x) {
+					disparityImage[width_*y + x] = selectDisparity(costSumRow + disparityTotal_*x);
 				}
 			}
 
@@ -733,10 +793,64 @@ void SGMStereo::performSGM(unsigned short* costImage, unsigned short* disparityI
 			std::swap(pathMinCosts[0], pathMinCosts[1]);
 		}
 	}
-	delete[] pathCosts;
-	delete[] pathMinCosts;
 
-	speckleFilter(100, static_cast<int>(2*disparityFactor_), disparityImage);
+	_mm_free(pathCostBuffer);
+}
+
+unsigned short SGMStereo::selectDisparity(const short* costSumCurrent) const {
+	// Minimum cost sum first, then the smallest disparity attaining it
+	__m128i regMin = _mm_load_si128(reinterpret_cast<const __m128i*>(costSumCurrent));
+	for (int d = 8; d < disparityTotal_; d += 8) {
+		regMin = _mm_min_epi16(regMin, _mm_load_si128(reinterpret_cast<const __m128i*>(costSumCurrent + d)));
+	}
+	regMin = _mm_min_epi16(regMin, _mm_srli_si128(regMin, 8));
+	regMin = _mm_min_epi16(regMin, _mm_srli_si128(regMin, 4));
+	regMin = _mm_min_epi16(regMin, _mm_srli_si128(regMin, 2));
+	int bestSumCost = static_cast<short>(_mm_extract_epi16(regMin, 0));
+
+	regMin = _mm_set1_epi16(static_cast<short>(bestSumCost));
+	int bestDisparity = 0;
+	while (_mm_movemask_epi8(_mm_cmpeq_epi16(regMin,
+		_mm_load_si128(reinterpret_cast<const __m128i*>(costSumCurrent + bestDisparity)))) == 0) {
+		bestDisparity += 8;
+	}
+	while (costSumCurrent[bestDisparity] != bestSumCost) {
+		++bestDisparity;
+	}
+
+	if (bestDisparity > 0 && bestDisparity < disparityTotal_ - 1) {
+		int centerCostValue = costSumCurrent[bestDisparity];
+		int leftCostValue = costSumCurrent[bestDisparity - 1];
+		int rightCostValue = costSumCurrent[bestDisparity + 1];
+		if (rightCostValue < leftCostValue) {
+			bestDisparity = static_cast<int>(bestDisparity*disparityFactor_
+											 + static_cast<double>(rightCostValue - leftCostValue)/(centerCostValue - leftCostValue)/2.0*disparityFactor_ + 0.5);
+		} else {
+			bestDisparity = static_cast<int>(bestDisparity*disparityFactor_
+											 + static_cast<double>(rightCostValue - leftCostValue)/(centerCostValue - rightCostValue)/2.0*disparityFactor_ + 0.5);
+		}
+	} else {
+		bestDisparity = static_cast<int>(bestDisparity*disparityFactor_);
+	}
+
+	return static_cast<unsigned short>(bestDisparity);
+}
+
+void SGMStereo::runParallel(const int total, const std::function<void(int, int)>& function) const {
+	int bandTotal = std::min(threadTotal_, total);
+	if (bandTotal <= 1) {
+		function(0, total);
+		return;
+	}
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < bandTotal; ++i) {
+		threads.push_back(std::thread(function, total*i/bandTotal, total*(i + 1)/bandTotal));
+	}
+	function(0, total/bandTotal);
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
 }
 
 void SGMStereo::speckleFilter(const int maxSpeckleSize, const int maxDifference, unsigned short* image) const {
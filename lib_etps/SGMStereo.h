@@ -18,6 +18,7 @@
 #pragma once
 
 #include <png++/png.hpp>
+#include <functional>
 
 class SGMStereo {
 public:
@@ -31,6 +32,7 @@ public:
 							   const int aggregationWindowRadius);
 	void setSmoothnessCostParameters(const int smoothnessPenaltySmall, const int smoothnessPenaltyLarge);
 	void setConsistencyThreshold(const int consistencyThreshold);
+	void setThreadTotal(const int threadTotal);
 
 	void compute(const png::image<png::rgb_pixel>& leftImage,
 				 const png::image<png::rgb_pixel>& rightImage,
@@ -60,6 +62,11 @@ private:
 	void addPixelwiseHamming(const int* leftCensusRow, const int* rightCensusRow);
 	void computeRightCostImage();
 	void performSGM(unsigned short* costImage, unsigned short* disparityImage);
+	void aggregateHorizontalPaths(const unsigned short* costImage, short* costSums, const int startY, const int endY) const;
+	void aggregateVerticalPaths(const unsigned short* costImage, short* costSums, unsigned short* disparityImage,
+								const int startX, const int endX) const;
+	unsigned short selectDisparity(const short* costSumCurrent) const;
+	void runParallel(const int total, const std::function<void(int, int)>& function) const;
 	void speckleFilter(const int maxSpeckleSize, const int maxDifference, unsigned short* image) const;
 	void enforceLeftRightConsistency(unsigned short* leftDisparityImage, unsigned short* rightDisparityImage) const;
 
@@ -74,6 +81,7 @@ private:
 	int smoothnessPenaltySmall_;
 	int smoothnessPenaltyLarge_;
 	int consistencyThreshold_;
+	int threadTotal_;
 
 	// Data
 	int width_;
@@ -85,14 +93,11 @@ private:
 	unsigned short* rowAggregatedCost_;
 	unsigned char* halfPixelRightMin_;
 	unsigned char* halfPixelRightMax_;
-	int pathRowBufferTotal_;
+	int* reversedRightCensusRow_;
+	unsigned char censusWeightTable_[32];
 	int disparitySize_;
-	int pathTotal_;
-	int pathDisparitySize_;
 	int costSumBufferRowSize_;
 	int costSumBufferSize_;
-	int pathMinCostBufferSize_;
-	int pathCostBufferSize_;
 	int totalBufferSize_;
 	short* sgmBuffer_;
 };
@@ -29,6 +29,9 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <fstream>
+#include <stdexcept>
+#include <thread>
 #include "stdafx.h"
 #include "segengine.h"
 #include "functions.h"
@@ -36,8 +39,10 @@
 #include "SGMStereo.h"
 #include "etps_opencv.h"
 
-void ETPS_OpenCV::computeSuperpixels(const cv::Mat &image, int region_size, 
-        double regularization_weight, double length_weight, double size_weight, int iterations, cv::Mat &labels) {
+/** \brief Parameters shared by the monocular and the stereo wrapper.
+ */
+static SPSegmentationParameters getParameters(int region_size, double regularization_weight, 
+        double length_weight, double size_weight, int iterations, int threads, bool stereo) {
     
     SPSegmentationParameters params;
     params.superpixelNum = 0; // Do not set both superpixelNum and gridSize to greater zero!
@@ -63,8 +68,8 @@ void ETPS_OpenCV::computeSuperpixels(const cv::Mat &image, int region_size,
     params.maxPixelSize = 16;
     params.reSteps = 10;
     params.instantBoundary = false;
-    params.stereo = false;
-    params.computeSGM = false;
+    params.stereo = stereo;
+    params.computeSGM = stereo;
     params.batchProcessing = true;
     params.inpaint = false;
     params.debugOutput = false;
@@ -72,11 +77,169 @@ void ETPS_OpenCV::computeSuperpixels(const cv::Mat &image, int region_size,
     
     time_t  timev;
     params.randomSeed = time(&timev);
+    params.threads = threads;
     
-    SPSegmentationEngine engine(params, image);
-    engine.ProcessImage();
+    return params;
+}
 
+/** \brief Labels and performance information of a processed engine.
+ */
+static ETPS_OpenCV::PerformanceInfo getResults(SPSegmentationEngine &engine, cv::Mat &labels) {
+    
     // Returns unsigned short!
     labels = engine.GetSegmentation();
     labels.convertTo(labels, CV_32S);
+    
+    const SPSegmentationEngine::PerformanceInfo &engine_info = engine.GetPerformanceInfo();
+    
+    ETPS_OpenCV::PerformanceInfo info;
+    info.sgm = 0;
+    info.init = engine_info.init;
+    info.imgproc = engine_info.imgproc;
+    info.total = engine_info.total;
+    info.level_max_pixel_size = engine_info.levelMaxPixelSize;
+    info.level_time = engine_info.levelTimes;
+    info.level_iterations = engine_info.levelIterations;
+    info.level_moves_tried = engine_info.levelMovesTried;
+    info.level_moves_accepted = engine_info.levelMovesAccepted;
+    info.level_moves_rejected = engine_info.levelMovesRejected;
+    info.level_queue_initial = engine_info.levelQueueInitial;
+    info.level_queue_max = engine_info.levelQueueMax;
+    
+    return info;
+}
+
+ETPS_OpenCV::PerformanceInfo ETPS_OpenCV::computeSuperpixels(const cv::Mat &image, int region_size, 
+        double regularization_weight, double length_weight, double size_weight, int iterations, cv::Mat &labels,
+        int threads) {
+    
+    SPSegmentationParameters params = getParameters(region_size, regularization_weight, 
+            length_weight, size_weight, iterations, threads, false);
+    
+    // Pixels, superpixels and queues reuse the memory of previous images 
+    // processed by this thread (e.g. in batch processing)
+    static thread_local SPSegmentationArena arena;
+    
+    SPSegmentationEngine engine(params, image, cv::Mat(), &arena);
+    engine.ProcessImage();
+    
+    return getResults(engine, labels);
+}
+
+ETPS_OpenCV::PerformanceInfo ETPS_OpenCV::computeSuperpixelsStereo(const cv::Mat &left_image, 
+        const cv::Mat &right_image, int region_size, double regularization_weight, 
+        double length_weight, double size_weight, int iterations, cv::Mat &labels, 
+        int threads) {
+    
+    SPSegmentationParameters params = getParameters(region_size, regularization_weight, 
+            length_weight, size_weight, iterations, threads, true);
+    
+    Timer t;
+    cv::Mat disparity;
+    computeDisparity(left_image, right_image, disparity, threads);
+    t.Stop();
+    
+    static thread_local SPSegmentationArena arena;
+    
+    SPSegmentationEngine engine(params, left_image, disparity, &arena);
+    engine.ProcessImageStereo();
+    
+    PerformanceInfo info = getResults(engine, labels);
+    info.sgm = t.GetTimeInSec();
+    
+    return info;
+}
+
+void ETPS_OpenCV::computeDisparity(const cv::Mat &left_image, const cv::Mat &right_image, 
+        cv::Mat &disparity, int threads) {
+    
+    if (left_image.rows != right_image.rows || left_image.cols != right_image.cols) {
+        throw std::invalid_argument("[ETPS_OpenCV::computeDisparity] sizes of left and right images are different");
+    }
+    
+    // SGMStereo takes RGB images, the images are BGR
+    png::image<png::rgb_pixel> left_png(left_image.cols, left_image.rows);
+    png::image<png::rgb_pixel> right_png(right_image.cols, right_image.rows);
+    for (int i = 0; i < left_image.rows; ++i) {
+        for (int j = 0; j < left_image.cols; ++j) {
+            const cv::Vec3b &left_bgr = left_image.at<cv::Vec3b>(i, j);
+            const cv::Vec3b &right_bgr = right_image.at<cv::Vec3b>(i, j);
+            left_png.set_pixel(j, i, png::rgb_pixel(left_bgr[2], left_bgr[1], left_bgr[0]));
+            right_png.set_pixel(j, i, png::rgb_pixel(right_bgr[2], right_bgr[1], right_bgr[0]));
+        }
+    }
+    
+    if (threads <= 0) {
+        threads = std::max(1, (int) std::thread::hardware_concurrency());
+    }
+    
+    std::vector<float> disparity_float(left_image.rows*left_image.cols);
+    
+    SGMStereo sgm;
+    sgm.setThreadTotal(threads);
+    sgm.compute(left_png, right_png, disparity_float.data());
+    
+    // Same encoding as disparity files, i.e. 16 bit with disparity*256
+    disparity.create(left_image.rows, left_image.cols, CV_16U);
+    for (int i = 0; i < disparity.rows; ++i) {
+        for (int j = 0; j < disparity.cols; ++j) {
+            disparity.at<unsigned short>(i, j) = (unsigned short) (disparity_float[disparity.cols*i + j]*256.0f + 0.5);
+        }
+    }
+}
+
+template<typename T>
+static void writeJSONArray(std::ofstream &out, const std::string &name, const std::vector<T> &values) {
+    out << "    \"" << name << "\": [";
+    for (unsigned int i = 0; i < values.size(); ++i) {
+        out << (i > 0 ? ", " : "") << values[i];
+    }
+    out << "]";
+}
+
+bool ETPS_OpenCV::writePerformanceInfo(const PerformanceInfo &info, const std::string &file) {
+    
+    std::ofstream out(file.c_str());
+    if (!out.is_open()) {
+        return false;
+    }
+    
+    bool csv = file.size() >= 4 && file.compare(file.size() - 4, 4, ".csv") == 0;
+    if (csv) {
+        out << "level,max_pixel_size,time,iterations,moves_tried,moves_accepted,"
+                << "moves_rejected,queue_initial,queue_max" << std::endl;
+        
+        for (unsigned int l = 0; l < info.level_time.size(); ++l) {
+            out << l << "," << info.level_max_pixel_size[l] << "," << info.level_time[l] 
+                    << "," << info.level_iterations[l] << "," << info.level_moves_tried[l] 
+                    << "," << info.level_moves_accepted[l] << "," << info.level_moves_rejected[l] 
+                    << "," << info.level_queue_initial[l] << "," << info.level_queue_max[l] 
+                    << std::endl;
+        }
+    }
+    else {
+        out << "{" << std::endl;
+        out << "    \"sgm\": " << info.sgm << "," << std::endl;
+        out << "    \"init\": " << info.init << "," << std::endl;
+        out << "    \"imgproc\": " << info.imgproc << "," << std::endl;
+        out << "    \"total\": " << info.total << "," << std::endl;
+        writeJSONArray(out, "level_max_pixel_size", info.level_max_pixel_size);
+        out << "," << std::endl;
+        writeJSONArray(out, "level_time", info.level_time);
+        out << "," << std::endl;
+        writeJSONArray(out, "level_iterations", info.level_iterations);
+        out << "," << std::endl;
+        writeJSONArray(out, "level_moves_tried", info.level_moves_tried);
+        out << "," << std::endl;
+        writeJSONArray(out, "level_moves_accepted", info.level_moves_accepted);
+        out << "," << std::endl;
+        writeJSONArray(out, "level_moves_rejected", info.level_moves_rejected);
+        out << "," << std::endl;
+        writeJSONArray(out, "level_queue_initial", info.level_queue_initial);
+        out << "," << std::endl;
+        writeJSONArray(out, "level_queue_max", info.level_queue_max);
+        out << std::endl << "}" << std::endl;
+    }
+    
+    return true;
 }
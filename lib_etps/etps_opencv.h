@@ -32,11 +32,47 @@
 #ifndef ETPS_OPENCV_H
 #define	ETPS_OPENCV_H
 
+#include <vector>
+#include <string>
+#include <opencv2/opencv.hpp>
+
 /** \brief Wrapper for running ETPS on OpenCV images.
  * \author David Stutz
  */
 class ETPS_OpenCV {
 public:
+    /** \brief Timing and move statistics of one run; times are in seconds
+     * (wall clock) and the level vectors have one entry per level, from large 
+     * to small pixel blocks. Moves are summed, queue lengths maximized over 
+     * the iterations of a level.
+     */
+    struct PerformanceInfo {
+        /** \brief Time of the SGM disparity computation, zero without stereo. */
+        double sgm;
+        /** \brief Time of the initialization. */
+        double init;
+        /** \brief Time of all levels. */
+        double imgproc;
+        /** \brief Total time. */
+        double total;
+        /** \brief Maximum size of pixel blocks. */
+        std::vector<int> level_max_pixel_size;
+        /** \brief Time of each level. */
+        std::vector<double> level_time;
+        /** \brief Maximum number of pixel blocks popped from the queue in one iteration. */
+        std::vector<int> level_iterations;
+        /** \brief Number of moves evaluated. */
+        std::vector<int> level_moves_tried;
+        /** \brief Number of pixel blocks moved to another superpixel. */
+        std::vector<int> level_moves_accepted;
+        /** \brief Number of pixel blocks popped but not moved. */
+        std::vector<int> level_moves_rejected;
+        /** \brief Number of boundary pixel blocks queued at the start of an iteration. */
+        std::vector<int> level_queue_initial;
+        /** \brief Maximum length of the queue. */
+        std::vector<int> level_queue_max;
+    };
+    
     /** \brief Compute superpixels using ETPS.
      * \param[in] image image to compute superpixels on
      * \param[in] region_size step size between superpixel centers, implicitly defining the number of superpixels
@@ -44,10 +80,48 @@ public:
      * \param[in] size_weight size weight
      * \param[in] iterations number of iterations
      * \param[out] labels superpixel labels
+     * \param[in] threads number of threads moving boundary pixels, 0 for all cores; with more than one thread the result depends on scheduling
+     * \return timing and move statistics
      */
-    static void computeSuperpixels(const cv::Mat &image, int region_size,
+    static PerformanceInfo computeSuperpixels(const cv::Mat &image, int region_size,
             double regularization_weight, double length_weight, 
-            double size_weight, int iterations, cv::Mat &labels);
+            double size_weight, int iterations, cv::Mat &labels, 
+            int threads = 1);
+    
+    /** \brief Compute depth-aware superpixels using ETPS on a rectified stereo pair;
+     * the disparity of the left image is computed using SGM.
+     * \param[in] left_image left image to compute superpixels on
+     * \param[in] right_image right image of the same size
+     * \param[in] region_size step size between superpixel centers, implicitly defining the number of superpixels
+     * \param[in] regularization_weight compactness parameter,
+     * \param[in] size_weight size weight
+     * \param[in] iterations number of iterations
+     * \param[out] labels superpixel labels
+     * \param[in] threads number of threads used by SGM, 0 for all cores
+     * \return timing and move statistics
+     */
+    static PerformanceInfo computeSuperpixelsStereo(const cv::Mat &left_image, 
+            const cv::Mat &right_image, int region_size, 
+            double regularization_weight, double length_weight, 
+            double size_weight, int iterations, cv::Mat &labels, 
+            int threads = 1);
+    
+    /** \brief Compute the disparity of the left image using SGM.
+     * \param[in] left_image left image
+     * \param[in] right_image right image of the same size
+     * \param[out] disparity 16 bit disparity image, disparity times 256 and 0 where invalid
+     * \param[in] threads number of threads, 0 for all cores
+     */
+    static void computeDisparity(const cv::Mat &left_image, const cv::Mat &right_image, 
+            cv::Mat &disparity, int threads = 1);
+    
+    /** \brief Write performance information as JSON or CSV (one row per level),
+     * depending on the extension of the file.
+     * \param[in] info performance information
+     * \param[in] file .json or .csv file
+     * \return success
+     */
+    static bool writePerformanceInfo(const PerformanceInfo &info, const std::string &file);
 };
 
 #endif	/* ETPS_OPENCV_H */
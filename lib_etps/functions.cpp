@@ -158,7 +158,7 @@ static ConnectivityCache connectivityCache;
 
 ostream& operator<<(ostream& os, const Timer& t)
 {
-    os << ((double)(t.time) / CLOCKS_PER_SEC);
+    os << chrono::duration<double>(t.time).count();
     return os;
 }
 
@@ -269,8 +269,8 @@ void MovePixelStereo(Matrix<Pixel>& pixelsImg, PixelMoveData& pmd, bool changeBo
     MovePixel(pixelsImg, pmd);
 
     if (changeBoundary) {
-        SuperpixelStereo* sp = (SuperpixelStereo*)pmd.p->superPixel;
-        SuperpixelStereo* sq = (SuperpixelStereo*)pmd.q->superPixel;
+        SuperpixelStereo* sp = (SuperpixelStereo*)pmd.p->superPixel.Load();
+        SuperpixelStereo* sq = (SuperpixelStereo*)pmd.q->superPixel.Load();
 
         // Update boundary
         std::swap(sp->boundaryData, pmd.bDataP);
@@ -602,6 +602,7 @@ bool LeastSquaresPlaneDebug(const double x1, const double y1, const double z1, c
     } else {
         plane.z = (d3 - plane.x * x3 - plane.y * y3) / z3;
     }
+    return true;
 }
 
 
@@ -2,50 +2,51 @@
 
 #include "stdafx.h"
 #include "structures.h"
+#include <chrono>
 
+// Measures elapsed (wall clock) time; CPU time would add up the time of all
+// threads used by the parallel iterations
 class Timer {
 private:
-    clock_t startTime, time;
+    typedef chrono::steady_clock Clock;
+
+    Clock::time_point startTime;
+    Clock::duration time;
     bool running;
 public:
     Timer(bool run = true)
     { 
         if (run) Reset();
         else {
-            startTime = time = 0;
+            time = Clock::duration::zero();
             running = false;
         }
     }
 
     void Reset() 
     { 
-        time = 0;
-        startTime = clock();
+        time = Clock::duration::zero();
+        startTime = Clock::now();
         running = true;
     }
 
     void Stop() 
     { 
         if (running) {
-            time += clock() - startTime;
+            time += Clock::now() - startTime;
             running = false;
         }
     }
 
     void Resume()
     {
-        startTime = clock();
+        startTime = Clock::now();
         running = true;
     }
 
-    clock_t GetTime()
-    {
-        return time;
-    }
-
     double GetTimeInSec()
     {
-        return (double)time / CLOCKS_PER_SEC;
+        return chrono::duration<double>(time).count();
     }
 
     friend ostream& operator<<(ostream& os, const Timer& t);
@@ -58,7 +58,7 @@ void UpdateHingeBoundaryData(const Pixel* r, byte sideFlag, const Pixel* sideP,
 {
     if (r == nullptr || sideP == nullptr) return;
 
-    SuperpixelStereo* sr = (SuperpixelStereo*)r->superPixel;
+    SuperpixelStereo* sr = (SuperpixelStereo*)r->superPixel.Load();
     double sum = 0;
     int count = 0;
     int length = 0;
@@ -122,8 +122,8 @@ void CalcBorderChangeDataStereo(const Matrix<Pixel>& pixelsImg, const cv::Mat1d&
     const SPSegmentationParameters& params, Pixel* p, Pixel* q, BorderDataMap& bcdp, BorderDataMap& bcdq, unordered_set<SuperpixelStereo*>& prem)
 {
     // Move p from sp -> sq
-    SuperpixelStereo* sp = (SuperpixelStereo*)p->superPixel;
-    SuperpixelStereo* sq = (SuperpixelStereo*)q->superPixel;
+    SuperpixelStereo* sp = (SuperpixelStereo*)p->superPixel.Load();
+    SuperpixelStereo* sq = (SuperpixelStereo*)q->superPixel.Load();
     const Pixel* r;
     unordered_set<SuperpixelStereo*> nbsps;    // Neighbors of p (other than sp and sq), make something more lightwight
 
@@ -272,6 +272,7 @@ void SPSegmentationParameters::SetLevelParams(int level)
         PRINT_PARAM(maxPixelSize);
         PRINT_PARAM(updateThreshold);
         PRINT_PARAM(debugOutput);
+        PRINT_PARAM(threads);
         cout << "---------------------------" << endl;
     }
 }
@@ -296,8 +297,10 @@ void UpdateFromNode(bool& val, const FileNode& node)
 ///////////////////////////////////////////////////////////////////////////////
 
 
-SPSegmentationEngine::SPSegmentationEngine(SPSegmentationParameters params, Mat im, Mat depthIm) :
-    params(params), origImg(im)
+SPSegmentationEngine::SPSegmentationEngine(SPSegmentationParameters params, Mat im, Mat depthIm, 
+        SPSegmentationArena* arenaPtr) :
+    params(params), origImg(im), arena(arenaPtr != nullptr ? *arenaPtr : ownArena),
+    superpixels(arena.superpixels)
 {
     planeSmoothWeight = 1;   // Calculated from params in initialization
     planeSmoothWeightCo = 0.1;
@@ -335,7 +338,7 @@ void calcPixelSizes(int actualGridSize, int maxPixelSize,
     minN = actualDiv - maxN;
 }
 
-void SPSegmentationEngine::Initialize(Superpixel* spGenerator(int))
+void SPSegmentationEngine::Initialize(bool stereo)
 {
     int imageSize = img.rows * img.cols;
     if (params.superpixelNum <= 0 && params.gridSize <= 0) {
@@ -396,7 +399,7 @@ void SPSegmentationEngine::Initialize(Superpixel* spGenerator(int))
     }
 
     // Initialize 'pixels', 'pixelsImg'
-    pixelsImg = Matrix<Pixel>(imgPixelsRows, imgPixelsCols);
+    pixelsImg = arena.pixels.Get(imgPixelsRows, imgPixelsCols);
 
     int i0, j0;
 
@@ -417,8 +420,26 @@ void SPSegmentationEngine::Initialize(Superpixel* spGenerator(int))
     PixelData pd;
     int superPixelIdCount = 0;
 
-    superpixels.clear();
-    superpixels.reserve(imgSPixelsCols*imgSPixelsRows);
+    // Superpixels are kept in one contiguous array (of the actual type), so
+    // that energy updates of neighboring superpixels touch nearby memory
+    int spCount = imgSPixelsCols*imgSPixelsRows;
+
+    Reset();
+    superpixels.reserve(spCount);
+    if (stereo) {
+        arena.superpixelStereoStore.reserve(spCount);
+        for (int id = 0; id < spCount; id++) {
+            arena.superpixelStereoStore.emplace_back(id);
+            superpixels.push_back(&arena.superpixelStereoStore.back());
+        }
+    } else {
+        arena.superpixelStore.reserve(spCount);
+        for (int id = 0; id < spCount; id++) {
+            arena.superpixelStore.emplace_back(id);
+            superpixels.push_back(&arena.superpixelStore.back());
+        }
+    }
+
     i0 = 0;
     for (int pi = 0; pi < imgSPixelsRows; pi++) {
         int i1 = i0 + rowSDims[pi];
@@ -426,7 +447,7 @@ void SPSegmentationEngine::Initialize(Superpixel* spGenerator(int))
         j0 = 0;
         for (int pj = 0; pj < imgSPixelsCols; pj++) {
             int j1 = j0 + colSDims[pj];
-            Superpixel* sp = spGenerator(superPixelIdCount++); // Superpixel();
+            Superpixel* sp = superpixels[superPixelIdCount++];
 
             // Update superpixels pointers in each pixel
             for (int i = i0; i < i1; i++) {
@@ -451,8 +472,6 @@ void SPSegmentationEngine::Initialize(Superpixel* spGenerator(int))
                 spCSize += pixelsImg(i0, j).GetCSize();
             }
             sp->SetBorderLength(2 * spRSize + 2 * spCSize);
-            superpixels.push_back(sp);
-
             j0 = j1;
         }
         i0 = i1;
@@ -462,7 +481,7 @@ void SPSegmentationEngine::Initialize(Superpixel* spGenerator(int))
 
 void SPSegmentationEngine::InitializeStereo()
 {
-    Initialize([](int id) -> Superpixel* { return new SuperpixelStereo(id); });
+    Initialize(true);
     InitializePPImage();
     EstimatePlaneParameters();
     InitializeStereoEnergies();
@@ -477,7 +496,7 @@ void SPSegmentationEngine::InitializeStereo()
 
 void SPSegmentationEngine::InitializePPImage()
 {
-    ppImg = Matrix<Pixel*>(img.rows, img.cols);
+    ppImg = arena.ppImg.Get(img.rows, img.cols);
     UpdatePPImage();
 }
 
@@ -491,16 +510,14 @@ void SPSegmentationEngine::UpdatePPImage()
 
 void SPSegmentationEngine::Reset()
 {
-    for (Superpixel* sp : superpixels) {
-        delete sp;
-    }
+    arena.Clear();
 }
 
 void SPSegmentationEngine::ProcessImage()
 {
     Timer t0;
 
-    Initialize([](int id) { return new Superpixel(id); });
+    Initialize(false);
 
     t0.Stop();
     performanceInfo.init = t0.GetTimeInSec();
@@ -514,12 +531,11 @@ void SPSegmentationEngine::ProcessImage()
     do {
         Timer t2;
 
-        performanceInfo.levelMaxPixelSize.push_back(maxPixelSize);
-        performanceInfo.levelIterations.push_back(0);
+        performanceInfo.AddLevel(maxPixelSize);
         for (int iteration = 0; iteration < params.iterations; iteration++) {
-            int iters = IterateMoves(level);
-            if (iters > performanceInfo.levelIterations.back())
-                performanceInfo.levelIterations.back() = iters;
+            MoveStats stats;
+            int iters = IterateMoves(level, stats);
+            performanceInfo.AddIteration(iters, stats);
         }
         if (maxPixelSize <= params.minPixelSize) splitted = false;
         else splitted = SplitPixels(maxPixelSize);
@@ -553,12 +569,11 @@ void SPSegmentationEngine::ProcessImageStereo()
     do {
         Timer t2;
 
-        performanceInfo.levelMaxPixelSize.push_back(maxPixelSize);
-        performanceInfo.levelIterations.push_back(0);
+        performanceInfo.AddLevel(maxPixelSize);
         for (int iteration = 0; iteration < params.iterations; iteration++) {
-            int iters = IterateMoves(level);
-            if (iters > performanceInfo.levelIterations.back())
-                performanceInfo.levelIterations.back() = iters;
+            MoveStats stats;
+            int iters = IterateMoves(level, stats);
+            performanceInfo.AddIteration(iters, stats);
             ReEstimatePlaneParameters();
         }
         if (maxPixelSize <= params.minPixelSize) splitted = false;
@@ -672,7 +687,7 @@ void SPSegmentationEngine::UpdateStereoSums()
     for (int i = 0; i < ppImg.rows; i++) {
         for (int j = 0; j < ppImg.cols; j++) {
             Pixel* p = ppImg(i, j);
-            SuperpixelStereo* sps = (SuperpixelStereo*)p->superPixel;
+            SuperpixelStereo* sps = (SuperpixelStereo*)p->superPixel.Load();
             const double& disp = depthImg(i, j);
 
             if (disp > 0) {
@@ -704,7 +719,7 @@ void SPSegmentationEngine::UpdateDispSums()
     for (int i = 0; i < ppImg.rows; i++) {
         for (int j = 0; j < ppImg.cols; j++) {
             Pixel* p = ppImg(i, j);
-            SuperpixelStereo* sps = (SuperpixelStereo*)p->superPixel;
+            SuperpixelStereo* sps = (SuperpixelStereo*)p->superPixel.Load();
             const double& disp = depthImg(i, j);
 
             if (disp > 0) {
@@ -732,13 +747,13 @@ void SPSegmentationEngine::UpdateBoundaryData()
 
     // update length & hiSum (written to smoSum)
     for (Pixel& p : pixelsImg) {
-        SuperpixelStereo* sp = (SuperpixelStereo*)p.superPixel;
+        SuperpixelStereo* sp = (SuperpixelStereo*)p.superPixel.Load();
 
         for (int dir = 0; dir < 2; dir++) {
             Pixel* q = PixelAt(pixelsImg, p.row + directions[dir][0], p.col + directions[dir][1]);
 
             if (q != nullptr) {
-                SuperpixelStereo* sq = (SuperpixelStereo*)q->superPixel;
+                SuperpixelStereo* sq = (SuperpixelStereo*)q->superPixel.Load();
 
                 if (q->superPixel != sp) {
                     BInfo& bdpq = sp->boundaryData[sq];
@@ -811,13 +826,13 @@ void SPSegmentationEngine::UpdateBoundaryData2()
 
     // update length & hiSum (written to smoSum)
     for (Pixel& p : pixelsImg) {
-        SuperpixelStereo* sp = (SuperpixelStereo*)p.superPixel;
+        SuperpixelStereo* sp = (SuperpixelStereo*)p.superPixel.Load();
 
         for (int dir = 0; dir < 2; dir++) {
             Pixel* q = PixelAt(pixelsImg, p.row + directions[dir][0], p.col + directions[dir][1]);
 
             if (q != nullptr) {
-                SuperpixelStereo* sq = (SuperpixelStereo*)q->superPixel;
+                SuperpixelStereo* sq = (SuperpixelStereo*)q->superPixel.Load();
 
                 if (q->superPixel != sp) {
                     BInfo& bdpq = sp->boundaryData[sq];
@@ -895,14 +910,14 @@ void SPSegmentationEngine::UpdateHingeStereoSums()
     for (int i = 1; i < ppImg.rows; i++) {
         for (int j = 1; j < ppImg.cols; j++) {
             Pixel* p = ppImg(i, j);
-            SuperpixelStereo* sps = (SuperpixelStereo*)p->superPixel;
+            SuperpixelStereo* sps = (SuperpixelStereo*)p->superPixel.Load();
             const double& disp = depthImg(i, j);
             Pixel* p1;
             SuperpixelStereo* sps1;
 
             // Upper pixel
             p1 = ppImg(i - 1, j);
-            sps1 = (SuperpixelStereo*)p1->superPixel;
+            sps1 = (SuperpixelStereo*)p1->superPixel.Load();
 
             if (sps != sps1) {
                 const auto& biIter = sps->boundaryData.find(sps1);
@@ -926,7 +941,7 @@ void SPSegmentationEngine::UpdateHingeStereoSums()
             }
             // Left pixel
             p1 = ppImg(i, j - 1);
-            sps1 = (SuperpixelStereo*)p1->superPixel;
+            sps1 = (SuperpixelStereo*)p1->superPixel.Load();
 
             if (sps != sps1) {
                 const auto& biIter = sps->boundaryData.find(sps1);
@@ -976,7 +991,7 @@ bool SPSegmentationEngine::SplitPixels(int& newMaxPixelSize)
     if (maxPixelSize == 1) 
         return false;
 
-    Matrix<Pixel> newPixelsImg(imgPixelsRows, imgPixelsCols);
+    Matrix<Pixel> newPixelsImg = arena.nextPixels.Get(imgPixelsRows, imgPixelsCols);
 
     if (params.stereo) {
         for (Superpixel*& sp : superpixels) {
@@ -1021,13 +1036,14 @@ bool SPSegmentationEngine::SplitPixels(int& newMaxPixelSize)
         newRow += (pRowSize > 1) ? 2 : 1;
     }
     pixelsImg = newPixelsImg;
+    swap(arena.pixels, arena.nextPixels);
 
     for (Superpixel* sp : superpixels) {
         sp->RecalculateEnergies();
     }
     if (params.stereo) {
         for (Pixel& p : pixelsImg) {
-            ((SuperpixelStereo*)p.superPixel)->AddToPixelSet(&p);
+            ((SuperpixelStereo*)p.superPixel.Load())->AddToPixelSet(&p);
         }
         UpdatePPImage();
     }
@@ -1036,25 +1052,33 @@ bool SPSegmentationEngine::SplitPixels(int& newMaxPixelSize)
 }
 
 // Lock function for non-stereo iterations
-// These are neighbors of p
-void LockNonStereo(Pixel*& p, unordered_set<Superpixel*>& toLock, const Matrix<Pixel>& pixelsImg)
+// These are the superpixels (ids) of the 3x3 neighborhood of p: the move of p
+// reads all of them (connectivity test) and changes those of p and its 
+// 4-neighbors; q->superPixel is loaded once (relaxed) since another worker
+// may move q meanwhile, see IterateParallel
+void LockNonStereo(Pixel*& p, vector<int>& toLock, const Matrix<Pixel>& pixelsImg)
 {
-    for (int m = 0; m < 5; m++) {
-        const Pixel* q = PixelAt(pixelsImg, p->row + nDeltas0[m][0], p->col + nDeltas0[m][1]);
-        if (q != nullptr) 
-            toLock.insert(q->superPixel);
+    for (int dr = -1; dr <= 1; dr++) {
+        for (int dc = -1; dc <= 1; dc++) {
+            const Pixel* q = PixelAt(pixelsImg, p->row + dr, p->col + dc);
+            if (q == nullptr) continue;
+
+            int id = q->superPixel.Load()->id;
+            if (find(toLock.begin(), toLock.end(), id) == toLock.end()) 
+                toLock.push_back(id);
+        }
     }
 }
 
 // Lock function for stereo iterations
-void LockStereo(Pixel*& p, unordered_set<Superpixel*>& toLock, const Matrix<Pixel>& pixelsImg)
+void LockStereo(Pixel*& p, vector<int>& toLock, const Matrix<Pixel>& pixelsImg)
 {
     for (int m = 0; m < 5; m++) {
         const Pixel* q = PixelAt(pixelsImg, p->row + nDeltas0[m][0], p->col + nDeltas0[m][1]);
         if (q != nullptr) {
-            SuperpixelStereo* sps = (SuperpixelStereo*)q->superPixel;
+            SuperpixelStereo* sps = (SuperpixelStereo*)q->superPixel.Load();
             for (auto& bdIter : sps->boundaryData) {
-                toLock.insert(bdIter.first);
+                toLock.push_back(bdIter.first->id);
             }
         }
     }
@@ -1062,7 +1086,7 @@ void LockStereo(Pixel*& p, unordered_set<Superpixel*>& toLock, const Matrix<Pixe
 
 static int dbgImageNum = 0;
 
-int SPSegmentationEngine::Iterate(Deque<Pixel*>& list, Matrix<bool>& inList)
+int SPSegmentationEngine::Iterate(Deque<Pixel*>& list, Matrix<bool>& inList, MoveStats& stats)
 {
     PixelMoveData tryMoveData[4];
     Superpixel* nbsp[5];
@@ -1098,6 +1122,7 @@ int SPSegmentationEngine::Iterate(Deque<Pixel*>& list, Matrix<bool>& inList)
                     if (params.stereo) TryMovePixelStereo(p, q, tryMoveData[m]);
                     else TryMovePixel(p, q, tryMoveData[m]);
                     nbsp[nbspSize++] = q->superPixel;
+                    stats.tried++;
                 }
             }
         }
@@ -1147,120 +1172,141 @@ int SPSegmentationEngine::Iterate(Deque<Pixel*>& list, Matrix<bool>& inList)
                     inList(qq->row, qq->col) = true;
                 }
             }
+            stats.accepted++;
+            stats.queueMax = max(stats.queueMax, (int)list.Size());
+        } else {
+            stats.rejected++;
         }
     }
     return popCount;
 }
 
-// Returns number of iterations
-//int SPSegmentationEngine::IterateMoves(int level)
-//{
-//    ParallelDeque<Pixel*, Superpixel*> list(pixelsImg.rows * pixelsImg.cols);
-//    int itemCount = 1;
-//
-//    list.SetEmptyVal(nullptr);
-//    if (params.stereo) {
-//        list.SetLockFunction([&](const Pixel*& p, unordered_set<const Superpixel*>& forb) { LockNonStereo(p, forb, pixelsImg); });
-//    } else {
-//        list.SetLockFunction([&](const Pixel*& p, unordered_set<const Superpixel*>& forb) { LockStereo(p, forb, pixelsImg); });
-//    }
-//
-//    // Initialize pixel (block) border list 
-//    for (Pixel& p : pixelsImg) {
-//        Pixel* q;
-//
-//        for (int m = 0; m < 4; m++) {
-//            q = PixelAt(pixelsImg, p.row + nDeltas[m][0], p.col + nDeltas[m][1]);
-//            if (q != nullptr && p.superPixel != q->superPixel) {
-//                list.PushBack(&p);
-//                break;
-//            }
-//        }
-//    }
-//
-//    int count = 0;
-//    PixelMoveData tryMoveData[4];
-//    Superpixel* nbsp[5];
-//    int nbspSize;
-//
-//    if (performanceInfo.levelMaxEDelta.size() <= level) {
-//        performanceInfo.levelMaxEDelta.resize(level + 1);
-//        performanceInfo.levelMaxEDelta[level] = 0;
-//    }
-//
-//    while (!list.Empty() && count < params.maxUpdates) {
-//        Pixel* p = list.PopAndLock();
-//
-//        nbsp[0] = p->superPixel;
-//        nbspSize = 1;
-//        for (int m = 0; m < 4; m++) {
-//            Pixel* q = PixelAt(pixelsImg, p->row + nDeltas[m][0], p->col + nDeltas[m][1]);
-//
-//            if (q == nullptr) tryMoveData[m].allowed = false;
-//            else {
-//                bool newNeighbor = true;
-//
-//                for (int i = 0; i < nbspSize; i++) {
-//                    if (q->superPixel == nbsp[i]) {
-//                        newNeighbor = false;
-//                        break;
-//                    }
-//                }
-//                if (!newNeighbor) tryMoveData[m].allowed = false;
-//                else {
-//                    if (params.stereo) TryMovePixelStereo(p, q, tryMoveData[m]); 
-//                    else TryMovePixel(p, q, tryMoveData[m]);
-//                    nbsp[nbspSize++] = q->superPixel;
-//                }
-//            }
-//        }
-//
-//        PixelMoveData* bestMoveData = FindBestMoveData(params, tryMoveData);
-//
-//        if (bestMoveData != nullptr) {
-//            if (params.stereo) {
-//                //SuperpixelStereo* sps = (SuperpixelStereo*)(bestMoveData->p->superPixel);
-//                //double calc = sps->CalcDispEnergy(depthImg, params.inlierThreshold, params.noDisp);
-//                //if (fabs(calc - sps->GetDispSum()) > 0.01) {
-//                //    cout << "Disp sum mismatch";
-//                //}
-//                //sps->CheckRegEnergy();
-//                //sps->CheckAppEnergy(img);
-//
-//                double delta = TotalEnergyDelta(params, bestMoveData);
-//
-//                if (performanceInfo.levelMaxEDelta[level] < delta)
-//                    performanceInfo.levelMaxEDelta[level] = delta;
-//
-//                MovePixelStereo(pixelsImg, *bestMoveData);
-//                //DebugBoundary();
-//                //DebugDispSums();
-//                //DebugNeighborhoods();
-//
-//            } else {
-//                MovePixel(pixelsImg, *bestMoveData);
-//            }
-//
-//            list.PushBack(p);
-//            for (int m = 0; m < 4; m++) {
-//                Pixel* qq = PixelAt(pixelsImg, p->row + nDeltas[m][0], p->col + nDeltas[m][1]);
-//                if (qq != nullptr && p->superPixel != qq->superPixel)
-//                    list.PushBack(qq);
-//            }
-//        }
-//
-//        list.PopFront();
-//        count++;
-//    }
-//    return count;
-//}
-
-int SPSegmentationEngine::IterateMoves(int level)
+// Parallel version of Iterate (non-stereo only): each worker pops a batch of
+// border pixels (blocks) together with a lock on the superpixels around them,
+// see LockNonStereo, so that moves of different workers never touch the same
+// superpixels or border flags. inList(r, c) is only accessed while holding the
+// lock of the superpixel of (r, c). The order of the moves, and thereby the 
+// result, depends on scheduling.
+// The lock function reads Pixel::superPixel without owning anything, while
+// other workers may write it in MovePixel; this is safe because of the 
+// invariant that a worker only changes the superpixel of a pixel while it 
+// holds the locks of both the old and the new superpixel (the move of p 
+// locks the superpixels of p and its neighbors). superPixel is a RelaxedPtr,
+// so a concurrent read gives either the old or the new superpixel, which is 
+// locked by the mover in both cases and p is passed over. Once the locks
+// of p are acquired, no other worker can change the superpixels around p,
+// so the lock set stays valid until Release, whose mutex also publishes the
+// writes to the next owner (checked by the assert in debug builds).
+int SPSegmentationEngine::IterateParallel(ParallelDeque<Pixel*, int>& list, Matrix<bool>& inList, int nThreads, 
+    MoveStats& stats)
+{
+    const int batchSize = 16;
+
+    list.SetPopLimit(params.maxUpdates);
+    list.SetLockFunction([&](Pixel*& p, vector<int>& toLock) { LockNonStereo(p, toLock, pixelsImg); });
+
+    mutex statsMutex;
+
+    auto worker = [&](int owner) {
+        MoveStats local;
+        PixelMoveData tryMoveData[4];
+        Superpixel* nbsp[5];
+        int nbspSize;
+        Pixel* batch[batchSize];
+        vector<Pixel*> push;
+        size_t count;
+#ifndef NDEBUG
+        vector<int> lockCheck;
+#endif
+
+        while ((count = list.PopAndLockWait(owner, batch, batchSize)) > 0) {
+            push.clear();
+            for (size_t b = 0; b < count; b++) {
+                Pixel* p = batch[b];
+
+#ifndef NDEBUG
+                lockCheck.clear();
+                LockNonStereo(p, lockCheck, pixelsImg);
+                assert(list.Holds(owner, lockCheck));
+#endif
+                inList(p->row, p->col) = false;
+                nbsp[0] = p->superPixel;
+                nbspSize = 1;
+                for (int m = 0; m < 4; m++) {
+                    Pixel* q = PixelAt(pixelsImg, p->row + nDeltas[m][0], p->col + nDeltas[m][1]);
+
+                    if (q == nullptr) tryMoveData[m].allowed = false;
+                    else {
+                        bool newNeighbor = true;
+
+                        for (int i = 0; i < nbspSize; i++) {
+                            if (q->superPixel == nbsp[i]) {
+                                newNeighbor = false;
+                                break;
+                            }
+                        }
+                        if (!newNeighbor) tryMoveData[m].allowed = false;
+                        else {
+                            TryMovePixel(p, q, tryMoveData[m]);
+                            nbsp[nbspSize++] = q->superPixel;
+                            local.tried++;
+                        }
+                    }
+                }
+
+                PixelMoveData* bestMoveData = FindBestMoveData(params, tryMoveData);
+
+                if (bestMoveData != nullptr) {
+                    MovePixel(pixelsImg, *bestMoveData);
+
+                    push.push_back(p);
+                    for (int m = 0; m < 4; m++) {
+                        Pixel* qq = PixelAt(pixelsImg, p->row + nDeltas[m][0], p->col + nDeltas[m][1]);
+                        if (qq != nullptr && p->superPixel != qq->superPixel && !inList(qq->row, qq->col)) {
+                            push.push_back(qq);
+                            inList(qq->row, qq->col) = true;
+                        }
+                    }
+                    local.accepted++;
+                } else {
+                    local.rejected++;
+                }
+            }
+            list.Release(owner, push);
+        }
+
+        lock_guard<mutex> lock(statsMutex);
+        stats.tried += local.tried;
+        stats.accepted += local.accepted;
+        stats.rejected += local.rejected;
+    };
+
+    vector<thread> threads;
+    for (int t = 1; t < nThreads; t++) {
+        threads.push_back(thread(worker, t + 1));
+    }
+    worker(1);
+    for (thread& t : threads) {
+        t.join();
+    }
+    stats.queueMax = (int)list.GetMaxSize();
+    return (int)list.GetPopCount();
+}
+
+int SPSegmentationEngine::IterateMoves(int level, MoveStats& stats)
 {
     params.SetLevelParams(level);
 
-    Deque<Pixel*> list(pixelsImg.rows * pixelsImg.cols);
-    Matrix<bool> inList(pixelsImg.rows, pixelsImg.cols);
+    int nThreads = params.threads;
+    if (nThreads <= 0) nThreads = max(1, (int)thread::hardware_concurrency());
+    bool parallel = nThreads > 1 && !params.stereo;
+
+    Deque<Pixel*>& list = arena.list;
+    ParallelDeque<Pixel*, int>& plist = arena.plist;
+    Matrix<bool> inList = arena.inList.Get(pixelsImg.rows, pixelsImg.cols);
+
+    if (parallel) plist.Reset(pixelsImg.rows * pixelsImg.cols);
+    else list.Reset(pixelsImg.rows * pixelsImg.cols);
 
     // Initialize pixel (block) border list 
     fill(inList.begin(), inList.end(), false);
@@ -1270,14 +1316,18 @@ int SPSegmentationEngine::IterateMoves(int level)
         for (int m = 0; m < 4; m++) {
             q = PixelAt(pixelsImg, p.row + nDeltas[m][0], p.col + nDeltas[m][1]);
             if (q != nullptr && p.superPixel != q->superPixel) {
-                list.PushBack(&p);
+                if (parallel) plist.PushBack(&p);
+                else list.PushBack(&p);
                 inList(q->row, q->col) = true;
                 break;
             }
         }
     }
 
-    int nIterations = Iterate(list, inList);
+    stats.queueInitial = (int)(parallel ? plist.Size() : list.Size());
+    stats.queueMax = stats.queueInitial;
+
+    int nIterations = parallel ? IterateParallel(plist, inList, nThreads, stats) : Iterate(list, inList, stats);
 
     return nIterations;
 }
@@ -1325,8 +1375,8 @@ const Vec3b& BoundaryColor(Pixel* p, Pixel* q)
     if (p == nullptr || q == nullptr) 
         return pixelColors[0];
 
-    SuperpixelStereo* sp = (SuperpixelStereo*)p->superPixel;
-    SuperpixelStereo* sq = (SuperpixelStereo*)q->superPixel;
+    SuperpixelStereo* sp = (SuperpixelStereo*)p->superPixel.Load();
+    SuperpixelStereo* sq = (SuperpixelStereo*)q->superPixel.Load();
 
     if (sp == nullptr || sq == nullptr) 
         return pixelColors[0];
@@ -1390,7 +1440,7 @@ Mat SPSegmentationEngine::GetDisparity() const
 
     for (int i = 0; i < ppImg.rows; i++) {
         for (int j = 0; j < ppImg.cols; j++) {
-            SuperpixelStereo* sps = (SuperpixelStereo*)ppImg(i, j)->superPixel;
+            SuperpixelStereo* sps = (SuperpixelStereo*)ppImg(i, j)->superPixel.Load();
             double val = DotProduct(sps->plane, i, j, 1.0);
             result(i, j) = val < 256.0 ? (val < 0 ? 0 : val * 256.0) : 65535;
         }
@@ -1539,6 +1589,15 @@ void SPSegmentationEngine::PrintPerformanceInfo()
         for (int& ps : performanceInfo.levelMaxPixelSize)
             cout << ps << ' ';
         cout << endl;
+        cout << "Tried/accepted/rejected moves for each level: ";
+        for (size_t l = 0; l < performanceInfo.levelMovesTried.size(); l++)
+            cout << performanceInfo.levelMovesTried[l] << '/' << performanceInfo.levelMovesAccepted[l] 
+                << '/' << performanceInfo.levelMovesRejected[l] << ' ';
+        cout << endl;
+        cout << "Initial/max queue length for each level: ";
+        for (size_t l = 0; l < performanceInfo.levelQueueInitial.size(); l++)
+            cout << performanceInfo.levelQueueInitial[l] << '/' << performanceInfo.levelQueueMax[l] << ' ';
+        cout << endl;
 
         int minBDSize = INT_MAX;
         int maxBDSize = 0;
@@ -1572,7 +1631,7 @@ void SPSegmentationEngine::UpdateInlierSums()
     for (int i = 0; i < ppImg.rows; i++) {
         for (int j = 0; j < ppImg.cols; j++) {
             Pixel* p = ppImg(i, j);
-            SuperpixelStereo* sps = (SuperpixelStereo*)p->superPixel;
+            SuperpixelStereo* sps = (SuperpixelStereo*)p->superPixel.Load();
             const double& disp = depthImg(i, j);
 
             if (disp > 0) {
@@ -1633,8 +1692,8 @@ bool SPSegmentationEngine::TryMovePixel(Pixel* p, Pixel* q, PixelMoveData& psd)
 
 bool SPSegmentationEngine::TryMovePixelStereo(Pixel* p, Pixel* q, PixelMoveData& psd)
 {
-    SuperpixelStereo* sp = (SuperpixelStereo*)p->superPixel;
-    SuperpixelStereo* sq = (SuperpixelStereo*)q->superPixel;
+    SuperpixelStereo* sp = (SuperpixelStereo*)p->superPixel.Load();
+    SuperpixelStereo* sq = (SuperpixelStereo*)q->superPixel.Load();
 
     if (sp == sq || !IsSuperpixelRegionConnectedOptimized(pixelsImg, p, p->row - 1, p->col - 1, p->row + 2, p->col + 2)) {
         psd.allowed = false;
@@ -1682,13 +1741,13 @@ void SPSegmentationEngine::DebugNeighborhoods()
 
     // update length & hiSum (written to smoSum)
     for (Pixel& p : pixelsImg) {
-        SuperpixelStereo* sp = (SuperpixelStereo*)p.superPixel;
+        SuperpixelStereo* sp = (SuperpixelStereo*)p.superPixel.Load();
 
         for (int dir = 0; dir < 2; dir++) {
             Pixel* q = PixelAt(pixelsImg, p.row + directions[dir][0], p.col + directions[dir][1]);
 
             if (q != nullptr) {
-                SuperpixelStereo* sq = (SuperpixelStereo*)q->superPixel;
+                SuperpixelStereo* sq = (SuperpixelStereo*)q->superPixel.Load();
 
                 if (sp->id != sq->id) {
                     if (sp->boundaryData.find(sq) == sp->boundaryData.end())
@@ -1711,13 +1770,13 @@ void SPSegmentationEngine::DebugBoundary()
 
     // update length & hiSum (written to smoSum)
     for (Pixel p : pixelsImg) {
-        SuperpixelStereo* sp = (SuperpixelStereo*)p.superPixel;
+        SuperpixelStereo* sp = (SuperpixelStereo*)p.superPixel.Load();
 
         for (int dir = 0; dir < 2; dir++) {
             Pixel* q = PixelAt(pixelsImg, p.row + directions[dir][0], p.col + directions[dir][1]);
 
             if (q != nullptr) {
-                SuperpixelStereo* sq = (SuperpixelStereo*)q->superPixel;
+                SuperpixelStereo* sq = (SuperpixelStereo*)q->superPixel.Load();
 
                 if (q->superPixel != sp) {
                     BInfo& bdpq = newBoundaryData[pair<SuperpixelStereo*, SuperpixelStereo*>(sp, sq)];
@@ -74,7 +74,8 @@ struct SPSegmentationParameters {
         inpaint(false),           // use opencv's inpaint method to fill gaps in
         debugOutput(false),
         timingOutput(true),
-        randomSeed(0) {};
+        randomSeed(0),
+        threads(1) {};
     
     int superpixelNum;        // Number of superpixels (the actual number can be different)
     int gridSize;
@@ -110,6 +111,7 @@ struct SPSegmentationParameters {
     bool debugOutput;
     bool timingOutput;
     int randomSeed;
+    int threads;            // Threads for the (non-stereo) move iterations, 0 for all cores
 
     vector<pair<string, vector<double>>> levelParamsDouble;
     vector<pair<string, vector<int>>> levelParamsInt;
@@ -149,6 +151,7 @@ struct SPSegmentationParameters {
         UpdateFromNode(debugOutput, node["debugOutput"]);
         UpdateFromNode(timingOutput, node["timingOutput"]);
         UpdateFromNode(randomSeed, node["randomSeed"]);
+        UpdateFromNode(threads, node["threads"]);
         SetLevelParams(0);
     }
 
@@ -201,8 +204,68 @@ private:
 };
 
 
+// Storage for the pixels, superpixels and move queues of a segmentation
+// An engine uses the arena for one ProcessImage(Stereo) call and only clears
+// it when done, so an arena passed to the engines of consecutive images (e.g.
+// one arena per thread in batch processing) keeps its memory and only
+// allocates when an image needs more. An arena must not be shared by engines
+// which exist at the same time.
+class SPSegmentationArena {
+    friend class SPSegmentationEngine;
+
+    MatrixBuffer<Pixel> pixels;                     // pixels of the current level
+    MatrixBuffer<Pixel> nextPixels;                 // pixels of the next level (used in SplitPixels)
+    MatrixBuffer<Pixel*> ppImg;                     // see SPSegmentationEngine::ppImg
+    MatrixBuffer<bool> inList;                      // see SPSegmentationEngine::IterateMoves
+    vector<Superpixel> superpixelStore;             // superpixels (non-stereo), indexed by id
+    vector<SuperpixelStereo> superpixelStereoStore; // superpixels (stereo), indexed by id
+    vector<Superpixel*> superpixels;                // pointers into one of the stores above
+    Deque<Pixel*> list;
+    ParallelDeque<Pixel*, int> plist;
+
+public:
+    SPSegmentationArena() : list(1), plist(1) { }
+
+    // Drop the superpixels but keep all memory for the next image
+    void Clear()
+    {
+        superpixels.clear();
+        superpixelStore.clear();
+        superpixelStereoStore.clear();
+    }
+
+    // Free all memory
+    void Release()
+    {
+        Clear();
+        pixels.Release();
+        nextPixels.Release();
+        ppImg.Release();
+        inList.Release();
+        vector<Superpixel>().swap(superpixelStore);
+        vector<SuperpixelStereo>().swap(superpixelStereoStore);
+        vector<Superpixel*>().swap(superpixels);
+        list.Release();
+        plist.Release();
+    }
+};
+
+
 class SPSegmentationEngine {
-private:
+public:
+    // Counts of one call of IterateMoves
+    struct MoveStats {
+        MoveStats() : tried(0), accepted(0), rejected(0), queueInitial(0), queueMax(0) {}
+        int tried;          // moves evaluated (TryMovePixel calls)
+        int accepted;       // pixels (blocks) moved
+        int rejected;       // pixels (blocks) popped but not moved
+        int queueInitial;   // border pixels (blocks) queued at the start
+        int queueMax;       // maximum length of the queue
+    };
+
+    // Times are in seconds (wall clock), level* vectors have one entry per
+    // level (from large to small pixel blocks); moves are summed and queue
+    // lengths maximized over the iterations of a level
     struct PerformanceInfo {
         PerformanceInfo() : init(0.0), imgproc(0.0), ransac(0.0), total(0.0) {}
         double init;
@@ -213,8 +276,35 @@ private:
         double total;
         vector<double> levelMaxEDelta;
         vector<int> levelMaxPixelSize;
+        vector<int> levelMovesTried;
+        vector<int> levelMovesAccepted;
+        vector<int> levelMovesRejected;
+        vector<int> levelQueueInitial;
+        vector<int> levelQueueMax;
+
+        void AddLevel(int maxPixelSize)
+        {
+            levelMaxPixelSize.push_back(maxPixelSize);
+            levelIterations.push_back(0);
+            levelMovesTried.push_back(0);
+            levelMovesAccepted.push_back(0);
+            levelMovesRejected.push_back(0);
+            levelQueueInitial.push_back(0);
+            levelQueueMax.push_back(0);
+        }
+
+        void AddIteration(int iterations, const MoveStats& stats)
+        {
+            levelIterations.back() = max(levelIterations.back(), iterations);
+            levelMovesTried.back() += stats.tried;
+            levelMovesAccepted.back() += stats.accepted;
+            levelMovesRejected.back() += stats.rejected;
+            levelQueueInitial.back() = max(levelQueueInitial.back(), stats.queueInitial);
+            levelQueueMax.back() = max(levelQueueMax.back(), stats.queueMax);
+        }
     };
 
+private:
     PerformanceInfo performanceInfo;
 
     // Parameters
@@ -234,12 +324,15 @@ private:
     // Image to process (in lab color space)
     Mat img;
 
-    // Support structures
+    // Support structures (memory is owned by arena)
+    SPSegmentationArena ownArena;   // used if no arena is given to the constructor
+    SPSegmentationArena& arena;
     Matrix<Pixel> pixelsImg;    // pixels matrix, dimension varies, depends on level
     Matrix<Pixel*> ppImg;       // matrix of dimension of img, pointers to pixelsImg pixels (for stereo)
-    vector<Superpixel*> superpixels;
+    vector<Superpixel*>& superpixels;   // superpixels, indexed by id
 public:
-    SPSegmentationEngine(SPSegmentationParameters params, Mat img, Mat depthImg = Mat());
+    SPSegmentationEngine(SPSegmentationParameters params, Mat img, Mat depthImg = Mat(), 
+        SPSegmentationArena* arena = nullptr);
     virtual ~SPSegmentationEngine();
 
     void ProcessImage();
@@ -256,13 +349,14 @@ public:
     void PrintPerformanceInfo();
     int GetNoOfSuperpixels() const;
     double ProcessingTime() { return performanceInfo.total; }
+    const PerformanceInfo& GetPerformanceInfo() const { return performanceInfo; }
 private:
-    void Initialize(Superpixel* spGenerator(int));
+    void Initialize(bool stereo);
     void InitializeStereo();
     void InitializeStereoEnergies();
     void InitializePPImage();
     void UpdatePPImage();
-    int IterateMoves(int level);
+    int IterateMoves(int level, MoveStats& stats);
     void ReEstimatePlaneParameters();
     void EstimatePlaneParameters();
     bool SplitPixels(int& newMaxPixelSize);
@@ -282,7 +376,8 @@ private:
     bool TryMovePixel(Pixel* p, Pixel* q, PixelMoveData& psd);
     bool TryMovePixelStereo(Pixel* p, Pixel* q, PixelMoveData& psd);
 
-    int Iterate(Deque<Pixel*>& list, Matrix<bool>& inList);
+    int Iterate(Deque<Pixel*>& list, Matrix<bool>& inList, MoveStats& stats);
+    int IterateParallel(ParallelDeque<Pixel*, int>& list, Matrix<bool>& inList, int nThreads, MoveStats& stats);
 };
 
 
@@ -85,7 +85,7 @@ void Pixel::SplitColumn(const cv::Mat& img, int row, int col1, int col2, Pixel&
 
 void Pixel::UpdateInliers(const cv::Mat1d& dispImg, double threshold, cv::Mat1b& inliers) const
 {
-    const Plane_d& plane = ((SuperpixelStereo*)superPixel)->plane;
+    const Plane_d& plane = ((SuperpixelStereo*)superPixel.Load())->plane;
 
     for (int i = ulr; i < (int)lrr; i++) {
         for (int j = ulc; j < (int)lrc; j++) {
@@ -6,6 +6,8 @@
 #include <cstdint>
 #include <unordered_set>
 #include <unordered_map>
+#include <algorithm>
+#include <atomic>
 
 using namespace std;
 
@@ -128,6 +130,9 @@ template <typename T> struct Matrix {
 
     Matrix(int rows_, int cols_) : data(new T[rows_*cols_], [](T* p) { delete[] p; }), rows(rows_), cols(cols_) { }
 
+    // Matrix on memory owned by someone else (see MatrixBuffer)
+    Matrix(T* data_, int rows_, int cols_) : data(shared_ptr<T>(), data_), rows(rows_), cols(cols_) { }
+
     inline T& operator() (int r, int c)
     {
         return *(data.get() + r*cols + c);
@@ -160,6 +165,60 @@ template <typename T> struct Matrix {
 
 };
 
+// Memory for matrices of varying dimensions
+// Matrices returned by Get share the buffer, which only grows; elements are
+// not (re-)initialized, as with Matrix(rows, cols).
+template <typename T> class MatrixBuffer {
+    unique_ptr<T[]> data;
+    size_t capacity;
+
+public:
+    MatrixBuffer() : capacity(0) { }
+
+    Matrix<T> Get(int rows, int cols)
+    {
+        size_t size = (size_t)rows*cols;
+
+        if (size > capacity) {
+            data.reset(new T[size]);
+            capacity = size;
+        }
+        return Matrix<T>(data.get(), rows, cols);
+    }
+
+    void Release()
+    {
+        data.reset();
+        capacity = 0;
+    }
+};
+
+
+// RelaxedPtr
+///////////////
+
+// Pointer whose loads and stores are relaxed atomics (plain moves on common
+// platforms); used for Pixel::superPixel, which the lock function of 
+// SPSegmentationEngine::IterateParallel reads while other workers may move 
+// the pixel
+template <typename T> class RelaxedPtr {
+private:
+    std::atomic<T*> ptr;
+public:
+    RelaxedPtr() { }
+    RelaxedPtr(T* p) : ptr(p) { }
+    RelaxedPtr(const RelaxedPtr& other) : ptr(other.Load()) { }
+
+    RelaxedPtr& operator=(const RelaxedPtr& other) { Store(other.Load()); return *this; }
+    RelaxedPtr& operator=(T* p) { Store(p); return *this; }
+
+    T* Load() const { return ptr.load(std::memory_order_relaxed); }
+    void Store(T* p) { ptr.store(p, std::memory_order_relaxed); }
+
+    operator T*() const { return Load(); }
+    T* operator->() const { return Load(); }
+};
+
 
 // Pixel/Superpixel
 /////////////////////
@@ -183,7 +242,67 @@ struct PixelData {
 };
 
 
-typedef unordered_map<SuperpixelStereo*, BInfo> BorderDataMap;
+// Small map kept as a vector of pairs sorted by key
+// Superpixels have a handful of neighbors, so a linear scan of contiguous
+// memory is faster than hashing, and copies (done for every tried stereo
+// move with instantBoundary) need a single allocation. Inserting or erasing
+// invalidates references and iterators into the map.
+template <typename K, typename V> class FlatMap {
+public:
+    typedef pair<K, V> value_type;
+    typedef typename vector<value_type>::iterator iterator;
+    typedef typename vector<value_type>::const_iterator const_iterator;
+
+private:
+    vector<value_type> data;
+
+    template <typename It> static It LowerBound(It from, It to, const K& key)
+    {
+        while (from != to && from->first < key) ++from;
+        return from;
+    }
+
+public:
+    iterator begin() { return data.begin(); }
+    iterator end() { return data.end(); }
+    const_iterator begin() const { return data.begin(); }
+    const_iterator end() const { return data.end(); }
+    size_t size() const { return data.size(); }
+    bool empty() const { return data.empty(); }
+    void clear() { data.clear(); }
+
+    iterator find(const K& key)
+    {
+        iterator iter = LowerBound(data.begin(), data.end(), key);
+        return (iter != data.end() && iter->first == key) ? iter : data.end();
+    }
+
+    const_iterator find(const K& key) const
+    {
+        const_iterator iter = LowerBound(data.begin(), data.end(), key);
+        return (iter != data.end() && iter->first == key) ? iter : data.end();
+    }
+
+    V& operator[](const K& key)
+    {
+        iterator iter = LowerBound(data.begin(), data.end(), key);
+        if (iter == data.end() || iter->first != key)
+            iter = data.insert(iter, value_type(key, V()));
+        return iter->second;
+    }
+
+    size_t erase(const K& key)
+    {
+        iterator iter = find(key);
+        if (iter == data.end()) return 0;
+        data.erase(iter);
+        return 1;
+    }
+};
+
+// Superpixels are stored contiguously (see SPSegmentationEngine), so the
+// order of keys is the order of superpixel ids
+typedef FlatMap<SuperpixelStereo*, BInfo> BorderDataMap;
 
 // Note: energy deltas below are "energy_before - energy_after"
 struct PixelMoveData {
@@ -217,7 +336,7 @@ struct PixelChangeDataStereo : public PixelChangeData {
 
 struct Pixel { // : public custom_alloc {
 
-    Superpixel* superPixel;
+    RelaxedPtr<Superpixel> superPixel;
 
     // Geometry info
     sint row, col;                 // pixelsImg position
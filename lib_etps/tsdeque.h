@@ -1,8 +1,11 @@
 #pragma once
 
 #include <vector>
-#include <unordered_set>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
 #include <mutex>
+#include <cassert>
 
 
 // ParallelDeque 
@@ -11,39 +14,59 @@
 // - Thread safe deque based on vector ("circular list" representation)
 // - Supports forbidden elements (excluded from PopFront operation)
 // - Operations: 
-//    * PopAndLock pops an "unforbidden" element from the front of the deque
-//      and locks it
-//    * Release releases element (removes it from forbidden list)
+//    * PopAndLock pops up to maxCount elements which are not forbidden for
+//      the given owner from the front of the deque, and locks them for the
+//      owner; forbidden elements passed on the way are moved to the back
+//    * PopAndLockWait is PopAndLock for worker threads: it waits while all
+//      queued elements are forbidden or other owners still hold locks, and
+//      returns 0 once no work is left
+//    * Release pushes elements to the end of the deque and releases all locks
+//      of an owner (removes them from forbidden list)
 //    * PushBack adds an element to the end of the deque.
+//    * Holds checks whether an owner holds a set of locks.
+// - Owners are positive integers (e.g. thread indices), locks are 
+//   non-negative integer indices (e.g. superpixel ids) kept in an array.
+// - Elements pushed while processing locked elements have to be pushed before
+//   (or when) the locks are released, otherwise PopAndLockWait may end too 
+//   early.
 
 
-template <typename T, typename S> class ParallelDeque {
-private:
-    typedef std::unordered_set<S> LockSetType;
-    typedef std::unordered_map<T, LockSetType> LockMapType;
+template <typename T, typename S = int> class ParallelDeque {
+public:
+    typedef std::vector<S> LockSetType;
 
+private:
     std::vector<T> vector;
     size_t start;
     size_t end;
     size_t listSize;
     size_t popCount;
-    T emptyVal;
+    size_t popLimit;
+    size_t maxSize;                     // maximum of listSize since Reset
     std::function<void(T&, LockSetType&)> lockFun;
-    LockMapType lockMap;
-    LockSetType locked;
+    std::vector<int> locked;            // owner of each lock, 0 if not locked
+    std::vector<LockSetType> held;      // locks held by each owner
+    int holding;                        // number of owners holding locks
+    LockSetType lockSet;
     std::mutex m;
+    std::condition_variable cv;
 public:
-    ParallelDeque(size_t maxSize) :
-        start(0), end(0), listSize(0), emptyVal(T()),
-        popCount(0)
+    ParallelDeque(size_t capacity) :
+        start(0), end(0), listSize(0), popCount(0), popLimit((size_t)-1),
+        maxSize(0), holding(0)
     {
-        vector.resize(maxSize);
+        vector.resize(capacity);
     }
 
     size_t GetPopCount() { return popCount; }
 
-    void SetEmptyVal(const T& ev) { emptyVal = ev; }
+    size_t GetMaxSize() { return maxSize; }
+
+    // No elements are popped after limit pops
+    void SetPopLimit(size_t limit) { popLimit = limit; }
 
+    // Lock function, adds the indices to lock to the given set (duplicates
+    // are allowed)
     void SetLockFunction(const std::function<void(T&, LockSetType&)>& lf)
     {
         lockFun = lf;
@@ -57,57 +80,149 @@ public:
 
     void Clear() { start = end = listSize = 0; }
 
+    // Empties the deque, releases all locks and resets the pop count and 
+    // limit; storage is kept (and grown to capacity elements if smaller) so
+    // the deque can be reused without allocation
+    void Reset(size_t capacity)
+    {
+        Clear();
+        if (vector.size() < capacity) vector.resize(capacity);
+        popCount = 0;
+        popLimit = (size_t)-1;
+        maxSize = 0;
+        std::fill(locked.begin(), locked.end(), 0);
+        for (LockSetType& h : held) h.clear();
+        holding = 0;
+    }
+
+    // Empties the deque and frees its storage
+    void Release()
+    {
+        Reset(1);
+        std::vector<T>(1).swap(vector);
+        std::vector<int>().swap(locked);
+        std::vector<LockSetType>().swap(held);
+    }
+
     void PushBack(const T& value)
     {
         std::unique_lock<std::mutex> lck(m);
 
+        pushBack(value);
+        cv.notify_one();
+    }
+
+    size_t PopAndLock(int owner, T* result, size_t maxCount)
+    {
+        std::unique_lock<std::mutex> lck(m);
+
+        return popAndLock(owner, result, maxCount);
+    }
+
+    size_t PopAndLockWait(int owner, T* result, size_t maxCount)
+    {
+        std::unique_lock<std::mutex> lck(m);
+
+        while (popCount < popLimit) {
+            size_t count = popAndLock(owner, result, maxCount);
+
+            if (count > 0) return count;
+            if (listSize == 0 && holding == 0) break;
+            cv.wait(lck);
+        }
+        cv.notify_all();
+        return 0;
+    }
+
+    // Whether the owner holds all locks of the set
+    bool Holds(int owner, const LockSetType& ls)
+    {
+        std::unique_lock<std::mutex> lck(m);
+
+        for (const S& s : ls) {
+            if ((size_t)s >= locked.size() || locked[s] != owner) return false;
+        }
+        return true;
+    }
+
+    void Release(int owner, const std::vector<T>& push = std::vector<T>()) 
+    {
+        std::unique_lock<std::mutex> lck(m);
+
+        for (const T& value : push) 
+            pushBack(value);
+        if ((size_t)owner < held.size() && !held[owner].empty()) {
+            for (const S& s : held[owner])
+                locked[s] = 0;
+            held[owner].clear();
+            holding--;
+        }
+        cv.notify_all();
+    }
+
+private:
+    void pushBack(const T& value)
+    {
         if ((end + 1) % vector.size() == start) resize(2 * vector.size());
         vector[end] = value;
         end = (end + 1) % vector.size();
         listSize++;
+        if (listSize > maxSize) maxSize = listSize;
     }
 
-    T PopAndLock()
+    bool isForbidden(int owner, const LockSetType& ls) const
     {
-        std::unique_lock<std::mutex> lck(m);
-        LockSetType lockSet;
-
-        if (Empty()) return emptyVal;
-        for (int i = start; i != end; i = (i + 1) % vector.size()) {
-            T result = vector[i];
-            if (result != emptyVal) {
-                lockSet.clear();
-                lockFun(result, lockSet);
-                if (find_if(lockSet.begin(), lockSet.end(), [&](const S& s) { return locked.find(s) != locked.end(); }) == lockSet.end()) {
-                    vector[i] = emptyVal;
-                    if (i == start) {
-                        do {
-                            start = (start + 1) % vector.size();
-                        } while (start != end && vector[start] == emptyVal);
-                    }
-                    locked.insert(lockSet.begin(), lockSet.end());
-                    lockMap[result] = std::move(lockSet);
-                    listSize--;
-                    popCount++;
-                    return result;
-                }
-            }
+        for (const S& s : ls) {
+            if ((size_t)s < locked.size() && locked[s] != 0 && locked[s] != owner) return true;
         }
-        return emptyVal;
+        return false;
     }
 
-    void Release(const T& e) {
-        std::unique_lock<std::mutex> lck(m);
+    void lock(int owner, const LockSetType& ls)
+    {
+        if ((size_t)owner >= held.size()) held.resize(owner + 1);
+        if (held[owner].empty()) holding++;
+        for (const S& s : ls) {
+            if ((size_t)s >= locked.size()) locked.resize(2 * s + 1, 0);
+            if (locked[s] == 0) {
+                locked[s] = owner;
+                held[owner].push_back(s);
+            }
+        }
+    }
 
-        typename LockMapType::iterator fiter = lockMap.find(e);
-        if (fiter != lockMap.end()) {
-            for (const S& s : fiter->second)
-                locked.erase(s);
-            lockMap.erase(e);
+    // Pops from the front until the first element which can be locked, then
+    // at most a few more elements to fill the batch; forbidden elements are
+    // moved to the back, so they are not scanned again by the next call
+    size_t popAndLock(int owner, T* result, size_t maxCount)
+    {
+        maxCount = std::min(maxCount, popLimit - popCount);
+
+        size_t count = 0;
+        size_t scanned = 0;
+        size_t size = listSize;
+
+        while (scanned < size && count < maxCount) {
+            if (count > 0 && scanned >= 4 * maxCount) break;
+
+            T value = vector[start];
+            start = (start + 1) % vector.size();
+            listSize--;
+            scanned++;
+
+            lockSet.clear();
+            lockFun(value, lockSet);
+            if (!isForbidden(owner, lockSet)) {
+                lock(owner, lockSet);
+                result[count++] = value;
+            } else {
+                pushBack(value);
+            }
         }
+        popCount += count;
+        return count;
     }
 
-private:
     void resize(size_t newSize)
     {
         std::vector<T> newVector;
@@ -132,10 +247,10 @@ private:
     size_t end;
     size_t listSize;
 public:
-    Deque(size_t maxSize) :
+    Deque(size_t capacity) :
         start(0), end(0), listSize(0)
     {
-        vector.resize(maxSize);
+        vector.resize(capacity);
     }
 
     size_t Size() const { return listSize; }
@@ -144,6 +259,20 @@ public:
 
     void Clear() { start = end = listSize = 0; }
 
+    // Empties the deque, keeps storage (grown to capacity elements if smaller)
+    void Reset(size_t capacity)
+    {
+        Clear();
+        if (vector.size() < capacity) vector.resize(capacity);
+    }
+
+    // Empties the deque and frees its storage
+    void Release()
+    {
+        Clear();
+        std::vector<T>(1).swap(vector);
+    }
+
     void PushBack(const T& value)
     {
         if ((end + 1) % vector.size() == start) resize(2 * vector.size());
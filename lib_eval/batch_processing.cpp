@@ -0,0 +1,363 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <map>
+#include <queue>
+#include <regex>
+#include <mutex>
+#include <thread>
+#include <fstream>
+#include <algorithm>
+#include <condition_variable>
+#include <glog/logging.h>
+#include "io_util.h"
+#include "visualization.h"
+#include "batch_processing.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+////////////////////////////////////////////////////////////////////////////////
+
+BatchProcessing::BatchProcessing(std::string store_contour, std::string store_mean, 
+        std::string store_random, std::string store_labels) 
+        : store_contour(store_contour), store_mean(store_mean), 
+        store_random(store_random), store_labels(store_labels) {
+    
+    label_extension = IOUtil::getLabelExtension("csv");
+    threads = 1;
+    prefetch = 4;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setFormat
+////////////////////////////////////////////////////////////////////////////////
+
+void BatchProcessing::setFormat(std::string format) {
+    label_extension = IOUtil::getLabelExtension(format);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setThreads
+////////////////////////////////////////////////////////////////////////////////
+
+void BatchProcessing::setThreads(int threads) {
+    LOG_IF(FATAL, threads < 0) << "Invalid number of threads.";
+    this->threads = threads;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setPrefetch
+////////////////////////////////////////////////////////////////////////////////
+
+void BatchProcessing::setPrefetch(int prefetch) {
+    LOG_IF(FATAL, prefetch < 1) << "Invalid number of prefetched images.";
+    this->prefetch = prefetch;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// process
+////////////////////////////////////////////////////////////////////////////////
+
+int BatchProcessing::process(std::string input, Algorithm algorithm) {
+    
+    return process(input, [&algorithm](const boost::filesystem::path &file,
+            cv::Mat &image, cv::Mat &labels) {
+        algorithm(image, labels);
+    });
+}
+
+int BatchProcessing::process(std::string input, FileAlgorithm algorithm) {
+    
+    if (!isBatch(input)) {
+        cv::Mat image = cv::imread(input);
+        LOG_IF(FATAL, image.empty()) << "Could not read image: " << input << ".";
+        
+        cv::Mat labels;
+        processImage(boost::filesystem::path(input), image, false, algorithm, labels);
+        return 1;
+    }
+    
+    std::vector<boost::filesystem::path> files;
+    listImages(input, files);
+    checkUniqueStems(files);
+    
+    std::vector<std::string> stores;
+    stores.push_back(store_contour);
+    stores.push_back(store_mean);
+    stores.push_back(store_random);
+    stores.push_back(store_labels);
+    
+    for (unsigned int i = 0; i < stores.size(); ++i) {
+        if (!stores[i].empty() && !boost::filesystem::is_directory(stores[i])) {
+            boost::filesystem::create_directories(stores[i]);
+        }
+    }
+    
+    int num_threads = threads;
+    if (num_threads <= 0) {
+        num_threads = std::max(1, (int) std::thread::hardware_concurrency());
+    }
+    
+    // Images read ahead; the reader blocks while the queue is full, the workers
+    // while it is empty and the reader has not finished.
+    std::queue< std::pair<boost::filesystem::path, cv::Mat> > queue;
+    std::mutex mutex;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+    bool finished = false;
+    int processed = 0;
+    
+    std::thread reader([&]() {
+        for (unsigned int n = 0; n < files.size(); ++n) {
+            cv::Mat image = cv::imread(files[n].string());
+            if (image.empty()) {
+                LOG(WARNING) << "Could not read image: " << files[n].string() << ".";
+                continue;
+            }
+            
+            std::unique_lock<std::mutex> lock(mutex);
+            not_full.wait(lock, [&]() { return (int) queue.size() < prefetch; });
+            
+            queue.push(std::pair<boost::filesystem::path, cv::Mat>(files[n], image));
+            not_empty.notify_one();
+        }
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+        not_empty.notify_all();
+    });
+    
+    auto worker = [&]() {
+        cv::Mat labels;
+        while (true) {
+            std::pair<boost::filesystem::path, cv::Mat> item;
+            
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                not_empty.wait(lock, [&]() { return !queue.empty() || finished; });
+                
+                if (queue.empty()) {
+                    break;
+                }
+                
+                item = queue.front();
+                queue.pop();
+                not_full.notify_one();
+            }
+            
+            processImage(item.first, item.second, true, algorithm, labels);
+            
+            std::lock_guard<std::mutex> lock(mutex);
+            ++processed;
+        }
+    };
+    
+    std::vector<std::thread> workers;
+    for (int t = 0; t < num_threads; ++t) {
+        workers.push_back(std::thread(worker));
+    }
+    
+    reader.join();
+    for (int t = 0; t < num_threads; ++t) {
+        workers[t].join();
+    }
+    
+    return processed;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// processImage
+////////////////////////////////////////////////////////////////////////////////
+
+void BatchProcessing::processImage(const boost::filesystem::path &file, 
+        cv::Mat &image, bool batch, FileAlgorithm algorithm, cv::Mat &labels) {
+    
+    algorithm(file, image, labels);
+    
+    if (!store_contour.empty()) {
+        cv::Mat blackima = cv::Mat::zeros(cv::Size(image.cols, image.rows), CV_8UC3);
+        
+        cv::Mat image_contours;
+        Visualization::drawContours(blackima, labels, image_contours);
+        cv::imwrite(getOutputFile(store_contour, file, "_contours.png", batch).string(), image_contours);
+    }
+    
+    if (!store_mean.empty()) {
+        cv::Mat image_means;
+        Visualization::drawMeans(image, labels, image_means);
+        cv::imwrite(getOutputFile(store_mean, file, "_mean.png", batch).string(), image_means);
+    }
+    
+    if (!store_random.empty()) {
+        cv::Mat image_random;
+        Visualization::drawRandom(labels, image_random);
+        cv::imwrite(getOutputFile(store_random, file, "_random.png", batch).string(), image_random);
+    }
+    
+    if (!store_labels.empty()) {
+        IOUtil::writeLabels(getOutputFile(store_labels, file, label_extension, batch), labels);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// checkUniqueStems
+////////////////////////////////////////////////////////////////////////////////
+
+void BatchProcessing::checkUniqueStems(const std::vector<boost::filesystem::path> &files) {
+    
+    std::map<std::string, boost::filesystem::path> stems;
+    for (unsigned int i = 0; i < files.size(); ++i) {
+        std::pair<std::map<std::string, boost::filesystem::path>::iterator, bool> inserted 
+                = stems.insert(std::make_pair(files[i].stem().string(), files[i]));
+        
+        LOG_IF(FATAL, !inserted.second) << "Images " << inserted.first->second.string() 
+                << " and " << files[i].string() << " have the same name, their outputs "
+                << "would overwrite each other.";
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getOutputFile
+////////////////////////////////////////////////////////////////////////////////
+
+boost::filesystem::path BatchProcessing::getOutputFile(std::string store, 
+        const boost::filesystem::path &file, std::string extension, bool batch) {
+    
+    if (!batch) {
+        return boost::filesystem::path(store);
+    }
+    
+    return boost::filesystem::path(store) 
+            / boost::filesystem::path(file.stem().string() + extension);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// isBatch
+////////////////////////////////////////////////////////////////////////////////
+
+bool BatchProcessing::isBatch(std::string input) {
+    
+    if (boost::filesystem::is_directory(input)) {
+        return true;
+    }
+    
+    if (input.find_first_of("*?") != std::string::npos) {
+        return true;
+    }
+    
+    std::string extension = boost::filesystem::path(input).extension().string();
+    return extension == ".txt" || extension == ".lst";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// listImages
+////////////////////////////////////////////////////////////////////////////////
+
+void BatchProcessing::listImages(std::string input, 
+        std::vector<boost::filesystem::path> &files) {
+    
+    files.clear();
+    
+    std::vector<std::string> extensions;
+    IOUtil::getImageExtensions(extensions);
+    
+    if (boost::filesystem::is_directory(input)) {
+        std::multimap<std::string, boost::filesystem::path> images;
+        IOUtil::readDirectory(input, extensions, images);
+        
+        for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
+                it != images.end(); ++it) {
+            files.push_back(it->second);
+        }
+    }
+    else if (input.find_first_of("*?") != std::string::npos) {
+        
+        // Wildcards are only supported in the file name.
+        boost::filesystem::path pattern(input);
+        boost::filesystem::path directory = pattern.parent_path();
+        if (directory.empty()) {
+            directory = ".";
+        }
+        
+        std::string expression;
+        std::string filename = pattern.filename().string();
+        for (unsigned int i = 0; i < filename.size(); ++i) {
+            if (filename[i] == '*') {
+                expression += ".*";
+            }
+            else if (filename[i] == '?') {
+                expression += ".";
+            }
+            else if (std::string("\\^$.|+()[]{}").find(filename[i]) != std::string::npos) {
+                expression += std::string("\\") + filename[i];
+            }
+            else {
+                expression += filename[i];
+            }
+        }
+        
+        std::regex regex(expression);
+        
+        std::multimap<std::string, boost::filesystem::path> images;
+        IOUtil::readDirectory(directory, extensions, images);
+        
+        for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
+                it != images.end(); ++it) {
+            if (std::regex_match(it->second.filename().string(), regex)) {
+                files.push_back(it->second);
+            }
+        }
+    }
+    else {
+        std::ifstream list(input);
+        LOG_IF(FATAL, !list.is_open()) << "Could not open image list: " << input << ".";
+        
+        // Relative paths are relative to the list.
+        boost::filesystem::path directory = boost::filesystem::path(input).parent_path();
+        
+        std::string line;
+        while (std::getline(list, line)) {
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            
+            boost::filesystem::path file(line);
+            if (file.is_relative()) {
+                file = directory / file;
+            }
+            
+            files.push_back(file);
+        }
+    }
+    
+    LOG_IF(FATAL, files.empty()) << "No images found: " << input << ".";
+}
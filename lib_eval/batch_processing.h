@@ -0,0 +1,167 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BATCH_PROCESSING_H
+#define	BATCH_PROCESSING_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+
+/** \brief Runs a superpixel algorithm on a single image or on a batch of
+ * images within one process.
+ * 
+ * The input is either a single image, a directory, a glob pattern on the file 
+ * name (e.g. images/test_*.jpg) or a text file (.txt or .lst) listing one image per
+ * line. For a single image, the outputs are file names; for a batch, the outputs 
+ * are directories and files are named after the image, with the suffixes 
+ * _contours, _mean and _random for the visualizations, so the directories 
+ * may coincide. A reader thread loads 
+ * the images into a bounded queue, from which a pool of workers computes the 
+ * superpixels and writes the outputs.
+ * 
+ * \author David Stutz
+ */
+class BatchProcessing {
+public:
+    
+    /** \brief Computes the superpixel labels of a single image; may modify the 
+     * image, e.g. smooth it. Has to be thread-safe when using multiple threads.
+     */
+    typedef std::function<void(cv::Mat &image, cv::Mat &labels)> Algorithm;
+    
+    /** \brief Same as Algorithm, but also given the path to the image, e.g. to
+     * write additional outputs using getOutputFile.
+     */
+    typedef std::function<void(const boost::filesystem::path &file, 
+            cv::Mat &image, cv::Mat &labels)> FileAlgorithm;
+    
+    /** \brief Constructor.
+     * \param[in] store_contour file or directory for contour images, empty to skip
+     * \param[in] store_mean file or directory for mean colored images, empty to skip
+     * \param[in] store_random file or directory for randomly colored images, empty to skip
+     * \param[in] store_labels file or directory for labels, empty to skip
+     */
+    BatchProcessing(std::string store_contour, std::string store_mean, 
+            std::string store_random, std::string store_labels);
+    
+    /** \brief Set the label format used for batches (the format of a single 
+     * label file is given by its extension).
+     * \param[in] format csv, bin or rle
+     */
+    void setFormat(std::string format);
+    
+    /** \brief Set the number of images processed in parallel.
+     * \param[in] threads number of threads, 0 to use all available cores
+     */
+    void setThreads(int threads);
+    
+    /** \brief Set the number of images read ahead.
+     * \param[in] prefetch maximum number of images waiting to be processed
+     */
+    void setPrefetch(int prefetch);
+    
+    /** \brief Run the algorithm on all images of the input.
+     * \param[in] input image, directory, glob pattern or list file
+     * \param[in] algorithm algorithm to run
+     * \return number of processed images
+     */
+    int process(std::string input, Algorithm algorithm);
+    
+    /** \brief Run the algorithm on all images of the input.
+     * \param[in] input image, directory, glob pattern or list file
+     * \param[in] algorithm algorithm to run, given the path to each image
+     * \return number of processed images
+     */
+    int process(std::string input, FileAlgorithm algorithm);
+    
+    /** \brief Check whether the input denotes a batch of images.
+     * \param[in] input image, directory, glob pattern or list file
+     * \return whether the input is a batch
+     */
+    static bool isBatch(std::string input);
+    
+    /** \brief List the images of the input.
+     * \param[in] input image, directory, glob pattern or list file
+     * \param[out] files images
+     */
+    static void listImages(std::string input, std::vector<boost::filesystem::path> &files);
+    
+    /** \brief Fail if two images share a stem, as their outputs in a batch 
+     * would overwrite each other (e.g. a.jpg and a.png).
+     * \param[in] files images
+     */
+    static void checkUniqueStems(const std::vector<boost::filesystem::path> &files);
+    
+    /** \brief Get the output file for an image.
+     * \param[in] store output file or directory
+     * \param[in] file path to the image
+     * \param[in] extension extension of the output file in batches
+     * \param[in] batch whether the output is a directory
+     * \return output file
+     */
+    static boost::filesystem::path getOutputFile(std::string store, 
+            const boost::filesystem::path &file, std::string extension, bool batch);
+    
+protected:
+    
+    /** \brief Run the algorithm on an image and write the outputs.
+     * \param[in] file path to the image
+     * \param[in] image image
+     * \param[in] batch whether the outputs are directories
+     * \param[in] algorithm algorithm to run
+     * \param[in,out] labels label matrix, reused by each worker across images
+     * so algorithms writing into it in place do not reallocate it
+     */
+    void processImage(const boost::filesystem::path &file, cv::Mat &image, 
+            bool batch, FileAlgorithm algorithm, cv::Mat &labels);
+    
+    /** \brief File or directory for contour images. */
+    std::string store_contour;
+    /** \brief File or directory for mean colored images. */
+    std::string store_mean;
+    /** \brief File or directory for randomly colored images. */
+    std::string store_random;
+    /** \brief File or directory for labels. */
+    std::string store_labels;
+    /** \brief Extension of label files in batches. */
+    std::string label_extension;
+    /** \brief Number of threads. */
+    int threads;
+    /** \brief Maximum number of images read ahead. */
+    int prefetch;
+    
+};
+
+#endif	/* BATCH_PROCESSING_H */
+
@@ -0,0 +1,217 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cmath>
+#include <glog/logging.h>
+#include "boundary_evaluation.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+////////////////////////////////////////////////////////////////////////////////
+
+BoundaryEvaluation::BoundaryEvaluation(const cv::Mat &labels, const cv::Mat &gt,
+        float d) {
+
+    LOG_IF(FATAL, labels.rows != gt.rows || labels.cols != gt.cols)
+            << "Superpixel segmentation does not match ground truth size.";
+
+    r = computeRadius(gt.rows, gt.cols, d);
+
+    computeBoundaryMap(labels, sp_boundary);
+    computeBoundaryMap(gt, gt_boundary);
+
+    computeBoundaryDistance(sp_boundary, sp_distance);
+    computeBoundaryDistance(gt_boundary, gt_distance);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeBoundaryRecall
+////////////////////////////////////////////////////////////////////////////////
+
+float BoundaryEvaluation::computeBoundaryRecall() const {
+
+    float tp = 0;
+    float fn = 0;
+
+    for (int i = 0; i < gt_boundary.rows; ++i) {
+        const unsigned char* gt_row = gt_boundary.ptr<unsigned char>(i);
+        const float* sp_distance_row = sp_distance.ptr<float>(i);
+
+        for (int j = 0; j < gt_boundary.cols; ++j) {
+            if (gt_row[j] > 0) {
+                if (sp_distance_row[j] <= r) {
+                    tp++;
+                }
+                else {
+                    fn++;
+                }
+            }
+        }
+    }
+
+    if (tp + fn > 0) {
+        return tp/(tp + fn);
+    }
+
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeBoundaryPrecision
+////////////////////////////////////////////////////////////////////////////////
+
+float BoundaryEvaluation::computeBoundaryPrecision() const {
+
+    float tp = 0;
+    float fp = 0;
+
+    for (int i = 0; i < gt_boundary.rows; ++i) {
+        const unsigned char* gt_row = gt_boundary.ptr<unsigned char>(i);
+        const unsigned char* sp_row = sp_boundary.ptr<unsigned char>(i);
+        const float* gt_distance_row = gt_distance.ptr<float>(i);
+        const float* sp_distance_row = sp_distance.ptr<float>(i);
+
+        for (int j = 0; j < gt_boundary.cols; ++j) {
+            if (gt_row[j] > 0) {
+                if (sp_distance_row[j] <= r) {
+                    tp++;
+                }
+            }
+            else if (sp_row[j] > 0) {
+                if (gt_distance_row[j] > r) {
+                    fp++;
+                }
+            }
+        }
+    }
+
+    if (tp + fp > 0) {
+        return tp/(tp + fp);
+    }
+
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeEdgeRecall
+////////////////////////////////////////////////////////////////////////////////
+
+float BoundaryEvaluation::computeEdgeRecall(const cv::Mat &labels, const cv::Mat &edges,
+        float d) {
+
+    LOG_IF(FATAL, labels.rows != edges.rows || labels.cols != edges.cols)
+            << "Superpixel segmentation does not match ground truth size.";
+
+    int r = computeRadius(edges.rows, edges.cols, d);
+
+    cv::Mat sp_boundary;
+    computeBoundaryMap(labels, sp_boundary);
+
+    cv::Mat sp_distance;
+    computeBoundaryDistance(sp_boundary, sp_distance);
+
+    float tp = 0;
+    float fn = 0;
+
+    for (int i = 0; i < edges.rows; ++i) {
+        const unsigned char* edges_row = edges.ptr<unsigned char>(i);
+        const float* sp_distance_row = sp_distance.ptr<float>(i);
+
+        for (int j = 0; j < edges.cols; ++j) {
+            if (edges_row[j] > 100) {
+                if (sp_distance_row[j] <= r) {
+                    tp++;
+                }
+                else {
+                    fn += ((float) edges_row[j])/255;
+                }
+            }
+        }
+    }
+
+    if (tp + fn > 0) {
+        return tp/(tp + fn);
+    }
+
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeBoundaryMap
+////////////////////////////////////////////////////////////////////////////////
+
+int BoundaryEvaluation::computeBoundaryMap(const cv::Mat &labels, cv::Mat &boundary) {
+
+    int H = labels.rows;
+    int W = labels.cols;
+
+    boundary.create(H, W, CV_8UC1);
+
+    int count = 0;
+    for (int i = 0; i < H; ++i) {
+        const int* row = labels.ptr<int>(i);
+        const int* row_above = (i > 0) ? labels.ptr<int>(i - 1) : row;
+        const int* row_below = (i < H - 1) ? labels.ptr<int>(i + 1) : row;
+        unsigned char* boundary_row = boundary.ptr<unsigned char>(i);
+
+        for (int j = 0; j < W; ++j) {
+            int label = row[j];
+            bool is_boundary = label != row_above[j] || label != row_below[j]
+                    || (j > 0 && label != row[j - 1])
+                    || (j < W - 1 && label != row[j + 1]);
+
+            boundary_row[j] = is_boundary ? 1 : 0;
+            count += is_boundary ? 1 : 0;
+        }
+    }
+
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeBoundaryDistance
+////////////////////////////////////////////////////////////////////////////////
+
+void BoundaryEvaluation::computeBoundaryDistance(const cv::Mat &boundary,
+        cv::Mat &distance) {
+
+    // cv::distanceTransform computes the distance to the nearest zero pixel.
+    cv::Mat inverted = 1 - boundary;
+    cv::distanceTransform(inverted, distance, CV_DIST_C, 3);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeRadius
+////////////////////////////////////////////////////////////////////////////////
+
+int BoundaryEvaluation::computeRadius(int rows, int cols, float d) {
+    return std::round(d*std::sqrt(rows*rows + cols*cols));
+}
@@ -0,0 +1,111 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BOUNDARY_EVALUATION_H
+#define	BOUNDARY_EVALUATION_H
+
+#include <opencv2/opencv.hpp>
+
+/** \brief Computes Boundary Recall, Boundary Precision and Edge Recall in
+ * O(HW) by computing the 4-connected boundary maps once and answering the
+ * tolerance queries using chessboard distance transforms.
+ *
+ * The tolerance window used in Evaluation is the (2r + 1) x (2r + 1) square
+ * around each pixel, so a boundary pixel lies within the window if and only
+ * if its chessboard distance is at most r; the results are therefore identical
+ * to Evaluation::computeBoundaryRecallReference and
+ * Evaluation::computeBoundaryPrecisionReference.
+ *
+ * \author David Stutz
+ */
+class BoundaryEvaluation {
+public:
+    /** \brief Constructor, computes boundary maps and distance transforms.
+     * \param[in] labels superpixel labels as int image
+     * \param[in] gt ground truth segmentation as int image
+     * \param[in] d fraction of the diagonal to use as tolerance
+     */
+    BoundaryEvaluation(const cv::Mat &labels, const cv::Mat &gt, float d = 0.0025);
+
+    /** \brief Compute boundary recall, see Evaluation::computeBoundaryRecall.
+     * \return Rec(labels, gt)
+     */
+    float computeBoundaryRecall() const;
+
+    /** \brief Compute boundary precision, see Evaluation::computeBoundaryPrecision.
+     * \return Pre(labels, gt)
+     */
+    float computeBoundaryPrecision() const;
+
+    /** \brief Compute edge recall, see Evaluation::computeEdgeRecall.
+     * \param[in] labels superpixel labels as int image
+     * \param[in] edges and edge map as unsigned char image
+     * \param[in] d fraction of the diagonal used as tolerance
+     * \return edge recall
+     */
+    static float computeEdgeRecall(const cv::Mat &labels, const cv::Mat &edges,
+            float d = 0.0025);
+
+    /** \brief Compute the 4-connected boundary map of a segmentation.
+     * \param[in] labels labels as int image
+     * \param[out] boundary boundary map as unsigned char image, 1 for boundary pixels
+     * \return number of boundary pixels
+     */
+    static int computeBoundaryMap(const cv::Mat &labels, cv::Mat &boundary);
+
+    /** \brief Compute the chessboard distance to the nearest boundary pixel.
+     * \param[in] boundary boundary map as unsigned char image
+     * \param[out] distance distance as float image
+     */
+    static void computeBoundaryDistance(const cv::Mat &boundary, cv::Mat &distance);
+
+    /** \brief Compute the tolerance radius in pixels.
+     * \param[in] rows number of rows
+     * \param[in] cols number of columns
+     * \param[in] d fraction of the diagonal used as tolerance
+     * \return radius
+     */
+    static int computeRadius(int rows, int cols, float d);
+
+private:
+    /** \brief Tolerance radius in pixels. */
+    int r;
+    /** \brief Superpixel boundary map. */
+    cv::Mat sp_boundary;
+    /** \brief Ground truth boundary map. */
+    cv::Mat gt_boundary;
+    /** \brief Distance to the nearest superpixel boundary pixel. */
+    cv::Mat sp_distance;
+    /** \brief Distance to the nearest ground truth boundary pixel. */
+    cv::Mat gt_distance;
+};
+
+#endif	/* BOUNDARY_EVALUATION_H */
@@ -32,6 +32,9 @@
 #include <limits>
 #include <glog/logging.h>
 #include "io_util.h"
+#include "boundary_evaluation.h"
+#include "intersection_statistics.h"
+#include "superpixel_statistics.h"
 #include "evaluation.h"
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -41,6 +44,17 @@
 float Evaluation::computeBoundaryRecall(const cv::Mat &labels, 
         const cv::Mat &gt, float d) {
     
+    BoundaryEvaluation boundary_evaluation(labels, gt, d);
+    return boundary_evaluation.computeBoundaryRecall();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeBoundaryRecallReference
+////////////////////////////////////////////////////////////////////////////////
+
+float Evaluation::computeBoundaryRecallReference(const cv::Mat &labels, 
+        const cv::Mat &gt, float d) {
+    
     LOG_IF(FATAL, labels.rows != gt.rows || labels.cols != gt.cols) 
             << "Superpixel segmentation does not match ground truth size.";
     
@@ -89,6 +103,17 @@ float Evaluation::computeBoundaryRecall(const cv::Mat &labels,
 float Evaluation::computeBoundaryPrecision(const cv::Mat &labels, 
         const cv::Mat &gt, float d) {
     
+    BoundaryEvaluation boundary_evaluation(labels, gt, d);
+    return boundary_evaluation.computeBoundaryPrecision();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeBoundaryPrecisionReference
+////////////////////////////////////////////////////////////////////////////////
+
+float Evaluation::computeBoundaryPrecisionReference(const cv::Mat &labels, 
+        const cv::Mat &gt, float d) {
+    
     LOG_IF(FATAL, labels.rows != gt.rows || labels.cols != gt.cols) 
             << "Superpixel segmentation does not match ground truth size.";
     
@@ -150,38 +175,8 @@ float Evaluation::computeBoundaryPrecision(const cv::Mat &labels,
 float Evaluation::computeUndersegmentationError(const cv::Mat &labels, 
         const cv::Mat &gt) {
     
-    LOG_IF(FATAL, labels.rows != gt.rows || labels.cols != gt.cols) 
-            << "Superpixel segmentation does not match ground truth size.";
-    
-    int H = gt.rows;
-    int W = gt.cols;
-    int N = H*W;
-
-    cv::Mat intersection_matrix;
-    std::vector<int> superpixel_sizes;
-    std::vector<int> gt_sizes;
-    
-    Evaluation::computeIntersectionMatrix(labels, gt, intersection_matrix, 
-            superpixel_sizes, gt_sizes);
-
-    float error = 0;
-    for (int j = 0; j < intersection_matrix.cols; ++j) {
-
-        int min = std::numeric_limits<int>::max();
-        for (int i = 0; i < intersection_matrix.rows; ++i) {
-            int superpixel_j_minus_gt_i = superpixel_sizes[j]
-                    - intersection_matrix.at<int>(i, j);
-
-            LOG_IF(FATAL, superpixel_j_minus_gt_i < 0) << "Set difference is negative.";
-            if (superpixel_j_minus_gt_i < min) {
-                min = superpixel_j_minus_gt_i;
-            }
-        }
-
-        error += min;
-    }
-
-    return error/N;
+    IntersectionStatistics intersection_statistics(labels, gt);
+    return intersection_statistics.computeUndersegmentationError();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -191,38 +186,8 @@ float Evaluation::computeUndersegmentationError(const cv::Mat &labels,
 float Evaluation::computeOversegmentationError(const cv::Mat &labels, 
         const cv::Mat &gt) {
     
-    LOG_IF(FATAL, labels.rows != gt.rows || labels.cols != gt.cols) 
-            << "Superpixel segmentation does not match ground truth size.";
-    
-    int H = gt.rows;
-    int W = gt.cols;
-    int N = H*W;
-        
-    cv::Mat intersection_matrix;
-    std::vector<int> superpixel_sizes;
-    std::vector<int> gt_sizes;
-    
-    Evaluation::computeIntersectionMatrix(labels, gt, intersection_matrix, 
-            superpixel_sizes, gt_sizes);
-    
-    float error = 0;
-    for (int i = 0; i < intersection_matrix.rows; ++i) {
-
-        int min = std::numeric_limits<int>::max();
-        for (int j = 0; j < intersection_matrix.cols; ++j) {
-            int gt_i_minus_superpixel_j = gt_sizes[i]
-                    - intersection_matrix.at<int>(i, j);
-
-            LOG_IF(FATAL, gt_i_minus_superpixel_j < 0) << "Set difference is negative.";
-            if (gt_i_minus_superpixel_j < min) {
-                min = gt_i_minus_superpixel_j;
-            }
-        }
-
-        error += min;
-    }
-    
-    return error /= N;
+    IntersectionStatistics intersection_statistics(labels, gt);
+    return intersection_statistics.computeOversegmentationError();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -232,32 +197,8 @@ float Evaluation::computeOversegmentationError(const cv::Mat &labels,
 float Evaluation::computeNPUndersegmentationError(const cv::Mat &labels, 
         const cv::Mat &gt) {
     
-    LOG_IF(FATAL, labels.rows != gt.rows || labels.cols != gt.cols) 
-            << "Superpixel segmentation does not match ground truth size.";
-    
-    int N = gt.rows*gt.cols;
-        
-    cv::Mat intersection_matrix;
-    std::vector<int> superpixel_sizes;
-    std::vector<int> gt_sizes;
-
-    Evaluation::computeIntersectionMatrix(labels, gt, 
-            intersection_matrix, superpixel_sizes, gt_sizes);
-    
-    float error = 0;
-    for (int i = 0; i < intersection_matrix.rows; ++i) {
-        for (int j = 0; j < intersection_matrix.cols; ++j) {
-            if (intersection_matrix.at<int>(i, j) > 0) {
-                LOG_IF (ERROR, superpixel_sizes[j] - intersection_matrix.at<int>(i, j) < 0)
-                        << "Invalid intersection computed, set difference is negative!";
-                
-                error += std::min(intersection_matrix.at<int>(i, j), 
-                        superpixel_sizes[j] - intersection_matrix.at<int>(i, j));
-            }
-        }
-    }
-
-    return error/N;
+    IntersectionStatistics intersection_statistics(labels, gt);
+    return intersection_statistics.computeNPUndersegmentationError();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -267,32 +208,8 @@ float Evaluation::computeNPUndersegmentationError(const cv::Mat &labels,
 float Evaluation::computeLevinUndersegmentationError(const cv::Mat &labels, 
         const cv::Mat &gt) {
     
-    cv::Mat intersection_matrix;
-    std::vector<int> superpixel_sizes;
-    std::vector<int> gt_sizes;
-
-    Evaluation::computeIntersectionMatrix(labels, gt, 
-            intersection_matrix, superpixel_sizes, gt_sizes);
-    
-    float error = 0;
-    for (int i = 0; i < intersection_matrix.rows; i++) {
-        
-        float gt_error = 0;
-        for (int j = 0; j < intersection_matrix.cols; j++) {
-            if (intersection_matrix.at<int>(i, j) > 0) {
-                gt_error += superpixel_sizes[j];
-            }
-        }
-        
-        gt_error -= gt_sizes[i];
-        
-        if (gt_sizes[i] > 0) {
-            gt_error /= gt_sizes[i];
-            error += gt_error;
-        }
-    }
-    
-    return error/gt_sizes.size();
+    IntersectionStatistics intersection_statistics(labels, gt);
+    return intersection_statistics.computeLevinUndersegmentationError();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -302,34 +219,8 @@ float Evaluation::computeLevinUndersegmentationError(const cv::Mat &labels,
 float Evaluation::computeAchievableSegmentationAccuracy(const cv::Mat &labels, 
         const cv::Mat &gt) {
     
-    LOG_IF(FATAL, labels.rows != gt.rows || labels.cols != gt.cols) 
-            << "Superpixel segmentation does not match ground truth size.";
-    
-    int H = gt.rows;
-    int W = gt.cols;
-    int N = H*W;
-        
-    cv::Mat intersection_matrix;
-    std::vector<int> superpixel_sizes;
-    std::vector<int> gt_sizes;
-
-    Evaluation::computeIntersectionMatrix(labels, gt, 
-            intersection_matrix, superpixel_sizes, gt_sizes);
-
-    float accuracy = 0;
-    for (int j = 0; j < intersection_matrix.cols; ++j) {
-
-        int max = 0;
-        for (int i = 0; i < intersection_matrix.rows; ++i) {
-            if (intersection_matrix.at<int>(i, j) > max) {
-                max = intersection_matrix.at<int>(i, j);
-            }
-        }
-
-        accuracy += max;
-    }
-
-    return accuracy/N;
+    IntersectionStatistics intersection_statistics(labels, gt);
+    return intersection_statistics.computeAchievableSegmentationAccuracy();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -339,49 +230,8 @@ float Evaluation::computeAchievableSegmentationAccuracy(const cv::Mat &labels,
 float Evaluation::computeSumOfSquaredErrorRGB(const cv::Mat &labels,
         const cv::Mat &image) {
     
-    LOG_IF(FATAL, image.channels() != 3) << "Currently only 3-channel images are supported.";
-    LOG_IF(FATAL, labels.rows != image.rows || labels.cols != image.cols) 
-            << "Superpixel segmentation does not match image size.";
-    
-    int superpixels = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > superpixels) {
-                superpixels = labels.at<int>(i, j);
-            }
-        }
-    }
-    
-    superpixels++;
-    
-    std::vector<cv::Vec3f> mean(superpixels, cv::Vec3f(0, 0, 0));
-    std::vector<int> count(superpixels, 0);
-    
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            for (int c = 0; c < image.channels(); ++c) {
-                mean[labels.at<int>(i, j)][c] += image.at<cv::Vec3b>(i, j)[c];
-            }
-            
-            count[labels.at<int>(i, j)]++;
-        }
-    }
-    
-    for (int k = 0; k < superpixels; k++) {
-        mean[k] /= count[k];
-    }
-    
-    float squared_sum = 0;
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            for (int c = 0; c < image.channels(); ++c) {
-                squared_sum += (mean[labels.at<int>(i, j)][c] - image.at<cv::Vec3b>(i, j)[c])
-                        * (mean[labels.at<int>(i, j)][c] - image.at<cv::Vec3b>(i, j)[c]);
-            }
-        }
-    }
-    
-    return squared_sum/(image.rows*image.cols);
+    SuperpixelStatistics superpixel_statistics(labels, image);
+    return superpixel_statistics.computeSumOfSquaredErrorRGB();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -391,47 +241,11 @@ float Evaluation::computeSumOfSquaredErrorRGB(const cv::Mat &labels,
 float Evaluation::computeSumOfSquaredErrorXY(const cv::Mat &labels,
         const cv::Mat &image) {
     
-    LOG_IF(FATAL, image.channels() != 3) << "Currently only 3-channel images are supported.";
     LOG_IF(FATAL, labels.rows != image.rows || labels.cols != image.cols) 
             << "Superpixel segmentation does not match image size.";
     
-    int superpixels = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > superpixels) {
-                superpixels = labels.at<int>(i, j);
-            }
-        }
-    }
-    
-    superpixels++;
-    
-    std::vector<cv::Vec2f> mean(superpixels, cv::Vec2f(0, 0));
-    std::vector<int> count(superpixels, 0);
-    
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            mean[labels.at<int>(i, j)][0] += i;
-            mean[labels.at<int>(i, j)][1] += j;
-            count[labels.at<int>(i, j)]++;
-        }
-    }
-    
-    for (int k = 0; k < superpixels; k++) {
-        mean[k] /= count[k];
-    }
-    
-    float squared_sum = 0;
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            squared_sum += (mean[labels.at<int>(i, j)][0] - i)
-                    * (mean[labels.at<int>(i, j)][0] - i);
-            squared_sum += (mean[labels.at<int>(i, j)][1] - j)
-                    * (mean[labels.at<int>(i, j)][1] - j);
-        }
-    }
-    
-    return squared_sum/(image.rows*image.cols);
+    SuperpixelStatistics superpixel_statistics(labels);
+    return superpixel_statistics.computeSumOfSquaredErrorXY();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -441,59 +255,8 @@ float Evaluation::computeSumOfSquaredErrorXY(const cv::Mat &labels,
 float Evaluation::computeExplainedVariation(const cv::Mat &labels,
         const cv::Mat &image) {
     
-    LOG_IF(FATAL, image.channels() != 3) << "Currently only 3-channel images are supported.";
-    LOG_IF(FATAL, labels.rows != image.rows || labels.cols != image.cols) 
-            << "Superpixel segmentation does not match image size.";
-    
-    int superpixels = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > superpixels) {
-                superpixels = labels.at<int>(i, j);
-            }
-        }
-    }
-    
-    superpixels++;
-    
-    std::vector<cv::Vec3f> mean(superpixels, cv::Vec3f(0, 0, 0));
-    std::vector<cv::Vec3f> squared_mean(superpixels, cv::Vec3f(0, 0, 0));
-    std::vector<int> count(superpixels, 0);
-    
-    cv::Vec3f overall_mean = 0;
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            for (int c = 0; c < image.channels(); ++c) {
-                mean[labels.at<int>(i, j)][c] += image.at<cv::Vec3b>(i, j)[c];
-                overall_mean[c] += image.at<cv::Vec3b>(i, j)[c];
-            }
-            
-            count[labels.at<int>(i, j)]++;
-        }
-    }
-    
-    for (int i = 0; i < superpixels; ++i) {
-        for (int c = 0; c < image.channels(); ++c) {
-            mean[i][c] /= count[i];
-        }
-    }
-    
-    overall_mean /= image.rows*image.cols;
-    
-    float sum_top = 0;
-    float sum_bottom = 0;
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            for (int c = 0; c < image.channels(); ++c) {
-                sum_top += (mean[labels.at<int>(i, j)][c] - overall_mean[c])
-                        *(mean[labels.at<int>(i, j)][c] - overall_mean[c]);
-                sum_bottom += (image.at<cv::Vec3b>(i, j)[c] - overall_mean[c])
-                        *(image.at<cv::Vec3b>(i, j)[c] - overall_mean[c]);
-            }
-        }
-    }
-    
-    return sum_top/sum_bottom;
+    SuperpixelStatistics superpixel_statistics(labels, image);
+    return superpixel_statistics.computeExplainedVariation();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -545,69 +308,8 @@ float Evaluation::computeMeanDistanceToEdge(const cv::Mat &labels,
 float Evaluation::computeIntraClusterVariation(const cv::Mat &labels, 
         const cv::Mat &image) {
     
-    LOG_IF(FATAL, image.channels() != 3) << "Currently only 3-channel images are supported.";
-    LOG_IF(FATAL, labels.rows != image.rows || labels.cols != image.cols) 
-            << "Superpixel segmentation does not match image size.";
-    
-    int superpixels = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > superpixels) {
-                superpixels = labels.at<int>(i, j);
-            }
-        }
-    }
-    
-    superpixels++;
-    
-    std::vector<cv::Vec3f> mean(superpixels, cv::Vec3f(0, 0, 0));
-    std::vector<int> count(superpixels, 0);
-    
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            for (int c = 0; c < image.channels(); ++c) {
-                mean[labels.at<int>(i, j)][c] += image.at<cv::Vec3b>(i, j)[c];
-            }
-            
-            ++count[labels.at<int>(i, j)];
-        }
-    }
-    
-    for (int i = 0; i < superpixels; ++i) {
-        for (int c = 0; c < image.channels(); ++c) {
-            if (count[i] > 0) {
-                mean[i][c] /= count[i];
-            }
-        }
-    }
-    
-    std::vector<float> variance(superpixels, 0);
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            for (int c = 0; c < image.channels(); ++c) {
-                variance[labels.at<int>(i, j)] += (image.at<cv::Vec3b>(i, j)[c] - mean[labels.at<int>(i, j)][c])
-                        * (image.at<cv::Vec3b>(i, j)[c] - mean[labels.at<int>(i, j)][c]);
-            }
-        }
-    }
-    
-    for (int i = 0; i < superpixels; ++i) {
-        if (count[i] > 0) {
-            variance[i] /= count[i];
-            variance[i] = std::sqrt(variance[i]);
-        }
-    }
-    
-    float sum = 0;
-    for (int i = 0; i < superpixels; ++i) {
-        sum += variance[i];
-    }
-    
-    if (superpixels > 0) {
-        return sum/superpixels;
-    }
-    
-    return sum;
+    SuperpixelStatistics superpixel_statistics(labels, image);
+    return superpixel_statistics.computeIntraClusterVariation();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -616,82 +318,8 @@ float Evaluation::computeIntraClusterVariation(const cv::Mat &labels,
 
 float Evaluation::computeCompactness(const cv::Mat &labels) {
     
-    int superpixels = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > superpixels) {
-                superpixels = labels.at<int>(i, j);
-            }
-        }
-    }
-    
-    superpixels++;
-    
-    std::vector<float> perimeter(superpixels, 0);
-//    std::vector<float> old_perimeter(superpixels, 0);
-    std::vector<float> area(superpixels, 0); // = number of pixels!
-    
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            
-            int count = 0;
-            if (i > 0) {
-                if (labels.at<int>(i, j) != labels.at<int>(i - 1, j)) {
-                    count++;
-                }
-            }
-            else {
-                count++;
-            }
-
-            if (i < labels.rows - 1) {
-                if (labels.at<int>(i, j) != labels.at<int>(i + 1, j)) {
-                    count++;
-                }
-            }
-            else {
-                count++;
-            }
-
-            if (j > 0) {
-                if (labels.at<int>(i, j) != labels.at<int>(i, j - 1)) {
-                    count++;
-                }
-            }
-            else {
-                count++;
-            }
-
-            if (j < labels.cols - 1) {
-                if (labels.at<int>(i, j) != labels.at<int>(i, j + 1)) {
-                    count++;
-                }
-            }
-            else {
-                count++;
-            }
-            
-            perimeter[labels.at<int>(i, j)] += count;
-            area[labels.at<int>(i, j)] += 1;
-        }
-    }
-    
-    float compactness = 0;
-//    float old_compactness = 0;
-    
-    for (int i = 0; i < superpixels; ++i) {
-        if (perimeter[i] > 0) {
-            compactness += area[i] * (4*M_PI*area[i])/(perimeter[i]*perimeter[i]);
-        }
-//        old_compactness += area[i] * (4*M_PI*area[i])/(old_perimeter[i]*old_perimeter[i]);
-    }
-    
-    compactness /= labels.rows*labels.cols;
-//    old_compactness /= labels.rows*labels.cols;
-    LOG_IF (ERROR, compactness > 1.0f) 
-            << "Invalid compactness: " << compactness;
-    
-    return compactness;
+    SuperpixelStatistics superpixel_statistics(labels);
+    return superpixel_statistics.computeCompactness();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -839,53 +467,9 @@ int Evaluation::computeSuperpixels(const cv::Mat &labels) {
 void Evaluation::computeSuperpixelSizes(const cv::Mat& labels, float& average_size, 
         int& min_size, int& max_size, float &size_variation) {
     
-    int max_label = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > max_label) {
-                max_label = labels.at<int>(i, j);
-            }
-        }
-    }
-    
-    std::vector<unsigned long long int> counts(max_label + 1, 0);
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            LOG_IF (FATAL, labels.at<int>(i, j) > max_label) << labels.at<int>(i, j);
-            counts[labels.at<int>(i, j)]++;
-        }
-    }
-    
-    unsigned long long int sum = 0;
-    unsigned long long int squared_sum = 0;
-    int superpixels = 0;
-    
-    min_size = std::numeric_limits<int>::max();
-    max_size = 0;
-    
-    for (unsigned int k = 0; k < counts.size(); k++) {
-        if (counts[k] > 0) {
-            superpixels++;
-            
-            sum += counts[k];
-            squared_sum += counts[k]*counts[k];
-            
-            if (counts[k] < min_size) {
-                min_size = counts[k];
-            }
-            if (counts[k] > max_size) {
-                max_size = counts[k];
-            }
-        }
-    }
-    
-    if (superpixels > 0) {
-        average_size = (double) sum / superpixels;
-        
-        float variance = (double) squared_sum / superpixels - (double) sum / superpixels * (double) sum / superpixels;
-        LOG_IF(ERROR, variance < 0) << "Invalid variance: " << variance <<  " " << squared_sum << " " << sum << " " << superpixels;
-        size_variation = std::sqrt(variance);
-    }
+    SuperpixelStatistics superpixel_statistics(labels);
+    superpixel_statistics.computeSuperpixelSizes(average_size, min_size, 
+            max_size, size_variation);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -894,6 +478,15 @@ void Evaluation::computeSuperpixelSizes(const cv::Mat& labels, float& average_si
 
 float Evaluation::computeEdgeRecall(const cv::Mat &labels, const cv::Mat &edges,
         float d) {
+    return BoundaryEvaluation::computeEdgeRecall(labels, edges, d);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeEdgeRecallReference
+////////////////////////////////////////////////////////////////////////////////
+
+float Evaluation::computeEdgeRecallReference(const cv::Mat &labels, const cv::Mat &edges,
+        float d) {
     LOG_IF(FATAL, labels.rows != edges.rows || labels.cols != edges.cols) 
             << "Superpixel segmentation does not match ground truth size.";
     
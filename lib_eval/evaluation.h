@@ -74,6 +74,8 @@ public:
      * pixel in S is allowed to deviate by a euclidean distance of d times the
      * image diagonal.
      * 
+     * Computed in O(HW) using BoundaryEvaluation.
+     * 
      * \param[in] labels superpixel labels as int image
      * \param[in] gt ground truth segmentation as int image
      * \param[in] d fraction of the diagonal to use as tolerance
@@ -82,6 +84,16 @@ public:
     static float computeBoundaryRecall(const cv::Mat &labels, 
             const cv::Mat &gt, float d = 0.0025);
     
+    /** \brief Reference implementation of computeBoundaryRecall searching the
+     * full tolerance window around each ground truth boundary pixel.
+     * \param[in] labels superpixel labels as int image
+     * \param[in] gt ground truth segmentation as int image
+     * \param[in] d fraction of the diagonal to use as tolerance
+     * \return Rec(labels, gt)
+     */
+    static float computeBoundaryRecallReference(const cv::Mat &labels, 
+            const cv::Mat &gt, float d = 0.0025);
+    
     /** \brief Compute boundary precision:
      * 
      *  \f$Pre(S, G) = \frac{TP}{TP + FP}\f$
@@ -93,6 +105,8 @@ public:
      * pixel in S is allowed to deviate by a euclidean distance of d times the
      * image diagonal.
      * 
+     * Computed in O(HW) using BoundaryEvaluation.
+     * 
      * \param[in] labels superpixel labels as int image
      * \pram[in] gt ground truth segmentation as int image
      * \param[in] d fraction of the diagonal to use as tolerance
@@ -101,6 +115,16 @@ public:
     static float computeBoundaryPrecision(const cv::Mat &labels, 
             const cv::Mat &gt, float d = 0.0025);
     
+    /** \brief Reference implementation of computeBoundaryPrecision searching the
+     * full tolerance window around each boundary pixel.
+     * \param[in] labels superpixel labels as int image
+     * \pram[in] gt ground truth segmentation as int image
+     * \param[in] d fraction of the diagonal to use as tolerance
+     * \return Pre(labels, gt)
+     */
+    static float computeBoundaryPrecisionReference(const cv::Mat &labels, 
+            const cv::Mat &gt, float d = 0.0025);
+    
     /** \brief Compute the explained variation of the given segmentation.
      * \param[in] labels superpixel labels as int image
      * \param[in] image image of the corresponding superpixel labels
@@ -241,6 +265,16 @@ public:
     static float computeEdgeRecall(const cv::Mat &labels, const cv::Mat &edges,
             float d = 0.0025);    
     
+    /** \brief Reference implementation of computeEdgeRecall searching the
+     * full tolerance window around each edge pixel.
+     * \param[in] labels superpixel labels as int image
+     * \param[in] edges and edge map as unsigned char image
+     * \param[in] d fraction of the diagonal used as tolerance
+     * \return edge recall
+     */
+    static float computeEdgeRecallReference(const cv::Mat &labels, const cv::Mat &edges,
+            float d = 0.0025);
+    
     /** \brief Computes the average of a metric, i.e. computes the
      * integral of the metric in the given superpixel range using the trapezoidal
      * rule.
@@ -260,7 +294,8 @@ private:
     static void computeBoundingBoxes(const cv::Mat &labels, std::vector<cv::Rect> &rectangles);
     
     /** \brief Compute the intersection matrix for a superpixel and a groudn truth
-     * segmentation. Element (i, j) contains the number of pixels in the
+     * segmentation; the overlap based metrics use the sparse IntersectionStatistics
+     * instead. Element (i, j) contains the number of pixels in the
      * intersection of \f$G_i\f$ and \f$S_j\f$.
      * \param[in] labels superpixel labels as int
      * \param[in] gt ground truth segmentation as int
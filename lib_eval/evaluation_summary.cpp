@@ -32,9 +32,16 @@
 #include <sstream>
 #include <fstream>
 #include <limits>
+#include <atomic>
+#include <thread>
+#include <memory>
 #include <glog/logging.h>
 #include "visualization.h"
 #include "evaluation.h"
+#include "boundary_evaluation.h"
+#include "intersection_statistics.h"
+#include "run_length_labels.h"
+#include "superpixel_statistics.h"
 #include "io_util.h"
 #include "evaluation_summary.h"
 
@@ -44,7 +51,7 @@
 
 EvaluationSummary::EvaluationSummary(boost::filesystem::path sp_directory, 
         boost::filesystem::path gt_directory, boost::filesystem::path img_directory)
-        : compute_correlation(false), sp_directory(sp_directory), gt_directory(gt_directory), 
+        : compute_correlation(false), threads(1), sp_directory(sp_directory), gt_directory(gt_directory), 
         img_directory(img_directory) {
     
     results_file = sp_directory / boost::filesystem::path("results.csv");
@@ -62,7 +69,7 @@ EvaluationSummary::EvaluationSummary(boost::filesystem::path sp_directory,
         boost::filesystem::path gt_directory, boost::filesystem::path img_directory,
         EvaluationMetrics evaluation_metrics, EvaluationStatistics evaluation_statistics)
         : evaluation_metrics(evaluation_metrics), evaluation_statistics(evaluation_statistics), 
-        compute_correlation(false), sp_directory(sp_directory), gt_directory(gt_directory), 
+        compute_correlation(false), threads(1), sp_directory(sp_directory), gt_directory(gt_directory), 
         img_directory(img_directory) {
     
     results_file = sp_directory / boost::filesystem::path("results.csv");
@@ -82,7 +89,7 @@ EvaluationSummary::EvaluationSummary(boost::filesystem::path sp_directory,
         SuperpixelVisualizations superpixel_visualizations)
         : evaluation_metrics(evaluation_metrics), evaluation_statistics(evaluation_statistics),
         superpixel_visualizations(superpixel_visualizations), compute_correlation(false),
-        sp_directory(sp_directory), gt_directory(gt_directory), img_directory(img_directory){
+        threads(1), sp_directory(sp_directory), gt_directory(gt_directory), img_directory(img_directory){
     
     results_file = sp_directory / boost::filesystem::path("results.csv");
     correlation_file = sp_directory / boost::filesystem::path("correlation.csv");
@@ -245,16 +252,48 @@ void EvaluationSummary::evaluateHeader(std::stringstream &output,
 ////////////////////////////////////////////////////////////////////////////////
 
 void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &gt_segmentation, 
-        const cv::Mat &image, cv::Mat &data, std::stringstream &output) {
+        const cv::Mat &image, cv::Mat &data, std::stringstream &output,
+        const RunLengthLabels *sp_runs, const RunLengthLabels *gt_runs) {
     
     int i = 0;
     cv::Mat row(1, countMetrics(), CV_32FC1, cv::Scalar(0));
     
+    // Boundary maps and distance transforms are shared between Recall and Precision.
+    float rec = 0;
+    float pre = 0;
+    if (evaluation_metrics.rec || evaluation_metrics.pre) {
+        BoundaryEvaluation boundary_evaluation(sp_segmentation, gt_segmentation);
+        rec = boundary_evaluation.computeBoundaryRecall();
+        pre = boundary_evaluation.computeBoundaryPrecision();
+    }
+    
+    // All overlap based metrics are derived from the same sparse intersections;
+    // for run-length label files these are merged from the runs.
+    cv::Ptr<IntersectionStatistics> intersection_statistics;
+    if (evaluation_metrics.ue || evaluation_metrics.oe || evaluation_metrics.ue_np
+            || evaluation_metrics.ue_levin || evaluation_metrics.asa) {
+        if (sp_runs != 0 && gt_runs != 0) {
+            intersection_statistics = cv::Ptr<IntersectionStatistics>(
+                    new IntersectionStatistics(*sp_runs, *gt_runs));
+        }
+        else {
+            intersection_statistics = cv::Ptr<IntersectionStatistics>(
+                    new IntersectionStatistics(sp_segmentation, gt_segmentation));
+        }
+    }
+    
+    // Color, position and size based metrics are derived from the same moments.
+    cv::Ptr<SuperpixelStatistics> superpixel_statistics;
+    if (evaluation_metrics.sse_rgb || evaluation_metrics.sse_xy || evaluation_metrics.co
+            || evaluation_metrics.ev || evaluation_metrics.icv || evaluation_metrics.sp_size) {
+        superpixel_statistics = cv::Ptr<SuperpixelStatistics>(
+                new SuperpixelStatistics(sp_segmentation, image));
+    }
+    
     std::string separator = "";
     if (evaluation_metrics.ue) {
 //        LOG(INFO) << "... Computing Undersegmentation Error.";
-        row.at<float>(0, i) = Evaluation::computeUndersegmentationError(sp_segmentation, 
-                gt_segmentation);
+        row.at<float>(0, i) = intersection_statistics->computeUndersegmentationError();
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -262,8 +301,7 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.oe) {
 //        LOG(INFO) << "... Computing Oversegmentation Error.";
-        row.at<float>(0, i) = Evaluation::computeOversegmentationError(sp_segmentation, 
-                gt_segmentation);
+        row.at<float>(0, i) = intersection_statistics->computeOversegmentationError();
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -271,8 +309,7 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.rec) {
 //        LOG(INFO) << "... Computing Boundary Recall.";
-        row.at<float>(0, i) = Evaluation::computeBoundaryRecall(sp_segmentation, 
-                gt_segmentation);
+        row.at<float>(0, i) = rec;
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -280,8 +317,7 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.pre) {
 //        LOG(INFO) << "... Computing Boundary Precision.";
-        row.at<float>(0, i) = Evaluation::computeBoundaryPrecision(sp_segmentation, 
-                gt_segmentation);
+        row.at<float>(0, i) = pre;
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -289,8 +325,7 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.ue_np) {
 //        LOG(INFO) << "... Computing NP Undersegmentation Error.";
-        row.at<float>(0, i) = Evaluation::computeNPUndersegmentationError(sp_segmentation, 
-                gt_segmentation);
+        row.at<float>(0, i) = intersection_statistics->computeNPUndersegmentationError();
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -298,8 +333,7 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.ue_levin) {
 //        LOG(INFO) << "... Computing Levin Undersegmentation Error.";
-        row.at<float>(0, i) = Evaluation::computeLevinUndersegmentationError(sp_segmentation, 
-                gt_segmentation);
+        row.at<float>(0, i) = intersection_statistics->computeLevinUndersegmentationError();
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -307,8 +341,7 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.asa) {
 //        LOG(INFO) << "... Computing Achievable Segmentation Accuracy.";
-        row.at<float>(0, i) = Evaluation::computeAchievableSegmentationAccuracy(sp_segmentation, 
-                gt_segmentation);
+        row.at<float>(0, i) = intersection_statistics->computeAchievableSegmentationAccuracy();
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -316,8 +349,7 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.sse_rgb) {
 //        LOG(INFO) << "... Computing Sum-Of-Squared Error RGB.";
-        row.at<float>(0, i) = Evaluation::computeSumOfSquaredErrorRGB(sp_segmentation, 
-                image);
+        row.at<float>(0, i) = superpixel_statistics->computeSumOfSquaredErrorRGB();
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -325,8 +357,7 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.sse_xy) {
 //        LOG(INFO) << "... Computing Sum-Of-Squared Error XY.";
-        row.at<float>(0, i) = Evaluation::computeSumOfSquaredErrorXY(sp_segmentation,
-                image);
+        row.at<float>(0, i) = superpixel_statistics->computeSumOfSquaredErrorXY();
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -334,7 +365,7 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.co) {
 //        LOG(INFO) << "... Computing Compactness.";
-        row.at<float>(0, i) = Evaluation::computeCompactness(sp_segmentation);
+        row.at<float>(0, i) = superpixel_statistics->computeCompactness();
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -342,8 +373,7 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.ev) {
 //        LOG(INFO) << "... Computing Explained Variation.";
-        row.at<float>(0, i) = Evaluation::computeExplainedVariation(sp_segmentation, 
-                image);
+        row.at<float>(0, i) = superpixel_statistics->computeExplainedVariation();
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -360,8 +390,7 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     if (evaluation_metrics.icv) {
 //        LOG(INFO) << "... Computing Intra Cluster Variation.";
-        row.at<float>(0, i) = Evaluation::computeIntraClusterVariation(sp_segmentation, 
-                image);
+        row.at<float>(0, i) = superpixel_statistics->computeIntraClusterVariation();
         
         output << separator << row.at<float>(0, i);
         separator = ",";
@@ -398,8 +427,8 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
         int min_size;
         int max_size;
         float size_variation;
-        Evaluation::computeSuperpixelSizes(sp_segmentation, 
-                average_size, min_size, max_size, size_variation);
+        superpixel_statistics->computeSuperpixelSizes(average_size, 
+                min_size, max_size, size_variation);
         
         row.at<float>(0, i) = average_size;
         output << separator << row.at<float>(0, i);
@@ -1130,6 +1159,136 @@ float EvaluationSummary::computeStandardDeviation(const std::vector<int> gt, con
     return std[0];
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// evaluateFile
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::evaluateFile(const boost::filesystem::path &sp_file, 
+        int i, int total, cv::Mat &data, std::stringstream &output, std::vector<int> &gt) {
+    
+    boost::filesystem::path img_file = img_directory / 
+            boost::filesystem::path(sp_file.stem().string() + ".png");
+    if (!boost::filesystem::is_regular_file(img_file)) {
+        img_file = img_directory / 
+            boost::filesystem::path(sp_file.stem().string() + ".jpg");
+    }
+    if (!boost::filesystem::is_regular_file(img_file)) {
+        img_file = img_directory / 
+            boost::filesystem::path(sp_file.stem().string() + ".jpeg");
+    }
+    
+    LOG_IF(FATAL, !boost::filesystem::is_regular_file(img_file)) 
+            << "Image does not exist (tried .png, .jpg, .jpeg): " 
+            << img_file.string() << ".";
+    LOG_IF(FATAL, !boost::filesystem::is_regular_file(sp_file)) 
+            << "Superpixel segmentation does not exist (which is weird): "
+            << sp_file.string() << ".";
+    
+    // Binary label files are mapped instead of parsed; run-length label files
+    // are kept as runs for the intersections and decoded for all other metrics.
+    std::unique_ptr<MappedLabels> mapped_sp_segmentation;
+    std::unique_ptr<RunLengthLabels> sp_runs;
+    cv::Mat sp_segmentation;
+//    IOUtil::readMatCSVInt(sp_file, sp_segmentation, image.rows, image.cols);
+    if (IOUtil::isBinaryLabelFile(sp_file)) {
+        mapped_sp_segmentation.reset(new MappedLabels(sp_file));
+        sp_segmentation = mapped_sp_segmentation->getLabels();
+    }
+    else if (RunLengthLabels::isRunLengthFile(sp_file)) {
+        sp_runs.reset(new RunLengthLabels());
+        sp_runs->read(sp_file);
+        sp_runs->decode(sp_segmentation);
+    }
+    else {
+        IOUtil::readLabels(sp_file, sp_segmentation);
+    }
+    cv::Mat image = cv::imread(img_file.string(), CV_LOAD_IMAGE_COLOR);
+    
+//    cv::namedWindow("Image");
+//    cv::imshow("Image", image);
+//    
+//    cv::waitKey(0);
+    
+    LOG_IF(FATAL, image.rows <= 0 || image.cols <= 0) << "Could not read image: " 
+            << img_file.string() << ".";
+    LOG_IF(FATAL, image.channels() != 3) << "Currently only 3-channel images are supported: " 
+            << image.channels() << " (" << img_file.string() << ").";
+    LOG_IF(FATAL, sp_segmentation.rows != image.rows || sp_segmentation.cols != image.cols) 
+            << "Superpixel segmentation does not match image size: (" 
+            << sp_segmentation.rows << "," << sp_segmentation.cols << ") != (" 
+            << image.rows << "," << image.cols << ").";
+
+    // Find at least one ground truth file.
+    // With run-length superpixel labels, the ground truth is needed as runs
+    // too; run-length ground truth files are read as runs and decoded once,
+    // all other formats are read and encoded.
+    RunLengthLabels gt_runs;
+    auto read_gt = [&](const boost::filesystem::path &file, cv::Mat &gt_segmentation) {
+        if (sp_runs && RunLengthLabels::isRunLengthFile(file)) {
+            gt_runs.read(file);
+            gt_runs.decode(gt_segmentation);
+        }
+        else {
+            IOUtil::readLabels(file, gt_segmentation);
+            if (sp_runs) {
+                gt_runs.encode(gt_segmentation);
+            }
+        }
+    };
+    
+    boost::filesystem::path gt_file = IOUtil::findLabelFile(gt_directory, sp_file.stem().string());
+    if (boost::filesystem::is_regular_file(gt_file)) {
+//        LOG(INFO) << "[" << i << "] One ground truth found for file " 
+//                << i << "/" << total << ".";
+        
+        // Only one gt_file.
+        cv::Mat gt_segmentation;
+        read_gt(gt_file, gt_segmentation);
+        
+        LOG_IF(FATAL, gt_segmentation.rows != image.rows || gt_segmentation.cols != image.cols) 
+                << "Ground truth does not match image size.";
+        
+        output << sp_file.stem() << ",";
+        output << gt_file.stem() << ",";
+        
+        evaluate(sp_segmentation, gt_segmentation, image, data, output, sp_runs.get(), &gt_runs);
+        gt.push_back(0);
+        
+        // Visualizations.
+        visualize(sp_segmentation, gt_segmentation, image, sp_file.stem().string());
+    }
+    else {
+        for (int t = 0; t < 5; ++t) {
+//            LOG(INFO) << "[" << i << "] Processing ground truth " << (t + 1) 
+//                    << " found for file " << i << "/" << total << ".";
+            
+            boost::filesystem::path gt_file_t = IOUtil::findLabelFile(gt_directory, 
+                    sp_file.stem().string() + "-" + std::to_string(t));
+            LOG_IF(ERROR, !boost::filesystem::is_regular_file(gt_file_t)) << "[" << i << "] Ground truth " << (t + 1)
+                    << " not found for file " << i << "/" << total << ".";
+            
+            if (boost::filesystem::is_regular_file(gt_file_t)) {
+                // Found a ground truth file.
+                
+                cv::Mat gt_segmentation;
+                read_gt(gt_file_t, gt_segmentation);
+
+                LOG_IF(FATAL, gt_segmentation.rows != image.rows || gt_segmentation.cols != image.cols) 
+                        << "Ground truth does not match image size.";
+
+                output << sp_file.stem() << ",";
+                output << gt_file_t.stem() << ",";
+
+                evaluate(sp_segmentation, gt_segmentation, image, data, output, sp_runs.get(), &gt_runs);
+                gt.push_back(t);
+                
+                // Visualizations.
+                visualize(sp_segmentation, gt_segmentation, image, sp_file.stem().string(), t);
+            }
+        }
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // computeSummary
 ////////////////////////////////////////////////////////////////////////////////
@@ -1139,125 +1298,82 @@ void EvaluationSummary::computeSummary(int &gt_max) {
     // Get all superpixel segmentations.
     std::multimap<std::string, boost::filesystem::path> sp_files;
     std::vector<std::string> csv_extensions;
-    IOUtil::getCSVExtensions(csv_extensions);
+    IOUtil::getLabelExtensions(csv_extensions);
     std::vector<std::string> exclude;
     exclude.push_back("correlation");
     exclude.push_back("results");
     exclude.push_back("summary");
     IOUtil::readDirectory(sp_directory, csv_extensions, sp_files, "", "", exclude);
     
-    // Ground truth indices for statistic computation.
-    std::vector<int> gt;
-//    cv::Mat mat_results(1, countMetrics(), CV_32FC1, cv::Scalar(0));
-    cv::Mat mat_results;
-    
-    std::stringstream csv_results;
-    std::vector<std::string> metric_order;
-    evaluateHeader(csv_results, metric_order);
-    
-//    LOG(INFO) << "Computing evaluation metrics.";
-    
-    int i = 0;
+    // Exclude created files.
+    std::vector<boost::filesystem::path> files;
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = sp_files.begin();
             it != sp_files.end(); it++) {
         
-        // Exclude created files.
         if (it->second.stem().string() == "results"
                 || it->second.stem().string() == "summary") {
             continue;
         }
         
-        boost::filesystem::path img_file = img_directory / 
-                boost::filesystem::path(it->second.stem().string() + ".png");
-        if (!boost::filesystem::is_regular_file(img_file)) {
-            img_file = img_directory / 
-                boost::filesystem::path(it->second.stem().string() + ".jpg");
-        }
-        if (!boost::filesystem::is_regular_file(img_file)) {
-            img_file = img_directory / 
-                boost::filesystem::path(it->second.stem().string() + ".jpeg");
+        files.push_back(it->second);
+    }
+    
+    // Each image is evaluated independently into its own slot such that
+    // the results are merged in the original order afterwards.
+    int count = files.size();
+    std::vector<std::string> csv_images(count);
+    std::vector<cv::Mat> mat_images(count);
+    std::vector< std::vector<int> > gt_images(count);
+    
+    int workers = threads;
+    if (workers <= 0) {
+        workers = std::max(1, (int) std::thread::hardware_concurrency());
+    }
+    workers = std::min(workers, count);
+    
+    auto evaluate_file = [&](int i) {
+        std::stringstream csv_image;
+        evaluateFile(files[i], i, count, mat_images[i], csv_image, gt_images[i]);
+        csv_images[i] = csv_image.str();
+    };
+    
+    if (workers <= 1) {
+        for (int i = 0; i < count; ++i) {
+            evaluate_file(i);
         }
+    }
+    else {
+        std::atomic<int> next(0);
+        std::vector<std::thread> pool;
         
-        LOG_IF(FATAL, !boost::filesystem::is_regular_file(img_file)) 
-                << "Image does not exist (tried .png, .jpg, .jpeg): " 
-                << img_file.string() << ".";
-        LOG_IF(FATAL, !boost::filesystem::is_regular_file(it->second)) 
-                << "Superpixel segmentation does not exist (which is weird): "
-                << it->second.string() << ".";
-        
-        cv::Mat sp_segmentation;
-//        IOUtil::readMatCSVInt(it->second, sp_segmentation, image.rows, image.cols);
-        IOUtil::readMatCSVInt(it->second, sp_segmentation);
-        cv::Mat image = cv::imread(img_file.string(), CV_LOAD_IMAGE_COLOR);
-        
-//        cv::namedWindow("Image");
-//        cv::imshow("Image", image);
-//        
-//        cv::waitKey(0);
-        
-        LOG_IF(FATAL, image.rows <= 0 || image.cols <= 0) << "Could not read image: " 
-                << img_file.string() << ".";
-        LOG_IF(FATAL, image.channels() != 3) << "Currently only 3-channel images are supported: " 
-                << image.channels() << " (" << img_file.string() << ").";
-        LOG_IF(FATAL, sp_segmentation.rows != image.rows || sp_segmentation.cols != image.cols) 
-                << "Superpixel segmentation does not match image size: (" 
-                << sp_segmentation.rows << "," << sp_segmentation.cols << ") != (" 
-                << image.rows << "," << image.cols << ").";
-
-        // Find at least one ground truth file.
-        boost::filesystem::path gt_file = gt_directory / it->second.filename();
-        if (boost::filesystem::is_regular_file(gt_file)) {
-//            LOG(INFO) << "[" << i << "] One ground truth found for file " 
-//                    << i << "/" << sp_files.size() << ".";
-            
-            // Only one gt_file.
-            cv::Mat gt_segmentation;
-            IOUtil::readMatCSVInt(gt_file, gt_segmentation);
-            
-            LOG_IF(FATAL, gt_segmentation.rows != image.rows || gt_segmentation.cols != image.cols) 
-                    << "Ground truth does not match image size.";
-            
-            csv_results << it->second.stem() << ",";
-            csv_results << gt_file.stem() << ",";
-            
-            evaluate(sp_segmentation, gt_segmentation, image, mat_results, csv_results);
-            gt.push_back(0);
-            
-            // Visualizations.
-            visualize(sp_segmentation, gt_segmentation, image, it->second.stem().string());
-        }
-        else {
-            for (int t = 0; t < 5; ++t) {
-//                LOG(INFO) << "[" << i << "] Processing ground truth " << (t + 1) 
-//                        << " found for file " << i << "/" << sp_files.size() << ".";
-                
-                boost::filesystem::path gt_file_t = gt_directory / 
-                        boost::filesystem::path(it->second.stem().string() + "-" + std::to_string(t) + ".csv");
-                LOG_IF(ERROR, !boost::filesystem::is_regular_file(gt_file_t)) << "[" << i << "] Ground truth " << (t + 1)
-                        << " not found for file " << i << "/" << sp_files.size() << ".";
-                
-                if (boost::filesystem::is_regular_file(gt_file_t)) {
-                    // Found a ground truth file.
-                    
-                    cv::Mat gt_segmentation;
-                    IOUtil::readMatCSVInt(gt_file_t, gt_segmentation);
-
-                    LOG_IF(FATAL, gt_segmentation.rows != image.rows || gt_segmentation.cols != image.cols) 
-                            << "Ground truth does not match image size.";
-
-                    csv_results << it->second.stem() << ",";
-                    csv_results << gt_file_t.stem() << ",";
-
-                    evaluate(sp_segmentation, gt_segmentation, image, mat_results, csv_results);
-                    gt.push_back(t);
-                    
-                    // Visualizations.
-                    visualize(sp_segmentation, gt_segmentation, image, it->second.stem().string(), t);
+        for (int t = 0; t < workers; ++t) {
+            pool.push_back(std::thread([&]() {
+                for (int i = next++; i < count; i = next++) {
+                    evaluate_file(i);
                 }
-            }
+            }));
         }
         
-        ++i;
+        for (int t = 0; t < workers; ++t) {
+            pool[t].join();
+        }
+    }
+    
+    // Ground truth indices for statistic computation.
+    std::vector<int> gt;
+    cv::Mat mat_results;
+    
+    std::stringstream csv_results;
+    std::vector<std::string> metric_order;
+    evaluateHeader(csv_results, metric_order);
+    
+    for (int i = 0; i < count; ++i) {
+        csv_results << csv_images[i];
+        gt.insert(gt.end(), gt_images[i].begin(), gt_images[i].end());
+        
+        if (!mat_images[i].empty()) {
+            mat_results.push_back(mat_images[i]);
+        }
     }
     
     LOG_IF(FATAL, gt.size() == 0) << "No superpixel segmentation files found!";
@@ -1395,4 +1511,20 @@ void EvaluationSummary::setComputeCorrelation(bool compute_correlation_) {
     
 bool EvaluationSummary::getComputeCorrelation() {
     return compute_correlation;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setThreads
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::setThreads(int threads_) {
+    threads = threads_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getThreads
+////////////////////////////////////////////////////////////////////////////////
+
+int EvaluationSummary::getThreads() {
+    return threads;
 }
\ No newline at end of file
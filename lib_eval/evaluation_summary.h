@@ -36,6 +36,8 @@
 #include <boost/filesystem.hpp>
 #include <opencv2/opencv.hpp>
 
+class RunLengthLabels;
+
 /** \brief Given a directory of superpixel segmentations and a directory of
  * ground truth segmentations, this class is used to generate a CSV file of 
  * statistics of different metrics.
@@ -177,6 +179,10 @@ public:
             SuperpixelVisualizations superpixel_visualizations);
     
     /** \brief Summarize the results; this is the main entrance point.
+     * 
+     * Images are distributed over the number of threads set using setThreads;
+     * the results are written in the same order regardless of the number of threads.
+     * 
      * \param[out] gt_max the maxmimum number of ground truth used, for BSDS 5 for all other 1
      */
     void computeSummary(int &gt_max);
@@ -226,6 +232,16 @@ public:
      */
     bool getComputeCorrelation();
     
+    /** \brief Set the number of threads used to evaluate images in parallel.
+     * \param[in] threads number of threads, 0 to use all available cores
+     */
+    void setThreads(int threads);
+    
+    /** \brief Get the number of threads used to evaluate images in parallel.
+     * \return number of threads
+     */
+    int getThreads();
+    
 protected:
     
     /** \brief Count number of metrics used.
@@ -245,9 +261,27 @@ protected:
      * \param[in] image corresponding image
      * \param[in] data data matrix to append results to
      * \param[in] output CSV file stream to append results to
+     * \param[in] sp_runs run-length encoded superpixel labels if read from a 
+     * run-length label file, used together with gt_runs to compute the 
+     * intersections directly on the runs; may be null
+     * \param[in] gt_runs run-length encoded ground truth segmentation, 
+     * required if sp_runs is given
      */
     void evaluate(const cv::Mat &sp_segmentation, const cv::Mat &gt_segmentation, 
-            const cv::Mat &image, cv::Mat &data, std::stringstream &output);
+            const cv::Mat &image, cv::Mat &data, std::stringstream &output,
+            const RunLengthLabels *sp_runs = 0, const RunLengthLabels *gt_runs = 0);
+    
+    /** \brief Read and evaluate a superpixel segmentation against all
+     * corresponding ground truth segmentations.
+     * \param[in] sp_file path to superpixel segmentation
+     * \param[in] i index of the file, used for logging
+     * \param[in] total total number of files, used for logging
+     * \param[out] data data matrix to append results to
+     * \param[out] output CSV stream to append results to
+     * \param[out] gt ground truth indices to append to
+     */
+    void evaluateFile(const boost::filesystem::path &sp_file, int i, int total,
+            cv::Mat &data, std::stringstream &output, std::vector<int> &gt);
     
     /** \brief Visualize given segmentation.
      * \param[in] sp_segmentation superpixel labels as int image
@@ -372,6 +406,8 @@ protected:
     
     /** \brief Whether to compute correlation. */
     bool compute_correlation;
+    /** \brief Number of threads to evaluate images with. */
+    int threads;
     
     /** \brief Directory of superpixel segmentations. */
     boost::filesystem::path sp_directory;
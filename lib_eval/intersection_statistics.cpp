@@ -0,0 +1,284 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <glog/logging.h>
+#include "intersection_statistics.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+////////////////////////////////////////////////////////////////////////////////
+
+IntersectionStatistics::IntersectionStatistics(const cv::Mat &labels, 
+        const cv::Mat &gt) {
+    
+    LOG_IF(FATAL, labels.rows != gt.rows || labels.cols != gt.cols) 
+            << "Superpixel segmentation does not match ground truth size.";
+    
+    N = labels.rows*labels.cols;
+    
+    // Labels are piecewise constant along rows, so runs of identical
+    // (ground truth, superpixel) pairs are accumulated before hashing.
+    std::unordered_map<unsigned long long, int> counts;
+    for (int i = 0; i < labels.rows; ++i) {
+        const int* labels_row = labels.ptr<int>(i);
+        const int* gt_row = gt.ptr<int>(i);
+        
+        int run_sp = labels_row[0];
+        int run_gt = gt_row[0];
+        int run = 0;
+        
+        for (int j = 0; j < labels.cols; ++j) {
+            if (labels_row[j] != run_sp || gt_row[j] != run_gt) {
+                counts[(((unsigned long long) run_gt) << 32) | ((unsigned int) run_sp)] += run;
+                
+                run_sp = labels_row[j];
+                run_gt = gt_row[j];
+                run = 0;
+            }
+            
+            ++run;
+        }
+        
+        counts[(((unsigned long long) run_gt) << 32) | ((unsigned int) run_sp)] += run;
+    }
+    
+    collectIntersections(counts);
+}
+
+IntersectionStatistics::IntersectionStatistics(const RunLengthLabels &labels, 
+        const RunLengthLabels &gt) {
+    
+    LOG_IF(FATAL, labels.getRows() != gt.getRows() || labels.getCols() != gt.getCols()) 
+            << "Superpixel segmentation does not match ground truth size.";
+    
+    N = labels.getRows()*labels.getCols();
+    
+    // Merge the runs of both segmentations row by row; each overlap of a 
+    // superpixel run and a ground truth run is one (partial) intersection.
+    std::unordered_map<unsigned long long, int> counts;
+    for (int i = 0; i < labels.getRows(); ++i) {
+        const RunLengthLabels::Run* sp_run = labels.getRowBegin(i);
+        const RunLengthLabels::Run* gt_run = gt.getRowBegin(i);
+        
+        int sp_end = sp_run->length;
+        int gt_end = gt_run->length;
+        
+        int j = 0;
+        while (j < labels.getCols()) {
+            int end = std::min(sp_end, gt_end);
+            counts[(((unsigned long long) gt_run->label) << 32) | ((unsigned int) sp_run->label)] += end - j;
+            
+            j = end;
+            if (j < labels.getCols()) {
+                if (j == sp_end) {
+                    ++sp_run;
+                    sp_end += sp_run->length;
+                }
+                if (j == gt_end) {
+                    ++gt_run;
+                    gt_end += gt_run->length;
+                }
+            }
+        }
+    }
+    
+    collectIntersections(counts);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// collectIntersections
+////////////////////////////////////////////////////////////////////////////////
+
+void IntersectionStatistics::collectIntersections(
+        const std::unordered_map<unsigned long long, int> &counts) {
+    
+    int superpixels = 0;
+    int gt_segments = 0;
+    
+    intersections.reserve(counts.size());
+    for (std::unordered_map<unsigned long long, int>::const_iterator it = counts.begin();
+            it != counts.end(); ++it) {
+        
+        Intersection intersection;
+        intersection.gt = (int) (it->first >> 32);
+        intersection.sp = (int) (it->first & 0xFFFFFFFF);
+        intersection.count = it->second;
+        
+        LOG_IF(FATAL, intersection.gt < 0 || intersection.sp < 0) 
+                << "Negative labels are not supported.";
+        
+        superpixels = std::max(superpixels, intersection.sp + 1);
+        gt_segments = std::max(gt_segments, intersection.gt + 1);
+        intersections.push_back(intersection);
+    }
+    
+    std::sort(intersections.begin(), intersections.end(), 
+            [](const Intersection &a, const Intersection &b) {
+                return a.sp < b.sp || (a.sp == b.sp && a.gt < b.gt);
+            });
+    
+    superpixel_sizes.resize(superpixels, 0);
+    gt_sizes.resize(gt_segments, 0);
+    
+    for (unsigned int k = 0; k < intersections.size(); ++k) {
+        superpixel_sizes[intersections[k].sp] += intersections[k].count;
+        gt_sizes[intersections[k].gt] += intersections[k].count;
+    }
+    
+    computeMaxIntersections();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeMaxIntersections
+////////////////////////////////////////////////////////////////////////////////
+
+void IntersectionStatistics::computeMaxIntersections() {
+    
+    superpixel_max_intersection.resize(superpixel_sizes.size(), 0);
+    gt_max_intersection.resize(gt_sizes.size(), 0);
+    
+    for (unsigned int k = 0; k < intersections.size(); ++k) {
+        const Intersection &intersection = intersections[k];
+        
+        if (intersection.count > superpixel_max_intersection[intersection.sp]) {
+            superpixel_max_intersection[intersection.sp] = intersection.count;
+        }
+        if (intersection.count > gt_max_intersection[intersection.gt]) {
+            gt_max_intersection[intersection.gt] = intersection.count;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeUndersegmentationError
+////////////////////////////////////////////////////////////////////////////////
+
+float IntersectionStatistics::computeUndersegmentationError() const {
+    
+    // min_i |S_j - G_i| is attained for the ground truth segment with maximum 
+    // overlap; segments not intersecting S_j yield |S_j|.
+    float error = 0;
+    for (unsigned int j = 0; j < superpixel_sizes.size(); ++j) {
+        error += superpixel_sizes[j] - superpixel_max_intersection[j];
+    }
+    
+    return error/N;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeOversegmentationError
+////////////////////////////////////////////////////////////////////////////////
+
+float IntersectionStatistics::computeOversegmentationError() const {
+    
+    float error = 0;
+    for (unsigned int i = 0; i < gt_sizes.size(); ++i) {
+        error += gt_sizes[i] - gt_max_intersection[i];
+    }
+    
+    return error/N;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeNPUndersegmentationError
+////////////////////////////////////////////////////////////////////////////////
+
+float IntersectionStatistics::computeNPUndersegmentationError() const {
+    
+    float error = 0;
+    for (unsigned int k = 0; k < intersections.size(); ++k) {
+        const Intersection &intersection = intersections[k];
+        error += std::min(intersection.count, 
+                superpixel_sizes[intersection.sp] - intersection.count);
+    }
+    
+    return error/N;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeLevinUndersegmentationError
+////////////////////////////////////////////////////////////////////////////////
+
+float IntersectionStatistics::computeLevinUndersegmentationError() const {
+    
+    std::vector<float> gt_error(gt_sizes.size(), 0);
+    for (unsigned int k = 0; k < intersections.size(); ++k) {
+        gt_error[intersections[k].gt] += superpixel_sizes[intersections[k].sp];
+    }
+    
+    float error = 0;
+    for (unsigned int i = 0; i < gt_sizes.size(); ++i) {
+        if (gt_sizes[i] > 0) {
+            error += (gt_error[i] - gt_sizes[i])/gt_sizes[i];
+        }
+    }
+    
+    return error/gt_sizes.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeAchievableSegmentationAccuracy
+////////////////////////////////////////////////////////////////////////////////
+
+float IntersectionStatistics::computeAchievableSegmentationAccuracy() const {
+    
+    float accuracy = 0;
+    for (unsigned int j = 0; j < superpixel_max_intersection.size(); ++j) {
+        accuracy += superpixel_max_intersection[j];
+    }
+    
+    return accuracy/N;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getIntersections
+////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<IntersectionStatistics::Intersection>& IntersectionStatistics::getIntersections() const {
+    return intersections;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getSuperpixelSizes
+////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<int>& IntersectionStatistics::getSuperpixelSizes() const {
+    return superpixel_sizes;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getGroundTruthSizes
+////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<int>& IntersectionStatistics::getGroundTruthSizes() const {
+    return gt_sizes;
+}
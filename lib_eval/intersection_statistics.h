@@ -0,0 +1,148 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef INTERSECTION_STATISTICS_H
+#define	INTERSECTION_STATISTICS_H
+
+#include <vector>
+#include <unordered_map>
+#include <opencv2/opencv.hpp>
+#include "run_length_labels.h"
+
+/** \brief Sparse intersection statistics between a superpixel segmentation
+ * and a ground truth segmentation.
+ * 
+ * Instead of the dense ground truth segments x superpixels intersection matrix,
+ * only non-empty intersections are stored. The intersections are collected in
+ * a single pass over the image; all overlap based metrics (UE, OE, UE_NP,
+ * UE_Levin and ASA) are then derived from the same structure in time
+ * proportional to the number of non-empty intersections.
+ * 
+ * \author David Stutz
+ */
+class IntersectionStatistics {
+public:
+    
+    /** \brief A non-empty intersection \f$G_i \cap S_j\f$.
+     */
+    struct Intersection {
+        /** \brief Ground truth segment \f$i\f$. */
+        int gt;
+        /** \brief Superpixel \f$j\f$. */
+        int sp;
+        /** \brief Number of pixels in the intersection. */
+        int count;
+    };
+    
+    /** \brief Constructor, collects all non-empty intersections.
+     * \param[in] labels superpixel labels as int image
+     * \param[in] gt ground truth segmentation as int image
+     */
+    IntersectionStatistics(const cv::Mat &labels, const cv::Mat &gt);
+    
+    /** \brief Constructor, collects all non-empty intersections directly
+     * from the runs of run-length encoded segmentations.
+     * \param[in] labels superpixel labels
+     * \param[in] gt ground truth segmentation
+     */
+    IntersectionStatistics(const RunLengthLabels &labels, const RunLengthLabels &gt);
+    
+    /** \brief Compute Undersegmentation Error, see Evaluation::computeUndersegmentationError.
+     * \return UE(gt, labels)
+     */
+    float computeUndersegmentationError() const;
+    
+    /** \brief Compute Oversegmentation Error, see Evaluation::computeOversegmentationError.
+     * \return OE(gt, labels)
+     */
+    float computeOversegmentationError() const;
+    
+    /** \brief Compute Undersegmentation Error (Neubert, Protzel), see 
+     * Evaluation::computeNPUndersegmentationError.
+     * \return UE_NP(labels, gt)
+     */
+    float computeNPUndersegmentationError() const;
+    
+    /** \brief Compute Undersegmentation Error (Levinshtein et al.), see 
+     * Evaluation::computeLevinUndersegmentationError.
+     * \return UE_Levin(labels, gt)
+     */
+    float computeLevinUndersegmentationError() const;
+    
+    /** \brief Compute Achievable Segmentation Accuracy, see
+     * Evaluation::computeAchievableSegmentationAccuracy.
+     * \return ASA(gt, labels)
+     */
+    float computeAchievableSegmentationAccuracy() const;
+    
+    /** \brief Get the non-empty intersections sorted by superpixel and ground truth segment.
+     * \return intersections
+     */
+    const std::vector<Intersection>& getIntersections() const;
+    
+    /** \brief Get the superpixel sizes indexed by label.
+     * \return superpixel sizes
+     */
+    const std::vector<int>& getSuperpixelSizes() const;
+    
+    /** \brief Get the ground truth segment sizes indexed by label.
+     * \return ground truth sizes
+     */
+    const std::vector<int>& getGroundTruthSizes() const;
+    
+protected:
+    
+    /** \brief Collect the intersections and sizes from the intersection counts.
+     * \param[in] counts pixel counts indexed by ground truth segment (upper 32 bits) 
+     * and superpixel (lower 32 bits)
+     */
+    void collectIntersections(const std::unordered_map<unsigned long long, int> &counts);
+    
+    /** \brief Compute, for each superpixel and each ground truth segment, the
+     * maximum intersection.
+     */
+    void computeMaxIntersections();
+    
+    /** \brief Number of pixels. */
+    int N;
+    /** \brief Non-empty intersections sorted by superpixel and ground truth segment. */
+    std::vector<Intersection> intersections;
+    /** \brief Size of each superpixel. */
+    std::vector<int> superpixel_sizes;
+    /** \brief Size of each ground truth segment. */
+    std::vector<int> gt_sizes;
+    /** \brief Maximum intersection of each superpixel with any ground truth segment. */
+    std::vector<int> superpixel_max_intersection;
+    /** \brief Maximum intersection of each ground truth segment with any superpixel. */
+    std::vector<int> gt_max_intersection;
+};
+
+#endif	/* INTERSECTION_STATISTICS_H */
@@ -30,10 +30,26 @@
  */
 
 #include <assert.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <iomanip>
 #include <fstream>
 #include <glog/logging.h>
 #include "io_util.h"
+#include "run_length_labels.h"
+
+#if !defined(WIN32) && !defined(_WIN32)
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+/** \brief Magic bytes of binary label files. */
+static const char BINARY_LABEL_MAGIC[4] = {'S', 'P', 'L', 'B'};
+/** \brief Current version of binary label files. */
+static const int BINARY_LABEL_VERSION = 1;
 
 ////////////////////////////////////////////////////////////////////////////////
 // readMat
@@ -294,6 +310,38 @@ void IOUtil::getCSVExtensions(std::vector<std::string> &extensions) {
     extensions.push_back(".CSV");
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// getLabelExtensions
+////////////////////////////////////////////////////////////////////////////////
+
+void IOUtil::getLabelExtensions(std::vector<std::string> &extensions) {
+    getCSVExtensions(extensions);
+    extensions.push_back(".bin");
+    extensions.push_back(".BIN");
+    extensions.push_back(".rle");
+    extensions.push_back(".RLE");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// findLabelFile
+////////////////////////////////////////////////////////////////////////////////
+
+boost::filesystem::path IOUtil::findLabelFile(boost::filesystem::path directory,
+        std::string stem) {
+    
+    std::vector<std::string> extensions;
+    IOUtil::getLabelExtensions(extensions);
+    
+    for (unsigned int i = 0; i < extensions.size(); ++i) {
+        boost::filesystem::path file = directory / boost::filesystem::path(stem + extensions[i]);
+        if (boost::filesystem::is_regular_file(file)) {
+            return file;
+        }
+    }
+    
+    return directory / boost::filesystem::path(stem + ".csv");
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // readMatCSVInt
 ////////////////////////////////////////////////////////////////////////////////
@@ -348,6 +396,132 @@ int IOUtil::readMatCSVInt(boost::filesystem::path file, cv::Mat &result) {
     return i;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// writeMatBinary
+////////////////////////////////////////////////////////////////////////////////
+
+int IOUtil::writeMatBinary(boost::filesystem::path file, const cv::Mat &labels) {
+    LOG_IF(FATAL, labels.type() != CV_32SC1) << "Only int labels can be written as binary label file.";
+    
+    BinaryLabelHeader header;
+    std::memcpy(header.magic, BINARY_LABEL_MAGIC, 4);
+    header.version = BINARY_LABEL_VERSION;
+    header.rows = labels.rows;
+    header.cols = labels.cols;
+    header.type = labels.type();
+    header.labels = 0;
+    
+    for (int i = 0; i < labels.rows; ++i) {
+        const int* row = labels.ptr<int>(i);
+        for (int j = 0; j < labels.cols; ++j) {
+            header.labels = std::max(header.labels, row[j] + 1);
+        }
+    }
+    
+    std::ofstream file_stream(file.c_str(), std::ofstream::binary);
+    file_stream.write((const char*) &header, sizeof(BinaryLabelHeader));
+    
+    for (int i = 0; i < labels.rows; ++i) {
+        file_stream.write((const char*) labels.ptr<int>(i), labels.cols*sizeof(int));
+    }
+    
+    file_stream.close();
+    return labels.rows;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readMatBinary
+////////////////////////////////////////////////////////////////////////////////
+
+int IOUtil::readMatBinary(boost::filesystem::path file, cv::Mat &result) {
+    MappedLabels mapped(file);
+    mapped.getLabels().copyTo(result);
+    
+    return result.rows;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// isBinaryLabelFile
+////////////////////////////////////////////////////////////////////////////////
+
+bool IOUtil::isBinaryLabelFile(boost::filesystem::path file) {
+    std::ifstream file_stream(file.c_str(), std::ifstream::binary);
+    
+    char magic[4];
+    file_stream.read(magic, 4);
+    
+    return file_stream.gcount() == 4 && std::memcmp(magic, BINARY_LABEL_MAGIC, 4) == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeLabels
+////////////////////////////////////////////////////////////////////////////////
+
+int IOUtil::writeLabels(boost::filesystem::path file, const cv::Mat &labels) {
+    // Extensions are matched case-insensitively, as by getLabelExtensions.
+    std::string extension = file.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    
+    if (extension == getLabelExtension("bin")) {
+        return writeMatBinary(file, labels);
+    }
+    else if (extension == getLabelExtension("rle")) {
+        return RunLengthLabels(labels).write(file);
+    }
+    
+    return writeMatCSV<int>(file, labels);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readLabels
+////////////////////////////////////////////////////////////////////////////////
+
+int IOUtil::readLabels(boost::filesystem::path file, cv::Mat &labels) {
+    if (isBinaryLabelFile(file)) {
+        return readMatBinary(file, labels);
+    }
+    else if (RunLengthLabels::isRunLengthFile(file)) {
+        RunLengthLabels runs;
+        int rows = runs.read(file);
+        runs.decode(labels);
+        
+        return rows;
+    }
+    
+    return readMatCSVInt(file, labels);
+}
+
+int IOUtil::readLabels(boost::filesystem::path file, RunLengthLabels &labels) {
+    if (RunLengthLabels::isRunLengthFile(file)) {
+        return labels.read(file);
+    }
+    
+    cv::Mat mat;
+    int rows = readLabels(file, mat);
+    labels.encode(mat);
+    
+    return rows;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getLabelExtension
+////////////////////////////////////////////////////////////////////////////////
+
+std::string IOUtil::getLabelExtension(std::string format) {
+    if (format == "csv") {
+        return ".csv";
+    }
+    else if (format == "bin") {
+        return ".bin";
+    }
+    else if (format == "rle") {
+        return ".rle";
+    }
+    
+    LOG(FATAL) << "Unknown label format: " << format << " (expected csv, bin or rle).";
+    return "";
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // readMatCSVFloat
 ////////////////////////////////////////////////////////////////////////////////
@@ -494,4 +668,64 @@ int IOUtil::readCSVSummary(boost::filesystem::path file, std::vector<std::string
     file_stream.close();
     
     return i;
-}
\ No newline at end of file
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedLabels
+////////////////////////////////////////////////////////////////////////////////
+
+MappedLabels::MappedLabels(boost::filesystem::path file) : data(0), size(0) {
+    LOG_IF(FATAL, !boost::filesystem::is_regular_file(file)) 
+            << "File does not exist: " << file.string() << ".";
+    
+    size = boost::filesystem::file_size(file);
+    LOG_IF(FATAL, size < sizeof(IOUtil::BinaryLabelHeader)) 
+            << "Invalid binary label file: " << file.string() << ".";
+    
+#if defined(WIN32) || defined(_WIN32)
+    data = new char[size];
+    std::ifstream file_stream(file.c_str(), std::ifstream::binary);
+    file_stream.read((char*) data, size);
+#else
+    int descriptor = open(file.c_str(), O_RDONLY);
+    LOG_IF(FATAL, descriptor < 0) << "Could not open file: " << file.string() << ".";
+    
+    // Private mapping, modifications are copy-on-write and never reach the file.
+    data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    
+    LOG_IF(FATAL, data == MAP_FAILED) << "Could not map file: " << file.string() << ".";
+#endif
+    
+    const IOUtil::BinaryLabelHeader* header = (const IOUtil::BinaryLabelHeader*) data;
+    LOG_IF(FATAL, std::memcmp(header->magic, BINARY_LABEL_MAGIC, 4) != 0) 
+            << "Not a binary label file: " << file.string() << ".";
+    LOG_IF(FATAL, header->version != BINARY_LABEL_VERSION) 
+            << "Unsupported binary label file version: " << header->version << ".";
+    LOG_IF(FATAL, header->type != CV_32SC1) 
+            << "Unsupported label type: " << header->type << ".";
+    LOG_IF(FATAL, size < sizeof(IOUtil::BinaryLabelHeader) + ((size_t) header->rows)*header->cols*sizeof(int))
+            << "Binary label file is truncated: " << file.string() << ".";
+    
+    label_count = header->labels;
+    labels = cv::Mat(header->rows, header->cols, CV_32SC1, 
+            (char*) data + sizeof(IOUtil::BinaryLabelHeader));
+}
+
+MappedLabels::~MappedLabels() {
+    labels.release();
+    
+#if defined(WIN32) || defined(_WIN32)
+    delete[] (char*) data;
+#else
+    munmap(data, size);
+#endif
+}
+
+cv::Mat& MappedLabels::getLabels() {
+    return labels;
+}
+
+int MappedLabels::getLabelCount() const {
+    return label_count;
+}
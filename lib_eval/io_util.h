@@ -46,11 +46,32 @@
     #endif
 #endif
 
+class RunLengthLabels;
+
 /** \brief I/O utilities.
  * \author David Stutz
  */
 class IOUtil {
 public:
+    
+    /** \brief Header of binary label files, followed by rows*cols labels 
+     * stored row-major in native byte order.
+     */
+    struct BinaryLabelHeader {
+        /** \brief Magic bytes, "SPLB". */
+        char magic[4];
+        /** \brief Format version. */
+        int version;
+        /** \brief Number of rows. */
+        int rows;
+        /** \brief Number of columns. */
+        int cols;
+        /** \brief OpenCV type of the labels, currently only CV_32SC1. */
+        int type;
+        /** \brief Number of labels, i.e. maximum label plus one. */
+        int labels;
+    };
+    
     /** \brief Read an OpenCV matrix.
      * \param[in] file path to file to read
      * \param[out] mat matrix read
@@ -114,6 +135,57 @@ public:
      */
     static int readMatCSVInt(boost::filesystem::path file, int rows, int cols, cv::Mat &result);
     
+    /** \brief Write labels to a binary label file, see BinaryLabelHeader.
+     * \param[in] file path to file to write
+     * \param[in] labels labels as int image
+     * \return number of rows written
+     */
+    static int writeMatBinary(boost::filesystem::path file, const cv::Mat &labels);
+    
+    /** \brief Read a binary label file into a matrix; use MappedLabels to
+     * avoid the copy.
+     * \param[in] file path to file
+     * \param[out] result labels read as int image
+     * \return number of rows read
+     */
+    static int readMatBinary(boost::filesystem::path file, cv::Mat &result);
+    
+    /** \brief Check whether the given file is a binary label file by its header.
+     * \param[in] file path to file
+     * \return whether the file is a binary label file
+     */
+    static bool isBinaryLabelFile(boost::filesystem::path file);
+    
+    /** \brief Write labels, the format is chosen by the extension of the file
+     * (.bin for binary label files, .rle for run-length encoded labels, see 
+     * RunLengthLabels, CSV otherwise).
+     * \param[in] file path to file to write
+     * \param[in] labels labels as int image
+     * \return number of rows written
+     */
+    static int writeLabels(boost::filesystem::path file, const cv::Mat &labels);
+    
+    /** \brief Read labels, the format is detected from the file header.
+     * \param[in] file path to file
+     * \param[out] labels labels read as int image
+     * \return number of rows read
+     */
+    static int readLabels(boost::filesystem::path file, cv::Mat &labels);
+    
+    /** \brief Read labels as runs, the format is detected from the file header;
+     * run-length label files are read without expanding them.
+     * \param[in] file path to file
+     * \param[out] labels labels read
+     * \return number of rows read
+     */
+    static int readLabels(boost::filesystem::path file, RunLengthLabels &labels);
+    
+    /** \brief Get the file extension for the given label format.
+     * \param[in] format label format, "csv", "bin" or "rle"
+     * \return extension including the dot
+     */
+    static std::string getLabelExtension(std::string format);
+    
     /** \brief Read CSV file into matrix.
      * \param[in] file path to file
      * \param[out] result matrix read
@@ -186,6 +258,60 @@ public:
      */
     static void getCSVExtensions(std::vector<std::string> &extensions);
     
+    /** \brief Get a vector of all supported label file extensions.
+     * \param[out] extensions label extensions
+     */
+    static void getLabelExtensions(std::vector<std::string> &extensions);
+    
+    /** \brief Find a label file with the given stem in any of the supported formats.
+     * \param[in] directory directory to search in
+     * \param[in] stem file name without extension
+     * \return path to the label file, the CSV path if none exists
+     */
+    static boost::filesystem::path findLabelFile(boost::filesystem::path directory,
+            std::string stem);
+    
+};
+
+/** \brief Memory maps a binary label file and wraps the labels as cv::Mat 
+ * without copying; the labels are only valid as long as the object lives.
+ * 
+ * The mapping is private, i.e. modifying the labels does not change the file.
+ * 
+ * \author David Stutz
+ */
+class MappedLabels {
+public:
+    /** \brief Constructor, maps the given file.
+     * \param[in] file path to binary label file
+     */
+    MappedLabels(boost::filesystem::path file);
+    
+    /** \brief Destructor, unmaps the file. */
+    ~MappedLabels();
+    
+    /** \brief Get the mapped labels.
+     * \return labels as int image
+     */
+    cv::Mat& getLabels();
+    
+    /** \brief Get the number of labels stored in the header.
+     * \return number of labels
+     */
+    int getLabelCount() const;
+    
+private:
+    MappedLabels(const MappedLabels&);
+    MappedLabels& operator=(const MappedLabels&);
+    
+    /** \brief Start of the mapping. */
+    void* data;
+    /** \brief Size of the mapping in bytes. */
+    size_t size;
+    /** \brief Number of labels. */
+    int label_count;
+    /** \brief Labels pointing into the mapping. */
+    cv::Mat labels;
 };
 
 #endif	/* IO_UTIL_H */
@@ -29,13 +29,22 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <ctime>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <random>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <glog/logging.h>
 #include <sys/time.h>
 #include "io_util.h"
+#include "evaluation.h"
+#include "boundary_evaluation.h"
+#include "intersection_statistics.h"
+#include "superpixel_statistics.h"
+#include "superpixel_tools.h"
 #include "evaluation_summary.h"
 #include "parameter_optimization_tool.h"
 
@@ -78,6 +87,13 @@ ParameterOptimizationTool::ParameterOptimizationTool(boost::filesystem::path img
     
     superpixels_min = 0;
     superpixels_max = std::numeric_limits<int>::max();
+    
+    threads = 1;
+    
+    strategy = GRID_SEARCH;
+    budget = 0;
+    halving_rate = 3;
+    halving_images = 10;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -178,35 +194,83 @@ void ParameterOptimizationTool::useIntrinsics(boost::filesystem::path intrinsics
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// optimize
+// registerAlgorithm
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::registerAlgorithm(std::string name, Algorithm algorithm) {
+    getAlgorithms()[name] = algorithm;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// isAlgorithmRegistered
 ////////////////////////////////////////////////////////////////////////////////
 
-int ParameterOptimizationTool::numCombinations() {
+bool ParameterOptimizationTool::isAlgorithmRegistered(std::string name) {
+    return getAlgorithms().find(name) != getAlgorithms().end();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// useAlgorithm
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::useAlgorithm(std::string name) {
+    LOG_IF(FATAL, !isAlgorithmRegistered(name)) << "Algorithm not registered: " << name << ".";
     
-    int combinations = 1;
-    for (unsigned int p = 0; p < parameters.size(); ++p) {
-        std::tuple<std::string, std::string, int, int> parameter_tuple = parameters[p];
-        
-        switch (std::get<2>(parameter_tuple)) {
-            case FLOAT_PARAMETER:
-            {
-                int float_parameter = std::get<3>(parameter_tuple);
-                combinations *= TUPLE(float_parameters[float_parameter], 0).size();
-                break;
-            }
-            case INTEGER_PARAMETER:
-            {
-                int integer_parameter = std::get<3>(parameter_tuple);
-                combinations *= TUPLE(integer_parameters[integer_parameter], 0).size();
-                break;
-            }
-            default:
-                LOG(FATAL) << "Invalid parameter type.";
-                break;
-        }
-    }
+    algorithm = getAlgorithms()[name];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setThreads
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::setThreads(int threads) {
+    LOG_IF(FATAL, threads < 0) << "Invalid number of threads.";
+    this->threads = threads;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getThreads
+////////////////////////////////////////////////////////////////////////////////
+
+int ParameterOptimizationTool::getThreads() {
+    return threads;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setStrategy
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::setStrategy(int strategy, int budget) {
+    LOG_IF(FATAL, strategy != GRID_SEARCH && strategy != SUCCESSIVE_HALVING 
+            && strategy != COORDINATE_DESCENT && strategy != RANDOM_SEARCH) 
+            << "Invalid search strategy.";
+    LOG_IF(FATAL, budget < 0) << "Invalid budget.";
+    LOG_IF(FATAL, strategy == RANDOM_SEARCH && budget == 0) 
+            << "Random search requires a budget.";
     
-    return combinations;
+    this->strategy = strategy;
+    this->budget = budget;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setSuccessiveHalving
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::setSuccessiveHalving(int halving_rate, int halving_images) {
+    LOG_IF(FATAL, halving_rate < 2) << "Invalid halving rate.";
+    LOG_IF(FATAL, halving_images < 1) << "Invalid number of images.";
+    
+    this->halving_rate = halving_rate;
+    this->halving_images = halving_images;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getAlgorithms
+////////////////////////////////////////////////////////////////////////////////
+
+std::map<std::string, ParameterOptimizationTool::Algorithm>& ParameterOptimizationTool::getAlgorithms() {
+    static std::map<std::string, Algorithm> algorithms;
+    return algorithms;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -216,374 +280,483 @@ int ParameterOptimizationTool::numCombinations() {
 void ParameterOptimizationTool::optimize(float weight, float weight_ue, float weight_co) {
     LOG_IF(FATAL, weight >= 1.0f) << "Invalid UE weight.";
     LOG_IF(FATAL, weight_ue + weight_co >= 1.0f) << "Invalid UE and CO weights.";
+    LOG_IF(FATAL, algorithm && (!depth_directory.empty() || !post_processing_command_line.empty())) 
+            << "In-process optimization supports neither depth nor post processing.";
     
     int K = numCombinations();
 //    std::cout << "Initializing parameters: " << K << "." << std::endl;
     std::cout << "Total: " << K << " combinations." << std::endl;
     
-    // Write header.
-    std::stringstream output;
-    output << "sp_directory" << ",";
-    for (unsigned int p = 0; p < parameters.size(); ++p) {
-        output << TUPLE(parameters[p], 0) << ",";
+    listImages();
+    
+    // Only combinations evaluated on all images are written.
+    std::vector<int> combinations;
+    std::vector<Result> results;
+    
+    switch (strategy) {
+        case GRID_SEARCH:
+            combinations.resize(K);
+            for (int k = 0; k < K; ++k) {
+                combinations[k] = k;
+            }
+            
+            evaluateCombinations(combinations, 0, results);
+            break;
+        case SUCCESSIVE_HALVING:
+            searchSuccessiveHalving(weight, combinations, results);
+            break;
+        case COORDINATE_DESCENT:
+            searchCoordinateDescent(weight, combinations, results);
+            break;
+        case RANDOM_SEARCH:
+            sampleCombinations(budget, combinations);
+            evaluateCombinations(combinations, 0, results);
+            break;
+        default:
+            LOG(FATAL) << "Invalid search strategy.";
+            break;
     }
-    output << "rec_average" << "," << "ue_np_average" << "," 
-            << "co_average" << "," << "score" << ","
-            << "co_score" << "," << "sp_average" << "\n";
     
-    // To store results and parameters only (all are convertible to float).
-    int cols = parameters.size() + 6;
-    cv::Mat mat_output(0, cols, CV_32FC1, cv::Scalar(0));
+    writeResults(combinations, results, weight, weight_ue, weight_co);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// searchSuccessiveHalving
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::searchSuccessiveHalving(float weight, 
+        std::vector<int> &combinations, std::vector<Result> &results) {
     
-    float score_max = 0;
-    float co_score_max = 0;
-    float average_time = 0;
+    // The budget covers the evaluations of all rounds, so start with as many
+    // combinations as fit.
+    int count = numCombinations();
+    if (budget > 0) {
+        count = std::min(count, budget);
+        while (count > 1 && countHalvingEvaluations(count) > budget) {
+            --count;
+        }
+    }
     
-    for (int k = 0; k < K; ++k) {
+    sampleCombinations(count, combinations);
+    
+    // Each round evaluates the remaining combinations on halving_rate times
+    // more images and keeps the best 1/halving_rate of them; the last round 
+    // uses all images.
+    int N = image_files.size();
+    int num_images = std::min(halving_images, N);
+    
+    while (true) {
+        std::cout << "Successive halving: " << combinations.size() 
+                << " combinations on " << num_images << " images." << std::endl;
         
-        // For estimating remaining time:
-        struct timeval tv;
-        struct timeval start_tv;
-
-        gettimeofday(&start_tv, NULL);
+        evaluateCombinations(combinations, (num_images < N ? num_images : 0), results);
         
-        bool done = false;
-        for (int p = parameters.size() - 1; p >= 0; --p) {
-            if (done) {
-                break;
-            }
-            
-            std::tuple<std::string, std::string, int, int> parameter_tuple = parameters[p];
-            switch (std::get<2>(parameter_tuple)) {
-                case FLOAT_PARAMETER:
-                {
-                    int float_parameter = std::get<3>(parameter_tuple);
-                    TUPLE(float_parameters[float_parameter], 1)++;
-                    
-                    if (TUPLE(float_parameters[float_parameter], 1) >= TUPLE(float_parameters[float_parameter], 0).size()) {
-                        TUPLE(float_parameters[float_parameter], 1) = 0;
-                    }
-                    else {
-                        done = true;
-                    }
-                    
-                    break;
-                }
-                case INTEGER_PARAMETER:
-                {
-                    int integer_parameter = std::get<3>(parameter_tuple);
-                    TUPLE(integer_parameters[integer_parameter], 1)++;
-                    
-                    if (TUPLE(integer_parameters[integer_parameter], 1) >= TUPLE(integer_parameters[integer_parameter], 0).size()) {
-                        TUPLE(integer_parameters[integer_parameter], 1) = 0;
-                    }
-                    else {
-                        done = true;
-                    }
-                    
-                    break;
-                }
-                default:
-                    LOG(FATAL) << "[" << k << "] Invalid parameter type (parameter update).";
-                    break;
-            }
+        if (num_images >= N || combinations.size() <= 1) {
+            break;
         }
         
-        // Build command line.
-        boost::filesystem::path sp_directory = base_directory / 
-                boost::filesystem::path(std::to_string(time(NULL)));
-        std::string command_line_k = command_line + " -i " + img_directory.string();
+        std::vector<std::pair<float, int> > scores(combinations.size());
+        for (unsigned int i = 0; i < combinations.size(); ++i) {
+            scores[i] = std::pair<float, int>(-computeScore(results[i], weight), i);
+        }
         
-        if (!depth_directory.empty()) {
-            command_line_k += " -d " + depth_directory.string();
+        std::sort(scores.begin(), scores.end());
+        
+        int keep = std::max(1, (int) combinations.size()/halving_rate);
+        std::vector<int> promoted(keep);
+        for (int i = 0; i < keep; ++i) {
+            promoted[i] = combinations[scores[i].second];
         }
         
-        // When using different intrinsics, we assume this to be SUNRGBD data
-        // - those images have not been cropped!
-        if (!intrinsics_directory.empty()) {
-            command_line_k += " --intrinsics " + intrinsics_directory.string();
-            command_line_k += " --cropping-x 0";
-            command_line_k += " --cropping-y 0";
+        // Keep the order of the combinations.
+        std::sort(promoted.begin(), promoted.end());
+        combinations = promoted;
+        
+        num_images = std::min(num_images*halving_rate, N);
+    }
+    
+    // A single remaining combination may not have been evaluated on all images.
+    if (num_images < N) {
+        evaluateCombinations(combinations, 0, results);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// countHalvingEvaluations
+////////////////////////////////////////////////////////////////////////////////
+
+int ParameterOptimizationTool::countHalvingEvaluations(int count) {
+    
+    // Same rounds as searchSuccessiveHalving.
+    int N = image_files.size();
+    int num_images = std::min(halving_images, N);
+    
+    int evaluations = 0;
+    while (true) {
+        evaluations += count;
+        
+        if (num_images >= N || count <= 1) {
+            break;
         }
         
-        command_line_k += " -o " + sp_directory.string();
+        count = std::max(1, count/halving_rate);
+        num_images = std::min(num_images*halving_rate, N);
+    }
+    
+    if (num_images < N) {
+        evaluations += count;
+    }
+    
+    return evaluations;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// searchCoordinateDescent
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::searchCoordinateDescent(float weight, 
+        std::vector<int> &combinations, std::vector<Result> &results) {
+    
+    int K = numCombinations();
+    int max_evaluations = (budget > 0 ? std::min(budget, K) : K);
+    
+    // Start with the middle value of each parameter.
+    std::vector<int> current(parameters.size());
+    for (unsigned int p = 0; p < parameters.size(); ++p) {
+        current[p] = countValues(p)/2;
+    }
+    
+    std::map<int, Result> evaluated;
+    bool changed = true;
+    
+    while (changed && (int) evaluated.size() < max_evaluations) {
+        changed = false;
         
-        for (unsigned p = 0; p < parameters.size(); ++p) {
-            std::tuple<std::string, std::string, int, int> parameter_tuple = parameters[p];
+        for (unsigned int p = 0; p < parameters.size(); ++p) {
             
-            command_line_k += " " + std::get<1>(parameter_tuple);
-            switch (std::get<2>(parameter_tuple)) {
-                case FLOAT_PARAMETER:
-                {
-                    int float_parameter = std::get<3>(parameter_tuple);
-                    std::vector<float> float_parameter_values = TUPLE(float_parameters[float_parameter], 0);
-                    
-                    std::stringstream float_parameter_ss;
-                    float_parameter_ss << std::setprecision(6) << float_parameter_values[TUPLE(float_parameters[float_parameter], 1)];
-                    
-                    command_line_k += " " + float_parameter_ss.str();
-                    break;
+            // Evaluate all values of parameter p while fixing the others.
+            std::vector<int> line;
+            std::vector<int> pending;
+            
+            std::vector<int> indices = current;
+            for (int index = 0; index < countValues(p); ++index) {
+                indices[p] = index;
+                
+                int k = getCombinationIndex(indices);
+                line.push_back(k);
+                
+                if (evaluated.find(k) == evaluated.end() 
+                        && (int) (evaluated.size() + pending.size()) < max_evaluations) {
+                    pending.push_back(k);
                 }
-                case INTEGER_PARAMETER:
-                {
-                    int integer_parameter = std::get<3>(parameter_tuple);
-                    std::vector<int> integer_parameter_values = TUPLE(integer_parameters[integer_parameter], 0);
-                    
-                    std::stringstream integer_parameter_ss;
-                    integer_parameter_ss << std::setprecision(6) << integer_parameter_values[TUPLE(integer_parameters[integer_parameter], 1)];
-                    
-                    command_line_k += " " + integer_parameter_ss.str();
-                    break;
+            }
+            
+            std::vector<Result> pending_results;
+            evaluateCombinations(pending, 0, pending_results);
+            
+            for (unsigned int i = 0; i < pending.size(); ++i) {
+                evaluated[pending[i]] = pending_results[i];
+            }
+            
+            // Only move for a strict improvement such that the search terminates.
+            int k_current = getCombinationIndex(current);
+            int k_best = k_current;
+            float score_best = -1;
+            
+            if (evaluated.find(k_current) != evaluated.end()) {
+                score_best = computeScore(evaluated[k_current], weight);
+            }
+            
+            for (unsigned int i = 0; i < line.size(); ++i) {
+                std::map<int, Result>::const_iterator it = evaluated.find(line[i]);
+                if (it == evaluated.end()) {
+                    continue;
+                }
+                
+                float score = computeScore(it->second, weight);
+                if (score > score_best) {
+                    score_best = score;
+                    k_best = line[i];
                 }
-                default:
-                    LOG(FATAL) << "Invalid parameter type.";
-                    break;
+            }
+            
+            if (k_best != k_current) {
+                getCombination(k_best, current);
+                changed = true;
             }
         }
         
-        if (!command_line_parameters.empty()) {
-            command_line_k += " " + command_line_parameters;
+        std::cout << "Coordinate descent: " << evaluated.size() 
+                << " combinations evaluated." << std::endl;
+    }
+    
+    combinations.clear();
+    results.clear();
+    
+    for (std::map<int, Result>::const_iterator it = evaluated.begin(); 
+            it != evaluated.end(); ++it) {
+        combinations.push_back(it->first);
+        results.push_back(it->second);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// sampleCombinations
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::sampleCombinations(int count, 
+        std::vector<int> &combinations) {
+    
+    int K = numCombinations();
+    
+    combinations.resize(K);
+    for (int k = 0; k < K; ++k) {
+        combinations[k] = k;
+    }
+    
+    if (count <= 0 || count >= K) {
+        return;
+    }
+    
+    // Fixed seed such that a resumed optimization samples the same combinations
+    // and finds them in the journal.
+    std::mt19937 generator(0);
+    std::shuffle(combinations.begin(), combinations.end(), generator);
+    
+    combinations.resize(count);
+    std::sort(combinations.begin(), combinations.end());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeScore
+////////////////////////////////////////////////////////////////////////////////
+
+float ParameterOptimizationTool::computeScore(const Result &result, float weight) {
+    
+    // Only consider for best parameters if superpixel tolerance is met!
+    if (result.sp_average >= superpixels_min && result.sp_average <= superpixels_max) {
+        return (1 - weight)*result.rec_average + weight*(1 - result.ue_np_average);
+    }
+    
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// evaluateCombinations
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::evaluateCombinations(const std::vector<int> &combinations, 
+        int num_images, std::vector<Result> &results) {
+    
+    results.resize(combinations.size());
+    
+    // Combinations found in the journal were evaluated by an earlier, 
+    // possibly interrupted, run.
+    std::map<int, Result> journal;
+    readJournal(num_images, journal);
+    
+    std::vector<int> pending;
+    for (unsigned int i = 0; i < combinations.size(); ++i) {
+        std::map<int, Result>::const_iterator it = journal.find(combinations[i]);
+        if (it != journal.end()) {
+            results[i] = it->second;
         }
-        
-//        LOG(INFO) << "[" << k << "] " << command_line_k;
-        
-        // Run.
-        int status = system(command_line_k.c_str());
-        
-        if (status != 0) {
-            LOG(FATAL) << "Command line was not successful: " << command_line_k;
+        else {
+            pending.push_back(i);
         }
-        
-        // Post processing:
-        if (!post_processing_command_line.empty()) {
-            std::string post_processing_command_line_k = post_processing_command_line 
-                    + " -i " + sp_directory.string() + " -m " + img_directory.string();
-
-            int status = system(post_processing_command_line_k.c_str());
+    }
+    
+    if (pending.size() < combinations.size()) {
+        std::cout << "Resuming: " << (combinations.size() - pending.size()) 
+                << " combinations found in journal." << std::endl;
+    }
+    
+    if (pending.empty()) {
+        return;
+    }
+    
+    // Images are shared read-only between the workers.
+    boost::filesystem::path img_directory_n = img_directory;
+    if (algorithm) {
+        if (images.empty()) {
+            loadImages();
+        }
+    }
+    else if (num_images > 0) {
+        img_directory_n = getImageSubset(num_images);
+    }
+    
+    std::ofstream journal_file(getJournalFile(num_images).string(), std::ofstream::app);
+    std::mutex mutex;
+    std::atomic<int> next(0);
+    int done = 0;
+    
+    // For estimating remaining time:
+    struct timeval start_tv;
+    gettimeofday(&start_tv, NULL);
+    
+    auto worker = [&]() {
+        while (true) {
+            int n = next++;
+            if (n >= (int) pending.size()) {
+                break;
+            }
+            
+            int i = pending[n];
+            int k = combinations[i];
             
-            if (status != 0) {
-                LOG(FATAL) << "Post processing command line was not successful: " << post_processing_command_line_k;
+            std::vector<int> indices;
+            getCombination(k, indices);
+            
+            Result result;
+            if (algorithm) {
+                evaluateInProcess(indices, num_images, result);
             }
+            else {
+                evaluateCommandLine(indices, img_directory_n, getCombinationDirectory(k), result);
+            }
+            
+            std::lock_guard<std::mutex> lock(mutex);
+            results[i] = result;
+            
+            // Flush each line so that an interrupted run loses at most the
+            // combinations currently running.
+            journal_file << k << std::setprecision(9) << "," << result.rec_average 
+                    << "," << result.ue_np_average << "," << result.co_average 
+                    << "," << result.sp_average << std::endl;
+            
+            struct timeval tv;
+            gettimeofday(&tv, NULL);
+            float elapsed = (tv.tv_sec - start_tv.tv_sec) 
+                    + (tv.tv_usec - start_tv.tv_usec) / 1000000.0;
+            
+            if (done%10 == 0) {
+                if (done != 0) {
+                    std::cout << std::endl;
+                }
+                
+                std::cout << "Time remaining: " << elapsed/(done + 1)*(pending.size() - done - 1) 
+                        << " (" << elapsed/(done + 1) << ") " << std::flush;
+            }
+            
+            // Show progress ...
+            std::cout << "." << std::flush;
+            ++done;
         }
-        // Evaluation:
-//        LOG(INFO) << "[" << k << "] Running evaluation.";
-        EvaluationSummary evaluation_summary(sp_directory, gt_directory, img_directory, 
-                evaluation_metrics, evaluation_statistics);
-        
-        int gt_max = 0;
-        evaluation_summary.computeSummary(gt_max);
-        
-        cv::Mat results;
-        IOUtil::readMat(sp_directory / boost::filesystem::path("summary.csv.txt"), results);
-        
-        // Compute average over all ground truths.
-        LOG_IF(FATAL, results.cols != (gt_max + 1) + 2) <<  "Invalid number of columns in evaluation results: " 
-                << results.cols << " != " << (gt_max + 1) + 2;
-        // Rec on first row, UE on second, superpixel number of third.
-        LOG_IF(FATAL, results.rows != 4) <<  "Invalid number of rows in evaluation results: " << results.rows << " != 4";
-        
-        float rec_average = 0;
-        float ue_np_average = 0;
-        float co_average = 0;
-        float sp_average = 0;
-        
-        for (int j = 0; j < gt_max + 1; ++j) {
-            rec_average += results.at<float>(0, j);
-            ue_np_average += results.at<float>(1, j);
-            co_average += results.at<float>(2, j);
-            sp_average += results.at<float>(3, j);
-        }
+    };
+    
+    int num_threads = threads;
+    if (num_threads <= 0) {
+        num_threads = std::max(1, (int) std::thread::hardware_concurrency());
+    }
+    num_threads = std::min(num_threads, (int) pending.size());
+    
+    std::vector<std::thread> workers;
+    for (int t = 0; t < num_threads; ++t) {
+        workers.push_back(std::thread(worker));
+    }
+    
+    for (int t = 0; t < num_threads; ++t) {
+        workers[t].join();
+    }
+    
+    journal_file.close();
+    std::cout << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeResults
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::writeResults(const std::vector<int> &combinations, 
+        const std::vector<Result> &results, float weight, float weight_ue, 
+        float weight_co) {
+    
+    // Write header.
+    std::stringstream output;
+    output << "sp_directory" << ",";
+    for (unsigned int p = 0; p < parameters.size(); ++p) {
+        output << TUPLE(parameters[p], 0) << ",";
+    }
+    output << "rec_average" << "," << "ue_np_average" << "," 
+            << "co_average" << "," << "score" << ","
+            << "co_score" << "," << "sp_average" << "\n";
+    
+    // To store results and parameters only (all are convertible to float).
+    int cols = parameters.size() + 6;
+    cv::Mat mat_output(0, cols, CV_32FC1, cv::Scalar(0));
+    
+    float score_max = 0;
+    float co_score_max = 0;
+    std::vector<int> best(parameters.size(), 0);
+    std::vector<int> co_best(parameters.size(), 0);
+    
+    for (unsigned int i = 0; i < combinations.size(); ++i) {
         
-        rec_average /= (gt_max + 1);
-        ue_np_average /= (gt_max + 1);
-        co_average /= (gt_max + 1);
-        sp_average /= (gt_max + 1);
+        int k = combinations[i];
+        const Result &result = results[i];
+        
+        std::vector<int> indices;
+        getCombination(k, indices);
         
         float score = 0;
         float co_score = 0;
         
         // Only consider for best parameters if superpixel tolerance is met!
-        if (sp_average >= superpixels_min && sp_average <= superpixels_max) {
+        if (result.sp_average >= superpixels_min && result.sp_average <= superpixels_max) {
             
-            score = (1 - weight)*rec_average + weight*(1 - ue_np_average);
+            score = computeScore(result, weight);
             if (score > score_max) {
                 score_max = score;
-
-                // Save current parameters.
-                for (unsigned p = 0; p < parameters.size(); ++p) {
-
-                    std::tuple<std::string, std::string, int, int> parameter_tuple = parameters[p];
-                    switch (std::get<2>(parameter_tuple)) {
-                        case FLOAT_PARAMETER:
-                        {
-                            int float_parameter = std::get<3>(parameter_tuple);
-                            std::vector<float> float_parameter_values = TUPLE(float_parameters[float_parameter], 0);
-
-                            // 2!
-                            TUPLE(float_parameters[float_parameter], 2) = float_parameter_values[TUPLE(float_parameters[float_parameter], 1)];
-                            break;
-                        }
-                        case INTEGER_PARAMETER:
-                        {
-                            int integer_parameter = std::get<3>(parameter_tuple);
-                            std::vector<int> integer_parameter_values = TUPLE(integer_parameters[integer_parameter], 0);
-
-                            // 2!
-                            TUPLE(integer_parameters[integer_parameter], 2) = integer_parameter_values[TUPLE(integer_parameters[integer_parameter], 1)];
-                            break;
-                        }
-                        default:
-                            LOG(FATAL) << "[" << k << "] Invalid parameter type (best value).";
-                            break;
-                    }
-                }
+                best = indices;
             }
 
-            co_score = (1 - weight_ue - weight_co)*rec_average 
-                    + weight_ue*(1 - ue_np_average) + weight_co*(co_average);
+            co_score = (1 - weight_ue - weight_co)*result.rec_average 
+                    + weight_ue*(1 - result.ue_np_average) + weight_co*(result.co_average);
 
             if (co_score > co_score_max) {
                 co_score_max = co_score;
-
-                // Save current parameters.
-                for (unsigned p = 0; p < parameters.size(); ++p) {
-
-                    std::tuple<std::string, std::string, int, int> parameter_tuple = parameters[p];
-                    switch (std::get<2>(parameter_tuple)) {
-                        case FLOAT_PARAMETER:
-                        {
-                            int float_parameter = std::get<3>(parameter_tuple);
-                            std::vector<float> float_parameter_values = TUPLE(float_parameters[float_parameter], 0);
-
-                            // 3!
-                            TUPLE(float_parameters[float_parameter], 3) = float_parameter_values[TUPLE(float_parameters[float_parameter], 1)];
-                            break;
-                        }
-                        case INTEGER_PARAMETER:
-                        {
-                            int integer_parameter = std::get<3>(parameter_tuple);
-                            std::vector<int> integer_parameter_values = TUPLE(integer_parameters[integer_parameter], 0);
-
-                            // 3!
-                            TUPLE(integer_parameters[integer_parameter], 3) = integer_parameter_values[TUPLE(integer_parameters[integer_parameter], 1)];
-                            break;
-                        }
-                        default:
-                            LOG(FATAL) << "[" << k << "] Invalid parameter type (best value).";
-                            break;
-                    }
-                }
+                co_best = indices;
             }
         }
         
 //        LOG(INFO) << "[" << k << "] Updating CSV output.";
-        output << sp_directory.string() << ",";
+        if (algorithm) {
+            output << k << ",";
+        }
+        else {
+            output << getCombinationDirectory(k).string() << ",";
+        }
+        
         cv::Mat mat_row(1, cols, CV_32FC1, cv::Scalar(0));
         
         for (unsigned p = 0; p < parameters.size(); ++p) {
-            
-            std::tuple<std::string, std::string, int, int> parameter_tuple = parameters[p];
-            switch (std::get<2>(parameter_tuple)) {
-                case FLOAT_PARAMETER:
-                {
-                    int float_parameter = std::get<3>(parameter_tuple);
-                    std::vector<float> float_parameter_values = TUPLE(float_parameters[float_parameter], 0);
-                        
-                    output << float_parameter_values[TUPLE(float_parameters[float_parameter], 1)] << ",";
-                    mat_row.at<float>(0, p) = float_parameter_values[TUPLE(float_parameters[float_parameter], 1)];
-                    break;
-                }
-                case INTEGER_PARAMETER:
-                {
-                    int integer_parameter = std::get<3>(parameter_tuple);
-                        std::vector<int> integer_parameter_values = TUPLE(integer_parameters[integer_parameter], 0);
-                    
-                    output << integer_parameter_values[TUPLE(integer_parameters[integer_parameter], 1)] << ",";
-                    mat_row.at<float>(0, p) = integer_parameter_values[TUPLE(integer_parameters[integer_parameter], 1)];
-                    break;
-                }
-                default:
-                    LOG(FATAL) << "Invalid parameter type.";
-                    break;
-            }
+            output << formatParameterValue(p, indices[p]) << ",";
+            mat_row.at<float>(0, p) = getParameterValue(p, indices[p]);
         }
         
-        output << rec_average << "," << ue_np_average << "," << co_average << "," 
-                << score << "," << co_score << "," << sp_average << "\n";
+        output << result.rec_average << "," << result.ue_np_average << "," 
+                << result.co_average << "," << score << "," << co_score << "," 
+                << result.sp_average << "\n";
         
-        mat_row.at<float>(0, parameters.size()) = rec_average;
-        mat_row.at<float>(0, parameters.size() + 1) = ue_np_average;
-        mat_row.at<float>(0, parameters.size() + 2) = co_average;
+        mat_row.at<float>(0, parameters.size()) = result.rec_average;
+        mat_row.at<float>(0, parameters.size() + 1) = result.ue_np_average;
+        mat_row.at<float>(0, parameters.size() + 2) = result.co_average;
         mat_row.at<float>(0, parameters.size() + 3) = score;
         mat_row.at<float>(0, parameters.size() + 4) = co_score;
-        mat_row.at<float>(0, parameters.size() + 5) = sp_average;
+        mat_row.at<float>(0, parameters.size() + 5) = result.sp_average;
         mat_output.push_back(mat_row);
-        
-        // Clean up superpixel directory!
-        this->cleanUp(sp_directory);
-        
-        gettimeofday(&tv, NULL);
-        average_time += (tv.tv_sec - start_tv.tv_sec) +
-          (tv.tv_usec - start_tv.tv_usec) / 1000000.0;
-        
-        if (k%10 == 0) {
-            if (k != 0) {
-                std::cout << std::endl;
-            }
-            
-            std::cout << "Time remaining: " << average_time/(k + 1)*(K - k - 1) 
-                    << " (" << average_time/(k + 1) << ") " << std::flush;
-        }
-        
-        // Show progress ...
-        std::cout << "." << std::flush;
     }
     
     // Write best parameters.
     output << "best";
     for (unsigned p = 0; p < parameters.size(); ++p) {
-
-        std::tuple<std::string, std::string, int, int> parameter_tuple = parameters[p];
-        switch (std::get<2>(parameter_tuple)) {
-            case FLOAT_PARAMETER:
-            {
-                int float_parameter = std::get<3>(parameter_tuple);
-                output << "," << TUPLE(float_parameters[float_parameter], 2); // 2!
-                break;
-            }
-            case INTEGER_PARAMETER:
-            {
-                int integer_parameter = std::get<3>(parameter_tuple);
-                output << "," << TUPLE(integer_parameters[integer_parameter], 2); // 2!
-                break;
-            }
-            default:
-                LOG(FATAL) << "Invalid parameter type.";
-                break;
-        }
+        output << "," << formatParameterValue(p, best[p]);
     }
     
     output << "\n" << "co_best";
     for (unsigned p = 0; p < parameters.size(); ++p) {
-
-        std::tuple<std::string, std::string, int, int> parameter_tuple = parameters[p];
-        switch (std::get<2>(parameter_tuple)) {
-            case FLOAT_PARAMETER:
-            {
-                int float_parameter = std::get<3>(parameter_tuple);
-                output << "," << TUPLE(float_parameters[float_parameter], 3); // 3!
-                break;
-            }
-            case INTEGER_PARAMETER:
-            {
-                int integer_parameter = std::get<3>(parameter_tuple);
-                output << "," << TUPLE(integer_parameters[integer_parameter], 3); // 3!
-                break;
-            }
-            default:
-                LOG(FATAL) << "Invalid parameter type.";
-                break;
-        }
+        output << "," << formatParameterValue(p, co_best[p]);
     }
     
 //    LOG(INFO) << "Writing output to CSV.";
@@ -596,8 +769,519 @@ void ParameterOptimizationTool::optimize(float weight, float weight_ue, float we
     boost::filesystem::path parameter_optimization_mat = base_directory
             / boost::filesystem::path("parameter_optimization.csv.txt");
     IOUtil::writeMat(parameter_optimization_mat, mat_output);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getCombination
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::getCombination(int k, std::vector<int> &indices) {
     
-    std::cout << std::endl;
+    // The last parameter varies fastest.
+    indices.resize(parameters.size());
+    for (int p = parameters.size() - 1; p >= 0; --p) {
+        int values = countValues(p);
+        
+        indices[p] = k%values;
+        k /= values;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getCombinationIndex
+////////////////////////////////////////////////////////////////////////////////
+
+int ParameterOptimizationTool::getCombinationIndex(const std::vector<int> &indices) {
+    
+    int k = 0;
+    for (unsigned int p = 0; p < parameters.size(); ++p) {
+        k = k*countValues(p) + indices[p];
+    }
+    
+    return k;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// countValues
+////////////////////////////////////////////////////////////////////////////////
+
+int ParameterOptimizationTool::countValues(int p) {
+    
+    std::tuple<std::string, std::string, int, int> parameter_tuple = parameters[p];
+    switch (std::get<2>(parameter_tuple)) {
+        case FLOAT_PARAMETER:
+            return TUPLE(float_parameters[std::get<3>(parameter_tuple)], 0).size();
+        case INTEGER_PARAMETER:
+            return TUPLE(integer_parameters[std::get<3>(parameter_tuple)], 0).size();
+        default:
+            LOG(FATAL) << "Invalid parameter type.";
+            break;
+    }
+    
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getParameterValue
+////////////////////////////////////////////////////////////////////////////////
+
+float ParameterOptimizationTool::getParameterValue(int p, int index) {
+    
+    std::tuple<std::string, std::string, int, int> parameter_tuple = parameters[p];
+    switch (std::get<2>(parameter_tuple)) {
+        case FLOAT_PARAMETER:
+            return TUPLE(float_parameters[std::get<3>(parameter_tuple)], 0)[index];
+        case INTEGER_PARAMETER:
+            return TUPLE(integer_parameters[std::get<3>(parameter_tuple)], 0)[index];
+        default:
+            LOG(FATAL) << "Invalid parameter type.";
+            break;
+    }
+    
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// formatParameterValue
+////////////////////////////////////////////////////////////////////////////////
+
+std::string ParameterOptimizationTool::formatParameterValue(int p, int index) {
+    
+    std::stringstream parameter_ss;
+    
+    std::tuple<std::string, std::string, int, int> parameter_tuple = parameters[p];
+    switch (std::get<2>(parameter_tuple)) {
+        case FLOAT_PARAMETER:
+            parameter_ss << std::setprecision(6) << TUPLE(float_parameters[std::get<3>(parameter_tuple)], 0)[index];
+            break;
+        case INTEGER_PARAMETER:
+            parameter_ss << TUPLE(integer_parameters[std::get<3>(parameter_tuple)], 0)[index];
+            break;
+        default:
+            LOG(FATAL) << "Invalid parameter type.";
+            break;
+    }
+    
+    return parameter_ss.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getCombinationDirectory
+////////////////////////////////////////////////////////////////////////////////
+
+boost::filesystem::path ParameterOptimizationTool::getCombinationDirectory(int k) {
+    return base_directory / boost::filesystem::path("combination_" + std::to_string(k));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getJournalFile
+////////////////////////////////////////////////////////////////////////////////
+
+boost::filesystem::path ParameterOptimizationTool::getJournalFile(int num_images) {
+    if (num_images > 0) {
+        return base_directory / boost::filesystem::path("parameter_optimization_" 
+                + std::to_string(num_images) + ".journal");
+    }
+    
+    return base_directory / boost::filesystem::path("parameter_optimization.journal");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getJournalSignature
+////////////////////////////////////////////////////////////////////////////////
+
+std::string ParameterOptimizationTool::getJournalSignature() {
+    
+    std::stringstream signature;
+    if (algorithm) {
+        signature << "in-process";
+    }
+    else {
+        signature << command_line << " " << command_line_parameters;
+    }
+    
+    for (unsigned int p = 0; p < parameters.size(); ++p) {
+        signature << " " << TUPLE(parameters[p], 0) << "=";
+        
+        for (int index = 0; index < countValues(p); ++index) {
+            signature << (index > 0 ? ";" : "") << formatParameterValue(p, index);
+        }
+    }
+    
+    signature << " img=" << img_directory.string() << " gt=" << gt_directory.string();
+    if (!depth_directory.empty()) {
+        signature << " depth=" << depth_directory.string();
+    }
+    if (!intrinsics_directory.empty()) {
+        signature << " intrinsics=" << intrinsics_directory.string();
+    }
+    
+    // The images are identified by a hash (FNV-1a) of their file names in 
+    // the order used for subsets.
+    unsigned long long hash = 14695981039346656037ULL;
+    for (unsigned int n = 0; n < image_files.size(); ++n) {
+        std::string name = image_files[n].filename().string() + "/";
+        for (unsigned int c = 0; c < name.size(); ++c) {
+            hash = (hash ^ (unsigned char) name[c])*1099511628211ULL;
+        }
+    }
+    
+    signature << " images=" << image_files.size() << ":" << std::hex 
+            << std::setw(16) << std::setfill('0') << hash;
+    
+    return signature.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readJournal
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::readJournal(int num_images, std::map<int, Result> &journal) {
+    
+    journal.clear();
+    
+    boost::filesystem::path journal_file = getJournalFile(num_images);
+    std::string signature = "# " + getJournalSignature();
+    
+    if (boost::filesystem::is_regular_file(journal_file)) {
+        std::ifstream file_stream(journal_file.string());
+        
+        std::string line;
+        std::getline(file_stream, line);
+        
+        if (line == signature) {
+            while (std::getline(file_stream, line)) {
+                std::stringstream line_stream(line);
+                std::string cell;
+                
+                std::vector<std::string> data;
+                while (std::getline(line_stream, cell, ',')) {
+                    data.push_back(cell);
+                }
+                
+                // Lines cut off by an interruption are skipped.
+                if (data.size() != 5) {
+                    continue;
+                }
+                
+                Result result;
+                result.rec_average = std::atof(data[1].c_str());
+                result.ue_np_average = std::atof(data[2].c_str());
+                result.co_average = std::atof(data[3].c_str());
+                result.sp_average = std::atof(data[4].c_str());
+                journal[std::atoi(data[0].c_str())] = result;
+            }
+            
+            return;
+        }
+        
+        LOG(WARNING) << "Journal does not match the current parameters, starting over: " 
+                << journal_file.string() << ".";
+    }
+    
+    std::ofstream file_stream(journal_file.string());
+    file_stream << signature << std::endl;
+    file_stream.close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// evaluateCommandLine
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::evaluateCommandLine(const std::vector<int> &indices, 
+        const boost::filesystem::path &img_directory_n, 
+        const boost::filesystem::path &sp_directory, Result &result) {
+    
+    // Left over from an interrupted run.
+    if (boost::filesystem::exists(sp_directory)) {
+        boost::filesystem::remove_all(sp_directory);
+    }
+    
+    // Build command line.
+    std::string command_line_k = command_line + " -i " + img_directory_n.string();
+    
+    if (!depth_directory.empty()) {
+        command_line_k += " -d " + depth_directory.string();
+    }
+    
+    // When using different intrinsics, we assume this to be SUNRGBD data
+    // - those images have not been cropped!
+    if (!intrinsics_directory.empty()) {
+        command_line_k += " --intrinsics " + intrinsics_directory.string();
+        command_line_k += " --cropping-x 0";
+        command_line_k += " --cropping-y 0";
+    }
+    
+    command_line_k += " -o " + sp_directory.string();
+    
+    for (unsigned p = 0; p < parameters.size(); ++p) {
+        command_line_k += " " + TUPLE(parameters[p], 1);
+        command_line_k += " " + formatParameterValue(p, indices[p]);
+    }
+    
+    if (!command_line_parameters.empty()) {
+        command_line_k += " " + command_line_parameters;
+    }
+    
+//        LOG(INFO) << "[" << k << "] " << command_line_k;
+    
+    // Run.
+    int status = system(command_line_k.c_str());
+    
+    if (status != 0) {
+        LOG(FATAL) << "Command line was not successful: " << command_line_k;
+    }
+    
+    // Post processing:
+    if (!post_processing_command_line.empty()) {
+        std::string post_processing_command_line_k = post_processing_command_line 
+                + " -i " + sp_directory.string() + " -m " + img_directory_n.string();
+
+        int status = system(post_processing_command_line_k.c_str());
+        
+        if (status != 0) {
+            LOG(FATAL) << "Post processing command line was not successful: " << post_processing_command_line_k;
+        }
+    }
+    // Evaluation:
+//        LOG(INFO) << "[" << k << "] Running evaluation.";
+    EvaluationSummary evaluation_summary(sp_directory, gt_directory, img_directory_n, 
+            evaluation_metrics, evaluation_statistics);
+    
+    int gt_max = 0;
+    evaluation_summary.computeSummary(gt_max);
+    
+    cv::Mat results;
+    IOUtil::readMat(sp_directory / boost::filesystem::path("summary.csv.txt"), results);
+    
+    // Compute average over all ground truths.
+    LOG_IF(FATAL, results.cols != (gt_max + 1) + 2) <<  "Invalid number of columns in evaluation results: " 
+            << results.cols << " != " << (gt_max + 1) + 2;
+    // Rec on first row, UE on second, superpixel number of third.
+    LOG_IF(FATAL, results.rows != 4) <<  "Invalid number of rows in evaluation results: " << results.rows << " != 4";
+    
+    result.rec_average = 0;
+    result.ue_np_average = 0;
+    result.co_average = 0;
+    result.sp_average = 0;
+    
+    for (int j = 0; j < gt_max + 1; ++j) {
+        result.rec_average += results.at<float>(0, j);
+        result.ue_np_average += results.at<float>(1, j);
+        result.co_average += results.at<float>(2, j);
+        result.sp_average += results.at<float>(3, j);
+    }
+    
+    result.rec_average /= (gt_max + 1);
+    result.ue_np_average /= (gt_max + 1);
+    result.co_average /= (gt_max + 1);
+    result.sp_average /= (gt_max + 1);
+    
+    // Clean up superpixel directory!
+    this->cleanUp(sp_directory);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// evaluateInProcess
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::evaluateInProcess(const std::vector<int> &indices, 
+        int num_images, Result &result) {
+    
+    LOG_IF(FATAL, images.empty()) << "Images not loaded.";
+    
+    int N = images.size();
+    if (num_images > 0) {
+        N = std::min(num_images, N);
+    }
+    
+    std::map<std::string, float> values;
+    getParameterValues(indices, values);
+    
+    // Mirror EvaluationSummary: average over all images per ground truth index
+    // first, then average over the ground truth indices.
+    std::vector<float> rec_sum;
+    std::vector<float> ue_np_sum;
+    std::vector<float> co_sum;
+    std::vector<float> sp_sum;
+    std::vector<int> count;
+    
+    for (int n = 0; n < N; ++n) {
+        cv::Mat labels;
+        algorithm(images[n], values, labels);
+        SuperpixelTools::relabelConnectedSuperpixels(labels);
+        
+        SuperpixelStatistics superpixel_statistics(labels, images[n]);
+        float co = superpixel_statistics.computeCompactness();
+        float sp = Evaluation::computeSuperpixels(labels);
+        
+        for (unsigned int t = 0; t < gts[n].size(); ++t) {
+            int g = gt_indices[n][t];
+            if (g >= (int) count.size()) {
+                rec_sum.resize(g + 1, 0);
+                ue_np_sum.resize(g + 1, 0);
+                co_sum.resize(g + 1, 0);
+                sp_sum.resize(g + 1, 0);
+                count.resize(g + 1, 0);
+            }
+            
+            BoundaryEvaluation boundary_evaluation(labels, gts[n][t]);
+            IntersectionStatistics intersection_statistics(labels, gts[n][t]);
+            
+            rec_sum[g] += boundary_evaluation.computeBoundaryRecall();
+            ue_np_sum[g] += intersection_statistics.computeNPUndersegmentationError();
+            co_sum[g] += co;
+            sp_sum[g] += sp;
+            count[g]++;
+        }
+    }
+    
+    LOG_IF(FATAL, count.empty()) << "No ground truth found for in-process evaluation.";
+    
+    result.rec_average = 0;
+    result.ue_np_average = 0;
+    result.co_average = 0;
+    result.sp_average = 0;
+    
+    int gt_count = 0;
+    for (unsigned int g = 0; g < count.size(); ++g) {
+        if (count[g] > 0) {
+            result.rec_average += rec_sum[g]/count[g];
+            result.ue_np_average += ue_np_sum[g]/count[g];
+            result.co_average += co_sum[g]/count[g];
+            result.sp_average += sp_sum[g]/count[g];
+            ++gt_count;
+        }
+    }
+    
+    result.rec_average /= gt_count;
+    result.ue_np_average /= gt_count;
+    result.co_average /= gt_count;
+    result.sp_average /= gt_count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// loadImages
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::loadImages() {
+    
+    if (image_files.empty()) {
+        listImages();
+    }
+    
+    images.clear();
+    gts.clear();
+    gt_indices.clear();
+    
+    for (std::vector<boost::filesystem::path>::iterator it = image_files.begin(); 
+            it != image_files.end(); ++it) {
+        
+        cv::Mat image = cv::imread(it->string(), CV_LOAD_IMAGE_COLOR);
+        LOG_IF(FATAL, image.rows <= 0 || image.cols <= 0) << "Could not read image: " 
+                << it->string() << ".";
+        
+        // Same ground truth naming as in EvaluationSummary.
+        std::string stem = it->stem().string();
+        std::vector<cv::Mat> gts_n;
+        std::vector<int> gt_indices_n;
+        
+        boost::filesystem::path gt_file = IOUtil::findLabelFile(gt_directory, stem);
+        if (boost::filesystem::is_regular_file(gt_file)) {
+            cv::Mat gt;
+            IOUtil::readLabels(gt_file, gt);
+            
+            gts_n.push_back(gt);
+            gt_indices_n.push_back(0);
+        }
+        else {
+            for (int t = 0; t < 5; ++t) {
+                boost::filesystem::path gt_file_t = IOUtil::findLabelFile(gt_directory, 
+                        stem + "-" + std::to_string(t));
+                
+                if (boost::filesystem::is_regular_file(gt_file_t)) {
+                    cv::Mat gt;
+                    IOUtil::readLabels(gt_file_t, gt);
+                    
+                    gts_n.push_back(gt);
+                    gt_indices_n.push_back(t);
+                }
+            }
+        }
+        
+        for (unsigned int t = 0; t < gts_n.size(); ++t) {
+            LOG_IF(FATAL, gts_n[t].rows != image.rows || gts_n[t].cols != image.cols) 
+                    << "Ground truth does not match image size: " << it->string() << ".";
+        }
+        
+        images.push_back(image);
+        gts.push_back(gts_n);
+        gt_indices.push_back(gt_indices_n);
+    }
+    
+    LOG_IF(FATAL, images.empty()) << "No images found in " << img_directory.string() << ".";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// listImages
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::listImages() {
+    
+    std::multimap<std::string, boost::filesystem::path> files;
+    std::vector<std::string> extensions;
+    IOUtil::getImageExtensions(extensions);
+    IOUtil::readDirectory(img_directory, extensions, files);
+    
+    image_files.clear();
+    for (std::multimap<std::string, boost::filesystem::path>::iterator it = files.begin(); 
+            it != files.end(); ++it) {
+        image_files.push_back(it->second);
+    }
+    
+    LOG_IF(FATAL, image_files.empty()) << "No images found in " << img_directory.string() << ".";
+    
+    // Subsets are prefixes of this order; a fixed seed keeps them identical
+    // across runs (and thereby the journals valid).
+    std::mt19937 generator(0);
+    std::shuffle(image_files.begin(), image_files.end(), generator);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getImageSubset
+////////////////////////////////////////////////////////////////////////////////
+
+boost::filesystem::path ParameterOptimizationTool::getImageSubset(int num_images) {
+    
+    boost::filesystem::path subset_directory = base_directory 
+            / boost::filesystem::path("images_" + std::to_string(num_images));
+    
+    if (boost::filesystem::exists(subset_directory)) {
+        boost::filesystem::remove_all(subset_directory);
+    }
+    
+    boost::filesystem::create_directories(subset_directory);
+    
+    int N = std::min(num_images, (int) image_files.size());
+    for (int n = 0; n < N; ++n) {
+        boost::filesystem::create_symlink(boost::filesystem::absolute(image_files[n]), 
+                subset_directory / image_files[n].filename());
+    }
+    
+    return subset_directory;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getParameterValues
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::getParameterValues(const std::vector<int> &indices, 
+        std::map<std::string, float> &values) {
+    
+    values.clear();
+    for (unsigned p = 0; p < parameters.size(); ++p) {
+        values[TUPLE(parameters[p], 0)] = getParameterValue(p, indices[p]);
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -607,10 +1291,14 @@ void ParameterOptimizationTool::optimize(float weight, float weight_ue, float we
 void ParameterOptimizationTool::cleanUp(const boost::filesystem::path &sp_directory) {
     if (boost::filesystem::exists(sp_directory)) {
         
+        std::vector<std::string> extensions;
+        IOUtil::getLabelExtensions(extensions);
+        
         boost::filesystem::directory_iterator end_it;
         for (boost::filesystem::directory_iterator i(sp_directory); i != end_it; ++i) {
                     
-            if (i->path().extension().string() == ".csv") {
+            if (std::find(extensions.begin(), extensions.end(), 
+                    i->path().extension().string()) != extensions.end()) {
                 if (i->path().stem().string() != "results" && i->path().stem().string() != "results.csv"
                         && i->path().stem().string() != "summary" && i->path().stem().string() != "summary.csv"
                         && i->path().stem().string() != "correlation" && i->path().stem().string() != "correlation.csv"
@@ -32,10 +32,31 @@
 #ifndef PARAMETER_OPTIMIZATION_TOOL_H
 #define	PARAMETER_OPTIMIZATION_TOOL_H
 
+#include <map>
 #include <tuple>
+#include <functional>
 #include "evaluation_summary.h"
 
-/** \brief Tool to guide parameter optimization using grid search.
+/** \brief Tool to guide parameter optimization using grid search or one of
+ * the adaptive search strategies (see setStrategy).
+ * 
+ * Per default, each parameter combination is evaluated by running the given
+ * command line tool and evaluating the written superpixel labels using
+ * EvaluationSummary. Alternatively, a registered algorithm can be run in-process
+ * (see registerAlgorithm and useAlgorithm): the images and ground truths are
+ * then loaded once and the labels are evaluated in memory without writing them.
+ * 
+ * Combinations are evaluated by a pool of threads (see setThreads), each 
+ * command line run writing to its own directory in the base directory. 
+ * Finished combinations are appended to a journal in the base directory such
+ * that an interrupted optimization resumes where it stopped.
+ * 
+ * Instead of grid search, successive halving evaluates all combinations on a 
+ * small subset of the images and promotes only the best combinations to larger 
+ * subsets; coordinate descent optimizes one parameter at a time and random 
+ * search evaluates a random subset of the combinations. Both successive halving
+ * and coordinate descent can be limited by a budget of combinations.
+ * 
  * \author David Stutz
  */
 class ParameterOptimizationTool {
@@ -46,6 +67,46 @@ public:
     /** \brief Constant to indicate an integer parameter. */
     static const int INTEGER_PARAMETER = 2;
     
+    /** \brief Constant to indicate exhaustive grid search. */
+    static const int GRID_SEARCH = 0;
+    /** \brief Constant to indicate successive halving on growing image subsets. */
+    static const int SUCCESSIVE_HALVING = 1;
+    /** \brief Constant to indicate coordinate descent. */
+    static const int COORDINATE_DESCENT = 2;
+    /** \brief Constant to indicate random search. */
+    static const int RANDOM_SEARCH = 3;
+    
+    /** \brief Algorithm used for in-process optimization; computes the labels 
+     * for the given image and parameter values (indexed by parameter name).
+     */
+    typedef std::function<void(const cv::Mat &image, 
+            const std::map<std::string, float> &parameters, cv::Mat &labels)> Algorithm;
+    
+    /** \brief Register an algorithm for in-process optimization; as combinations
+     * are evaluated in parallel, the algorithm needs to be thread-safe.
+     * \param[in] name name of the algorithm
+     * \param[in] algorithm callback computing the superpixels
+     */
+    static void registerAlgorithm(std::string name, Algorithm algorithm);
+    
+    /** \brief Results of evaluating a single parameter combination. */
+    struct Result {
+        /** \brief Average Boundary Recall. */
+        float rec_average;
+        /** \brief Average Undersegmentation Error. */
+        float ue_np_average;
+        /** \brief Average Compactness. */
+        float co_average;
+        /** \brief Average number of superpixels. */
+        float sp_average;
+    };
+    
+    /** \brief Check whether an algorithm is registered for in-process optimization.
+     * \param[in] name name of the algorithm
+     * \return whether the algorithm is registered
+     */
+    static bool isAlgorithmRegistered(std::string name);
+    
     /** \brief Constructor.
      * 
      * The command line tool to use has to provide several options, including -i to
@@ -101,6 +162,35 @@ public:
      */
     void useIntrinsics(boost::filesystem::path intrinsics_directory);
     
+    /** \brief Run the given registered algorithm in-process instead of the
+     * command line; the parameters are passed by name.
+     * \param[in] name name of the registered algorithm
+     */
+    void useAlgorithm(std::string name);
+    
+    /** \brief Set the number of combinations evaluated in parallel.
+     * \param[in] threads number of threads, 0 to use all available cores
+     */
+    void setThreads(int threads);
+    
+    /** \brief Get the number of combinations evaluated in parallel.
+     * \return number of threads
+     */
+    int getThreads();
+    
+    /** \brief Set the search strategy.
+     * \param[in] strategy GRID_SEARCH, SUCCESSIVE_HALVING, COORDINATE_DESCENT or RANDOM_SEARCH
+     * \param[in] budget maximum number of combinations to evaluate, 0 for no limit (required for RANDOM_SEARCH);
+     * for SUCCESSIVE_HALVING, evaluations are summed over all rounds
+     */
+    void setStrategy(int strategy, int budget = 0);
+    
+    /** \brief Configure successive halving.
+     * \param[in] halving_rate factor by which the combinations are reduced and the images increased in each round
+     * \param[in] halving_images number of images to start with
+     */
+    void setSuccessiveHalving(int halving_rate, int halving_images);
+    
     /** \brief Set parameter optimization verbose. Per default output is written to
      * std::cout.
      * \param[in] stream stream to output to
@@ -126,6 +216,168 @@ protected:
      */
     void cleanUp(const boost::filesystem::path &sp_directory);
     
+    /** \brief Successive halving, see setSuccessiveHalving.
+     * \param[in] weight weight between boundary recall and undersegmentation error
+     * \param[out] combinations indices of the combinations evaluated on all images
+     * \param[out] results results for each combination
+     */
+    void searchSuccessiveHalving(float weight, std::vector<int> &combinations, 
+            std::vector<Result> &results);
+    
+    /** \brief Count the evaluations of successive halving over all rounds.
+     * \param[in] count number of combinations in the first round
+     * \return number of evaluated combinations summed over all rounds
+     */
+    int countHalvingEvaluations(int count);
+    
+    /** \brief Coordinate descent starting from the middle value of each parameter;
+     * sweeps over the parameters until no parameter changes or the budget is used up.
+     * \param[in] weight weight between boundary recall and undersegmentation error
+     * \param[out] combinations indices of the evaluated combinations
+     * \param[out] results results for each combination
+     */
+    void searchCoordinateDescent(float weight, std::vector<int> &combinations, 
+            std::vector<Result> &results);
+    
+    /** \brief Sample combinations uniformly at random (with a fixed seed).
+     * \param[in] count number of combinations, 0 for all combinations
+     * \param[out] combinations sorted indices of the sampled combinations
+     */
+    void sampleCombinations(int count, std::vector<int> &combinations);
+    
+    /** \brief Compute the score used for selecting the best combination.
+     * \param[in] result evaluation results
+     * \param[in] weight weight between boundary recall and undersegmentation error
+     * \return score, zero if the superpixel tolerance is not met
+     */
+    float computeScore(const Result &result, float weight);
+    
+    /** \brief Evaluate the given combinations, skipping those already in the
+     * journal, and append the new results to the journal.
+     * \param[in] combinations indices of the combinations to evaluate
+     * \param[in] num_images number of images to evaluate on, 0 for all images
+     * \param[out] results results for each combination
+     */
+    void evaluateCombinations(const std::vector<int> &combinations, 
+            int num_images, std::vector<Result> &results);
+    
+    /** \brief Write the results and the best parameters to 
+     * parameter_optimization.csv in the base directory.
+     * \param[in] combinations indices of the evaluated combinations
+     * \param[in] results results for each combination
+     * \param[in] weight weight between boundary recall and undersegmentation error
+     * \param[in] weight_ue alternative (secondary) optimization weight for undersegmentation error
+     * \param[in] weight_co alternative (secondary) optimization weight for compactness
+     */
+    void writeResults(const std::vector<int> &combinations, 
+            const std::vector<Result> &results, float weight, float weight_ue, 
+            float weight_co);
+    
+    /** \brief Evaluate a parameter combination by running the command
+     * line and EvaluationSummary on the written labels.
+     * \param[in] indices value index of each parameter
+     * \param[in] img_directory_n directory containing the images to run on
+     * \param[in] sp_directory directory to write the superpixel labels to
+     * \param[out] result evaluation results
+     */
+    void evaluateCommandLine(const std::vector<int> &indices, 
+            const boost::filesystem::path &img_directory_n,
+            const boost::filesystem::path &sp_directory, Result &result);
+    
+    /** \brief Evaluate a parameter combination by running the 
+     * registered algorithm on the images held in memory.
+     * \param[in] indices value index of each parameter
+     * \param[in] num_images number of images to evaluate on, 0 for all images
+     * \param[out] result evaluation results
+     */
+    void evaluateInProcess(const std::vector<int> &indices, int num_images, 
+            Result &result);
+    
+    /** \brief Load all images and the corresponding ground truths into memory,
+     * in the order of listImages. */
+    void loadImages();
+    
+    /** \brief List the images in a fixed, shuffled order; image subsets are
+     * prefixes of this order. */
+    void listImages();
+    
+    /** \brief Create a directory in the base directory linking the given number
+     * of images.
+     * \param[in] num_images number of images
+     * \return directory
+     */
+    boost::filesystem::path getImageSubset(int num_images);
+    
+    /** \brief Get the value index of each parameter for the given combination;
+     * the last parameter varies fastest.
+     * \param[in] k index of the combination
+     * \param[out] indices value index of each parameter
+     */
+    void getCombination(int k, std::vector<int> &indices);
+    
+    /** \brief Get the index of the combination given the value index of each parameter.
+     * \param[in] indices value index of each parameter
+     * \return index of the combination
+     */
+    int getCombinationIndex(const std::vector<int> &indices);
+    
+    /** \brief Count the values of a parameter.
+     * \param[in] p index of the parameter
+     * \return number of values
+     */
+    int countValues(int p);
+    
+    /** \brief Get a value of a parameter.
+     * \param[in] p index of the parameter
+     * \param[in] index index of the value
+     * \return value
+     */
+    float getParameterValue(int p, int index);
+    
+    /** \brief Format a value of a parameter as used on the command line.
+     * \param[in] p index of the parameter
+     * \param[in] index index of the value
+     * \return formatted value
+     */
+    std::string formatParameterValue(int p, int index);
+    
+    /** \brief Get the values of a parameter combination by name.
+     * \param[in] indices value index of each parameter
+     * \param[out] values parameter values
+     */
+    void getParameterValues(const std::vector<int> &indices, 
+            std::map<std::string, float> &values);
+    
+    /** \brief Get the directory a combination writes its labels to.
+     * \param[in] k index of the combination
+     * \return directory
+     */
+    boost::filesystem::path getCombinationDirectory(int k);
+    
+    /** \brief Get the journal file in the base directory.
+     * \param[in] num_images number of images evaluated on, 0 for all images
+     * \return journal file
+     */
+    boost::filesystem::path getJournalFile(int num_images);
+    
+    /** \brief Get the signature identifying the command line, parameter
+     * values, directories and images the journal was written for.
+     * \return signature
+     */
+    std::string getJournalSignature();
+    
+    /** \brief Read the results from the journal; if the journal does not exist 
+     * or was written for other parameters, a new journal is started.
+     * \param[in] num_images number of images evaluated on, 0 for all images
+     * \param[out] journal results by combination index
+     */
+    void readJournal(int num_images, std::map<int, Result> &journal);
+    
+    /** \brief Get the registered algorithms.
+     * \return algorithms by name
+     */
+    static std::map<std::string, Algorithm>& getAlgorithms();
+    
     /** \brief The command used to runt he algorithm. */
     std::string command_line;
     /** \brief Command line parameters always to append. */
@@ -156,6 +408,28 @@ protected:
     /** \brief Vector containing all float parameters. */
     std::vector< std::tuple<std::vector<float>, int, float, float> > float_parameters;
     
+    /** \brief Algorithm to run in-process, empty to use the command line. */
+    Algorithm algorithm;
+    /** \brief Images in the order used for subsets. */
+    std::vector<boost::filesystem::path> image_files;
+    /** \brief Images for in-process optimization. */
+    std::vector<cv::Mat> images;
+    /** \brief Ground truths of each image for in-process optimization. */
+    std::vector< std::vector<cv::Mat> > gts;
+    /** \brief Ground truth indices of each image, as used by EvaluationSummary. */
+    std::vector< std::vector<int> > gt_indices;
+    
+    /** \brief Number of combinations evaluated in parallel. */
+    int threads;
+    /** \brief Search strategy. */
+    int strategy;
+    /** \brief Maximum number of combinations to evaluate, 0 for no limit. */
+    int budget;
+    /** \brief Reduction factor for successive halving. */
+    int halving_rate;
+    /** \brief Number of images for the first round of successive halving. */
+    int halving_images;
+    
     /** \brief Minimum number of superpixels. */
     int superpixels_min;
     /** brief Maximum number of superpixels. */
@@ -0,0 +1,333 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <glog/logging.h>
+#include "run_length_labels.h"
+
+/** \brief Magic bytes of run-length label files. */
+static const char RUN_LENGTH_MAGIC[4] = {'S', 'P', 'L', 'R'};
+/** \brief Current version of run-length label files. */
+static const int RUN_LENGTH_VERSION = 1;
+
+/** \brief Append an unsigned variable length integer, 7 bits per byte.
+ * \param[in] value value to append
+ * \param[out] buffer buffer to append to
+ */
+static void writeVarint(unsigned int value, std::vector<unsigned char> &buffer) {
+    while (value >= 0x80) {
+        buffer.push_back((unsigned char) (value | 0x80));
+        value >>= 7;
+    }
+    
+    buffer.push_back((unsigned char) value);
+}
+
+/** \brief Read an unsigned variable length integer.
+ * \param[in,out] position current position, advanced behind the integer
+ * \param[in] end end of the buffer
+ * \return value read
+ */
+static unsigned int readVarint(const unsigned char* &position, const unsigned char* end) {
+    unsigned int value = 0;
+    int shift = 0;
+    
+    while (position < end) {
+        unsigned char byte = *position++;
+        value |= ((unsigned int) (byte & 0x7F)) << shift;
+        
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+        
+        shift += 7;
+        LOG_IF(FATAL, shift >= 32) << "Invalid variable length integer in run-length label file.";
+    }
+    
+    LOG(FATAL) << "Truncated run-length label file.";
+    return value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+////////////////////////////////////////////////////////////////////////////////
+
+RunLengthLabels::RunLengthLabels() : rows(0), cols(0), label_count(0) {
+    row_offsets.push_back(0);
+}
+
+RunLengthLabels::RunLengthLabels(const cv::Mat &labels) {
+    encode(labels);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// encode
+////////////////////////////////////////////////////////////////////////////////
+
+void RunLengthLabels::encode(const cv::Mat &labels) {
+    LOG_IF(FATAL, labels.type() != CV_32SC1) << "Only int labels can be run-length encoded.";
+    
+    rows = labels.rows;
+    cols = labels.cols;
+    label_count = 0;
+    
+    runs.clear();
+    row_offsets.resize(rows + 1);
+    row_offsets[0] = 0;
+    
+    for (int i = 0; i < rows; ++i) {
+        const int* row = labels.ptr<int>(i);
+        
+        int j = 0;
+        while (j < cols) {
+            Run run;
+            run.label = row[j];
+            run.length = 1;
+            
+            while (j + run.length < cols && row[j + run.length] == run.label) {
+                ++run.length;
+            }
+            
+            label_count = std::max(label_count, run.label + 1);
+            runs.push_back(run);
+            j += run.length;
+        }
+        
+        row_offsets[i + 1] = runs.size();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// decode
+////////////////////////////////////////////////////////////////////////////////
+
+void RunLengthLabels::decode(cv::Mat &labels) const {
+    labels.create(rows, cols, CV_32SC1);
+    
+    for (int i = 0; i < rows; ++i) {
+        int* row = labels.ptr<int>(i);
+        
+        for (const Run* run = getRowBegin(i); run != getRowEnd(i); ++run) {
+            std::fill(row, row + run->length, run->label);
+            row += run->length;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// write
+////////////////////////////////////////////////////////////////////////////////
+
+int RunLengthLabels::write(boost::filesystem::path file) const {
+    RunLengthHeader header;
+    std::memcpy(header.magic, RUN_LENGTH_MAGIC, 4);
+    header.version = RUN_LENGTH_VERSION;
+    header.rows = rows;
+    header.cols = cols;
+    header.labels = label_count;
+    header.runs = runs.size();
+    
+    // Neighboring runs mostly belong to the same or neighboring superpixels,
+    // so storing label differences keeps most varints at a single byte.
+    std::vector<unsigned char> buffer;
+    buffer.reserve(rows + 3*runs.size());
+    
+    int previous = 0;
+    for (int i = 0; i < rows; ++i) {
+        writeVarint(row_offsets[i + 1] - row_offsets[i], buffer);
+        
+        for (const Run* run = getRowBegin(i); run != getRowEnd(i); ++run) {
+            int delta = run->label - previous;
+            writeVarint((((unsigned int) delta) << 1) ^ ((unsigned int) (delta >> 31)), buffer);
+            writeVarint(run->length, buffer);
+            previous = run->label;
+        }
+    }
+    
+    std::ofstream file_stream(file.c_str(), std::ofstream::binary);
+    file_stream.write((const char*) &header, sizeof(RunLengthHeader));
+    file_stream.write((const char*) buffer.data(), buffer.size());
+    file_stream.close();
+    
+    return rows;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// read
+////////////////////////////////////////////////////////////////////////////////
+
+int RunLengthLabels::read(boost::filesystem::path file) {
+    LOG_IF(FATAL, !boost::filesystem::is_regular_file(file)) 
+            << "File does not exist: " << file.string() << ".";
+    
+    std::ifstream file_stream(file.c_str(), std::ifstream::binary);
+    
+    RunLengthHeader header;
+    file_stream.read((char*) &header, sizeof(RunLengthHeader));
+    
+    LOG_IF(FATAL, file_stream.gcount() != sizeof(RunLengthHeader) 
+            || std::memcmp(header.magic, RUN_LENGTH_MAGIC, 4) != 0)
+            << "Not a run-length label file: " << file.string() << ".";
+    LOG_IF(FATAL, header.version != RUN_LENGTH_VERSION) 
+            << "Unsupported run-length label file version: " << header.version << ".";
+    
+    std::vector<unsigned char> buffer((std::istreambuf_iterator<char>(file_stream)),
+            std::istreambuf_iterator<char>());
+    file_stream.close();
+    
+    LOG_IF(FATAL, header.rows < 0 || header.cols < 0 || header.labels < 0 || header.runs < 0) 
+            << "Invalid run-length label file: " << file.string() << ".";
+    
+    // Check the sizes against the payload before allocating: each row takes
+    // at least one byte (its number of runs) and each run at least two.
+    LOG_IF(FATAL, (size_t) header.rows + 2*(size_t) header.runs > buffer.size()
+            || (long long) header.runs > (long long) header.rows*header.cols) 
+            << "Invalid run-length label file: " << file.string() << ".";
+    
+    rows = header.rows;
+    cols = header.cols;
+    label_count = header.labels;
+    
+    runs.resize(header.runs);
+    row_offsets.resize(rows + 1);
+    row_offsets[0] = 0;
+    
+    const unsigned char* position = buffer.data();
+    const unsigned char* end = buffer.data() + buffer.size();
+    
+    int k = 0;
+    int previous = 0;
+    for (int i = 0; i < rows; ++i) {
+        int row_runs = readVarint(position, end);
+        LOG_IF(FATAL, row_runs < 0 || k + row_runs > header.runs) 
+                << "Invalid run-length label file: " << file.string() << ".";
+        
+        int length = 0;
+        for (int r = 0; r < row_runs; ++r, ++k) {
+            unsigned int zigzag = readVarint(position, end);
+            previous += (int) ((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+            
+            LOG_IF(FATAL, previous < 0 || previous >= header.labels) 
+                    << "Invalid run-length label file: " << file.string() << ".";
+            
+            runs[k].label = previous;
+            runs[k].length = readVarint(position, end);
+            LOG_IF(FATAL, runs[k].length <= 0 || runs[k].length > cols - length) 
+                    << "Invalid run-length label file: " << file.string() << ".";
+            
+            length += runs[k].length;
+        }
+        
+        LOG_IF(FATAL, length != cols) 
+                << "Invalid run-length label file: " << file.string() << ".";
+        row_offsets[i + 1] = k;
+    }
+    
+    LOG_IF(FATAL, k != header.runs) 
+            << "Invalid run-length label file: " << file.string() << ".";
+    
+    return rows;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// isRunLengthFile
+////////////////////////////////////////////////////////////////////////////////
+
+bool RunLengthLabels::isRunLengthFile(boost::filesystem::path file) {
+    std::ifstream file_stream(file.c_str(), std::ifstream::binary);
+    
+    char magic[4];
+    file_stream.read(magic, 4);
+    
+    return file_stream.gcount() == 4 && std::memcmp(magic, RUN_LENGTH_MAGIC, 4) == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeSuperpixelSizes
+////////////////////////////////////////////////////////////////////////////////
+
+void RunLengthLabels::computeSuperpixelSizes(std::vector<int> &sizes) const {
+    sizes.assign(label_count, 0);
+    
+    for (unsigned int k = 0; k < runs.size(); ++k) {
+        sizes[runs[k].label] += runs[k].length;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getRows
+////////////////////////////////////////////////////////////////////////////////
+
+int RunLengthLabels::getRows() const {
+    return rows;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getCols
+////////////////////////////////////////////////////////////////////////////////
+
+int RunLengthLabels::getCols() const {
+    return cols;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getLabelCount
+////////////////////////////////////////////////////////////////////////////////
+
+int RunLengthLabels::getLabelCount() const {
+    return label_count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getRunCount
+////////////////////////////////////////////////////////////////////////////////
+
+int RunLengthLabels::getRunCount() const {
+    return runs.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getRowBegin
+////////////////////////////////////////////////////////////////////////////////
+
+const RunLengthLabels::Run* RunLengthLabels::getRowBegin(int i) const {
+    return runs.data() + row_offsets[i];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getRowEnd
+////////////////////////////////////////////////////////////////////////////////
+
+const RunLengthLabels::Run* RunLengthLabels::getRowEnd(int i) const {
+    return runs.data() + row_offsets[i + 1];
+}
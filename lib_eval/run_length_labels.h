@@ -0,0 +1,169 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUN_LENGTH_LABELS_H
+#define	RUN_LENGTH_LABELS_H
+
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <opencv2/opencv.hpp>
+
+/** \brief Run-length encoded superpixel segmentation.
+ * 
+ * Labels are piecewise constant along rows, so each row is stored as a 
+ * sequence of (label, length) runs. Superpixel sizes and intersections with a 
+ * ground truth segmentation (see IntersectionStatistics, used by 
+ * EvaluationSummary for run-length label files) can be computed directly on 
+ * the runs without expanding the labels to a cv::Mat.
+ * 
+ * On disk, a run-length label file starts with a RunLengthHeader, followed by 
+ * the number of runs of each row and the runs themselves. All numbers are 
+ * stored as variable length integers (7 bits per byte); labels are stored as 
+ * the zig-zag encoded difference to the previous label. Use IOUtil::writeLabels 
+ * with a .rle file or IOUtil::readLabels to read and write them.
+ * 
+ * \author David Stutz
+ */
+class RunLengthLabels {
+public:
+    
+    /** \brief A run of constant label within a row. */
+    struct Run {
+        /** \brief Label of the run. */
+        int label;
+        /** \brief Number of pixels in the run. */
+        int length;
+    };
+    
+    /** \brief Header of run-length label files. */
+    struct RunLengthHeader {
+        /** \brief Magic bytes, "SPLR". */
+        char magic[4];
+        /** \brief Format version. */
+        int version;
+        /** \brief Number of rows. */
+        int rows;
+        /** \brief Number of columns. */
+        int cols;
+        /** \brief Number of labels, i.e. maximum label plus one. */
+        int labels;
+        /** \brief Total number of runs. */
+        int runs;
+    };
+    
+    /** \brief Constructor, creates empty labels. */
+    RunLengthLabels();
+    
+    /** \brief Constructor, encodes the given labels.
+     * \param[in] labels labels as int image
+     */
+    RunLengthLabels(const cv::Mat &labels);
+    
+    /** \brief Encode the given labels.
+     * \param[in] labels labels as int image
+     */
+    void encode(const cv::Mat &labels);
+    
+    /** \brief Decode into a full label image.
+     * \param[out] labels labels as int image
+     */
+    void decode(cv::Mat &labels) const;
+    
+    /** \brief Write the runs to the given file.
+     * \param[in] file path to file to write
+     * \return number of rows written
+     */
+    int write(boost::filesystem::path file) const;
+    
+    /** \brief Read runs from the given file.
+     * \param[in] file path to file to read
+     * \return number of rows read
+     */
+    int read(boost::filesystem::path file);
+    
+    /** \brief Check whether the given file is a run-length label file by its header.
+     * \param[in] file path to file
+     * \return whether the file is a run-length label file
+     */
+    static bool isRunLengthFile(boost::filesystem::path file);
+    
+    /** \brief Compute the size of each superpixel from the runs.
+     * \param[out] sizes superpixel sizes indexed by label
+     */
+    void computeSuperpixelSizes(std::vector<int> &sizes) const;
+    
+    /** \brief Get the number of rows.
+     * \return rows
+     */
+    int getRows() const;
+    
+    /** \brief Get the number of columns.
+     * \return columns
+     */
+    int getCols() const;
+    
+    /** \brief Get the number of labels, i.e. maximum label plus one.
+     * \return number of labels
+     */
+    int getLabelCount() const;
+    
+    /** \brief Get the total number of runs.
+     * \return number of runs
+     */
+    int getRunCount() const;
+    
+    /** \brief Get the first run of the given row.
+     * \param[in] i row
+     * \return pointer to the first run
+     */
+    const Run* getRowBegin(int i) const;
+    
+    /** \brief Get the end of the runs of the given row.
+     * \param[in] i row
+     * \return pointer behind the last run
+     */
+    const Run* getRowEnd(int i) const;
+    
+protected:
+    
+    /** \brief Number of rows. */
+    int rows;
+    /** \brief Number of columns. */
+    int cols;
+    /** \brief Number of labels. */
+    int label_count;
+    /** \brief Runs of all rows. */
+    std::vector<Run> runs;
+    /** \brief Offset of the first run of each row into runs, rows + 1 entries. */
+    std::vector<int> row_offsets;
+};
+
+#endif	/* RUN_LENGTH_LABELS_H */
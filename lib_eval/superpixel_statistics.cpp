@@ -0,0 +1,301 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cmath>
+#include <glog/logging.h>
+#include "superpixel_statistics.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+////////////////////////////////////////////////////////////////////////////////
+
+SuperpixelStatistics::SuperpixelStatistics(const cv::Mat &labels) 
+        : has_color(false) {
+    accumulate(labels, cv::Mat());
+}
+
+SuperpixelStatistics::SuperpixelStatistics(const cv::Mat &labels, 
+        const cv::Mat &image) : has_color(true) {
+    
+    LOG_IF(FATAL, image.channels() != 3) << "Currently only 3-channel images are supported.";
+    LOG_IF(FATAL, labels.rows != image.rows || labels.cols != image.cols) 
+            << "Superpixel segmentation does not match image size.";
+    
+    accumulate(labels, image);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// accumulate
+////////////////////////////////////////////////////////////////////////////////
+
+void SuperpixelStatistics::accumulate(const cv::Mat &labels, const cv::Mat &image) {
+    
+    int H = labels.rows;
+    int W = labels.cols;
+    N = H*W;
+    
+    moments.clear();
+    for (int i = 0; i < H; ++i) {
+        const int* row = labels.ptr<int>(i);
+        const int* row_above = (i > 0) ? labels.ptr<int>(i - 1) : 0;
+        const int* row_below = (i < H - 1) ? labels.ptr<int>(i + 1) : 0;
+        const cv::Vec3b* image_row = has_color ? image.ptr<cv::Vec3b>(i) : 0;
+        
+        for (int j = 0; j < W; ++j) {
+            int label = row[j];
+            
+            LOG_IF(FATAL, label < 0) << "Negative labels are not supported.";
+            if (label >= (int) moments.size()) {
+                moments.resize(label + 1);
+            }
+            
+            Moments &moment = moments[label];
+            
+            // Pixel edges to the image border count towards the perimeter.
+            int perimeter = 0;
+            perimeter += (row_above == 0 || row_above[j] != label) ? 1 : 0;
+            perimeter += (row_below == 0 || row_below[j] != label) ? 1 : 0;
+            perimeter += (j == 0 || row[j - 1] != label) ? 1 : 0;
+            perimeter += (j == W - 1 || row[j + 1] != label) ? 1 : 0;
+            
+            moment.count++;
+            moment.perimeter += perimeter;
+            
+            moment.min_i = std::min(moment.min_i, i);
+            moment.max_i = std::max(moment.max_i, i);
+            moment.min_j = std::min(moment.min_j, j);
+            moment.max_j = std::max(moment.max_j, j);
+            
+            moment.xy_sum[0] += i;
+            moment.xy_sum[1] += j;
+            moment.xy_squared_sum[0] += i*i;
+            moment.xy_squared_sum[1] += j*j;
+            
+            if (has_color) {
+                for (int c = 0; c < 3; ++c) {
+                    moment.color_sum[c] += image_row[j][c];
+                    moment.color_squared_sum[c] += image_row[j][c]*image_row[j][c];
+                }
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeSumOfSquaredErrorRGB
+////////////////////////////////////////////////////////////////////////////////
+
+float SuperpixelStatistics::computeSumOfSquaredErrorRGB() const {
+    
+    LOG_IF(FATAL, !has_color) << "Color moments have not been computed.";
+    
+    // sum_x (x - mean)^2 = sum_x x^2 - (sum_x x)^2/n for each superpixel.
+    double squared_sum = 0;
+    for (unsigned int k = 0; k < moments.size(); ++k) {
+        if (moments[k].count > 0) {
+            for (int c = 0; c < 3; ++c) {
+                squared_sum += moments[k].color_squared_sum[c] 
+                        - moments[k].color_sum[c]*moments[k].color_sum[c]/moments[k].count;
+            }
+        }
+    }
+    
+    return squared_sum/N;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeSumOfSquaredErrorXY
+////////////////////////////////////////////////////////////////////////////////
+
+float SuperpixelStatistics::computeSumOfSquaredErrorXY() const {
+    
+    double squared_sum = 0;
+    for (unsigned int k = 0; k < moments.size(); ++k) {
+        if (moments[k].count > 0) {
+            for (int c = 0; c < 2; ++c) {
+                squared_sum += moments[k].xy_squared_sum[c] 
+                        - moments[k].xy_sum[c]*moments[k].xy_sum[c]/moments[k].count;
+            }
+        }
+    }
+    
+    return squared_sum/N;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeExplainedVariation
+////////////////////////////////////////////////////////////////////////////////
+
+float SuperpixelStatistics::computeExplainedVariation() const {
+    
+    LOG_IF(FATAL, !has_color) << "Color moments have not been computed.";
+    
+    double overall_sum[3] = {0, 0, 0};
+    double overall_squared_sum[3] = {0, 0, 0};
+    for (unsigned int k = 0; k < moments.size(); ++k) {
+        for (int c = 0; c < 3; ++c) {
+            overall_sum[c] += moments[k].color_sum[c];
+            overall_squared_sum[c] += moments[k].color_squared_sum[c];
+        }
+    }
+    
+    double sum_top = 0;
+    double sum_bottom = 0;
+    for (int c = 0; c < 3; ++c) {
+        double overall_mean = overall_sum[c]/N;
+        
+        for (unsigned int k = 0; k < moments.size(); ++k) {
+            if (moments[k].count > 0) {
+                double mean = moments[k].color_sum[c]/moments[k].count;
+                sum_top += moments[k].count*(mean - overall_mean)*(mean - overall_mean);
+            }
+        }
+        
+        sum_bottom += overall_squared_sum[c] - N*overall_mean*overall_mean;
+    }
+    
+    return sum_top/sum_bottom;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeIntraClusterVariation
+////////////////////////////////////////////////////////////////////////////////
+
+float SuperpixelStatistics::computeIntraClusterVariation() const {
+    
+    LOG_IF(FATAL, !has_color) << "Color moments have not been computed.";
+    
+    double sum = 0;
+    for (unsigned int k = 0; k < moments.size(); ++k) {
+        if (moments[k].count > 0) {
+            double variance = 0;
+            for (int c = 0; c < 3; ++c) {
+                variance += moments[k].color_squared_sum[c] 
+                        - moments[k].color_sum[c]*moments[k].color_sum[c]/moments[k].count;
+            }
+            
+            // Guard against small negative values due to cancellation.
+            sum += std::sqrt(std::max(0.0, variance/moments[k].count));
+        }
+    }
+    
+    if (moments.size() > 0) {
+        return sum/moments.size();
+    }
+    
+    return sum;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeCompactness
+////////////////////////////////////////////////////////////////////////////////
+
+float SuperpixelStatistics::computeCompactness() const {
+    
+    float compactness = 0;
+    for (unsigned int k = 0; k < moments.size(); ++k) {
+        if (moments[k].perimeter > 0) {
+            float area = moments[k].count;
+            float perimeter = moments[k].perimeter;
+            compactness += area * (4*M_PI*area)/(perimeter*perimeter);
+        }
+    }
+    
+    compactness /= N;
+    LOG_IF (ERROR, compactness > 1.0f) 
+            << "Invalid compactness: " << compactness;
+    
+    return compactness;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeSuperpixelSizes
+////////////////////////////////////////////////////////////////////////////////
+
+void SuperpixelStatistics::computeSuperpixelSizes(float &average_size, int &min_size, 
+        int &max_size, float &size_variation) const {
+    
+    unsigned long long int sum = 0;
+    unsigned long long int squared_sum = 0;
+    int superpixels = 0;
+    
+    min_size = std::numeric_limits<int>::max();
+    max_size = 0;
+    
+    for (unsigned int k = 0; k < moments.size(); ++k) {
+        unsigned long long int count = moments[k].count;
+        
+        if (count > 0) {
+            superpixels++;
+            
+            sum += count;
+            squared_sum += count*count;
+            
+            min_size = std::min(min_size, (int) count);
+            max_size = std::max(max_size, (int) count);
+        }
+    }
+    
+    if (superpixels > 0) {
+        average_size = (double) sum / superpixels;
+        
+        float variance = (double) squared_sum / superpixels - (double) sum / superpixels * (double) sum / superpixels;
+        LOG_IF(ERROR, variance < 0) << "Invalid variance: " << variance <<  " " << squared_sum << " " << sum << " " << superpixels;
+        size_variation = std::sqrt(variance);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeBoundingBoxes
+////////////////////////////////////////////////////////////////////////////////
+
+void SuperpixelStatistics::computeBoundingBoxes(std::vector<cv::Rect> &rectangles) const {
+    
+    rectangles.resize(moments.size());
+    for (unsigned int k = 0; k < moments.size(); ++k) {
+        if (moments[k].count > 0) {
+            rectangles[k] = cv::Rect(moments[k].min_j, moments[k].min_i, 
+                    moments[k].max_j - moments[k].min_j + 1, 
+                    moments[k].max_i - moments[k].min_i + 1);
+        }
+        else {
+            rectangles[k] = cv::Rect();
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getMoments
+////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<SuperpixelStatistics::Moments>& SuperpixelStatistics::getMoments() const {
+    return moments;
+}
@@ -0,0 +1,160 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SUPERPIXEL_STATISTICS_H
+#define	SUPERPIXEL_STATISTICS_H
+
+#include <vector>
+#include <limits>
+#include <opencv2/opencv.hpp>
+
+/** \brief Per-superpixel moments (size, color and position sums and squared
+ * sums, bounding box and perimeter) gathered in a single pass over the
+ * superpixel labels and, optionally, the image.
+ * 
+ * The color and position based metrics (SSE_RGB, SSE_XY, EV, ICV), Compactness
+ * and the superpixel size statistics are derived from the moments without
+ * further passes over the image.
+ * 
+ * \author David Stutz
+ */
+class SuperpixelStatistics {
+public:
+    
+    /** \brief Moments of a single superpixel.
+     */
+    struct Moments {
+        Moments() : count(0), perimeter(0), min_i(std::numeric_limits<int>::max()),
+                max_i(-1), min_j(std::numeric_limits<int>::max()), max_j(-1) {
+            for (int c = 0; c < 3; ++c) {
+                color_sum[c] = 0;
+                color_squared_sum[c] = 0;
+            }
+            for (int c = 0; c < 2; ++c) {
+                xy_sum[c] = 0;
+                xy_squared_sum[c] = 0;
+            }
+        };
+        
+        /** \brief Number of pixels. */
+        int count;
+        /** \brief Perimeter, i.e. number of 4-connected pixel edges on the boundary. */
+        int perimeter;
+        /** \brief Minimum row. */
+        int min_i;
+        /** \brief Maximum row. */
+        int max_i;
+        /** \brief Minimum column. */
+        int min_j;
+        /** \brief Maximum column. */
+        int max_j;
+        /** \brief Sum of colors per channel. */
+        double color_sum[3];
+        /** \brief Sum of squared colors per channel. */
+        double color_squared_sum[3];
+        /** \brief Sum of row (0) and column (1) coordinates. */
+        double xy_sum[2];
+        /** \brief Sum of squared row (0) and column (1) coordinates. */
+        double xy_squared_sum[2];
+    };
+    
+    /** \brief Constructor, only gathers size, position, bounding box and perimeter.
+     * \param[in] labels superpixel labels as int image
+     */
+    SuperpixelStatistics(const cv::Mat &labels);
+    
+    /** \brief Constructor, additionally gathers color moments.
+     * \param[in] labels superpixel labels as int image
+     * \param[in] image image corresponding to the superpixel labels
+     */
+    SuperpixelStatistics(const cv::Mat &labels, const cv::Mat &image);
+    
+    /** \brief Compute Sum-of-Squared Error on RGB, see Evaluation::computeSumOfSquaredErrorRGB.
+     * \return sum-of-squared error on RGB
+     */
+    float computeSumOfSquaredErrorRGB() const;
+    
+    /** \brief Compute Sum-of-Squared Error on XY, see Evaluation::computeSumOfSquaredErrorXY.
+     * \return sum-of-squared error on XY
+     */
+    float computeSumOfSquaredErrorXY() const;
+    
+    /** \brief Compute Explained Variation, see Evaluation::computeExplainedVariation.
+     * \return explained variation
+     */
+    float computeExplainedVariation() const;
+    
+    /** \brief Compute Intra-Cluster Variation, see Evaluation::computeIntraClusterVariation.
+     * \return intra-cluster variation
+     */
+    float computeIntraClusterVariation() const;
+    
+    /** \brief Compute Compactness, see Evaluation::computeCompactness.
+     * \return compactness
+     */
+    float computeCompactness() const;
+    
+    /** \brief Compute superpixel size statistics, see Evaluation::computeSuperpixelSizes.
+     * \param[out] average_size average size of superpixels
+     * \param[out] min_size minimum size of superpixels
+     * \param[out] max_size maximum size of superpixels
+     * \param[out] size_variation standard deviation of superpixel sizes
+     */
+    void computeSuperpixelSizes(float &average_size, int &min_size, 
+            int &max_size, float &size_variation) const;
+    
+    /** \brief Compute bounding boxes of all superpixels.
+     * \param[out] rectangles bounding box for each label, empty for unused labels
+     */
+    void computeBoundingBoxes(std::vector<cv::Rect> &rectangles) const;
+    
+    /** \brief Get the moments indexed by label.
+     * \return moments
+     */
+    const std::vector<Moments>& getMoments() const;
+    
+protected:
+    
+    /** \brief Gather all moments in a single pass.
+     * \param[in] labels superpixel labels as int image
+     * \param[in] image image, may be empty
+     */
+    void accumulate(const cv::Mat &labels, const cv::Mat &image);
+    
+    /** \brief Number of pixels. */
+    int N;
+    /** \brief Whether color moments have been gathered. */
+    bool has_color;
+    /** \brief Moments of each label. */
+    std::vector<Moments> moments;
+};
+
+#endif	/* SUPERPIXEL_STATISTICS_H */
@@ -2,23 +2,15 @@
 #define MYRGB2LAB
 
 #include<cmath>
+#include "color_conversion.h"
 
 // Change from RGB colour space to LAB colour space
 
 void RGB2XYZ(unsigned char sR,unsigned char sG,unsigned char sB,double&	X,double& Y,double& Z)
 {
-	double R = sR/255.0;
-	double G = sG/255.0;
-	double B = sB/255.0;
-
-	double r, g, b;
-
-	if(R <= 0.04045)	r = R/12.92;
-	else				r = pow((R+0.055)/1.055,2.4);
-	if(G <= 0.04045)	g = G/12.92;
-	else				g = pow((G+0.055)/1.055,2.4);
-	if(B <= 0.04045)	b = B/12.92;
-	else				b = pow((B+0.055)/1.055,2.4);
+	double r = ColorConversion::linearize(sR);
+	double g = ColorConversion::linearize(sG);
+	double b = ColorConversion::linearize(sB);
 
 	X = r*0.412453 + g*0.357580 + b*0.180423;
 	Y = r*0.212671 + g*0.715160 + b*0.072169;
@@ -42,11 +34,11 @@ void RGB2LAB(const unsigned char& sR, const unsigned char& sG, const unsigned ch
 	double zr = Z/Zr;
 
 	double fx, fy, fz;
-	if(xr > epsilon)	fx = pow(xr, 1.0/3.0);
+	if(xr > epsilon)	fx = ColorConversion::cbrt(xr);
 	else				fx = (kappa*xr + 16.0)/116.0;
-	if(yr > epsilon)	fy = pow(yr, 1.0/3.0);
+	if(yr > epsilon)	fy = ColorConversion::cbrt(yr);
 	else				fy = (kappa*yr + 16.0)/116.0;
-	if(zr > epsilon)	fz = pow(zr, 1.0/3.0);
+	if(zr > epsilon)	fz = ColorConversion::cbrt(zr);
 	else				fz = (kappa*zr + 16.0)/116.0;
 
 	lval = (unsigned char)((116.0*fy-16.0)/100*255+0.5);
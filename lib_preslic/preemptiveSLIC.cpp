@@ -38,7 +38,12 @@
 #include <cmath>
 #include <iostream>
 #include <fstream>
+#include <atomic>
+#include <functional>
+#include <thread>
 #include "preemptiveSLIC.h"
+#include "slic_distance.h"
+#include "color_conversion.h"
 
 
 using namespace std;
@@ -53,6 +58,9 @@ PreemptiveSLIC::PreemptiveSLIC()
 	m_lvec = NULL;
 	m_avec = NULL;
 	m_bvec = NULL;
+
+	m_use_float = false;
+	m_threads = 1;
 }
 
 PreemptiveSLIC::~PreemptiveSLIC()
@@ -423,6 +431,16 @@ void PreemptiveSLIC::PerformSuperpixelSLIC_preemptive(
     int nChanges = sz;
     int nSkippedClusters;
 
+    // float copies for the float path
+    vector<float> lvecf, avecf, bvecf, distvecf;
+    if(m_use_float)
+    {
+      lvecf.assign(m_lvec, m_lvec + sz);
+      avecf.assign(m_avec, m_avec + sz);
+      bvecf.assign(m_bvec, m_bvec + sz);
+      distvecf.assign(sz, FLT_MAX);
+    }
+    
     // main iteration loop 
     vector<double> dist_n((2*m_sx+1)*(2*m_sy+1));
     for( int itr = 0; itr < maxIter; itr++ )
@@ -452,6 +470,20 @@ void PreemptiveSLIC::PerformSuperpixelSLIC_preemptive(
           x1 = max(0.0,           kseedsx[n]-m_sx);
           x2 = min((double)m_width,   kseedsx[n]+m_sx);
 
+          // float path: compute distances and update labels row by row using
+          // the SIMD kernel
+          if(m_use_float)
+          {
+            for( int y = y1; y < y2; y++ )
+            {
+              int i = y*m_width;
+              SLICDistance::assignRow(&lvecf[i], &avecf[i], &bvecf[i], x1, x2, y,
+                  kseedsl[n], kseedsa[n], kseedsb[n], kseedsx[n], kseedsy[n], invwt, n,
+                  &distvecf[i], &klabels_new[i]);
+            }
+            continue;
+          }
+          
           // for each pixel in the area of the cluster, update label and distance
           int i=0;          
           
@@ -622,6 +654,269 @@ void PreemptiveSLIC::PerformSuperpixelSLIC_preemptive(
     } // main loop
 }
 
+//===========================================================================
+/// PerformSuperpixelSLIC_preemptive_parallel
+///
+/// Multi-threaded variant of PerformSuperpixelSLIC_preemptive. In each
+/// iteration, the clusters that are still active (enough changes in their
+/// neighbourhood) are collected in cluster order. The image is split into
+/// strips of rows, one row of clusters high, which the threads take from a
+/// shared counter: strips do not overlap and can be updated concurrently,
+/// and each strip applies the active clusters overlapping it in cluster
+/// order, i.e. overlapping cluster neighbourhoods are merged exactly as in
+/// the sequential version. Changes are counted per thread and the centroid
+/// sums are accumulated per strip and added up in strip order, so the result
+/// does not depend on the number of threads.
+//===========================================================================
+void PreemptiveSLIC::PerformSuperpixelSLIC_preemptive_parallel(
+    vector<double>&             kseedsl,
+    vector<double>&             kseedsa,
+    vector<double>&             kseedsb,
+    vector<double>&             kseedsx,
+    vector<double>&             kseedsy,
+        int*&                   klabels,
+    const double&               M,
+    const int&                  maxIter)
+{
+    double preemptive_thresh_iteration = 0.01;
+    double preemptive_thresh_segment = 0.01;
+    double minChanges = preemptive_thresh_segment*9*m_sx*m_sy; // m_sx*_m_sy is cluster size, 9 clusters are in the neighborhoud
+    
+    const int sz = m_width*m_height;
+    const int numk = kseedsl.size();
+    const double invwt = 1.0/((m_sx/M)*(m_sy/M));
+    
+    // work units: strips of rows, one row of clusters high
+    const int stripHeight = max(1, (int) m_sy);
+    const int numStrips = (m_height + stripHeight - 1)/stripHeight;
+    
+    int threads = m_threads > 0 ? m_threads : max(1, (int) std::thread::hardware_concurrency());
+    threads = max(1, min(threads, numStrips));
+    
+    // runs function(thread, strip) for all strips
+    auto parallel = [&](std::function<void(int, int)> function)
+    {
+      std::atomic<int> next(0);
+      auto work = [&](int t)
+      {
+        for(int strip = next++; strip < numStrips; strip = next++)
+          function(t, strip);
+      };
+      
+      std::vector<std::thread> workers;
+      for(int t = 1; t < threads; t++)
+        workers.push_back(std::thread(work, t));
+      
+      work(0);
+      for(size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+    };
+    
+    vector<double> distvec(sz, DBL_MAX);
+    std::vector<int> klabels_new(sz, 1);
+    
+    for( int s = 0; s < sz; s++ )
+    {
+      klabels[s] = 0;
+      klabels_new[s] = 1;
+    }
+    
+    vector<unsigned int> nChangesVec(sz, sz);
+    int nChanges = sz;
+    
+    // float copies for the float path
+    vector<float> lvecf, avecf, bvecf, distvecf;
+    if(m_use_float)
+    {
+      lvecf.assign(m_lvec, m_lvec + sz);
+      avecf.assign(m_avec, m_avec + sz);
+      bvecf.assign(m_bvec, m_bvec + sz);
+      distvecf.assign(sz, FLT_MAX);
+    }
+    
+    // active clusters in cluster order and their windows x1, x2, y1, y2
+    vector<int> active;
+    active.reserve(numk);
+    vector<int> windows(4*numk);
+    
+    // change counts per thread; the counts are scattered to the clusters
+    // around each pixel, so bound the indices from the last pixel
+    int x_seed_max = int(m_width-1-m_pixel_offset)/int(m_sx + 1);
+    int y_seed_max = int(m_height-1-m_pixel_offset)/int(m_sy + 1);
+    int numCounts = min(sz, max(numk, y_seed_max*m_nx + x_seed_max + m_nx + 2));
+    vector< vector<unsigned int> > changes(threads, vector<unsigned int>(numCounts));
+    vector<int> threadChanges(threads);
+    
+    // centroid sums l, a, b, x, y and size per strip and cluster
+    vector<double> sums(6*numk*numStrips);
+    
+    // main iteration loop 
+    for( int itr = 0; itr < maxIter; itr++ )
+    {
+        if(nChanges<preemptive_thresh_iteration*sz)
+          break;
+        
+        // collect the clusters with enough changes in their area
+        active.clear();
+        for( int n = 0; n < numk; n++ )
+        {
+          if(nChangesVec[n]<minChanges)
+            continue;
+          nChangesVec[n]=0;
+          
+          active.push_back(n);
+          windows[4*n + 0] = max(0.0,               kseedsx[n]-m_sx);
+          windows[4*n + 1] = min((double)m_width,   kseedsx[n]+m_sx);
+          windows[4*n + 2] = max(0.0,               kseedsy[n]-m_sy);
+          windows[4*n + 3] = min((double)m_height,  kseedsy[n]+m_sy);
+        }
+        
+        //-----------------------------------------------------------------
+        // Assign the pixels of each strip, applying the clusters in order
+        //-----------------------------------------------------------------
+        parallel([&](int t, int strip)
+        {
+          int ystart = strip*stripHeight;
+          int yend = min(m_height, ystart + stripHeight);
+          
+          for( size_t j = 0; j < active.size(); j++ )
+          {
+            int n = active[j];
+            int x1 = windows[4*n + 0];
+            int x2 = windows[4*n + 1];
+            int y1 = max(windows[4*n + 2], ystart);
+            int y2 = min(windows[4*n + 3], yend);
+            
+            if(m_use_float)
+            {
+              for( int y = y1; y < y2; y++ )
+              {
+                int i = y*m_width;
+                SLICDistance::assignRow(&lvecf[i], &avecf[i], &bvecf[i], x1, x2, y,
+                    kseedsl[n], kseedsa[n], kseedsb[n], kseedsx[n], kseedsy[n], invwt, n,
+                    &distvecf[i], &klabels_new[i]);
+              }
+              continue;
+            }
+            
+            for( int y = y1; y < y2; y++ )
+            {
+              int i = y*m_width + x1;
+              double dy = y-kseedsy[n];
+              
+              for( int x = x1; x < x2; x++ )
+              {
+                double dl = m_lvec[i]-kseedsl[n];
+                double da = m_avec[i]-kseedsa[n];
+                double db = m_bvec[i]-kseedsb[n];
+                double dx = x-kseedsx[n];
+                
+                double dist = dl*dl + da*da + db*db;
+                double distxy = dx*dx + dy*dy;
+                dist += distxy*invwt;
+                
+                if( dist < distvec[i] )
+                {
+                  distvec[i] = dist;
+                  klabels_new[i]  = n;
+                }
+                i++;
+              }
+            }
+          }
+        });
+        
+        //-----------------------------------------------------------------
+        // Collect number of changes per cluster and the centroid sums
+        //-----------------------------------------------------------------
+        for( int t = 0; t < threads; t++ )
+        {
+          changes[t].assign(numCounts, 0);
+          threadChanges[t] = 0;
+        }
+        
+        parallel([&](int t, int strip)
+        {
+          int ystart = strip*stripHeight;
+          int yend = min(m_height, ystart + stripHeight);
+          unsigned int* counts = &changes[t][0];
+          double* sigma = &sums[6*numk*strip];
+          std::fill(sigma, sigma + 6*numk, 0.0);
+          
+          int ind = ystart*m_width;
+          for( int r = ystart; r < yend; r++ )
+          {
+            for( int c = 0; c < m_width; c++ )
+            {
+              // if the label has changed
+              if(klabels_new[ind]!=klabels[ind])
+              {
+                  klabels[ind] = klabels_new[ind];
+                  threadChanges[t]++;
+                  counts[ klabels[ind] ]++;
+                  
+                  // see PerformSuperpixelSLIC_preemptive
+                  int x_seed = int(c-m_pixel_offset)/int(m_sx + 1);
+                  int y_seed = int(r-m_pixel_offset)/int(m_sy + 1);
+                  
+                  counts[ y_seed*m_nx + x_seed ]++; // center
+                  
+                  if(x_seed>0)          counts[ y_seed*m_nx + x_seed - 1]++; // left
+                  if(x_seed<m_nx-1)     counts[ y_seed*m_nx + x_seed + 1]++; // right
+                  if(y_seed>0)          counts[ (y_seed-1)*m_nx + x_seed]++; // top
+                  if(y_seed<m_ny-1)     counts[ (y_seed+1)*m_nx + x_seed]++; // bottom
+                  
+                  if(x_seed<m_nx-1 &&  y_seed>0)       counts[ (y_seed-1)*m_nx + x_seed + 1]++;
+                  if(x_seed<m_nx-1 &&  y_seed<m_ny-1)  counts[ (y_seed+1)*m_nx + x_seed + 1]++;
+                  if(x_seed>0 && y_seed>0)             counts[ (y_seed-1)*m_nx + x_seed - 1]++;
+                  if(x_seed>0 && y_seed<m_ny-1)        counts[ (y_seed+1)*m_nx + x_seed - 1]++;
+              }
+              
+              double* sigma_k = sigma + 6*klabels[ind];
+              sigma_k[0] += m_lvec[ind];
+              sigma_k[1] += m_avec[ind];
+              sigma_k[2] += m_bvec[ind];
+              sigma_k[3] += c;
+              sigma_k[4] += r;
+              sigma_k[5] += 1.0;
+              ind++;
+            }
+          }
+        });
+        
+        nChanges = 0;
+        for( int t = 0; t < threads; t++ )
+        {
+          nChanges += threadChanges[t];
+          for( int i = 0; i < numCounts; i++ )
+            nChangesVec[i] += changes[t][i];
+        }
+        
+        //-----------------------------------------------------------------
+        // Recalculate the centroid and store in the seed values
+        //-----------------------------------------------------------------
+        for( int k = 0; k < numk; k++ )
+        {
+          double sigma[6] = {0, 0, 0, 0, 0, 0};
+          for( int strip = 0; strip < numStrips; strip++ )
+          {
+            const double* sigma_k = &sums[6*numk*strip + 6*k];
+            for( int c = 0; c < 6; c++ )
+              sigma[c] += sigma_k[c];
+          }
+          
+          if( sigma[5] <= 0 ) sigma[5] = 1;
+          double inv = 1.0/sigma[5];
+          
+          kseedsl[k] = sigma[0]*inv;
+          kseedsa[k] = sigma[1]*inv;
+          kseedsb[k] = sigma[2]*inv;
+          kseedsx[k] = sigma[3]*inv;
+          kseedsy[k] = sigma[4]*inv;
+        }
+    } // main loop
+}
+
 //===========================================================================
 ///	EnforceLabelConnectivity
 ///
@@ -725,6 +1020,19 @@ void PreemptiveSLIC::EnforceLabelConnectivity(
 	if(yvec) delete [] yvec;
 }
 
+/*
+Convert a CV_8UC3 BGR image to CV_8UC3 Lab (OpenCV's 8-bit encoding) using the
+shared table-based conversion instead of cvtColor
+*/
+inline void convertBGR2Lab(const Mat& I_rgb, Mat& I_lab)
+{
+  I_lab.create(I_rgb.rows, I_rgb.cols, CV_8UC3);
+  for(int y=0; y<I_rgb.rows; y++)
+  {
+    ColorConversion::BGR2Lab8(I_rgb.ptr<unsigned char>(y), I_lab.ptr<unsigned char>(y), I_rgb.cols);
+  }
+}
+
 /*
 Append a single seed to vectors kseedsx, kseedsy, kseedsl, kseedsa,  kseedsb
 The seed is located at (x,y) and should cover (x-sx/2,  x+sx/2), (y-sy/2
@@ -982,7 +1290,7 @@ void PreemptiveSLIC::preemptiveSLIC(const Mat& I_rgb, const int k, const double
 
 
   Mat I_lab;
-  cvtColor(I_rgb, I_lab, CV_BGR2Lab); // I_lab is CV_8UC3
+  convertBGR2Lab(I_rgb, I_lab); // I_lab is CV_8UC3
   
   // fill lab vectors
   m_lvec = new double[sz];
@@ -1008,7 +1316,10 @@ void PreemptiveSLIC::preemptiveSLIC(const Mat& I_rgb, const int k, const double
   if(perturbseeds) DetectLabEdges(m_lvec, m_avec, m_bvec, m_width, m_height, edgemag);
   
   initSeeds(I_lab, k, m_kseedsx, m_kseedsy, m_kseedsl, m_kseedsa,  m_kseedsb, klabels, 0 /*init labels*/, seeds);
-  PerformSuperpixelSLIC_preemptive(m_kseedsl, m_kseedsa, m_kseedsb, m_kseedsx, m_kseedsy, klabels, compactness, 10);
+  if(m_threads != 1)
+    PerformSuperpixelSLIC_preemptive_parallel(m_kseedsl, m_kseedsa, m_kseedsb, m_kseedsx, m_kseedsy, klabels, compactness, 10);
+  else
+    PerformSuperpixelSLIC_preemptive(m_kseedsl, m_kseedsa, m_kseedsb, m_kseedsx, m_kseedsy, klabels, compactness, 10);
   
   int numlabels = m_kseedsl.size();
   int* nlabels = new int[sz];
@@ -1044,7 +1355,7 @@ void PreemptiveSLIC::preemptiveSLIC(const Mat& I_rgb, const int region_size, con
   Mat I_lab;
   if (!rgb)
   {
-    cvtColor(I_rgb, I_lab, CV_BGR2Lab);
+    convertBGR2Lab(I_rgb, I_lab);
   }
   else
   {
@@ -1077,7 +1388,10 @@ void PreemptiveSLIC::preemptiveSLIC(const Mat& I_rgb, const int region_size, con
   if(perturbseeds) DetectLabEdges(m_lvec, m_avec, m_bvec, m_width, m_height, edgemag);
   
   initSeedsStep(I_lab, region_size, m_kseedsx, m_kseedsy, m_kseedsl, m_kseedsa,  m_kseedsb, klabels, 0 /*init labels*/, seeds);
-  PerformSuperpixelSLIC_preemptive(m_kseedsl, m_kseedsa, m_kseedsb, m_kseedsx, m_kseedsy, klabels, compactness, iterations);
+  if(m_threads != 1)
+    PerformSuperpixelSLIC_preemptive_parallel(m_kseedsl, m_kseedsa, m_kseedsb, m_kseedsx, m_kseedsy, klabels, compactness, iterations);
+  else
+    PerformSuperpixelSLIC_preemptive(m_kseedsl, m_kseedsa, m_kseedsb, m_kseedsx, m_kseedsy, klabels, compactness, iterations);
   
   int numlabels = m_kseedsl.size();
   int* nlabels = new int[sz];
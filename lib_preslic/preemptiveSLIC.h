@@ -82,6 +82,14 @@ public:
     vector<double> m_kseedsb;
     vector<double> m_kseedsx;
     vector<double> m_kseedsy;
+    
+    // compute the assignment step in float instead of double precision, which
+    // allows to use the SIMD distance kernel (see lib_slic/slic_distance.h)
+    bool m_use_float;
+    
+    // number of threads for the preemptive iterations, 0 for all cores; with
+    // more than one thread PerformSuperpixelSLIC_preemptive_parallel is used
+    int m_threads;
 
 private:
 	//============================================================================
@@ -107,6 +115,16 @@ private:
         int*&                       klabels,
         const double&               m = 10.0,
         const int&                  maxIter = 10);
+    
+    void PerformSuperpixelSLIC_preemptive_parallel(
+        vector<double>&             kseedsl,
+        vector<double>&             kseedsa,
+        vector<double>&             kseedsb,
+        vector<double>&             kseedsx,
+        vector<double>&             kseedsy,
+        int*&                       klabels,
+        const double&               m = 10.0,
+        const int&                  maxIter = 10);
 	//============================================================================
 	// Pick seeds for superpixels when step size of superpixels is given.
 	//============================================================================
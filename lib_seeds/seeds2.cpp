@@ -23,6 +23,7 @@
  */
 
 #include "seeds2.h"
+#include "color_conversion.h"
 #include "math.h"
 #include <cstdio>
 #include <algorithm>
@@ -1835,14 +1836,14 @@ int SEEDS::RGB2LAB(const int& r, const int& g, const int& b, float* lval, float*
 	bool YT = (yVal > T);
 	bool ZT = (zVal > T);
 
-	fX = XT * pow(xVal,1.0/3.0) + (!XT) * (7.787 * xVal + 16.0/116.0);
+	fX = XT * ColorConversion::cbrt(xVal) + (!XT) * (7.787 * xVal + 16.0/116.0);
 
 	// Compute L
-	float Y3 = pow(yVal,1.0/3.0); 
+	float Y3 = ColorConversion::cbrt(yVal); 
 	fY = YT*Y3 + (!YT)*(7.787*yVal + 16.0/116.0);
 	lVal  = YT * (116 * Y3 - 16.0) + (!YT)*(903.3*yVal);
 
-	fZ = ZT*pow(zVal,1.0/3.0) + (!ZT)*(7.787*zVal + 16.0/116.0);
+	fZ = ZT*ColorConversion::cbrt(zVal) + (!ZT)*(7.787*zVal + 16.0/116.0);
 
 	// Compute a and b
 	aVal = 500 * (fX - fY);
@@ -1948,14 +1949,14 @@ int SEEDS::RGB2LAB_special(int r, int g, int b, float* lval, float* aval, float*
 	bool YT = (yVal > T);
 	bool ZT = (zVal > T);
 
-	fX = XT * pow(xVal,1.0/3.0) + (!XT) * (7.787 * xVal + 16/116);
+	fX = XT * ColorConversion::cbrt(xVal) + (!XT) * (7.787 * xVal + 16/116);
 
 	// Compute L
-	float Y3 = pow(yVal,1.0/3.0); 
+	float Y3 = ColorConversion::cbrt(yVal); 
 	fY = YT*Y3 + (!YT)*(7.787*yVal + 16/116);
 	lVal  = YT * (116 * Y3 - 16.0) + (!YT)*(903.3*yVal);
 
-	fZ = ZT*pow(zVal,1.0/3.0) + (!ZT)*(7.787*zVal + 16/116);
+	fZ = ZT*ColorConversion::cbrt(zVal) + (!ZT)*(7.787*zVal + 16/116);
 
 	// Compute a and b
 	aVal = 500 * (fX - fY);
@@ -2019,14 +2020,14 @@ int SEEDS::RGB2LAB_special(int r, int g, int b, int* bin_l, int* bin_a, int* bin
 	bool YT = (yVal > T);
 	bool ZT = (zVal > T);
 
-	fX = XT * pow(xVal,1.0/3.0) + (!XT) * (7.787 * xVal + 16/116);
+	fX = XT * ColorConversion::cbrt(xVal) + (!XT) * (7.787 * xVal + 16/116);
 
 	// Compute L
-	float Y3 = pow(yVal,1.0/3.0); 
+	float Y3 = ColorConversion::cbrt(yVal); 
 	fY = YT*Y3 + (!YT)*(7.787*yVal + 16/116);
 	lVal  = YT * (116 * Y3 - 16.0) + (!YT)*(903.3*yVal);
 
-	fZ = ZT*pow(zVal,1.0/3.0) + (!ZT)*(7.787*zVal + 16/116);
+	fZ = ZT*ColorConversion::cbrt(zVal) + (!ZT)*(7.787*zVal + 16/116);
 
 	// Compute a and b
 	aVal = 500 * (fX - fY);
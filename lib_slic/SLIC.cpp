@@ -9,8 +9,16 @@
 #include <iostream>
 #include <fstream>
 #include <assert.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "SLIC.h"
+#include "slic_distance.h"
+#include "color_conversion.h"
 
+// Fixed point scale of the color sums in PerformSuperpixelSLIC (2^20, so 
+// Lab values keep 20 fractional bits and the sums fit into 64 bits)
+static const float SLIC_COLOR_SCALE = 1048576.0f;
 
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
@@ -29,6 +37,17 @@ SLIC::SLIC()
 	m_lvecvec = NULL;
 	m_avecvec = NULL;
 	m_bvecvec = NULL;
+
+	m_threads = 1;
+	m_instruction_set = SLICDistance::getInstructionSet();
+
+	m_max_displacement = -1;
+	m_max_changed = -1;
+	m_iterations = 0;
+
+	m_videostep = 0;
+	m_reusedlvec = NULL;
+	m_buffersize = 0;
 }
 
 SLIC::~SLIC()
@@ -58,73 +77,14 @@ SLIC::~SLIC()
 	}
 }
 
-//==============================================================================
-///	RGB2XYZ
-///
-/// sRGB (D65 illuninant assumption) to XYZ conversion
-//==============================================================================
-void SLIC::RGB2XYZ(
-	const int&		sR,
-	const int&		sG,
-	const int&		sB,
-	float&			X,
-	float&			Y,
-	float&			Z)
-{
-	float R = sR/255.0;
-	float G = sG/255.0;
-	float B = sB/255.0;
-
-	float r, g, b;
-
-	if(R <= 0.04045)	r = R/12.92;
-	else				r = pow((R+0.055)/1.055,2.4);
-	if(G <= 0.04045)	g = G/12.92;
-	else				g = pow((G+0.055)/1.055,2.4);
-	if(B <= 0.04045)	b = B/12.92;
-	else				b = pow((B+0.055)/1.055,2.4);
-
-	X = r*0.4124564 + g*0.3575761 + b*0.1804375;
-	Y = r*0.2126729 + g*0.7151522 + b*0.0721750;
-	Z = r*0.0193339 + g*0.1191920 + b*0.9503041;
-}
-
 //===========================================================================
 ///	RGB2LAB
+///
+/// Uses the shared table-based conversion, see color_conversion.h
 //===========================================================================
 void SLIC::RGB2LAB(const int& sR, const int& sG, const int& sB, float& lval, float& aval, float& bval)
 {
-	//------------------------
-	// sRGB to XYZ conversion
-	//------------------------
-	float X, Y, Z;
-	RGB2XYZ(sR, sG, sB, X, Y, Z);
-
-	//------------------------
-	// XYZ to LAB conversion
-	//------------------------
-	float epsilon = 0.008856;	//actual CIE standard
-	float kappa   = 903.3;		//actual CIE standard
-
-	float Xr = 0.950456;	//reference white
-	float Yr = 1.0;		//reference white
-	float Zr = 1.088754;	//reference white
-
-	float xr = X/Xr;
-	float yr = Y/Yr;
-	float zr = Z/Zr;
-
-	float fx, fy, fz;
-	if(xr > epsilon)	fx = pow(xr, 1.0/3.0);
-	else				fx = (kappa*xr + 16.0)/116.0;
-	if(yr > epsilon)	fy = pow(yr, 1.0/3.0);
-	else				fy = (kappa*yr + 16.0)/116.0;
-	if(zr > epsilon)	fz = pow(zr, 1.0/3.0);
-	else				fz = (kappa*zr + 16.0)/116.0;
-
-	lval = 116.0*fy-16.0;
-	aval = 500.0*(fx-fy);
-	bval = 200.0*(fy-fz);
+	ColorConversion::RGB2Lab(sR, sG, sB, lval, aval, bval);
 }
 
 //===========================================================================
@@ -143,14 +103,7 @@ void SLIC::DoRGBtoLABConversion(
 	avec = new float[sz];
 	bvec = new float[sz];
 
-	for( int j = 0; j < sz; j++ )
-	{
-		int r = (ubuff[j] >> 16) & 0xFF;
-		int g = (ubuff[j] >>  8) & 0xFF;
-		int b = (ubuff[j]      ) & 0xFF;
-
-		RGB2LAB( r, g, b, lvec[j], avec[j], bvec[j] );
-	}
+	ColorConversion::ARGB2Lab(ubuff, lvec, avec, bvec, sz);
 }
 
 //===========================================================================
@@ -167,14 +120,7 @@ void SLIC::DoRGBtoLABConversion(
 	int sz = m_width*m_height;
 	for( int d = 0; d < m_depth; d++ )
 	{
-		for( int j = 0; j < sz; j++ )
-		{
-			int r = (ubuff[d][j] >> 16) & 0xFF;
-			int g = (ubuff[d][j] >>  8) & 0xFF;
-			int b = (ubuff[d][j]      ) & 0xFF;
-
-			RGB2LAB( r, g, b, lvec[d][j], avec[d][j], bvec[d][j] );
-		}
+		ColorConversion::ARGB2Lab(ubuff[d], lvec[d], avec[d], bvec[d], sz);
 	}
 }
 
@@ -790,6 +736,17 @@ void SLIC::GetKValues_LABXYZ(
 ///
 ///	Performs k mean segmentation. It is fast because it looks locally, not
 /// over the entire image.
+///
+/// With multiple threads, the image is split into horizontal bands. Each
+/// thread assigns the pixels of its band, visiting the seeds whose windows
+/// reach the band in the same order as the single threaded loop. The centroid
+/// sums are accumulated per band in integers (colors in fixed point) and
+/// reduced afterwards, so the reduction is exact and the labels do not depend
+/// on the number of threads. The threads are started once per call and
+/// reused for all iterations.
+///
+/// If a convergence criterion is set (see SetConvergence), the iterations
+/// stop early once the centroids and labels have settled.
 //===========================================================================
 void SLIC::PerformSuperpixelSLIC(
 	vector<float>&				kseedsl,
@@ -810,93 +767,118 @@ void SLIC::PerformSuperpixelSLIC(
         //if(STEP < 8) offset = STEP*1.5;//to prevent a crash due to a very small step size
 	//----------------
 	
-	vector<float> clustersize(numk, 0);
-	vector<float> inv(numk, 0);//to store 1/clustersize[k] values
+	// The buffers are members so that repeated calls do not allocate.
+	vector<double>& inv = m_inv;//to store 1/clustersize[k] values
+	inv.assign(numk, 0);
 
-	vector<float> sigmal(numk, 0);
-	vector<float> sigmaa(numk, 0);
-	vector<float> sigmab(numk, 0);
-	vector<float> sigmax(numk, 0);
-	vector<float> sigmay(numk, 0);
-	vector<float> distvec(sz, DBL_MAX);
+	vector<float>& distvec = m_distvec;
+	distvec.assign(sz, DBL_MAX);
         
 	float invwt = 1.0/((STEP/M)*(STEP/M));
         
-	int x1, y1, x2, y2;
-	float l, a, b;
-	float dist;
-	float distxy;
-	for( int itr = 0; itr < iterations; itr++ )
+	int threads = max(1, min(m_threads, m_height));
+	
+	// Sums of each band: l, a, b, x, y and cluster size. The sums are 
+	// integers, so the reduction is exact and the centroids (and thereby the
+	// labels) do not depend on the number of threads.
+	vector< vector<long long> >& partials = m_partials;
+	partials.resize(threads);
+	
+	// Band t: assign the pixels of the band to the seeds and sum them up.
+	auto band = [&](int t)
 	{
-		distvec.assign(sz, DBL_MAX);
-		for( int n = 0; n < numk; n++ )
+		int ystart = (m_height*t)/threads;
+		int yend = (m_height*(t + 1))/threads;
+		
+		std::fill(distvec.begin() + ystart*m_width, 
+			distvec.begin() + yend*m_width, DBL_MAX);
+		AssignSuperpixelSeeds(kseedsl, kseedsa, kseedsb, kseedsx, kseedsy, 
+			klabels, distvec, offset, invwt, ystart, yend);
+		
+		partials[t].assign(6*numk, 0);
+		AccumulateSuperpixelSeeds(klabels, ystart, yend, 
+			&partials[t][0], &partials[t][numk], &partials[t][2*numk], 
+			&partials[t][3*numk], &partials[t][4*numk], &partials[t][5*numk]);
+	};
+	
+	// Bands 1 to threads - 1 are processed by workers started once for all 
+	// iterations, band 0 by the calling thread. Each iteration increments 
+	// generation to start the workers and waits until none is pending.
+	std::mutex mutex;
+	std::condition_variable started;
+	std::condition_variable finished;
+	int generation = 0;
+	int pending = 0;
+	bool stop = false;
+	
+	vector<thread> workers;
+	for( int t = 1; t < threads; t++ )
+	{
+		workers.push_back(thread([&, t]()
 		{
-                        y1 = max(0.0f,			kseedsy[n]-offset);
-                        y2 = min((float)m_height,	kseedsy[n]+offset);
-                        x1 = max(0.0f,			kseedsx[n]-offset);
-                        x2 = min((float)m_width,	kseedsx[n]+offset);
-
-
-			for( int y = y1; y < y2; y++ )
+			int done = 0;
+			while( true )
 			{
-				for( int x = x1; x < x2; x++ )
 				{
-					int i = y*m_width + x;
-
-					l = m_lvec[i];
-					a = m_avec[i];
-					b = m_bvec[i];
-
-					dist =			(l - kseedsl[n])*(l - kseedsl[n]) +
-								(a - kseedsa[n])*(a - kseedsa[n]) +
-								(b - kseedsb[n])*(b - kseedsb[n]);
-
-					distxy =		(x - kseedsx[n])*(x - kseedsx[n]) +
-								(y - kseedsy[n])*(y - kseedsy[n]);
-					
-					//------------------------------------------------------------------------
-					dist += distxy*invwt;//dist = sqrt(dist) + sqrt(distxy*invwt);//this is more exact
-					//------------------------------------------------------------------------
-					if( dist < distvec[i] )
-					{
-						distvec[i] = dist;
-						klabels[i]  = n;
-					}
+					std::unique_lock<std::mutex> lock(mutex);
+					started.wait(lock, [&]() { return stop || generation != done; });
+					if( stop ) return;
+					done = generation;
 				}
+				
+				band(t);
+				
+				std::lock_guard<std::mutex> lock(mutex);
+				if( --pending == 0 ) finished.notify_one();
 			}
+		}));
+	}
+	
+	// Labels of the previous iteration, only kept for the convergence check.
+	bool convergence = m_max_displacement >= 0 || m_max_changed >= 0;
+	vector<int>& previouslabels = m_previouslabels;
+	previouslabels.resize(convergence ? sz : 0);
+	m_iterations = 0;
+	
+	for( int itr = 0; itr < iterations; itr++ )
+	{
+		if( convergence ) std::copy(klabels, klabels + sz, previouslabels.begin());
+		
+		if( threads > 1 )
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			generation++;
+			pending = threads - 1;
+			started.notify_all();
+		}
+		
+		band(0);
+		
+		if( threads > 1 )
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			finished.wait(lock, [&]() { return pending == 0; });
 		}
 		//-----------------------------------------------------------------
 		// Recalculate the centroid and store in the seed values
 		//-----------------------------------------------------------------
-		//instead of reassigning memory on each iteration, just reset.
-	
-		sigmal.assign(numk, 0);
-		sigmaa.assign(numk, 0);
-		sigmab.assign(numk, 0);
-		sigmax.assign(numk, 0);
-		sigmay.assign(numk, 0);
-		clustersize.assign(numk, 0);
+		long long* sigmal = &partials[0][0];
+		long long* sigmaa = &partials[0][numk];
+		long long* sigmab = &partials[0][2*numk];
+		long long* sigmax = &partials[0][3*numk];
+		long long* sigmay = &partials[0][4*numk];
+		long long* clustersize = &partials[0][5*numk];
 		//------------------------------------
 		//edgesum.assign(numk, 0);
 		//------------------------------------
 
-		{int ind(0);
-		for( int r = 0; r < m_height; r++ )
+		for( int t = 1; t < threads; t++ )
 		{
-			for( int c = 0; c < m_width; c++ )
+			for( int k = 0; k < 6*numk; k++ )
 			{
-				sigmal[klabels[ind]] += m_lvec[c + m_width*r];
-				sigmaa[klabels[ind]] += m_avec[c + m_width*r];
-				sigmab[klabels[ind]] += m_bvec[c + m_width*r];
-				sigmax[klabels[ind]] += c;
-				sigmay[klabels[ind]] += r;
-				//------------------------------------
-				//edgesum[klabels[ind]] += edgemag[ind];
-				//------------------------------------
-				clustersize[klabels[ind]] += 1.0;
-				ind++;
+				partials[0][k] += partials[t][k];
 			}
-		}}
+		}
 
 		{for( int k = 0; k < numk; k++ )
 		{
@@ -904,20 +886,170 @@ void SLIC::PerformSuperpixelSLIC(
 			inv[k] = 1.0/clustersize[k];//computing inverse now to multiply, than divide later
 		}}
 		
+		float maxdisplacement = 0;
 		{for( int k = 0; k < numk; k++ )
 		{
-			kseedsl[k] = sigmal[k]*inv[k];
-			kseedsa[k] = sigmaa[k]*inv[k];
-			kseedsb[k] = sigmab[k]*inv[k];
+			float dx = sigmax[k]*inv[k] - kseedsx[k];
+			float dy = sigmay[k]*inv[k] - kseedsy[k];
+			maxdisplacement = max(maxdisplacement, dx*dx + dy*dy);
+			
+			kseedsl[k] = sigmal[k]*(inv[k]/SLIC_COLOR_SCALE);
+			kseedsa[k] = sigmaa[k]*(inv[k]/SLIC_COLOR_SCALE);
+			kseedsb[k] = sigmab[k]*(inv[k]/SLIC_COLOR_SCALE);
 			kseedsx[k] = sigmax[k]*inv[k];
 			kseedsy[k] = sigmay[k]*inv[k];
 			//------------------------------------
 			//edgesum[k] *= inv[k];
 			//------------------------------------
 		}}
+		
+		m_iterations = itr + 1;
+		
+		//-----------------------------------------------------------------
+		// Stop if no centroid moved more than m_max_displacement pixels and
+		// at most a fraction m_max_changed of the labels changed.
+		//-----------------------------------------------------------------
+		if( convergence )
+		{
+			int changed = 0;
+			for( int j = 0; j < sz; j++ )
+			{
+				if( klabels[j] != previouslabels[j] ) changed++;
+			}
+			
+			bool settled = m_max_displacement < 0 
+				|| sqrt(maxdisplacement) <= m_max_displacement;
+			bool stable = m_max_changed < 0 
+				|| changed <= m_max_changed*sz;
+			
+			if( settled && stable ) break;
+		}
+	}
+	
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+		started.notify_all();
+	}
+	for( int t = 0; t < (int) workers.size(); t++ ) workers[t].join();
+}
+
+//===========================================================================
+///	AssignSuperpixelSeeds
+///
+///	Assigns the pixels in rows [ystart, yend) to the closest seed whose
+/// window covers them; only writes distvec and klabels within these rows.
+//===========================================================================
+void SLIC::AssignSuperpixelSeeds(
+	const vector<float>&		kseedsl,
+	const vector<float>&		kseedsa,
+	const vector<float>&		kseedsb,
+	const vector<float>&		kseedsx,
+	const vector<float>&		kseedsy,
+	int*					klabels,
+	vector<float>&			distvec,
+	const int&				offset,
+	const float&			invwt,
+	const int&				ystart,
+	const int&				yend)
+{
+	const int numk = kseedsl.size();
+	
+	int x1, y1, x2, y2;
+	for( int n = 0; n < numk; n++ )
+	{
+                y1 = max(0.0f,			kseedsy[n]-offset);
+                y2 = min((float)m_height,	kseedsy[n]+offset);
+                x1 = max(0.0f,			kseedsx[n]-offset);
+                x2 = min((float)m_width,	kseedsx[n]+offset);
+		
+		y1 = max(y1, ystart);
+		y2 = min(y2, yend);
+
+		// dist = (l - l_n)^2 + (a - a_n)^2 + (b - b_n)^2 + ((x - x_n)^2 + (y - y_n)^2)*invwt,
+		// computed for 8 (AVX2) or 4 (SSE) pixels at once if supported.
+		for( int y = y1; y < y2; y++ )
+		{
+			int i = y*m_width;
+			
+			SLICDistance::assignRow(m_lvec + i, m_avec + i, m_bvec + i, x1, x2, y, 
+				kseedsl[n], kseedsa[n], kseedsb[n], kseedsx[n], kseedsy[n], invwt, n, 
+				&distvec[i], klabels + i, m_instruction_set);
+		}
+	}
+}
+
+//===========================================================================
+///	AccumulateSuperpixelSeeds
+///
+///	Adds color, position and size of the pixels in rows [ystart, yend) to
+/// the sums of their superpixels.
+//===========================================================================
+void SLIC::AccumulateSuperpixelSeeds(
+	const int*				klabels,
+	const int&				ystart,
+	const int&				yend,
+	long long*				sigmal,
+	long long*				sigmaa,
+	long long*				sigmab,
+	long long*				sigmax,
+	long long*				sigmay,
+	long long*				clustersize)
+{
+	int ind(ystart*m_width);
+	for( int r = ystart; r < yend; r++ )
+	{
+		for( int c = 0; c < m_width; c++ )
+		{
+			sigmal[klabels[ind]] += (long long) (m_lvec[ind]*SLIC_COLOR_SCALE);
+			sigmaa[klabels[ind]] += (long long) (m_avec[ind]*SLIC_COLOR_SCALE);
+			sigmab[klabels[ind]] += (long long) (m_bvec[ind]*SLIC_COLOR_SCALE);
+			sigmax[klabels[ind]] += c;
+			sigmay[klabels[ind]] += r;
+			//------------------------------------
+			//edgesum[klabels[ind]] += edgemag[ind];
+			//------------------------------------
+			clustersize[klabels[ind]] += 1;
+			ind++;
+		}
 	}
 }
 
+//===========================================================================
+///	SetThreads
+///
+///	Number of threads used by PerformSuperpixelSLIC, 0 for all cores.
+//===========================================================================
+void SLIC::SetThreads(const int threads)
+{
+	m_threads = threads;
+	if( m_threads <= 0 ) m_threads = max(1, (int) thread::hardware_concurrency());
+}
+
+//===========================================================================
+///	SetConvergence
+///
+///	Convergence criterion of PerformSuperpixelSLIC: stop once no centroid
+/// moved more than displacement pixels and at most a fraction changed of the
+/// labels changed in an iteration. A negative value disables the
+/// corresponding criterion; both negative (the default) runs all iterations.
+//===========================================================================
+void SLIC::SetConvergence(const float displacement, const float changed)
+{
+	m_max_displacement = displacement;
+	m_max_changed = changed;
+}
+
+//===========================================================================
+///	GetIterations
+///
+///	Number of iterations actually run by the last segmentation.
+//===========================================================================
+int SLIC::GetIterations() const
+{
+	return m_iterations;
+}
+
 //===========================================================================
 ///	Perform3DSupervoxelSLIC
 ///
@@ -1338,8 +1470,10 @@ void SLIC::EnforceLabelConnectivity(
 	//nlabels.resize(sz, -1);
 	for( int i = 0; i < sz; i++ ) nlabels[i] = -1;
 	int label(0);
-	int* xvec = new int[sz];
-	int* yvec = new int[sz];
+	if( (int) m_segmentx.size() < sz ) m_segmentx.resize(sz);
+	if( (int) m_segmenty.size() < sz ) m_segmenty.resize(sz);
+	int* xvec = &m_segmentx[0];
+	int* yvec = &m_segmenty[0];
 	int oindex(0);
 	int adjlabel(0);//adjacent label
 	for( int j = 0; j < height; j++ )
@@ -1410,9 +1544,6 @@ void SLIC::EnforceLabelConnectivity(
 		}
 	}
 	numlabels = label;
-
-	if(xvec) delete [] xvec;
-	if(yvec) delete [] yvec;
 }
 
 
@@ -1786,6 +1917,284 @@ void SLIC::DoSuperpixelSegmentation_ForGivenSuperpixelStep(
 	if(nlabels) delete [] nlabels;
 }
 
+//===========================================================================
+///	DoSuperpixelSegmentation_ForVideoFrame
+///
+/// Temporal variant of DoSuperpixelSegmentation_ForGivenSuperpixelStep for
+/// consecutive video frames. The first frame is segmented as usual; every
+/// following frame of the same size and step starts from the centroids of
+/// the previous frame and only runs warmiterations. Seeds whose cluster was
+/// empty in the previous frame are put back at their initial position so the
+/// number of superpixels does not decay over time.
+///
+/// The Lab buffers and the seeds are kept across frames; the labels are
+/// written to the given buffer.
+//===========================================================================
+void SLIC::DoSuperpixelSegmentation_ForVideoFrame(
+        const unsigned int*                             ubuff,
+	const int					width,
+	const int					height,
+	int*						klabels,
+	int&						numlabels,
+        const int&					superpixelstep,
+        const float&                                   compactness,
+        const bool&                                     perturbseeds,
+        const int                                       iterations,
+        const int                                       warmiterations,
+        const int                                       color)
+{
+	const int STEP = superpixelstep;
+	const int sz = width*height;
+
+	bool warm = !m_videoseedsl.empty() && m_width == width 
+		&& m_height == height && m_videostep == STEP;
+
+	m_width  = width;
+	m_height = height;
+	//--------------------------------------------------
+	ReserveLabBuffers(sz);
+
+	if(color > 0)//LAB, the default option
+	{
+		ColorConversion::ARGB2Lab(ubuff, m_lvec, m_avec, m_bvec, sz);
+	}
+	else//RGB
+	{
+		for( int i = 0; i < sz; i++ )
+		{
+			m_lvec[i] = ubuff[i] >> 16 & 0xff;
+			m_avec[i] = ubuff[i] >>  8 & 0xff;
+			m_bvec[i] = ubuff[i]       & 0xff;
+		}
+	}
+	//--------------------------------------------------
+	vector<float> edgemag(0);
+	if( !warm )
+	{
+		if(perturbseeds) DetectLabEdges(m_lvec, m_avec, m_bvec, m_width, m_height, edgemag);
+		GetLABXYSeeds_ForGivenStepSize(m_videoseedsl, m_videoseedsa, m_videoseedsb, 
+			m_videoseedsx, m_videoseedsy, STEP, perturbseeds, edgemag);
+
+		m_videogridx = m_videoseedsx;
+		m_videogridy = m_videoseedsy;
+		m_videolabels.assign(sz, -1);
+		m_videostep = STEP;
+	}
+	else
+	{
+		//-----------------------------------------------------------------
+		// Re-seed clusters that were empty in the previous frame
+		//-----------------------------------------------------------------
+		const int numk = m_videoseedsl.size();
+		m_videocounts.assign(numk, 0);
+		for( int i = 0; i < sz; i++ )
+		{
+			if( m_videolabels[i] >= 0 ) m_videocounts[m_videolabels[i]]++;
+		}
+
+		for( int n = 0; n < numk; n++ )
+		{
+			if( m_videocounts[n] > 0 ) continue;
+
+			int i = int(m_videogridy[n])*m_width + int(m_videogridx[n]);
+			m_videoseedsl[n] = m_lvec[i];
+			m_videoseedsa[n] = m_avec[i];
+			m_videoseedsb[n] = m_bvec[i];
+			m_videoseedsx[n] = m_videogridx[n];
+			m_videoseedsy[n] = m_videogridy[n];
+		}
+	}
+
+	int* rawlabels = &m_videolabels[0];
+	PerformSuperpixelSLIC(m_videoseedsl, m_videoseedsa, m_videoseedsb, m_videoseedsx, m_videoseedsy, 
+		rawlabels, STEP, edgemag, compactness, warm ? warmiterations : iterations);
+	numlabels = m_videoseedsl.size();
+
+	int* nlabels = klabels;
+	EnforceLabelConnectivity(rawlabels, m_width, m_height, nlabels, numlabels, float(sz)/float(STEP*STEP));
+}
+
+//===========================================================================
+///	ResetVideo
+//===========================================================================
+void SLIC::ResetVideo()
+{
+	m_videoseedsl.clear();
+	m_videoseedsa.clear();
+	m_videoseedsb.clear();
+	m_videoseedsx.clear();
+	m_videoseedsy.clear();
+	m_videostep = 0;
+}
+
+//===========================================================================
+///	DoSuperpixelSegmentation_ForBGRImage
+///
+/// Same as DoSuperpixelSegmentation_ForGivenSuperpixelStep, but reads the
+/// image as interleaved 8-bit BGR (e.g. a CV_8UC3 cv::Mat, rows stride bytes
+/// apart) instead of packed ARGB and writes the labels to the given buffer.
+/// The Lab buffers, seeds, raw labels and all scratch buffers are members,
+/// so repeated calls on images of the same size do not allocate.
+//===========================================================================
+void SLIC::DoSuperpixelSegmentation_ForBGRImage(
+	const unsigned char*			bgr,
+	const int					stride,
+	const int					width,
+	const int					height,
+	int*						klabels,
+	int&						numlabels,
+        const int&					superpixelstep,
+        const float&                                   compactness,
+        const bool&                                     perturbseeds,
+        const int                                       iterations,
+        const int                                       color)
+{
+	const int STEP = superpixelstep;
+	const int sz = width*height;
+
+	m_width  = width;
+	m_height = height;
+	//--------------------------------------------------
+	ReserveLabBuffers(sz);
+	ConvertBGRImage(bgr, stride, width, height, m_lvec, m_avec, m_bvec, color);
+	//--------------------------------------------------
+	if(perturbseeds)
+	{
+		m_edgemag.assign(sz, 0);
+		DetectLabEdges(m_lvec, m_avec, m_bvec, m_width, m_height, m_edgemag);
+	}
+	SegmentLabBuffers(klabels, numlabels, STEP, compactness, perturbseeds, iterations);
+}
+
+//===========================================================================
+///	DoSuperpixelSegmentation_ForLabImage
+///
+/// Same as DoSuperpixelSegmentation_ForBGRImage, but the planes (and, if
+/// given, the edges) are copied from a previous conversion instead of being
+/// recomputed.
+//===========================================================================
+void SLIC::DoSuperpixelSegmentation_ForLabImage(
+	const float*				lvec,
+	const float*				avec,
+	const float*				bvec,
+	const float*				edgemag,
+	const int					width,
+	const int					height,
+	int*						klabels,
+	int&						numlabels,
+        const int&					superpixelstep,
+        const float&                                   compactness,
+        const bool&                                     perturbseeds,
+        const int                                       iterations)
+{
+	const int STEP = superpixelstep;
+	const int sz = width*height;
+
+	m_width  = width;
+	m_height = height;
+	//--------------------------------------------------
+	ReserveLabBuffers(sz);
+	std::copy(lvec, lvec + sz, m_lvec);
+	std::copy(avec, avec + sz, m_avec);
+	std::copy(bvec, bvec + sz, m_bvec);
+	//--------------------------------------------------
+	if(perturbseeds)
+	{
+		if(edgemag)
+		{
+			m_edgemag.assign(edgemag, edgemag + sz);
+		}
+		else
+		{
+			m_edgemag.assign(sz, 0);
+			DetectLabEdges(m_lvec, m_avec, m_bvec, m_width, m_height, m_edgemag);
+		}
+	}
+	SegmentLabBuffers(klabels, numlabels, STEP, compactness, perturbseeds, iterations);
+}
+
+//===========================================================================
+///	SegmentLabBuffers
+//===========================================================================
+void SLIC::SegmentLabBuffers(
+	int*						klabels,
+	int&						numlabels,
+	const int					STEP,
+	const float					compactness,
+	const bool					perturbseeds,
+	const int					iterations)
+{
+	const int sz = m_width*m_height;
+
+	GetLABXYSeeds_ForGivenStepSize(m_kseedsl, m_kseedsa, m_kseedsb, m_kseedsx, m_kseedsy, 
+		STEP, perturbseeds, m_edgemag);
+
+	m_rawlabels.assign(sz, -1);
+	int* rawlabels = &m_rawlabels[0];
+	PerformSuperpixelSLIC(m_kseedsl, m_kseedsa, m_kseedsb, m_kseedsx, m_kseedsy, 
+		rawlabels, STEP, m_edgemag, compactness, iterations);
+	numlabels = m_kseedsl.size();
+
+	int* nlabels = klabels;
+	EnforceLabelConnectivity(rawlabels, m_width, m_height, nlabels, numlabels, float(sz)/float(STEP*STEP));
+}
+
+//===========================================================================
+///	ConvertBGRImage
+//===========================================================================
+void SLIC::ConvertBGRImage(
+	const unsigned char*			bgr,
+	const int					stride,
+	const int					width,
+	const int					height,
+	float*						lvec,
+	float*						avec,
+	float*						bvec,
+	const int					color)
+{
+	for( int j = 0; j < height; j++ )
+	{
+		const unsigned char* row = bgr + j*(size_t)stride;
+		int i = j*width;
+
+		if(color > 0)//LAB, the default option
+		{
+			ColorConversion::BGR2Lab(row, lvec + i, avec + i, bvec + i, width);
+		}
+		else//RGB
+		{
+			for( int k = 0; k < width; k++ )
+			{
+				lvec[i + k] = row[3*k + 2];
+				avec[i + k] = row[3*k + 1];
+				bvec[i + k] = row[3*k + 0];
+			}
+		}
+	}
+}
+
+//===========================================================================
+///	ReserveLabBuffers
+///
+/// The Lab buffers are kept as long as the image size does not change and
+/// no other segmentation function replaced them with its own buffers.
+//===========================================================================
+void SLIC::ReserveLabBuffers(const int sz)
+{
+	if( m_buffersize != sz || m_lvec != m_reusedlvec )
+	{
+		if(m_lvec) delete [] m_lvec;
+		if(m_avec) delete [] m_avec;
+		if(m_bvec) delete [] m_bvec;
+
+		m_lvec = new float[sz];
+		m_avec = new float[sz];
+		m_bvec = new float[sz];
+		m_reusedlvec = m_lvec;
+		m_buffersize = sz;
+	}
+}
+
 //===========================================================================
 ///	Do3DSupervixelSegmentation_ForGivenSuperpixelSize
 ///
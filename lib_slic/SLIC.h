@@ -71,6 +71,90 @@ public:
                 const int                                       iterations = 10,
                 const int                                       color = 1);
 	//============================================================================
+	// Superpixel segmentation of the next frame of a video for a given step size;
+	// starts from the centroids of the previous frame and runs warmiterations
+	// (the first frame, or after ResetVideo, starts from the grid and runs
+	// iterations). klabels has to hold width*height labels.
+	//============================================================================
+        void DoSuperpixelSegmentation_ForVideoFrame(
+                const unsigned int*                             ubuff,//Each 32 bit unsigned int contains ARGB pixel values.
+		const int					width,
+		const int					height,
+		int*						klabels,
+		int&						numlabels,
+                const int&					superpixelstep,
+                const float&                                   compactness,
+                const bool&                                     perturbseeds = false,
+                const int                                       iterations = 10,
+                const int                                       warmiterations = 2,
+                const int                                       color = 1);
+	//============================================================================
+	// Forget the previous frame; the next frame starts from the grid again
+	//============================================================================
+	void ResetVideo();
+	//============================================================================
+	// Superpixel segmentation of an interleaved 8-bit BGR image (rows stride
+	// bytes apart) for a given step size; the Lab buffers, seeds and all
+	// intermediate buffers are kept and reused by the next call, so repeated
+	// calls on images of the same size do not allocate. klabels has to hold
+	// width*height labels.
+	//============================================================================
+	void DoSuperpixelSegmentation_ForBGRImage(
+		const unsigned char*				bgr,
+		const int					stride,
+		const int					width,
+		const int					height,
+		int*						klabels,
+		int&						numlabels,
+                const int&					superpixelstep,
+                const float&                                   compactness,
+                const bool&                                     perturbseeds = false,
+                const int                                       iterations = 10,
+                const int                                       color = 1);
+	//============================================================================
+	// Same as DoSuperpixelSegmentation_ForBGRImage, but starts from Lab (or
+	// RGB) planes computed before, e.g. by ConvertBGRImage; edgemag are the
+	// edges computed by DetectLabEdges and may be NULL, in which case they are
+	// recomputed if perturbseeds is set. Used to share the preprocessing
+	// between runs on the same image.
+	//============================================================================
+	void DoSuperpixelSegmentation_ForLabImage(
+		const float*				lvec,
+		const float*				avec,
+		const float*				bvec,
+		const float*				edgemag,
+		const int					width,
+		const int					height,
+		int*						klabels,
+		int&						numlabels,
+                const int&					superpixelstep,
+                const float&                                   compactness,
+                const bool&                                     perturbseeds = false,
+                const int                                       iterations = 10);
+	//============================================================================
+	// Convert an interleaved 8-bit BGR image (rows stride bytes apart) to the
+	// planes used by SLIC: Lab if color > 0, RGB otherwise
+	//============================================================================
+	static void ConvertBGRImage(
+		const unsigned char*				bgr,
+		const int					stride,
+		const int					width,
+		const int					height,
+		float*						lvec,
+		float*						avec,
+		float*						bvec,
+		const int					color = 1);
+	//============================================================================
+	// Detect color edges, to help PerturbSeeds()
+	//============================================================================
+	static void DetectLabEdges(
+		const float*				lvec,
+		const float*				avec,
+		const float*				bvec,
+		const int&					width,
+		const int&					height,
+		vector<float>&				edges);
+	//============================================================================
 	// Superpixel segmentation for a given number of superpixels
 	//============================================================================
         void DoSuperpixelSegmentation_ForGivenNumberOfSuperpixels(
@@ -179,6 +263,23 @@ public:
 		const int&					height,
 		const unsigned int&			color );
 
+	//============================================================================
+	// Number of threads used for superpixel segmentation, 0 for all cores
+	//============================================================================
+	void SetThreads(
+		const int					threads);
+	//============================================================================
+	// Stop iterating once no centroid moved more than displacement pixels and
+	// at most a fraction changed of the labels changed; negative to disable
+	//============================================================================
+	void SetConvergence(
+		const float					displacement,
+		const float					changed);
+	//============================================================================
+	// Number of iterations actually run by the last segmentation
+	//============================================================================
+	int GetIterations() const;
+
 private:
 	//============================================================================
 	// The main SLIC algorithm for generating superpixels
@@ -194,6 +295,36 @@ private:
                 const vector<float>&                   edgemag,
 		const float&				m = 10.0,
                 const int                               iterations = 10);
+	//============================================================================
+	// Assign the pixels in rows [ystart, yend) to the closest seed
+	//============================================================================
+	void AssignSuperpixelSeeds(
+		const vector<float>&		kseedsl,
+		const vector<float>&		kseedsa,
+		const vector<float>&		kseedsb,
+		const vector<float>&		kseedsx,
+		const vector<float>&		kseedsy,
+		int*					klabels,
+		vector<float>&			distvec,
+		const int&				offset,
+		const float&			invwt,
+		const int&				ystart,
+		const int&				yend);
+	//============================================================================
+	// Accumulate the centroid sums over the pixels in rows [ystart, yend);
+	// colors are summed in fixed point (see SLIC_COLOR_SCALE), so the sums
+	// are exact and do not depend on the order of accumulation
+	//============================================================================
+	void AccumulateSuperpixelSeeds(
+		const int*				klabels,
+		const int&				ystart,
+		const int&				yend,
+		long long*				sigmal,
+		long long*				sigmaa,
+		long long*				sigmab,
+		long long*				sigmax,
+		long long*				sigmay,
+		long long*				clustersize);
         //============================================================================
 	// The main SLIC algorithm for generating 3D supervoxels
 	//============================================================================
@@ -302,27 +433,7 @@ private:
                 vector<float>&				kseedsz,
 		const vector<float>&               edges);
 	//============================================================================
-	// Detect color edges, to help PerturbSeeds()
-	//============================================================================
-	void DetectLabEdges(
-		const float*				lvec,
-		const float*				avec,
-		const float*				bvec,
-		const int&					width,
-		const int&					height,
-		vector<float>&				edges);
-	//============================================================================
-	// sRGB to XYZ conversion; helper for RGB2LAB()
-	//============================================================================
-	void RGB2XYZ(
-		const int&					sR,
-		const int&					sG,
-		const int&					sB,
-		float&						X,
-		float&						Y,
-		float&						Z);
-	//============================================================================
-	// sRGB to CIELAB conversion (uses RGB2XYZ function)
+	// sRGB to CIELAB conversion (see color_conversion.h)
 	//============================================================================
 	void RGB2LAB(
 		const int&					sR,
@@ -332,6 +443,23 @@ private:
 		float&						aval,
 		float&						bval);
 	//============================================================================
+	// (Re-)allocate m_lvec, m_avec and m_bvec for sz pixels unless the buffers
+	// of the previous call to ReserveLabBuffers can be reused
+	//============================================================================
+	void ReserveLabBuffers(
+		const int					sz);
+	//============================================================================
+	// Seeding, clustering and connectivity on the filled Lab buffers; the
+	// edges in m_edgemag have to be computed if perturbseeds is set
+	//============================================================================
+	void SegmentLabBuffers(
+		int*						klabels,
+		int&						numlabels,
+		const int					STEP,
+		const float					compactness,
+		const bool					perturbseeds,
+		const int					iterations);
+	//============================================================================
 	// sRGB to CIELAB conversion for 2-D images
 	//============================================================================
 	void DoRGBtoLABConversion(
@@ -384,6 +512,47 @@ private:
 	float**						m_lvecvec;
 	float**						m_avecvec;
 	float**						m_bvecvec;
+
+	int							m_threads;
+	int							m_instruction_set;
+
+	float						m_max_displacement;
+	float						m_max_changed;
+	int							m_iterations;
+
+	// State of DoSuperpixelSegmentation_ForVideoFrame: centroids and raw labels
+	// of the previous frame and the initial seeds (used to re-seed empty clusters).
+	vector<float>				m_videoseedsl;
+	vector<float>				m_videoseedsa;
+	vector<float>				m_videoseedsb;
+	vector<float>				m_videoseedsx;
+	vector<float>				m_videoseedsy;
+	vector<float>				m_videogridx;
+	vector<float>				m_videogridy;
+	vector<int>					m_videolabels;
+	vector<int>					m_videocounts;
+	int							m_videostep;
+
+	// Lab buffers allocated by ReserveLabBuffers; the other segmentation
+	// functions allocate their own.
+	float*						m_reusedlvec;
+	int							m_buffersize;
+
+	// Seeds, labels and scratch buffers of PerformSuperpixelSLIC and
+	// EnforceLabelConnectivity, kept to avoid allocations on repeated calls.
+	vector<float>				m_kseedsl;
+	vector<float>				m_kseedsa;
+	vector<float>				m_kseedsb;
+	vector<float>				m_kseedsx;
+	vector<float>				m_kseedsy;
+	vector<int>					m_rawlabels;
+	vector<float>				m_edgemag;
+	vector<float>				m_distvec;
+	vector<double>				m_inv;
+	vector< vector<long long> >	m_partials;
+	vector<int>					m_previouslabels;
+	vector<int>					m_segmentx;
+	vector<int>					m_segmenty;
 };
 
 #endif // !defined(_SLIC_H_INCLUDED_)
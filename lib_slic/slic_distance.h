@@ -0,0 +1,260 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SLIC_DISTANCE_H
+#define	SLIC_DISTANCE_H
+
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SLIC_DISTANCE_X86
+#include <immintrin.h>
+#endif
+
+/** \brief Distance kernel of the SLIC assignment step, shared by SLIC and preSLIC.
+ * 
+ * For a row span of a seed window, computes the squared color plus weighted
+ * squared spatial distance of each pixel to the seed and updates distance and
+ * label where the seed is closer. The AVX2 and SSE variants process 8 and 4 
+ * pixels at once using the same operations in the same order as the scalar
+ * code, so all variants yield identical results. The variant is selected at 
+ * runtime based on the CPU.
+ * 
+ * \author David Stutz
+ */
+class SLICDistance {
+public:
+    
+    /** \brief Constant for the scalar fallback. */
+    static const int SCALAR = 0;
+    /** \brief Constant for SSE (4 pixels at once). */
+    static const int SSE = 1;
+    /** \brief Constant for AVX2 (8 pixels at once). */
+    static const int AVX2 = 2;
+    
+    /** \brief Get the best instruction set supported by the CPU.
+     * \return SCALAR, SSE or AVX2
+     */
+    static int getInstructionSet() {
+        static const int instruction_set = detectInstructionSet();
+        return instruction_set;
+    }
+    
+    /** \brief Assign the pixels [x1, x2) of a row to the given seed where it 
+     * is closer than the current assignment.
+     * \param[in] l first color channel of the row
+     * \param[in] a second color channel of the row
+     * \param[in] b third color channel of the row
+     * \param[in] x1 first column
+     * \param[in] x2 last column (exclusive)
+     * \param[in] y row
+     * \param[in] seedl first color channel of the seed
+     * \param[in] seeda second color channel of the seed
+     * \param[in] seedb third color channel of the seed
+     * \param[in] seedx column of the seed
+     * \param[in] seedy row of the seed
+     * \param[in] invwt weight of the spatial distance
+     * \param[in] label label of the seed
+     * \param[in,out] distvec distances of the row
+     * \param[in,out] klabels labels of the row
+     * \param[in] instruction_set SCALAR, SSE or AVX2
+     */
+    static void assignRow(const float* l, const float* a, const float* b, 
+            int x1, int x2, int y, float seedl, float seeda, float seedb, 
+            float seedx, float seedy, float invwt, int label, float* distvec, 
+            int* klabels, int instruction_set = getInstructionSet()) {
+        
+        float dy = y - seedy;
+        float dy2 = dy*dy;
+        
+        assignSpan(l, a, b, x1, x2, seedl, seeda, seedb, seedx, dy2, invwt, 
+                label, distvec, klabels, instruction_set);
+    }
+    
+    /** \brief Same as assignRow, but with the squared spatial distance 
+     * orthogonal to the row given, e.g. dy*dy + dz*dz for supervoxels.
+     * \param[in] l first color channel of the row
+     * \param[in] a second color channel of the row
+     * \param[in] b third color channel of the row
+     * \param[in] x1 first column
+     * \param[in] x2 last column (exclusive)
+     * \param[in] seedl first color channel of the seed
+     * \param[in] seeda second color channel of the seed
+     * \param[in] seedb third color channel of the seed
+     * \param[in] seedx column of the seed
+     * \param[in] dy2 squared distance of the row to the seed
+     * \param[in] invwt weight of the spatial distance
+     * \param[in] label label of the seed
+     * \param[in,out] distvec distances of the row
+     * \param[in,out] klabels labels of the row
+     * \param[in] instruction_set SCALAR, SSE or AVX2
+     */
+    static void assignSpan(const float* l, const float* a, const float* b, 
+            int x1, int x2, float seedl, float seeda, float seedb, float seedx, 
+            float dy2, float invwt, int label, float* distvec, int* klabels, 
+            int instruction_set = getInstructionSet()) {
+        
+#ifdef SLIC_DISTANCE_X86
+        if (instruction_set == AVX2) {
+            x1 = assignRowAVX2(l, a, b, x1, x2, dy2, seedl, seeda, seedb, 
+                    seedx, invwt, label, distvec, klabels);
+        }
+        else if (instruction_set == SSE) {
+            x1 = assignRowSSE(l, a, b, x1, x2, dy2, seedl, seeda, seedb, 
+                    seedx, invwt, label, distvec, klabels);
+        }
+#endif
+        
+        // Scalar fallback and remaining pixels.
+        for (int x = x1; x < x2; ++x) {
+            float dl = l[x] - seedl;
+            float da = a[x] - seeda;
+            float db = b[x] - seedb;
+            float dx = x - seedx;
+            
+            float dist = dl*dl + da*da + db*db;
+            float distxy = dx*dx + dy2;
+            
+            dist += distxy*invwt;
+            if (dist < distvec[x]) {
+                distvec[x] = dist;
+                klabels[x] = label;
+            }
+        }
+    }
+    
+protected:
+    
+    /** \brief Detect the best instruction set supported by the CPU.
+     * \return SCALAR, SSE or AVX2
+     */
+    static int detectInstructionSet() {
+#ifdef SLIC_DISTANCE_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return AVX2;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return SSE;
+        }
+#endif
+        return SCALAR;
+    }
+    
+#ifdef SLIC_DISTANCE_X86
+    /** \brief AVX2 variant of assignRow.
+     * \return first column not processed
+     */
+    __attribute__((target("avx2")))
+    static int assignRowAVX2(const float* l, const float* a, const float* b, 
+            int x1, int x2, float dy2, float seedl, float seeda, float seedb, 
+            float seedx, float invwt, int label, float* distvec, int* klabels) {
+        
+        const __m256 seedl_v = _mm256_set1_ps(seedl);
+        const __m256 seeda_v = _mm256_set1_ps(seeda);
+        const __m256 seedb_v = _mm256_set1_ps(seedb);
+        const __m256 seedx_v = _mm256_set1_ps(seedx);
+        const __m256 dy2_v = _mm256_set1_ps(dy2);
+        const __m256 invwt_v = _mm256_set1_ps(invwt);
+        const __m256 label_v = _mm256_castsi256_ps(_mm256_set1_epi32(label));
+        const __m256 step_v = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+        
+        int x = x1;
+        for (; x + 8 <= x2; x += 8) {
+            __m256 dl = _mm256_sub_ps(_mm256_loadu_ps(l + x), seedl_v);
+            __m256 da = _mm256_sub_ps(_mm256_loadu_ps(a + x), seeda_v);
+            __m256 db = _mm256_sub_ps(_mm256_loadu_ps(b + x), seedb_v);
+            __m256 dx = _mm256_sub_ps(_mm256_add_ps(_mm256_set1_ps((float) x), step_v), seedx_v);
+            
+            __m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dl, dl), 
+                    _mm256_mul_ps(da, da)), _mm256_mul_ps(db, db));
+            __m256 distxy = _mm256_add_ps(_mm256_mul_ps(dx, dx), dy2_v);
+            dist = _mm256_add_ps(dist, _mm256_mul_ps(distxy, invwt_v));
+            
+            __m256 old_dist = _mm256_loadu_ps(distvec + x);
+            __m256 old_labels = _mm256_loadu_ps((const float*) (klabels + x));
+            __m256 mask = _mm256_cmp_ps(dist, old_dist, _CMP_LT_OQ);
+            
+            _mm256_storeu_ps(distvec + x, _mm256_blendv_ps(old_dist, dist, mask));
+            _mm256_storeu_ps((float*) (klabels + x), _mm256_blendv_ps(old_labels, label_v, mask));
+        }
+        
+        return x;
+    }
+    
+    /** \brief SSE variant of assignRow.
+     * \return first column not processed
+     */
+    __attribute__((target("sse2")))
+    static int assignRowSSE(const float* l, const float* a, const float* b, 
+            int x1, int x2, float dy2, float seedl, float seeda, float seedb, 
+            float seedx, float invwt, int label, float* distvec, int* klabels) {
+        
+        const __m128 seedl_v = _mm_set1_ps(seedl);
+        const __m128 seeda_v = _mm_set1_ps(seeda);
+        const __m128 seedb_v = _mm_set1_ps(seedb);
+        const __m128 seedx_v = _mm_set1_ps(seedx);
+        const __m128 dy2_v = _mm_set1_ps(dy2);
+        const __m128 invwt_v = _mm_set1_ps(invwt);
+        const __m128 label_v = _mm_castsi128_ps(_mm_set1_epi32(label));
+        const __m128 step_v = _mm_setr_ps(0, 1, 2, 3);
+        
+        int x = x1;
+        for (; x + 4 <= x2; x += 4) {
+            __m128 dl = _mm_sub_ps(_mm_loadu_ps(l + x), seedl_v);
+            __m128 da = _mm_sub_ps(_mm_loadu_ps(a + x), seeda_v);
+            __m128 db = _mm_sub_ps(_mm_loadu_ps(b + x), seedb_v);
+            __m128 dx = _mm_sub_ps(_mm_add_ps(_mm_set1_ps((float) x), step_v), seedx_v);
+            
+            __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dl, dl), 
+                    _mm_mul_ps(da, da)), _mm_mul_ps(db, db));
+            __m128 distxy = _mm_add_ps(_mm_mul_ps(dx, dx), dy2_v);
+            dist = _mm_add_ps(dist, _mm_mul_ps(distxy, invwt_v));
+            
+            __m128 old_dist = _mm_loadu_ps(distvec + x);
+            __m128 old_labels = _mm_loadu_ps((const float*) (klabels + x));
+            __m128 mask = _mm_cmplt_ps(dist, old_dist);
+            
+            // SSE2 has no blend instruction.
+            _mm_storeu_ps(distvec + x, _mm_or_ps(_mm_and_ps(mask, dist), 
+                    _mm_andnot_ps(mask, old_dist)));
+            _mm_storeu_ps((float*) (klabels + x), _mm_or_ps(_mm_and_ps(mask, label_v), 
+                    _mm_andnot_ps(mask, old_labels)));
+        }
+        
+        return x;
+    }
+#endif
+    
+};
+
+#endif	/* SLIC_DISTANCE_H */
+
@@ -29,48 +29,248 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cstring>
+#include <glog/logging.h>
 #include "SLIC.h"
 #include "slic_opencv.h"
 
-void SLIC_OpenCV::computeSuperpixels(const cv::Mat &mat, int region_size, 
+int SLIC_OpenCV::computeSuperpixels(const cv::Mat &mat, int region_size, 
         double compactness, int iterations, bool perturb_seeds, 
-        int color_space, cv::Mat &labels) {
+        int color_space, cv::Mat &labels, int threads, float displacement, 
+        float changed) {
     
-    // Convert matrix to unsigned int array.
-    unsigned int* image = new unsigned int[mat.rows*mat.cols];
-    unsigned int value = 0x0000;
+    SLICContext_OpenCV context(threads);
+    context.setConvergence(displacement, changed);
+    
+    return context.computeSuperpixels(mat, region_size, compactness, 
+            iterations, perturb_seeds, color_space, labels);
+}
+
+SLICCache_OpenCV::SLICCache_OpenCV(int capacity) 
+    : capacity(capacity), hits(0), misses(0) {
+    
+}
+
+std::shared_ptr<const SLICCache_OpenCV::Entry> SLICCache_OpenCV::get(
+        const cv::Mat &image, int color_space) {
+    
+    std::pair<uint64_t, int> key(hash(image), color_space > 0 ? 1 : 0);
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        
+        std::map<std::pair<uint64_t, int>, std::shared_ptr<const Entry>>::const_iterator 
+                it = entries.find(key);
+        if (it != entries.end() && equals(it->second->image, image)) {
+            ++hits;
+            return it->second;
+        }
+        
+        ++misses;
+    }
+    
+    // Preprocess outside the lock; if two threads miss on the same image,
+    // both compute it and the first one is kept.
+    std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+    entry->image = image.clone();
+    entry->width = image.cols;
+    entry->height = image.rows;
+    entry->L.resize(image.rows*image.cols);
+    entry->A.resize(image.rows*image.cols);
+    entry->B.resize(image.rows*image.cols);
+    entry->edges.assign(image.rows*image.cols, 0);
+    
+    SLIC::ConvertBGRImage(image.ptr<unsigned char>(0), image.step, 
+            image.cols, image.rows, &entry->L[0], &entry->A[0], &entry->B[0], 
+            color_space);
+    SLIC::DetectLabEdges(&entry->L[0], &entry->A[0], &entry->B[0], 
+            image.cols, image.rows, entry->edges);
+    
+    // On a hash collision the entry already stored is kept.
+    std::lock_guard<std::mutex> lock(mutex);
+    if (capacity <= 0 || static_cast<int>(entries.size()) < capacity) {
+        std::shared_ptr<const Entry> stored = entries.insert(std::make_pair(key, entry)).first->second;
+        if (equals(stored->image, image)) {
+            return stored;
+        }
+    }
+    
+    return entry;
+}
 
-    for (int i = 0; i < mat.rows; ++i) {
-        for (int j = 0; j < mat.cols; ++j) {
+void SLICCache_OpenCV::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+}
 
-            int b = mat.at<cv::Vec3b>(i,j)[0];
-            int g = mat.at<cv::Vec3b>(i,j)[1];
-            int r = mat.at<cv::Vec3b>(i,j)[2];
+int SLICCache_OpenCV::getHits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hits;
+}
 
-            value = 0x0000;
-            value |= (0xFF000000);
-            value |= (0x00FF0000 & (r << 16));
-            value |= (0x0000FF00 & (g << 8));
-            value |= (0x000000FF & b);
+int SLICCache_OpenCV::getMisses() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return misses;
+}
 
-            image[j + mat.cols*i] = value;
+uint64_t SLICCache_OpenCV::hash(const cv::Mat &image) {
+    
+    // FNV-1a over 8-byte words (and the remaining bytes of each row), seeded
+    // with the image size and type; each word is multiplied and the state
+    // rotated so that the high bits of the words also reach the low bits.
+    // Equal hashes are still verified against the image content in get().
+    const uint64_t prime = 1099511628211ull;
+    const uint64_t golden = 0x9E3779B97F4A7C15ull;
+    uint64_t h = 14695981039346656037ull;
+    
+    h = (h ^ static_cast<uint64_t>(image.rows)) * prime;
+    h = (h ^ static_cast<uint64_t>(image.cols)) * prime;
+    h = (h ^ static_cast<uint64_t>(image.type())) * prime;
+    
+    const size_t bytes = image.cols*image.elemSize();
+    for (int i = 0; i < image.rows; ++i) {
+        const unsigned char* row = image.ptr<unsigned char>(i);
+        
+        size_t k = 0;
+        for (; k + 8 <= bytes; k += 8) {
+            uint64_t word;
+            std::memcpy(&word, row + k, 8);
+            h ^= word*golden;
+            h = ((h << 27) | (h >> 37))*prime;
+        }
+        
+        for (; k < bytes; ++k) {
+            h = (h ^ row[k]) * prime;
         }
     }
+    
+    // Final avalanche (from MurmurHash3).
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    
+    return h;
+}
 
-    SLIC slic;
+bool SLICCache_OpenCV::equals(const cv::Mat &a, const cv::Mat &b) {
+    
+    if (a.rows != b.rows || a.cols != b.cols || a.type() != b.type()) {
+        return false;
+    }
+    
+    const size_t bytes = a.cols*a.elemSize();
+    for (int i = 0; i < a.rows; ++i) {
+        if (std::memcmp(a.ptr<unsigned char>(i), b.ptr<unsigned char>(i), bytes) != 0) {
+            return false;
+        }
+    }
+    
+    return true;
+}
 
-    int* segmentation = new int[mat.rows*mat.cols];
+SLICContext_OpenCV::SLICContext_OpenCV(int threads) 
+    : slic(new SLIC()), cache(NULL) {
+    
+    slic->SetThreads(threads);
+}
+
+SLICContext_OpenCV::~SLICContext_OpenCV() {
+    
+}
+
+void SLICContext_OpenCV::setConvergence(float displacement, float changed) {
+    slic->SetConvergence(displacement, changed);
+}
+
+void SLICContext_OpenCV::setCache(SLICCache_OpenCV* cache) {
+    this->cache = cache;
+}
+
+int SLICContext_OpenCV::computeSuperpixels(const cv::Mat &image, 
+        int region_size, double compactness, int iterations, 
+        bool perturb_seeds, int color_space, cv::Mat &labels) {
+    
+    LOG_IF(FATAL, image.type() != CV_8UC3) << "Expected CV_8UC3 image.";
+    
+    // Labels are written directly into the matrix, which is only reallocated 
+    // if the image size changes or it is not continuous (e.g. a ROI).
+    labels.create(image.rows, image.cols, CV_32SC1);
+    if (!labels.isContinuous()) {
+        labels = cv::Mat(image.rows, image.cols, CV_32SC1);
+    }
+    
     int number_of_labels = 0;
+    if (cache != NULL) {
+        std::shared_ptr<const SLICCache_OpenCV::Entry> entry = cache->get(image, color_space);
+        slic->DoSuperpixelSegmentation_ForLabImage(&entry->L[0], &entry->A[0], 
+                &entry->B[0], &entry->edges[0], image.cols, image.rows, 
+                labels.ptr<int>(0), number_of_labels, region_size, 
+                compactness, perturb_seeds, iterations);
+    }
+    else {
+        slic->DoSuperpixelSegmentation_ForBGRImage(image.ptr<unsigned char>(0), 
+                image.step, image.cols, image.rows, labels.ptr<int>(0), 
+                number_of_labels, region_size, compactness, perturb_seeds, 
+                iterations, color_space);
+    }
+    
+    return slic->GetIterations();
+}
+
+SLICVideo_OpenCV::SLICVideo_OpenCV(double compactness, int iterations, 
+        int warm_iterations, bool perturb_seeds, int color_space, int threads, 
+        int key_frames) 
+    : slic(new SLIC()), compactness(compactness), iterations(iterations), 
+        warm_iterations(warm_iterations), 
+        perturb_seeds(perturb_seeds), color_space(color_space), 
+        key_frames(key_frames), frames(0) {
+    
+    slic->SetThreads(threads);
+}
+
+SLICVideo_OpenCV::~SLICVideo_OpenCV() {
+    
+}
 
-    slic.DoSuperpixelSegmentation_ForGivenSuperpixelStep(image, mat.cols, 
-            mat.rows, segmentation, number_of_labels, region_size, 
-            compactness, perturb_seeds, iterations, color_space);
+void SLICVideo_OpenCV::setConvergence(float displacement, float changed) {
+    slic->SetConvergence(displacement, changed);
+}
 
-    // Convert labels.
-    labels.create(mat.rows, mat.cols, CV_32SC1);
-    for (int i = 0; i < mat.rows; ++i) {
-        for (int j = 0; j < mat.cols; ++j) {
-            labels.at<int>(i, j) = segmentation[j + i*mat.cols];
+int SLICVideo_OpenCV::computeSuperpixels(const cv::Mat &frame, 
+        int region_size, cv::Mat &labels) {
+    
+    LOG_IF(FATAL, frame.type() != CV_8UC3) << "Expected CV_8UC3 frame.";
+    
+    if (key_frames > 0 && frames%key_frames == 0) {
+        slic->ResetVideo();
+    }
+    
+    image.resize(frame.rows*frame.cols);
+    for (int i = 0; i < frame.rows; ++i) {
+        const cv::Vec3b* row = frame.ptr<cv::Vec3b>(i);
+        unsigned int* packed = &image[i*frame.cols];
+        
+        for (int j = 0; j < frame.cols; ++j) {
+            packed[j] = 0xFF000000 | (row[j][2] << 16) | (row[j][1] << 8) | row[j][0];
         }
     }
-}
\ No newline at end of file
+    
+    // Labels are written directly into the matrix, which is only reallocated 
+    // if the frame size changes or it is not continuous (e.g. a ROI).
+    labels.create(frame.rows, frame.cols, CV_32SC1);
+    if (!labels.isContinuous()) {
+        labels = cv::Mat(frame.rows, frame.cols, CV_32SC1);
+    }
+    
+    int number_of_labels = 0;
+    slic->DoSuperpixelSegmentation_ForVideoFrame(&image[0], frame.cols, 
+            frame.rows, labels.ptr<int>(0), number_of_labels, region_size, 
+            compactness, perturb_seeds, iterations, warm_iterations, color_space);
+    
+    ++frames;
+    return slic->GetIterations();
+}
+
+void SLICVideo_OpenCV::reset() {
+    slic->ResetVideo();
+}
@@ -32,8 +32,15 @@
 #ifndef SLIC_OPENCV_H
 #define	SLIC_OPENCV_H
 
+#include <vector>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <cstdint>
 #include <opencv2/opencv.hpp>
 
+class SLIC;
+
 /** \brief Wrapper for running SLIC on OpenCV images.
  * \author David Stutz
  */
@@ -47,10 +54,225 @@ public:
      * \param[in] perturb_seeds whether to perturb seeds for better performance
      * \param[in] color_space color space to use, > 0 for Lab, 0 for RGB
      * \param[out] labels superpixel labels
+     * \param[in] threads number of threads for the assignment and update steps, 0 for all cores
+     * \param[in] displacement stop early once no centroid moves more than this many pixels, negative to disable
+     * \param[in] changed stop early once at most this fraction of labels changes, negative to disable
+     * \return number of iterations actually run
+     */
+    static int computeSuperpixels(const cv::Mat &image, int region_size, 
+            double compactness, int iterations, bool perturb_seeds, 
+            int color_space, cv::Mat &labels, int threads = 1, 
+            float displacement = -1, float changed = -1);
+};
+
+/** \brief In-memory cache of the SLIC preprocessing, i.e. the Lab (or RGB)
+ * planes and the edge magnitude used to perturb the seeds, keyed by a hash
+ * of the image content and the color space; a copy of the image is kept per
+ * entry to verify hits.
+ * 
+ * Meant for parameter sweeps, where the same images are segmented once per
+ * parameter combination: with a cache attached to SLICContext_OpenCV, the
+ * conversion and edge detection are paid once per image. The cache can be
+ * shared between threads.
+ * 
+ * \author David Stutz
+ */
+class SLICCache_OpenCV {
+public:
+    /** \brief Preprocessed image. */
+    struct Entry {
+        /** \brief Copy of the image, compared on lookups to rule out hash collisions. */
+        cv::Mat image;
+        /** \brief Image width. */
+        int width;
+        /** \brief Image height. */
+        int height;
+        /** \brief L (or R) plane. */
+        std::vector<float> L;
+        /** \brief a (or G) plane. */
+        std::vector<float> A;
+        /** \brief b (or B) plane. */
+        std::vector<float> B;
+        /** \brief Edge magnitude, see SLIC::DetectLabEdges. */
+        std::vector<float> edges;
+    };
+    
+    /** \brief Constructor.
+     * \param[in] capacity maximum number of images to keep, 0 for no limit;
+     * once full, further images are preprocessed but not stored, so a sweep
+     * cycling over more images than fit keeps hitting the first ones instead
+     * of evicting every entry before it is reused
+     */
+    SLICCache_OpenCV(int capacity = 0);
+    
+    /** \brief Get the preprocessed image, computing it if not cached.
+     * \param[in] image CV_8UC3 image
+     * \param[in] color_space color space, > 0 for Lab, 0 for RGB
+     * \return preprocessed image
+     */
+    std::shared_ptr<const Entry> get(const cv::Mat &image, int color_space);
+    
+    /** \brief Remove all entries. */
+    void clear();
+    
+    /** \brief Get the number of lookups answered from the cache.
+     * \return hits
+     */
+    int getHits() const;
+    
+    /** \brief Get the number of lookups that had to preprocess the image.
+     * \return misses
+     */
+    int getMisses() const;
+    
+    /** \brief Hash the image content (including its size).
+     * \param[in] image image to hash
+     * \return 64-bit hash
+     */
+    static uint64_t hash(const cv::Mat &image);
+    
+    /** \brief Check whether two images have the same size, type and content.
+     * \param[in] a first image
+     * \param[in] b second image
+     * \return whether the images are equal
+     */
+    static bool equals(const cv::Mat &a, const cv::Mat &b);
+    
+protected:
+    
+    /** \brief Maximum number of entries, 0 for no limit. */
+    int capacity;
+    /** \brief Entries by image hash and color space. */
+    std::map<std::pair<uint64_t, int>, std::shared_ptr<const Entry>> entries;
+    /** \brief Guards entries and the counters. */
+    mutable std::mutex mutex;
+    /** \brief Hits. */
+    int hits;
+    /** \brief Misses. */
+    int misses;
+    
+};
+
+/** \brief Reusable context for running SLIC on many images.
+ * 
+ * Owns a SLIC instance whose Lab planes, distances, seeds, labels and scratch
+ * buffers are kept between calls; as long as the image size does not change,
+ * computeSuperpixels does not allocate. The image is read directly from the
+ * cv::Mat and the labels are written in place.
+ * 
+ * \author David Stutz
+ */
+class SLICContext_OpenCV {
+public:
+    /** \brief Constructor.
+     * \param[in] threads number of threads for the assignment and update steps, 0 for all cores
      */
-    static void computeSuperpixels(const cv::Mat &image, int region_size, 
+    SLICContext_OpenCV(int threads = 1);
+    
+    /** \brief Destructor. */
+    ~SLICContext_OpenCV();
+    
+    /** \brief Set the convergence criterion, see SLIC_OpenCV::computeSuperpixels.
+     * \param[in] displacement stop early once no centroid moves more than this many pixels, negative to disable
+     * \param[in] changed stop early once at most this fraction of labels changes, negative to disable
+     */
+    void setConvergence(float displacement, float changed);
+    
+    /** \brief Take the Lab planes and edges from the given cache instead of
+     * recomputing them for every call.
+     * \param[in] cache cache to use, not owned, NULL to disable
+     */
+    void setCache(SLICCache_OpenCV* cache);
+    
+    /** \brief Compute superpixels using SLIC.
+     * \param[in] image CV_8UC3 image to compute superpixels on
+     * \param[in] region_size size between superpixels implicitly defining number of superpixels
+     * \param[in] compactness compactness parameter
+     * \param[in] iterations number of iterations
+     * \param[in] perturb_seeds whether to perturb seeds for better performance
+     * \param[in] color_space color space to use, > 0 for Lab, 0 for RGB
+     * \param[out] labels superpixel labels, only reallocated if the size changes
+     * \return number of iterations actually run
+     */
+    int computeSuperpixels(const cv::Mat &image, int region_size, 
             double compactness, int iterations, bool perturb_seeds, 
             int color_space, cv::Mat &labels);
+    
+protected:
+    
+    /** \brief SLIC instance holding the buffers; not copyable. */
+    std::unique_ptr<SLIC> slic;
+    /** \brief Preprocessing cache, not owned. */
+    SLICCache_OpenCV* cache;
+    
+};
+
+/** \brief Wrapper for running SLIC on consecutive video frames.
+ * 
+ * Keeps the SLIC state between frames: each frame after the first starts from
+ * the centroids of the previous frame and only runs a few iterations; the Lab
+ * buffers, seeds and the packed image are reused as long as the frame size
+ * does not change.
+ * 
+ * \author David Stutz
+ */
+class SLICVideo_OpenCV {
+public:
+    /** \brief Constructor.
+     * \param[in] compactness compactness parameter
+     * \param[in] iterations number of iterations on the first frame (and on key frames)
+     * \param[in] warm_iterations number of iterations on the following frames
+     * \param[in] perturb_seeds whether to perturb seeds on the first frame
+     * \param[in] color_space color space to use, > 0 for Lab, 0 for RGB
+     * \param[in] threads number of threads for the assignment and update steps, 0 for all cores
+     * \param[in] key_frames start from the grid again every key_frames frames, 0 to never restart
+     */
+    SLICVideo_OpenCV(double compactness, int iterations, 
+            int warm_iterations, bool perturb_seeds, int color_space, 
+            int threads = 1, int key_frames = 0);
+    
+    /** \brief Destructor. */
+    ~SLICVideo_OpenCV();
+    
+    /** \brief Set the convergence criterion, see SLIC_OpenCV::computeSuperpixels.
+     * \param[in] displacement stop early once no centroid moves more than this many pixels, negative to disable
+     * \param[in] changed stop early once at most this fraction of labels changes, negative to disable
+     */
+    void setConvergence(float displacement, float changed);
+    
+    /** \brief Compute superpixels on the next frame; a different region size
+     * or frame size starts from the grid again.
+     * \param[in] frame frame to compute superpixels on
+     * \param[in] region_size size between superpixels implicitly defining number of superpixels
+     * \param[out] labels superpixel labels
+     * \return number of iterations actually run
+     */
+    int computeSuperpixels(const cv::Mat &frame, int region_size, cv::Mat &labels);
+    
+    /** \brief Start from the grid again on the next frame, e.g. after a cut. */
+    void reset();
+    
+protected:
+    
+    /** \brief SLIC instance kept across frames; not copyable. */
+    std::unique_ptr<SLIC> slic;
+    /** \brief Packed frame, reused across frames. */
+    std::vector<unsigned int> image;
+    /** \brief Compactness. */
+    double compactness;
+    /** \brief Iterations on the first frame. */
+    int iterations;
+    /** \brief Iterations on the following frames. */
+    int warm_iterations;
+    /** \brief Whether to perturb seeds. */
+    bool perturb_seeds;
+    /** \brief Color space. */
+    int color_space;
+    /** \brief Key frame interval. */
+    int key_frames;
+    /** \brief Number of frames processed. */
+    int frames;
+    
 };
 
 #endif	/* SLIC_OPENCV_H */
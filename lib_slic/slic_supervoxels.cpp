@@ -0,0 +1,394 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cfloat>
+#include <cmath>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include "color_conversion.h"
+#include "slic_distance.h"
+#include "slic_supervoxels.h"
+
+// Fixed point scale of the color sums (2^20), as in SLIC::PerformSuperpixelSLIC.
+static const float SUPERVOXEL_COLOR_SCALE = 1048576.0f;
+
+SLICSupervoxels::SLICSupervoxels(int step, float compactness, int iterations, 
+        int color_space, int threads) 
+    : step(std::max(1, step)), compactness(compactness), iterations(iterations), 
+        color_space(color_space), threads(threads), width(0), height(0), 
+        depth(0) {
+    
+    if (this->threads <= 0) {
+        this->threads = std::max(1, (int) std::thread::hardware_concurrency());
+    }
+    
+    instruction_set = SLICDistance::getInstructionSet();
+}
+
+int SLICSupervoxels::computeSupervoxels(const unsigned int* frames, int width, 
+        int height, int depth, int* labels) {
+    
+    this->width = width;
+    this->height = height;
+    this->depth = depth;
+    
+    // Buffers only grow, so slabs of the same size do not allocate.
+    int size = width*height*depth;
+    l.resize(size);
+    a.resize(size);
+    b.resize(size);
+    distances.resize(size);
+    raw_labels.resize(size);
+    
+    int num_threads = std::max(1, std::min(threads, depth));
+    partials.resize(num_threads);
+    
+    // Bands 1 to num_threads - 1 are processed by workers started once per
+    // slab, band 0 by the calling thread; each call of parallel sets the job
+    // and increments generation to start the workers.
+    std::function<void(int, int, int)> job;
+    std::mutex mutex;
+    std::condition_variable started;
+    std::condition_variable finished;
+    int generation = 0;
+    int pending = 0;
+    bool stop = false;
+    
+    auto band = [&](int t) {
+        job(t, (depth*t)/num_threads, (depth*(t + 1))/num_threads);
+    };
+    
+    std::vector<std::thread> workers;
+    for (int t = 1; t < num_threads; ++t) {
+        workers.push_back(std::thread([&, t]() {
+            int done = 0;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    started.wait(lock, [&]() { return stop || generation != done; });
+                    if (stop) {
+                        return;
+                    }
+                    done = generation;
+                }
+                
+                band(t);
+                
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--pending == 0) {
+                    finished.notify_one();
+                }
+            }
+        }));
+    }
+    
+    // Runs the given function on the frame bands in parallel.
+    auto parallel = [&](std::function<void(int, int, int)> function) {
+        job = function;
+        
+        if (num_threads > 1) {
+            std::lock_guard<std::mutex> lock(mutex);
+            generation++;
+            pending = num_threads - 1;
+            started.notify_all();
+        }
+        
+        band(0);
+        
+        if (num_threads > 1) {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&]() { return pending == 0; });
+        }
+    };
+    
+    parallel([&](int t, int zstart, int zend) {
+        convertFrames(frames, zstart, zend);
+    });
+    
+    initializeSeeds();
+    const int numk = seeds_l.size();
+    
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        parallel([&](int t, int zstart, int zend) {
+            assignVoxels(zstart, zend);
+            accumulateVoxels(zstart, zend, partials[t]);
+        });
+        
+        // The sums are integers, so the reduction is exact and the labels do
+        // not depend on the number of threads.
+        for (int k = 0; k < numk; ++k) {
+            long long sums[7] = {0, 0, 0, 0, 0, 0, 0};
+            for (int t = 0; t < num_threads; ++t) {
+                for (int c = 0; c < 7; ++c) {
+                    sums[c] += partials[t][7*k + c];
+                }
+            }
+            
+            // Empty supervoxels keep their seed.
+            if (sums[6] <= 0) {
+                continue;
+            }
+            
+            double inv = 1.0/sums[6];
+            seeds_l[k] = sums[0]*(inv/SUPERVOXEL_COLOR_SCALE);
+            seeds_a[k] = sums[1]*(inv/SUPERVOXEL_COLOR_SCALE);
+            seeds_b[k] = sums[2]*(inv/SUPERVOXEL_COLOR_SCALE);
+            seeds_x[k] = sums[3]*inv;
+            seeds_y[k] = sums[4]*inv;
+            seeds_z[k] = sums[5]*inv;
+        }
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+        started.notify_all();
+    }
+    for (unsigned int t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+    
+    return enforceConnectivity(labels);
+}
+
+void SLICSupervoxels::initializeSeeds() {
+    
+    // Same grid as SLIC::GetKValues_LABXYZ, but with at least one seed along
+    // each dimension to allow thin slabs.
+    int xstrips = std::max(1, (int) (0.5 + float(width)/float(step)));
+    int ystrips = std::max(1, (int) (0.5 + float(height)/float(step)));
+    int zstrips = std::max(1, (int) (0.5 + float(depth)/float(step)));
+    
+    int xerr = width - step*xstrips; if (xerr < 0 && xstrips > 1) { xstrips--; xerr = width - step*xstrips; }
+    int yerr = height - step*ystrips; if (yerr < 0 && ystrips > 1) { ystrips--; yerr = height - step*ystrips; }
+    int zerr = depth - step*zstrips; if (zerr < 0 && zstrips > 1) { zstrips--; zerr = depth - step*zstrips; }
+    
+    float xerrperstrip = float(xerr)/float(xstrips);
+    float yerrperstrip = float(yerr)/float(ystrips);
+    float zerrperstrip = float(zerr)/float(zstrips);
+    
+    int xoff = std::min(step/2, width/2);
+    int yoff = std::min(step/2, height/2);
+    int zoff = std::min(step/2, depth/2);
+    
+    int numk = xstrips*ystrips*zstrips;
+    seeds_l.resize(numk);
+    seeds_a.resize(numk);
+    seeds_b.resize(numk);
+    seeds_x.resize(numk);
+    seeds_y.resize(numk);
+    seeds_z.resize(numk);
+    
+    int n = 0;
+    for (int z = 0; z < zstrips; ++z) {
+        int d = std::min(depth - 1, (int) (z*step + zoff + z*zerrperstrip));
+        for (int y = 0; y < ystrips; ++y) {
+            int r = std::min(height - 1, (int) (y*step + yoff + y*yerrperstrip));
+            for (int x = 0; x < xstrips; ++x) {
+                int c = std::min(width - 1, (int) (x*step + xoff + x*xerrperstrip));
+                int i = (d*height + r)*width + c;
+                
+                seeds_l[n] = l[i];
+                seeds_a[n] = a[i];
+                seeds_b[n] = b[i];
+                seeds_x[n] = c;
+                seeds_y[n] = r;
+                seeds_z[n] = d;
+                n++;
+            }
+        }
+    }
+}
+
+void SLICSupervoxels::convertFrames(const unsigned int* frames, int zstart, 
+        int zend) {
+    
+    int sz = width*height;
+    int start = zstart*sz;
+    int end = zend*sz;
+    
+    if (color_space > 0) {
+        ColorConversion::ARGB2Lab(frames + start, &l[start], &a[start], 
+                &b[start], end - start);
+    }
+    else {
+        for (int i = start; i < end; ++i) {
+            l[i] = frames[i] >> 16 & 0xFF;
+            a[i] = frames[i] >>  8 & 0xFF;
+            b[i] = frames[i]       & 0xFF;
+        }
+    }
+}
+
+void SLICSupervoxels::assignVoxels(int zstart, int zend) {
+    
+    int sz = width*height;
+    std::fill(distances.begin() + zstart*sz, distances.begin() + zend*sz, FLT_MAX);
+    
+    const int numk = seeds_l.size();
+    const float offset = step;
+    const float invwt = 1.0/((step/compactness)*(step/compactness));
+    
+    for (int n = 0; n < numk; ++n) {
+        int z1 = std::max((float) zstart, std::max(0.0f, seeds_z[n] - offset));
+        int z2 = std::min((float) zend, std::min((float) depth, seeds_z[n] + offset));
+        if (z1 >= z2) {
+            continue;
+        }
+        
+        int y1 = std::max(0.0f, seeds_y[n] - offset);
+        int y2 = std::min((float) height, seeds_y[n] + offset);
+        int x1 = std::max(0.0f, seeds_x[n] - offset);
+        int x2 = std::min((float) width, seeds_x[n] + offset);
+        
+        for (int z = z1; z < z2; ++z) {
+            float dz = z - seeds_z[n];
+            float dz2 = dz*dz;
+            
+            for (int y = y1; y < y2; ++y) {
+                float dy = y - seeds_y[n];
+                int i = (z*height + y)*width;
+                
+                SLICDistance::assignSpan(&l[i], &a[i], &b[i], x1, x2, 
+                        seeds_l[n], seeds_a[n], seeds_b[n], seeds_x[n], 
+                        dy*dy + dz2, invwt, n, &distances[i], &raw_labels[i], 
+                        instruction_set);
+            }
+        }
+    }
+}
+
+void SLICSupervoxels::accumulateVoxels(int zstart, int zend, 
+        std::vector<long long> &sums) {
+    
+    sums.assign(7*seeds_l.size(), 0);
+    
+    for (int z = zstart; z < zend; ++z) {
+        for (int y = 0; y < height; ++y) {
+            int i = (z*height + y)*width;
+            
+            for (int x = 0; x < width; ++x, ++i) {
+                long long* sum = &sums[7*raw_labels[i]];
+                sum[0] += (long long) (l[i]*SUPERVOXEL_COLOR_SCALE);
+                sum[1] += (long long) (a[i]*SUPERVOXEL_COLOR_SCALE);
+                sum[2] += (long long) (b[i]*SUPERVOXEL_COLOR_SCALE);
+                sum[3] += x;
+                sum[4] += y;
+                sum[5] += z;
+                sum[6] += 1;
+            }
+        }
+    }
+}
+
+int SLICSupervoxels::enforceConnectivity(int* labels) {
+    
+    // 6-connectivity plus the in-plane diagonals, as in 
+    // SLIC::EnforceSupervoxelLabelConnectivity.
+    const int dx10[10] = {-1,  0,  1,  0, -1,  1,  1, -1,  0, 0};
+    const int dy10[10] = { 0, -1,  0,  1, -1, -1,  1,  1,  0, 0};
+    const int dz10[10] = { 0,  0,  0,  0,  0,  0,  0,  0, -1, 1};
+    
+    const int sz = width*height;
+    const int size = sz*depth;
+    const int minimum_size = (step*step*step) >> 2;
+    
+    std::fill(labels, labels + size, -1);
+    segment.resize(size);
+    
+    int label = 0;
+    int adjacent_label = 0;
+    
+    for (int i = 0; i < size; ++i) {
+        if (labels[i] >= 0) {
+            continue;
+        }
+        
+        int z = i/sz;
+        int y = (i%sz)/width;
+        int x = i%width;
+        
+        // Quickly find an adjacent label for use later if needed.
+        for (int n = 0; n < 10; ++n) {
+            int xx = x + dx10[n];
+            int yy = y + dy10[n];
+            int zz = z + dz10[n];
+            
+            if (xx >= 0 && xx < width && yy >= 0 && yy < height && zz >= 0 && zz < depth) {
+                int j = (zz*height + yy)*width + xx;
+                if (labels[j] >= 0) {
+                    adjacent_label = labels[j];
+                }
+            }
+        }
+        
+        labels[i] = label;
+        segment[0] = i;
+        int count = 1;
+        
+        for (int c = 0; c < count; ++c) {
+            int cz = segment[c]/sz;
+            int cy = (segment[c]%sz)/width;
+            int cx = segment[c]%width;
+            
+            for (int n = 0; n < 10; ++n) {
+                int xx = cx + dx10[n];
+                int yy = cy + dy10[n];
+                int zz = cz + dz10[n];
+                
+                if (xx >= 0 && xx < width && yy >= 0 && yy < height && zz >= 0 && zz < depth) {
+                    int j = (zz*height + yy)*width + xx;
+                    
+                    if (labels[j] < 0 && raw_labels[j] == raw_labels[i]) {
+                        labels[j] = label;
+                        segment[count] = j;
+                        count++;
+                    }
+                }
+            }
+        }
+        
+        // Merge small segments into the adjacent supervoxel found before.
+        if (count <= minimum_size && label > 0) {
+            for (int c = 0; c < count; ++c) {
+                labels[segment[c]] = adjacent_label;
+            }
+        }
+        else {
+            label++;
+        }
+    }
+    
+    return label;
+}
@@ -0,0 +1,155 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SLIC_SUPERVOXELS_H
+#define	SLIC_SUPERVOXELS_H
+
+#include <vector>
+
+/** \brief SLIC supervoxels on slabs of consecutive video frames.
+ * 
+ * Unlike SLIC::DoSupervoxelSegmentation, the volume is stored in contiguous
+ * planar arrays (frame-major, then row-major) that are allocated once and
+ * reused for every slab, so a long clip can be processed slab by slab with a
+ * memory footprint of about 28 bytes per voxel of a single slab. Within a
+ * slab, the frames are split into bands that are assigned and accumulated 
+ * in parallel by workers started once per slab; each band visits the seeds 
+ * in the same order as a single thread would and the centroid sums are 
+ * integers (fixed point colors), so the labels do not depend on the number
+ * of threads.
+ * 
+ * Supervoxels do not cross slab boundaries.
+ * 
+ * \author David Stutz
+ */
+class SLICSupervoxels {
+public:
+    
+    /** \brief Constructor.
+     * \param[in] step spacing of the seeds in x, y and t (supervoxel size ~= step^3)
+     * \param[in] compactness compactness parameter
+     * \param[in] iterations number of iterations
+     * \param[in] color_space color space to use, > 0 for Lab, 0 for RGB
+     * \param[in] threads number of threads, 0 for all cores
+     */
+    SLICSupervoxels(int step, float compactness, int iterations = 5, 
+            int color_space = 1, int threads = 1);
+    
+    /** \brief Compute supervoxels on a slab.
+     * \param[in] frames packed pixels (0x00RRGGBB) of depth frames, frame after frame
+     * \param[in] width width of the frames
+     * \param[in] height height of the frames
+     * \param[in] depth number of frames
+     * \param[out] labels width*height*depth labels, in the same order as frames
+     * \return number of supervoxels, the labels are in [0, number of supervoxels)
+     */
+    int computeSupervoxels(const unsigned int* frames, int width, int height, 
+            int depth, int* labels);
+    
+protected:
+    
+    /** \brief Place the seeds on a regular grid. */
+    void initializeSeeds();
+    
+    /** \brief Convert the frames [zstart, zend) to Lab (or RGB).
+     * \param[in] frames packed pixels
+     * \param[in] zstart first frame
+     * \param[in] zend last frame (exclusive)
+     */
+    void convertFrames(const unsigned int* frames, int zstart, int zend);
+    
+    /** \brief Assign the voxels of frames [zstart, zend) to the closest seed.
+     * \param[in] zstart first frame
+     * \param[in] zend last frame (exclusive)
+     */
+    void assignVoxels(int zstart, int zend);
+    
+    /** \brief Accumulate color, position and size of the supervoxels over 
+     * frames [zstart, zend).
+     * \param[in] zstart first frame
+     * \param[in] zend last frame (exclusive)
+     * \param[out] sums 7 sums (l, a, b, x, y, z, size) per seed; colors are
+     * summed in fixed point with 20 fractional bits, so the sums are exact
+     */
+    void accumulateVoxels(int zstart, int zend, std::vector<long long> &sums);
+    
+    /** \brief Relabel connected components and merge small ones into an 
+     * adjacent supervoxel.
+     * \param[out] labels connected labels
+     * \return number of supervoxels
+     */
+    int enforceConnectivity(int* labels);
+    
+    /** \brief Seed spacing. */
+    int step;
+    /** \brief Compactness. */
+    float compactness;
+    /** \brief Number of iterations. */
+    int iterations;
+    /** \brief Color space. */
+    int color_space;
+    /** \brief Number of threads. */
+    int threads;
+    /** \brief Instruction set of the distance kernel. */
+    int instruction_set;
+    
+    /** \brief Width of the current slab. */
+    int width;
+    /** \brief Height of the current slab. */
+    int height;
+    /** \brief Depth of the current slab. */
+    int depth;
+    
+    /** \brief Planar color channels of the slab. */
+    std::vector<float> l;
+    std::vector<float> a;
+    std::vector<float> b;
+    /** \brief Distance of each voxel to its seed. */
+    std::vector<float> distances;
+    /** \brief Labels before enforcing connectivity. */
+    std::vector<int> raw_labels;
+    /** \brief Voxels of the segment grown while enforcing connectivity. */
+    std::vector<int> segment;
+    
+    /** \brief Seeds: color, position and time. */
+    std::vector<float> seeds_l;
+    std::vector<float> seeds_a;
+    std::vector<float> seeds_b;
+    std::vector<float> seeds_x;
+    std::vector<float> seeds_y;
+    std::vector<float> seeds_z;
+    
+    /** \brief Partial sums of each band. */
+    std::vector< std::vector<long long> > partials;
+    
+};
+
+#endif	/* SLIC_SUPERVOXELS_H */
@@ -35,6 +35,7 @@
 #include<iostream>
 #include<fstream>
 #include<sstream>
+#include "color_conversion.h"
 
 #define MAX_RADIUS 9 // 3; the radius of neighborhood when calculating the length energy
 #define MAX_NUM_NEI_CLUSTER 400 // 200; the number of neighbor clusters
@@ -187,7 +188,6 @@ public:
     /********************************************************************************************************/
     void RGB2Lab(double vec[]){
             int i;
-            double index = 0.333333;
             double X, Y, Z, XT, YT, ZT,Y3, fx, fy, fz, inv1, inv2;
             inv1 = 1/0.950456;
             inv2 = 1/1.088754;
@@ -204,11 +204,11 @@ public:
             YT = (Y > 0.008856 ? 1 : 0);
             ZT = (Z > 0.008856 ? 1 : 0);
 
-            Y3 = pow(Y, index);
+            Y3 = ColorConversion::cbrt(Y);
 
-            fx = XT * pow(X, index) + (1 - XT) * (7.787 * X + 0.138);
+            fx = XT * ColorConversion::cbrt(X) + (1 - XT) * (7.787 * X + 0.138);
             fy = YT * Y3 + (1 - YT) * (7.787 * Y + 0.138);
-            fz = ZT * pow(Z, index) + (1 - ZT) * (7.787 * Z + 0.138);
+            fz = ZT * ColorConversion::cbrt(Z) + (1 - ZT) * (7.787 * Z + 0.138);
 
             vec[0] = YT * (116 * Y3 -16) + (1 - YT) * (903.3 * Y);
             vec[1] = 500 * (fx - fy);
@@ -74,6 +74,12 @@ After the k-means step, SLIC optionally
 removes any segment whose area is smaller than a threshld @c minRegionSize
 by merging them into larger ones.
 
+::vl_slic_segment_mt computes the edge map and runs the k-means
+assignment and update steps on several threads (see @ref threadpool.h).
+The work is split such that every sum is accumulated in the same order
+as in the single threaded case, so the segmentation does not depend on
+the number of threads.
+
 <!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
 @section slic-usage Usage from the C library
 <!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
@@ -144,9 +150,182 @@ except for the very first pixel).
 
 #include "slic.h"
 #include "mathop.h"
+#include "threadpool.h"
 #include <math.h>
 #include <string.h>
 
+/** @internal
+ ** @brief State shared by the threads of ::vl_slic_segment_mt
+ **/
+
+typedef struct _VlSlicJob
+{
+  vl_uint32 * segmentation ;
+  float const * image ;
+  vl_size width ;
+  vl_size height ;
+  vl_size numChannels ;
+  vl_size regionSize ;
+  vl_size numRegionsX ;
+  vl_size numRegionsY ;
+  float factor ;
+  float * edgeMap ;
+  float * distances ;
+  float * centers ;
+  vl_uint32 * masses ;
+} VlSlicJob ;
+
+#define atimage(x,y,k) image[(x)+(y)*width+(k)*width*height]
+#define atEdgeMap(x,y) edgeMap[(x)+(y)*width]
+
+/** @internal
+ ** @brief Compute the edge map on the rows of one thread
+ **/
+
+static void
+_vl_slic_edge_map (void * data, vl_size threadIndex, vl_size numThreads)
+{
+  VlSlicJob * job = (VlSlicJob *) data ;
+  float const * image = job->image ;
+  float * edgeMap = job->edgeMap ;
+  vl_size const width = job->width ;
+  vl_size const height = job->height ;
+  vl_index const ystart = VL_MAX(1, (signed)(height * threadIndex / numThreads)) ;
+  vl_index const yend = VL_MIN((signed)height-1, (signed)(height * (threadIndex + 1) / numThreads)) ;
+  vl_index x, y, k ;
+
+  for (k = 0 ; k < (signed)job->numChannels ; ++k) {
+    for (y = ystart ; y < yend ; ++y) {
+      for (x = 1 ; x < (signed)width-1 ; ++x) {
+        float a = atimage(x-1,y,k) ;
+        float b = atimage(x+1,y,k) ;
+        float c = atimage(x,y+1,k) ;
+        float d = atimage(x,y-1,k) ;
+        atEdgeMap(x,y) += (a - b)  * (a - b) + (c - d) * (c - d) ;
+      }
+    }
+  }
+}
+
+/** @internal
+ ** @brief Assign the pixels in the rows of one thread to centers
+ **
+ ** The distance of each pixel to its center is stored so that the
+ ** energy can be summed up in the original order afterwards.
+ **/
+
+static void
+_vl_slic_assign (void * data, vl_size threadIndex, vl_size numThreads)
+{
+  VlSlicJob * job = (VlSlicJob *) data ;
+  float const * image = job->image ;
+  float const * centers = job->centers ;
+  vl_uint32 * segmentation = job->segmentation ;
+  vl_size const width = job->width ;
+  vl_size const height = job->height ;
+  vl_size const numChannels = job->numChannels ;
+  vl_size const regionSize = job->regionSize ;
+  vl_size const numRegionsX = job->numRegionsX ;
+  vl_size const numRegionsY = job->numRegionsY ;
+  float const factor = job->factor ;
+  vl_index const ystart = height * threadIndex / numThreads ;
+  vl_index const yend = height * (threadIndex + 1) / numThreads ;
+  vl_index x, y, k ;
+
+  for (y = ystart ; y < yend ; ++y) {
+    for (x = 0 ; x < (signed)width ; ++x) {
+      vl_index u = floor((double)x / regionSize - 0.5) ;
+      vl_index v = floor((double)y / regionSize - 0.5) ;
+      vl_index up, vp ;
+      float minDistance = VL_INFINITY_F ;
+
+      for (vp = VL_MAX(0, v) ; vp <= VL_MIN((signed)numRegionsY-1, v+1) ; ++vp) {
+        for (up = VL_MAX(0, u) ; up <= VL_MIN((signed)numRegionsX-1, u+1) ; ++up) {
+          vl_index region = up  + vp * numRegionsX ;
+          float centerx = centers[(2 + numChannels) * region + 0]  ;
+          float centery = centers[(2 + numChannels) * region + 1] ;
+          float spatial = (x - centerx) * (x - centerx) + (y - centery) * (y - centery) ;
+          float appearance = 0 ;
+          float distance ;
+          for (k = 0 ; k < (signed)numChannels ; ++k) {
+            float centerz = centers[(2 + numChannels) * region + k + 2]  ;
+            float z = atimage(x,y,k) ;
+            appearance += (z - centerz) * (z - centerz) ;
+          }
+          distance = appearance + factor * spatial ;
+          if (minDistance > distance) {
+            minDistance = distance ;
+            segmentation[x + y * width] = (vl_uint32)region ;
+          }
+        }
+      }
+      job->distances[x + y * width] = minDistance ;
+    }
+  }
+}
+
+/** @internal
+ ** @brief Recompute the centers of the region rows of one thread
+ **
+ ** Every thread owns a band of region rows and scans the pixel rows
+ ** that can be assigned to them in raster order, so each center is
+ ** accumulated in the same order as by a single thread.
+ **/
+
+static void
+_vl_slic_update (void * data, vl_size threadIndex, vl_size numThreads)
+{
+  VlSlicJob * job = (VlSlicJob *) data ;
+  float const * image = job->image ;
+  float * centers = job->centers ;
+  vl_uint32 * masses = job->masses ;
+  vl_uint32 const * segmentation = job->segmentation ;
+  vl_size const width = job->width ;
+  vl_size const height = job->height ;
+  vl_size const numChannels = job->numChannels ;
+  vl_size const regionSize = job->regionSize ;
+  vl_size const numRegionsX = job->numRegionsX ;
+  vl_size const numRegionsY = job->numRegionsY ;
+  vl_index const vstart = numRegionsY * threadIndex / numThreads ;
+  vl_index const vend = numRegionsY * (threadIndex + 1) / numThreads ;
+  vl_uint32 const regionStart = vstart * numRegionsX ;
+  vl_uint32 const regionEnd = vend * numRegionsX ;
+  vl_index i, x, y, k, region ;
+
+  if (vstart >= vend) return ;
+
+  memset(masses + regionStart, 0, sizeof(vl_uint32) * (regionEnd - regionStart)) ;
+  memset(centers + (2 + numChannels) * regionStart, 0,
+         sizeof(float) * (2 + numChannels) * (regionEnd - regionStart)) ;
+
+  for (y = 0 ; y < (signed)height ; ++y) {
+    /* skip rows that cannot be assigned to the regions of this thread */
+    vl_index v = floor((double)y / regionSize - 0.5) ;
+    if (VL_MIN((signed)numRegionsY-1, v+1) < vstart || VL_MAX(0, v) >= vend) continue ;
+
+    for (x = 0 ; x < (signed)width ; ++x) {
+      vl_index pixel = x + y * width ;
+      region = segmentation[pixel] ;
+      if (region < (signed)regionStart || region >= (signed)regionEnd) continue ;
+      masses[region] ++ ;
+      centers[region * (2 + numChannels) + 0] += x ;
+      centers[region * (2 + numChannels) + 1] += y ;
+      for (k = 0 ; k < (signed)numChannels ; ++k) {
+        centers[region * (2 + numChannels) + k + 2] += atimage(x,y,k) ;
+      }
+    }
+  }
+
+  for (region = regionStart ; region < (signed)regionEnd ; ++region) {
+    float mass = VL_MAX(masses[region], 1e-8) ;
+    for (i = (2 + numChannels) * region ;
+         i < (signed)(2 + numChannels) * (region + 1) ;
+         ++i) {
+      centers[i] /= mass ;
+    }
+  }
+}
+
 /** @brief SLIC superpixel segmentation
  ** @param segmentation segmentation.
  ** @param image image to segment.
@@ -179,6 +358,20 @@ vl_slic_segment (vl_uint32 * segmentation,
     vl_slic_segment_t(segmentation, image, width, height, numChannels, regionSize, regularization, minRegionSize, 100);
 }
 
+/** @brief SLIC superpixel segmentation with a maximum number of iterations
+ ** @param segmentation segmentation.
+ ** @param image image to segment.
+ ** @param width image width.
+ ** @param height image height.
+ ** @param numChannels number of image channels (depth).
+ ** @param regionSize nominal size of the regions.
+ ** @param regularization trade-off between appearance and spatial terms.
+ ** @param minRegionSize minimum size of a segment.
+ ** @param maxNumIterations maximum number of k-means iterations.
+ **
+ ** @sa ::vl_slic_segment
+ **/
+
 void
 vl_slic_segment_t (vl_uint32 * segmentation,
                  float const * image,
@@ -190,7 +383,42 @@ vl_slic_segment_t (vl_uint32 * segmentation,
                  vl_size minRegionSize,
                  vl_size maxNumIterations)
 {
-  vl_index i, x, y, u, v, k, region ;
+    vl_slic_segment_mt(segmentation, image, width, height, numChannels, regionSize, regularization, minRegionSize, maxNumIterations, 1);
+}
+
+/** @brief Multithreaded SLIC superpixel segmentation
+ ** @param segmentation segmentation.
+ ** @param image image to segment.
+ ** @param width image width.
+ ** @param height image height.
+ ** @param numChannels number of image channels (depth).
+ ** @param regionSize nominal size of the regions.
+ ** @param regularization trade-off between appearance and spatial terms.
+ ** @param minRegionSize minimum size of a segment.
+ ** @param maxNumIterations maximum number of k-means iterations.
+ ** @param numThreads number of threads, 0 for the number of CPU cores.
+ **
+ ** The edge map and the k-means iterations are computed on @a numThreads
+ ** threads; the result is identical to ::vl_slic_segment_t for any number
+ ** of threads.
+ **
+ ** @sa ::vl_slic_segment
+ **/
+
+void
+vl_slic_segment_mt (vl_uint32 * segmentation,
+                 float const * image,
+                 vl_size width,
+                 vl_size height,
+                 vl_size numChannels,
+                 vl_size regionSize,
+                 float regularization,
+                 vl_size minRegionSize,
+                 vl_size maxNumIterations,
+                 vl_size numThreads)
+{
+  vl_index i, x, y, u, v, k ;
+  vl_uindex pixel ;
   vl_uindex iter ;
   vl_size const numRegionsX = (vl_size) ceil((double) width / regionSize) ;
   vl_size const numRegionsY = (vl_size) ceil((double) height / regionSize) ;
@@ -201,6 +429,8 @@ vl_slic_segment_t (vl_uint32 * segmentation,
   float previousEnergy = VL_INFINITY_F ;
   float startingEnergy ;
   vl_uint32 * masses ;
+  VlThreadPool * pool ;
+  VlSlicJob job ;
 //  vl_size const maxNumIterations = 100 ;
 
   assert(segmentation) ;
@@ -211,25 +441,29 @@ vl_slic_segment_t (vl_uint32 * segmentation,
   assert(regionSize >= 1) ;
   assert(regularization >= 0) ;
 
-#define atimage(x,y,k) image[(x)+(y)*width+(k)*width*height]
-#define atEdgeMap(x,y) edgeMap[(x)+(y)*width]
-
   edgeMap = vl_calloc(numPixels, sizeof(float)) ;
   masses = vl_malloc(sizeof(vl_uint32) * numPixels) ;
   centers = vl_malloc(sizeof(float) * (2 + numChannels) * numRegions) ;
 
+  pool = vl_threadpool_new(numThreads) ;
+
+  job.segmentation = segmentation ;
+  job.image = image ;
+  job.width = width ;
+  job.height = height ;
+  job.numChannels = numChannels ;
+  job.regionSize = regionSize ;
+  job.numRegionsX = numRegionsX ;
+  job.numRegionsY = numRegionsY ;
+  job.factor = regularization / (regionSize * regionSize) ;
+  job.edgeMap = edgeMap ;
+  /* the edge map is only needed for the initialization */
+  job.distances = edgeMap ;
+  job.centers = centers ;
+  job.masses = masses ;
+
   /* compute edge map (gradient strength) */
-  for (k = 0 ; k < (signed)numChannels ; ++k) {
-    for (y = 1 ; y < (signed)height-1 ; ++y) {
-      for (x = 1 ; x < (signed)width-1 ; ++x) {
-        float a = atimage(x-1,y,k) ;
-        float b = atimage(x+1,y,k) ;
-        float c = atimage(x,y+1,k) ;
-        float d = atimage(x,y-1,k) ;
-        atEdgeMap(x,y) += (a - b)  * (a - b) + (c - d) * (c - d) ;
-      }
-    }
-  }
+  vl_threadpool_run(pool, _vl_slic_edge_map, &job) ;
 
   /* initialize K-means centers */
   i = 0 ;
@@ -270,39 +504,13 @@ vl_slic_segment_t (vl_uint32 * segmentation,
   
   /* run k-means iterations */
   for (iter = 0 ; iter < maxNumIterations ; ++iter) {
-    float factor = regularization / (regionSize * regionSize) ;
     float energy = 0 ;
     
     /* assign pixels to centers */
-    for (y = 0 ; y < (signed)height ; ++y) {
-      for (x = 0 ; x < (signed)width ; ++x) {
-        vl_index u = floor((double)x / regionSize - 0.5) ;
-        vl_index v = floor((double)y / regionSize - 0.5) ;
-        vl_index up, vp ;
-        float minDistance = VL_INFINITY_F ;
-
-        for (vp = VL_MAX(0, v) ; vp <= VL_MIN((signed)numRegionsY-1, v+1) ; ++vp) {
-          for (up = VL_MAX(0, u) ; up <= VL_MIN((signed)numRegionsX-1, u+1) ; ++up) {
-            vl_index region = up  + vp * numRegionsX ;
-            float centerx = centers[(2 + numChannels) * region + 0]  ;
-            float centery = centers[(2 + numChannels) * region + 1] ;
-            float spatial = (x - centerx) * (x - centerx) + (y - centery) * (y - centery) ;
-            float appearance = 0 ;
-            float distance ;
-            for (k = 0 ; k < (signed)numChannels ; ++k) {
-              float centerz = centers[(2 + numChannels) * region + k + 2]  ;
-              float z = atimage(x,y,k) ;
-              appearance += (z - centerz) * (z - centerz) ;
-            }
-            distance = appearance + factor * spatial ;
-            if (minDistance > distance) {
-              minDistance = distance ;
-              segmentation[x + y * width] = (vl_uint32)region ;
-            }
-          }
-        }
-        energy += minDistance ;
-      }
+    vl_threadpool_run(pool, _vl_slic_assign, &job) ;
+
+    for (pixel = 0 ; pixel < numPixels ; ++pixel) {
+      energy += job.distances[pixel] ;
     }
 
     /*
@@ -320,32 +528,10 @@ vl_slic_segment_t (vl_uint32 * segmentation,
     previousEnergy = energy ;
 
     /* recompute centers */
-    memset(masses, 0, sizeof(vl_uint32) * width * height) ;
-    memset(centers, 0, sizeof(float) * (2 + numChannels) * numRegions) ;
-
-    for (y = 0 ; y < (signed)height ; ++y) {
-      for (x = 0 ; x < (signed)width ; ++x) {
-        vl_index pixel = x + y * width ;
-        vl_index region = segmentation[pixel] ;
-        masses[region] ++ ;
-        centers[region * (2 + numChannels) + 0] += x ;
-        centers[region * (2 + numChannels) + 1] += y ;
-        for (k = 0 ; k < (signed)numChannels ; ++k) {
-          centers[region * (2 + numChannels) + k + 2] += atimage(x,y,k) ;
-        }
-      }
-    }
-
-    for (region = 0 ; region < (signed)numRegions ; ++region) {
-      float mass = VL_MAX(masses[region], 1e-8) ;
-      for (i = (2 + numChannels) * region ;
-           i < (signed)(2 + numChannels) * (region + 1) ;
-           ++i) {
-        centers[i] /= mass ;
-      }
-    }
+    vl_threadpool_run(pool, _vl_slic_update, &job) ;
   }
 
+  vl_threadpool_delete(pool) ;
   vl_free(masses) ;
   vl_free(centers) ;
   vl_free(edgeMap) ;
@@ -0,0 +1,278 @@
+/** @file threadpool.c
+ ** @brief Minimal portable thread pool - Definition
+ ** @author David Stutz
+ **/
+
+/*
+This file is made available under the terms of the BSD license
+(see the LICENSE.md file).
+*/
+
+/**
+@file threadpool.h
+
+A thread pool runs the same function on a fixed number of threads and
+waits for all of them to finish; the function receives the index of
+the thread so that it can pick its share of the work. The calling
+thread takes index 0, so a pool of one thread runs everything on the
+caller and never starts a thread. The workers are started once by
+::vl_threadpool_new and sleep between calls to ::vl_threadpool_run,
+so running many short jobs (e.g. one per k-means iteration) is cheap.
+
+The pool uses POSIX threads or the Windows thread API, whichever the
+host provides (see @ref host.h), and no OpenMP. If threads are
+disabled (@c VL_DISABLE_THREADS) every pool has a single thread.
+**/
+
+#include "threadpool.h"
+
+#if ! defined(VL_DISABLE_THREADS) && defined(VL_THREADS_POSIX)
+#include <pthread.h>
+#elif ! defined(VL_DISABLE_THREADS) && defined(VL_THREADS_WIN)
+#include <Windows.h>
+#endif
+
+typedef struct _VlThreadPoolWorker
+{
+  VlThreadPool * pool ;
+  vl_size index ;
+} VlThreadPoolWorker ;
+
+struct _VlThreadPool
+{
+  vl_size numThreads ;
+  VlThreadPoolFunction function ;
+  void * data ;
+  vl_size generation ;
+  vl_size pending ;
+  vl_bool quit ;
+  VlThreadPoolWorker * workers ;
+#if ! defined(VL_DISABLE_THREADS) && defined(VL_THREADS_POSIX)
+  pthread_mutex_t mutex ;
+  pthread_cond_t start ;
+  pthread_cond_t done ;
+  pthread_t * threads ;
+#elif ! defined(VL_DISABLE_THREADS) && defined(VL_THREADS_WIN)
+  CRITICAL_SECTION mutex ;
+  CONDITION_VARIABLE start ;
+  CONDITION_VARIABLE done ;
+  HANDLE * threads ;
+#endif
+} ;
+
+#if ! defined(VL_DISABLE_THREADS) && (defined(VL_THREADS_POSIX) || defined(VL_THREADS_WIN))
+#define VL_THREADPOOL_THREADS 1
+
+#if defined(VL_THREADS_POSIX)
+#define vl_threadpool_lock(self) pthread_mutex_lock(&(self)->mutex)
+#define vl_threadpool_unlock(self) pthread_mutex_unlock(&(self)->mutex)
+#define vl_threadpool_wait(self,cond) pthread_cond_wait(&(self)->cond, &(self)->mutex)
+#define vl_threadpool_signal(self,cond) pthread_cond_signal(&(self)->cond)
+#define vl_threadpool_broadcast(self,cond) pthread_cond_broadcast(&(self)->cond)
+#else
+#define vl_threadpool_lock(self) EnterCriticalSection(&(self)->mutex)
+#define vl_threadpool_unlock(self) LeaveCriticalSection(&(self)->mutex)
+#define vl_threadpool_wait(self,cond) SleepConditionVariableCS(&(self)->cond, &(self)->mutex, INFINITE)
+#define vl_threadpool_signal(self,cond) WakeConditionVariable(&(self)->cond)
+#define vl_threadpool_broadcast(self,cond) WakeAllConditionVariable(&(self)->cond)
+#endif
+
+/** @internal
+ ** @brief Main loop of a worker thread
+ **/
+
+static void
+_vl_threadpool_work (VlThreadPoolWorker * worker)
+{
+  VlThreadPool * self = worker->pool ;
+  vl_size generation = 0 ;
+
+  while (1) {
+    VlThreadPoolFunction function ;
+    void * data ;
+
+    vl_threadpool_lock(self) ;
+    while (self->generation == generation && ! self->quit) {
+      vl_threadpool_wait(self, start) ;
+    }
+    if (self->quit) {
+      vl_threadpool_unlock(self) ;
+      break ;
+    }
+    generation = self->generation ;
+    function = self->function ;
+    data = self->data ;
+    vl_threadpool_unlock(self) ;
+
+    function (data, worker->index, self->numThreads) ;
+
+    vl_threadpool_lock(self) ;
+    if (--self->pending == 0) {
+      vl_threadpool_signal(self, done) ;
+    }
+    vl_threadpool_unlock(self) ;
+  }
+}
+
+#if defined(VL_THREADS_POSIX)
+static void *
+_vl_threadpool_main (void * worker)
+{
+  _vl_threadpool_work ((VlThreadPoolWorker *) worker) ;
+  return NULL ;
+}
+#else
+static DWORD WINAPI
+_vl_threadpool_main (LPVOID worker)
+{
+  _vl_threadpool_work ((VlThreadPoolWorker *) worker) ;
+  return 0 ;
+}
+#endif
+#endif
+
+/** @brief Create a new thread pool
+ ** @param numThreads number of threads, 0 for the number of CPU cores.
+ ** @return new pool.
+ **
+ ** If a thread cannot be started, the pool uses fewer threads.
+ **/
+
+VlThreadPool *
+vl_threadpool_new (vl_size numThreads)
+{
+  VlThreadPool * self = vl_calloc(1, sizeof(VlThreadPool)) ;
+
+  if (numThreads == 0) {
+    numThreads = VL_MAX(vl_get_num_cpus(), 1) ;
+  }
+#if ! defined(VL_THREADPOOL_THREADS)
+  numThreads = 1 ;
+#endif
+
+  self->numThreads = 1 ;
+  self->workers = vl_malloc(sizeof(VlThreadPoolWorker) * numThreads) ;
+
+#if defined(VL_THREADPOOL_THREADS)
+#if defined(VL_THREADS_POSIX)
+  pthread_mutex_init (&self->mutex, NULL) ;
+  pthread_cond_init (&self->start, NULL) ;
+  pthread_cond_init (&self->done, NULL) ;
+  self->threads = vl_malloc(sizeof(pthread_t) * numThreads) ;
+#else
+  InitializeCriticalSection (&self->mutex) ;
+  InitializeConditionVariable (&self->start) ;
+  InitializeConditionVariable (&self->done) ;
+  self->threads = vl_malloc(sizeof(HANDLE) * numThreads) ;
+#endif
+
+  /* the calling thread is thread 0 */
+  for ( ; self->numThreads < numThreads ; ++ self->numThreads) {
+    VlThreadPoolWorker * worker = self->workers + self->numThreads ;
+    worker->pool = self ;
+    worker->index = self->numThreads ;
+#if defined(VL_THREADS_POSIX)
+    if (pthread_create (self->threads + self->numThreads, NULL,
+                        _vl_threadpool_main, worker) != 0) {
+      break ;
+    }
+#else
+    self->threads[self->numThreads] =
+      CreateThread (NULL, 0, _vl_threadpool_main, worker, 0, NULL) ;
+    if (self->threads[self->numThreads] == NULL) {
+      break ;
+    }
+#endif
+  }
+#endif
+
+  return self ;
+}
+
+/** @brief Delete a thread pool
+ ** @param self pool.
+ **
+ ** Stops and joins all threads.
+ **/
+
+void
+vl_threadpool_delete (VlThreadPool * self)
+{
+#if defined(VL_THREADPOOL_THREADS)
+  vl_index t ;
+
+  vl_threadpool_lock(self) ;
+  self->quit = VL_TRUE ;
+  vl_threadpool_broadcast(self, start) ;
+  vl_threadpool_unlock(self) ;
+
+  for (t = 1 ; t < (signed)self->numThreads ; ++t) {
+#if defined(VL_THREADS_POSIX)
+    pthread_join (self->threads[t], NULL) ;
+#else
+    WaitForSingleObject (self->threads[t], INFINITE) ;
+    CloseHandle (self->threads[t]) ;
+#endif
+  }
+
+#if defined(VL_THREADS_POSIX)
+  pthread_cond_destroy (&self->done) ;
+  pthread_cond_destroy (&self->start) ;
+  pthread_mutex_destroy (&self->mutex) ;
+#else
+  DeleteCriticalSection (&self->mutex) ;
+#endif
+  vl_free(self->threads) ;
+#endif
+
+  vl_free(self->workers) ;
+  vl_free(self) ;
+}
+
+/** @brief Get the number of threads of a pool
+ ** @param self pool.
+ ** @return number of threads, including the calling thread.
+ **/
+
+vl_size
+vl_threadpool_get_num_threads (VlThreadPool const * self)
+{
+  return self->numThreads ;
+}
+
+/** @brief Run a function on all threads of a pool
+ ** @param self pool.
+ ** @param function function to run.
+ ** @param data user data passed to @a function.
+ **
+ ** The calling thread runs @a function with index 0; the function
+ ** returns once all threads have finished.
+ **/
+
+void
+vl_threadpool_run (VlThreadPool * self,
+                   VlThreadPoolFunction function,
+                   void * data)
+{
+#if defined(VL_THREADPOOL_THREADS)
+  if (self->numThreads > 1) {
+    vl_threadpool_lock(self) ;
+    self->function = function ;
+    self->data = data ;
+    self->pending = self->numThreads - 1 ;
+    self->generation ++ ;
+    vl_threadpool_broadcast(self, start) ;
+    vl_threadpool_unlock(self) ;
+
+    function (data, 0, self->numThreads) ;
+
+    vl_threadpool_lock(self) ;
+    while (self->pending > 0) {
+      vl_threadpool_wait(self, done) ;
+    }
+    vl_threadpool_unlock(self) ;
+    return ;
+  }
+#endif
+  function (data, 0, 1) ;
+}
@@ -0,0 +1,36 @@
+/** @file threadpool.h
+ ** @brief Minimal portable thread pool
+ ** @author David Stutz
+ **/
+
+/*
+This file is made available under the terms of the BSD license
+(see the LICENSE.md file).
+*/
+
+#ifndef VL_THREADPOOL_H
+#define VL_THREADPOOL_H
+
+#include "generic.h"
+
+/** @brief Function run by every thread of the pool.
+ ** @param data user data passed to ::vl_threadpool_run.
+ ** @param threadIndex index of the calling thread, from 0 to @c numThreads - 1.
+ ** @param numThreads number of threads of the pool.
+ **/
+typedef void (*VlThreadPoolFunction) (void * data,
+                                      vl_size threadIndex,
+                                      vl_size numThreads) ;
+
+/** @brief Thread pool */
+typedef struct _VlThreadPool VlThreadPool ;
+
+VL_EXPORT VlThreadPool * vl_threadpool_new (vl_size numThreads) ;
+VL_EXPORT void vl_threadpool_delete (VlThreadPool * self) ;
+VL_EXPORT vl_size vl_threadpool_get_num_threads (VlThreadPool const * self) ;
+VL_EXPORT void vl_threadpool_run (VlThreadPool * self,
+                                  VlThreadPoolFunction function,
+                                  void * data) ;
+
+/* VL_THREADPOOL_H */
+#endif
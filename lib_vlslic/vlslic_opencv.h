@@ -46,9 +46,11 @@ public:
      * \param[in] regularization compactness parameter
      * \param[in] min_region_size minimum size of superpixels
      * \param[out] superpixel labels
+     * \param[in] threads number of threads, 0 for all cores; the labels do not depend on it
      */
     static void computeSuperpixels(const cv::Mat &mat, int region_size, 
-            double regularization, int min_region_size, int iterations, cv::Mat &labels)
+            double regularization, int min_region_size, int iterations, cv::Mat &labels,
+            int threads = 1)
     {
         // Convert image to one-dimensional array.
         float* image = new float[mat.rows*mat.cols*mat.channels()];
@@ -70,8 +72,8 @@ public:
         vl_size width = mat.cols;
         vl_size channels = mat.channels();
         
-        vl_slic_segment_t(segmentation, image, width, height, channels, region_size, 
-                regularization, min_region_size, iterations);
+        vl_slic_segment_mt(segmentation, image, width, height, channels, region_size, 
+                regularization, min_region_size, iterations, threads);
         
         // Convert segmentation.
         labels.create(mat.rows, mat.cols, CV_32SC1);
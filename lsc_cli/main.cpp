@@ -36,6 +36,7 @@
 #include <boost/timer.hpp>
 #include "lsc_opencv.h"
 #include "io_util.h"
+#include "batch_processing.h"
 #include "superpixel_tools.h"
 #include "visualization.h"
 
@@ -68,15 +69,19 @@ int main(int argc, const char** argv) {
     boost::program_options::options_description desc("Allowed options");
     desc.add_options()
         ("help,h", "produce help message")
-        ("input,i", boost::program_options::value<std::string>(), "the folder to process")
+        ("input,i", boost::program_options::value<std::string>(), "image, directory, glob pattern or image list (.txt) to process")
         ("superpixels,s", boost::program_options::value<int>()->default_value(400), "number of superpixels")
         ("ratio,c", boost::program_options::value<double>()->default_value(0.075), "compactness ratio = color weight / spatial weight")
         ("iterations,t", boost::program_options::value<int>()->default_value(20), "number of iterations to perform")
         ("threshold,g", boost::program_options::value<int>()->default_value(4), "threshold coefficient")
         ("color-space,r", boost::program_options::value<int>()->default_value(1), "color space: 0 = RGB, >0 = Lab")
         ("fair,f", "for a fair comparison with other algorithms, quadratic blocks are used for initialization")
-        ("oc", boost::program_options::value<std::string>()->default_value("output"), "name of the contour picture")
-        ("om", boost::program_options::value<std::string>()->default_value("output"), "name of the mean picture");   
+        ("oc", boost::program_options::value<std::string>()->default_value("output"), "name of the contour picture (directory for batches)")
+        ("om", boost::program_options::value<std::string>()->default_value("output"), "name of the mean picture (directory for batches)")
+        ("ol", boost::program_options::value<std::string>()->default_value(""), "name of the label file (.csv, .bin or .rle; directory for batches)")
+        ("format", boost::program_options::value<std::string>()->default_value("csv"), "format of the label files for batches: csv, bin or rle")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of images to process in parallel for batches (0 for all cores)")
+        ("prefetch", boost::program_options::value<int>()->default_value(4), "number of images to read ahead for batches");
 
     boost::program_options::positional_options_description positionals;
     positionals.add("input", 1);
@@ -92,6 +97,7 @@ int main(int argc, const char** argv) {
     
     std::string inputfile = parameters["input"].as<std::string>();
     std::string store_contour = parameters["oc"].as<std::string>();
+    std::string store_labels = parameters["ol"].as<std::string>();
     std::string store_mean = parameters["om"].as<std::string>();    
     int superpixels = parameters["superpixels"].as<int>();
     double ratio = parameters["ratio"].as<double>();
@@ -104,38 +110,32 @@ int main(int argc, const char** argv) {
         return 1;
     }
         
-    cv::Mat image = cv::imread(inputfile);
-    cv::Mat labels;
-        
-    int region_width;
-    int region_height;
-    SuperpixelTools::computeHeightWidthFromSuperpixels(image, superpixels,
-            region_height, region_width);
-        
-    // If a fair comparison is requested:
-    if (parameters.find("fair") != parameters.end()) {
-        region_width = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
-                superpixels);
-        region_height = region_width;
-    }
-        
-    LSC_OpenCV::computeSuperpixels(image, region_height, region_width, ratio, 
-            iterations, threshold, color_space, labels);
-        
-    int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
-//  int merged_components = SuperpixelTools::enforceMinimumSuperpixelSize(image, labels, 5);
-    int merged_components = SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, labels, unconnected_components);
-    SuperpixelTools::relabelSuperpixels(labels);
-        
-    cv::Mat blackima = cv::Mat::zeros(cv::Size(image.cols, image.rows), CV_8UC3);
+    BatchProcessing batch_processing(store_contour, store_mean, "", store_labels);
+    batch_processing.setFormat(parameters["format"].as<std::string>());
+    batch_processing.setThreads(parameters["threads"].as<int>());
+    batch_processing.setPrefetch(parameters["prefetch"].as<int>());
     
-    cv::Mat image_contours;
-    Visualization::drawContours(blackima, labels, image_contours);
-    cv::imwrite(store_contour, image_contours);
+    batch_processing.process(inputfile, [&](cv::Mat &image, cv::Mat &labels) {
+        int region_width;
+        int region_height;
+        SuperpixelTools::computeHeightWidthFromSuperpixels(image, superpixels,
+                region_height, region_width);
+
+        // If a fair comparison is requested:
+        if (parameters.find("fair") != parameters.end()) {
+            region_width = SuperpixelTools::computeRegionSizeFromSuperpixels(image,
+                    superpixels);
+            region_height = region_width;
+        }
 
-    cv::Mat image_means;
-    Visualization::drawMeans(image, labels, image_means);
-    cv::imwrite(store_mean, image_means);   
+        LSC_OpenCV::computeSuperpixels(image, region_height, region_width, ratio,
+                iterations, threshold, color_space, labels);
+
+        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
+//  int merged_components = SuperpixelTools::enforceMinimumSuperpixelSize(image, labels, 5);
+        int merged_components = SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, labels, unconnected_components);
+        SuperpixelTools::relabelSuperpixels(labels);
+    });
     
     return 0;
 }
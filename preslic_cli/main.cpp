@@ -36,6 +36,7 @@
 #include <boost/timer.hpp>
 #include "preemptiveSLIC.h"
 #include "io_util.h"
+#include "batch_processing.h"
 #include "superpixel_tools.h"
 #include "visualization.h"
 
@@ -51,6 +52,10 @@
  *     -t [ --iterations ] arg (=10)   iterations
  *     -p [ --perturb-seeds ] arg (=1) perturb seeds: > 0 yes, = 0 no
  *     -r [ --color-space ] arg (=1)   color space: =0 for RGB, >0 for Lab
+ *     --float                         use the single precision (SIMD) distance
+ *                                     computation
+ *     --preslic-threads arg (=1)      number of threads used by preSLIC for 
+ *                                     each image (0 for all cores)
  *     -o [ --csv ] arg                save segmentation as CSV file
  *     -v [ --vis ] arg                visualize contours
  *     -x [ --prefix ] arg             output file prefix
@@ -63,14 +68,20 @@ int main(int argc, const char** argv) {
     boost::program_options::options_description desc("Allowed options");
     desc.add_options()
         ("help,h", "produce help message")
-        ("input,i", boost::program_options::value<std::string>(), "the folder to process")
+        ("input,i", boost::program_options::value<std::string>(), "image, directory, glob pattern or image list (.txt) to process")
         ("superpixels,s", boost::program_options::value<int>()->default_value(400), "number of superpixels")
         ("compactness,c", boost::program_options::value<double>()->default_value(40.f), "constant for threshold function")
         ("iterations,t", boost::program_options::value<int>()->default_value(10), "iterations")
         ("perturb-seeds,p", boost::program_options::value<int>()->default_value(1), "perturb seeds: > 0 yes, = 0 no")
         ("color-space,r", boost::program_options::value<int>()->default_value(1), "color space: =0 for RGB, >0 for Lab")
-        ("oc", boost::program_options::value<std::string>()->default_value("output"), "name of the contour picture")
-        ("om", boost::program_options::value<std::string>()->default_value("output"), "name of the mean picture");   
+        ("float", "use the single precision (SIMD) distance computation")
+        ("preslic-threads", boost::program_options::value<int>()->default_value(1), "number of threads used by preSLIC for each image (0 for all cores)")
+        ("oc", boost::program_options::value<std::string>()->default_value("output"), "name of the contour picture (directory for batches)")
+        ("om", boost::program_options::value<std::string>()->default_value("output"), "name of the mean picture (directory for batches)")
+        ("ol", boost::program_options::value<std::string>()->default_value(""), "name of the label file (.csv, .bin or .rle; directory for batches)")
+        ("format", boost::program_options::value<std::string>()->default_value("csv"), "format of the label files for batches: csv, bin or rle")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of images to process in parallel for batches (0 for all cores)")
+        ("prefetch", boost::program_options::value<int>()->default_value(4), "number of images to read ahead for batches");
     
     boost::program_options::positional_options_description positionals;
     positionals.add("input", 1);
@@ -86,6 +97,7 @@ int main(int argc, const char** argv) {
     
     std::string inputfile = parameters["input"].as<std::string>();
     std::string store_contour = parameters["oc"].as<std::string>();
+    std::string store_labels = parameters["ol"].as<std::string>();
     std::string store_mean = parameters["om"].as<std::string>();         
     int superpixels = parameters["superpixels"].as<int>();
     double compactness = parameters["compactness"].as<double>();
@@ -94,36 +106,33 @@ int main(int argc, const char** argv) {
     bool rgb = rgb_int == 0 ? true : false;
     int perturb_seeds_int = parameters["perturb-seeds"].as<int>();
     bool perturb_seeds = perturb_seeds_int > 0 ? true : false;
+    bool use_float = parameters.find("float") != parameters.end();
+    int preslic_threads = parameters["preslic-threads"].as<int>();
             
-    cv::Mat image = cv::imread(inputfile);
-    int* labeling;
-    cv::Mat seeds;
-        
-    int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
-                superpixels);
-        
-    PreemptiveSLIC preemptiveSLIC;
-    preemptiveSLIC.preemptiveSLIC(image, region_size,
-            compactness, perturb_seeds, iterations, rgb, labeling, seeds);
-        
-    cv::Mat labels(image.rows, image.cols, CV_32SC1, cv::Scalar(0));
-    for(int i = 0; i < image.rows; i++) {
-        for(int j = 0; j < image.cols; j++) {
-            labels.at<int>(i,j) = labeling[image.cols*i+j];
-        }
-    }
-        
-    int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
-        
-    cv::Mat blackima = cv::Mat::zeros(cv::Size(image.cols, image.rows), CV_8UC3);
+    BatchProcessing batch_processing(store_contour, store_mean, "", store_labels);
+    batch_processing.setFormat(parameters["format"].as<std::string>());
+    batch_processing.setThreads(parameters["threads"].as<int>());
+    batch_processing.setPrefetch(parameters["prefetch"].as<int>());
     
-    cv::Mat image_contours;
-    Visualization::drawContours(blackima, labels, image_contours);
-    cv::imwrite(store_contour, image_contours);
+    batch_processing.process(inputfile, [&](cv::Mat &image, cv::Mat &labels) {
+        int* labeling;
+        cv::Mat seeds;
+
+        int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image,
+                    superpixels);
+
+        PreemptiveSLIC preemptiveSLIC;
+        preemptiveSLIC.m_use_float = use_float;
+        preemptiveSLIC.m_threads = preslic_threads;
+        preemptiveSLIC.preemptiveSLIC(image, region_size,
+                compactness, perturb_seeds, iterations, rgb, labeling, seeds);
+
+        // preemptiveSLIC allocates labeling with new[].
+        cv::Mat(image.rows, image.cols, CV_32SC1, labeling).copyTo(labels);
+        delete[] labeling;
 
-    cv::Mat image_means;
-    Visualization::drawMeans(image, labels, image_means);
-    cv::imwrite(store_mean, image_means);  
+        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
+    });
     
     return 0;
 }
@@ -36,6 +36,7 @@
 #include <boost/timer.hpp>
 #include "seeds2.h"
 #include "io_util.h"
+#include "batch_processing.h"
 #include "superpixel_tools.h"
 #include "visualization.h"
 
@@ -73,7 +74,7 @@ int main(int argc, const char** argv) {
     boost::program_options::options_description desc("Allowed options");
     desc.add_options()
         ("help,h", "produce help message")
-        ("input,i", boost::program_options::value<std::string>(), "the folder to process (can also be passed as positional argument)")
+        ("input,i", boost::program_options::value<std::string>(), "image, directory, glob pattern or image list (.txt) to process")
         ("superpixels,s", boost::program_options::value<int>()->default_value(400), "number of superpixels")
         ("bins,b", boost::program_options::value<int>()->default_value(5), "number of bins")
         ("confidence,c", boost::program_options::value<float>()->default_value(0.1), "minimum confidence used for block update")
@@ -82,8 +83,12 @@ int main(int argc, const char** argv) {
         ("iterations,t", boost::program_options::value<int>()->default_value(2), "iterations at each level")
         ("color-space,r", boost::program_options::value<int>()->default_value(1), "color space: 0 = RGB, 1 = Lab, 2 = HSV")
         ("fair,f", "for a fair comparison with other algorithms, quadratic blocks are used for initialization")
-        ("oc", boost::program_options::value<std::string>()->default_value("output"), "name of the contour picture")
-        ("om", boost::program_options::value<std::string>()->default_value("output"), "name of the mean picture");   
+        ("oc", boost::program_options::value<std::string>()->default_value("output"), "name of the contour picture (directory for batches)")
+        ("om", boost::program_options::value<std::string>()->default_value("output"), "name of the mean picture (directory for batches)")
+        ("ol", boost::program_options::value<std::string>()->default_value(""), "name of the label file (.csv, .bin or .rle; directory for batches)")
+        ("format", boost::program_options::value<std::string>()->default_value("csv"), "format of the label files for batches: csv, bin or rle")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of images to process in parallel for batches (0 for all cores)")
+        ("prefetch", boost::program_options::value<int>()->default_value(4), "number of images to read ahead for batches");
        
     boost::program_options::positional_options_description positionals;
     positionals.add("input", 1);
@@ -99,6 +104,7 @@ int main(int argc, const char** argv) {
     
     std::string inputfile = parameters["input"].as<std::string>();
     std::string store_contour = parameters["oc"].as<std::string>();
+    std::string store_labels = parameters["ol"].as<std::string>();
     std::string store_mean = parameters["om"].as<std::string>();            
     int superpixels = parameters["superpixels"].as<int>();
     int iterations = parameters["iterations"].as<int>();
@@ -115,45 +121,40 @@ int main(int argc, const char** argv) {
         return 1;
     }
         
-    cv::Mat image = cv::imread(inputfile);
-        
-    int region_width = 2;
-    int region_height = 2;
-    int levels = 2;
-        
-    if (parameters.find("fair") != parameters.end()) {
-        SuperpixelTools::computeRegionSizeLevels(image, superpixels, 
-                region_width, levels);
-        region_height = region_width;
-    }
-    else {
-        SuperpixelTools::computeHeightWidthLevelsFromSuperpixels(image, 
-                superpixels, region_height, region_width, levels);
-    }
-        
-    SEEDS seeds(image.cols, image.rows, image.channels(), bins, 0, 
-            confidence, prior, means, color_space);
-    seeds.initialize(image, region_width, region_height, levels);
-    seeds.iterate(iterations);
-        
-    cv::Mat labels(image.rows, image.cols, CV_32SC1, cv::Scalar(0));
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            labels.at<int>(i, j) = seeds.labels[levels - 1][j + image.cols*i];
-        }
-    }
-        
-    int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
-        
-    cv::Mat blackima = cv::Mat::zeros(cv::Size(image.cols, image.rows), CV_8UC3);
+    BatchProcessing batch_processing(store_contour, store_mean, "", store_labels);
+    batch_processing.setFormat(parameters["format"].as<std::string>());
+    batch_processing.setThreads(parameters["threads"].as<int>());
+    batch_processing.setPrefetch(parameters["prefetch"].as<int>());
     
-    cv::Mat image_contours;
-    Visualization::drawContours(blackima, labels, image_contours);
-    cv::imwrite(store_contour, image_contours);
+    batch_processing.process(inputfile, [&](cv::Mat &image, cv::Mat &labels) {
+        int region_width = 2;
+        int region_height = 2;
+        int levels = 2;
+
+        if (parameters.find("fair") != parameters.end()) {
+            SuperpixelTools::computeRegionSizeLevels(image, superpixels,
+                    region_width, levels);
+            region_height = region_width;
+        }
+        else {
+            SuperpixelTools::computeHeightWidthLevelsFromSuperpixels(image,
+                    superpixels, region_height, region_width, levels);
+        }
+
+        SEEDS seeds(image.cols, image.rows, image.channels(), bins, 0,
+                confidence, prior, means, color_space);
+        seeds.initialize(image, region_width, region_height, levels);
+        seeds.iterate(iterations);
+
+        labels = cv::Mat(image.rows, image.cols, CV_32SC1, cv::Scalar(0));
+        for (int i = 0; i < image.rows; ++i) {
+            for (int j = 0; j < image.cols; ++j) {
+                labels.at<int>(i, j) = seeds.labels[levels - 1][j + image.cols*i];
+            }
+        }
 
-    cv::Mat image_means;
-    Visualization::drawMeans(image, labels, image_means);
-    cv::imwrite(store_mean, image_means);  
+        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
+    });
     
     return 0;
 }
@@ -29,6 +29,7 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <atomic>
 #include <fstream>
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
@@ -37,6 +38,7 @@
 #include <bitset>
 #include "slic_opencv.h"
 #include "io_util.h"
+#include "batch_processing.h"
 #include "superpixel_tools.h"
 #include "visualization.h"
 
@@ -53,6 +55,12 @@
  *     -p [ --perturb-seeds ] arg (=1) perturb seeds: > 0 yes, = 0 no
  *     -t [ --iterations ] arg (=10)   iterations
  *     -r [ --color-space ] arg (=1)   color space: 0 = RGB, > 0 = Lab
+ *     --convergence-displacement arg (=-1)
+ *                                     stop early once no centroid moves more 
+ *                                     than this many pixels (negative to 
+ *                                     disable)
+ *     --convergence-changed arg (=-1) stop early once at most this fraction of
+ *                                     labels changes (negative to disable)
  *     -o [ --csv ] arg                specify the output directory (default is 
  *                                     ./output)
  *     -v [ --vis ] arg                visualize contours
@@ -66,15 +74,22 @@ int main(int argc, const char** argv) {
     boost::program_options::options_description desc("Allowed options");
     desc.add_options()
         ("help,h", "produce help message")
-        ("input,i", boost::program_options::value<std::string>(), "the folder to process (can also be passed as positional argument)")
+        ("input,i", boost::program_options::value<std::string>(), "image, directory, glob pattern or image list (.txt) to process")
         ("superpixels,s", boost::program_options::value<int>()->default_value(400), "number of superpixles")
         ("compactness,c", boost::program_options::value<double>()->default_value(40.), "compactness")
         ("perturb-seeds,p", boost::program_options::value<int>()->default_value(1), "perturb seeds: > 0 yes, = 0 no")
         ("iterations,t", boost::program_options::value<int>()->default_value(10), "iterations")
         ("color-space,r", boost::program_options::value<int>()->default_value(1), "color space: 0 = RGB, > 0 = Lab")
-        ("oc", boost::program_options::value<std::string>()->default_value("output"), "name of the contour picture")
-        ("om", boost::program_options::value<std::string>()->default_value("output"), "name of the mean picture")  
-        ("or", boost::program_options::value<std::string>()->default_value("output"), "name of the random picture");   
+        ("slic-threads", boost::program_options::value<int>()->default_value(1), "number of threads used by SLIC for each image (0 for all cores)")
+        ("convergence-displacement", boost::program_options::value<float>()->default_value(-1), "stop early once no centroid moves more than this many pixels (negative to disable)")
+        ("convergence-changed", boost::program_options::value<float>()->default_value(-1), "stop early once at most this fraction of labels changes (negative to disable)")
+        ("oc", boost::program_options::value<std::string>()->default_value("output"), "name of the contour picture (directory for batches)")
+        ("om", boost::program_options::value<std::string>()->default_value("output"), "name of the mean picture (directory for batches)")  
+        ("or", boost::program_options::value<std::string>()->default_value("output"), "name of the random picture (directory for batches)")
+        ("ol", boost::program_options::value<std::string>()->default_value(""), "name of the label file (.csv, .bin or .rle; directory for batches)")
+        ("format", boost::program_options::value<std::string>()->default_value("csv"), "format of the label files for batches: csv, bin or rle")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of images to process in parallel for batches (0 for all cores)")
+        ("prefetch", boost::program_options::value<int>()->default_value(4), "number of images to read ahead for batches");
          
     boost::program_options::positional_options_description positionals;
     positionals.add("input", 1);
@@ -90,6 +105,7 @@ int main(int argc, const char** argv) {
     
     std::string inputfile = parameters["input"].as<std::string>();
     std::string store_contour = parameters["oc"].as<std::string>();
+    std::string store_labels = parameters["ol"].as<std::string>();
     std::string store_mean = parameters["om"].as<std::string>();    
     std::string store_random = parameters["or"].as<std::string>();    
     int superpixels = parameters["superpixels"].as<int>();
@@ -98,31 +114,38 @@ int main(int argc, const char** argv) {
     int perturb_seeds_int = parameters["perturb-seeds"].as<int>();
     bool perturb_seeds = perturb_seeds_int > 0 ? true : false;
     int color_space = parameters["color-space"].as<int> ();
+    int slic_threads = parameters["slic-threads"].as<int>();
+    float displacement = parameters["convergence-displacement"].as<float>();
+    float changed = parameters["convergence-changed"].as<float>();
+    bool convergence = displacement >= 0 || changed >= 0;
+    
+    std::atomic<int> images(0);
+    std::atomic<int> used_iterations(0);
             
-    cv::Mat image = cv::imread(inputfile);
-    cv::Mat labels;
-        
-    int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
-            superpixels);
-        
-    SLIC_OpenCV::computeSuperpixels(image, region_size, compactness, 
-            iterations, perturb_seeds, color_space, labels);
-        
-    int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
-        
-    cv::Mat blackima = cv::Mat::zeros(cv::Size(image.cols, image.rows), CV_8UC3);
+    BatchProcessing batch_processing(store_contour, store_mean, store_random, store_labels);
+    batch_processing.setFormat(parameters["format"].as<std::string>());
+    batch_processing.setThreads(parameters["threads"].as<int>());
+    batch_processing.setPrefetch(parameters["prefetch"].as<int>());
     
-    cv::Mat image_contours;
-    Visualization::drawContours(blackima, labels, image_contours);
-    cv::imwrite(store_contour, image_contours);
+    batch_processing.process(inputfile, [&](cv::Mat &image, cv::Mat &labels) {
+        int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image,
+                superpixels);
+
+        // One context per worker, so its buffers are reused across images.
+        thread_local SLICContext_OpenCV context(slic_threads);
+        context.setConvergence(displacement, changed);
+        
+        used_iterations += context.computeSuperpixels(image, region_size, 
+                compactness, iterations, perturb_seeds, color_space, labels);
+        ++images;
 
-    cv::Mat image_means;
-    Visualization::drawMeans(image, labels, image_means);
-    cv::imwrite(store_mean, image_means);  
+        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
+    });
     
-    cv::Mat image_random;
-    Visualization::drawRandom(labels, image_random);
-    cv::imwrite(store_random, image_random);  
+    if (convergence && images > 0) {
+        std::cout << "Average iterations: " 
+                << ((float) used_iterations)/images << std::endl;
+    }
     
     return 0;
 }
@@ -0,0 +1,226 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <chrono>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <glog/logging.h>
+#include "slic_supervoxels.h"
+#include "io_util.h"
+#include "batch_processing.h"
+#include "superpixel_tools.h"
+#include "visualization.h"
+
+/** \brief Command line tool for computing SLIC supervoxels on a directory of
+ * video frames.
+ * 
+ * The frames are read in the order of their file names and processed in slabs
+ * of `--slab` frames; supervoxel labels are unique across slabs.
+ * 
+ * Usage:
+ * \code{sh}
+ *   $ ../bin/slic_supervoxel_cli --help
+ *   Allowed options:
+ *     -h [ --help ]                   produce help message
+ *     -i [ --input ] arg              directory, glob pattern or list (.txt) of
+ *                                     the frames to process
+ *     -s [ --superpixels ] arg (=400) number of superpixels per frame (used if
+ *                                     no step is given)
+ *     --step arg (=0)                 supervoxel size in pixels and frames
+ *     -c [ --compactness ] arg (=40)  compactness
+ *     -t [ --iterations ] arg (=5)    iterations
+ *     -r [ --color-space ] arg (=1)   color space: 0 = RGB, > 0 = Lab
+ *     --slab arg (=32)                number of frames processed at once
+ *     --threads arg (=0)              number of threads (0 for all cores)
+ *     --oc arg (=output)              directory for contour pictures
+ *     --om arg (=output)              directory for mean pictures
+ *     --or arg (=output)              directory for random pictures
+ *     --ol arg                        directory for label files
+ *     --format arg (=csv)             format of the label files: csv, bin or 
+ *                                     rle
+ * \endcode
+ * \author David Stutz
+ */
+int main(int argc, const char** argv) {
+    
+    boost::program_options::options_description desc("Allowed options");
+    desc.add_options()
+        ("help,h", "produce help message")
+        ("input,i", boost::program_options::value<std::string>(), "directory, glob pattern or list (.txt) of the frames to process")
+        ("superpixels,s", boost::program_options::value<int>()->default_value(400), "number of superpixels per frame (used if no step is given)")
+        ("step", boost::program_options::value<int>()->default_value(0), "supervoxel size in pixels and frames")
+        ("compactness,c", boost::program_options::value<float>()->default_value(40.f), "compactness")
+        ("iterations,t", boost::program_options::value<int>()->default_value(5), "iterations")
+        ("color-space,r", boost::program_options::value<int>()->default_value(1), "color space: 0 = RGB, > 0 = Lab")
+        ("slab", boost::program_options::value<int>()->default_value(32), "number of frames processed at once")
+        ("threads", boost::program_options::value<int>()->default_value(0), "number of threads (0 for all cores)")
+        ("oc", boost::program_options::value<std::string>()->default_value("output"), "directory for contour pictures")
+        ("om", boost::program_options::value<std::string>()->default_value("output"), "directory for mean pictures")  
+        ("or", boost::program_options::value<std::string>()->default_value("output"), "directory for random pictures")
+        ("ol", boost::program_options::value<std::string>()->default_value(""), "directory for label files")
+        ("format", boost::program_options::value<std::string>()->default_value("csv"), "format of the label files: csv, bin or rle");
+         
+    boost::program_options::positional_options_description positionals;
+    positionals.add("input", 1);
+    
+    boost::program_options::variables_map parameters;
+    boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).positional(positionals).run(), parameters);
+    boost::program_options::notify(parameters);
+
+    if (parameters.find("help") != parameters.end()) {
+        std::cout << desc << std::endl;
+        return 1;
+    }
+    
+    std::string inputfile = parameters["input"].as<std::string>();
+    std::string store_contour = parameters["oc"].as<std::string>();
+    std::string store_labels = parameters["ol"].as<std::string>();
+    std::string store_mean = parameters["om"].as<std::string>();    
+    std::string store_random = parameters["or"].as<std::string>();    
+    int superpixels = parameters["superpixels"].as<int>();
+    int step = parameters["step"].as<int>();
+    float compactness = parameters["compactness"].as<float>();
+    int iterations = parameters["iterations"].as<int>();
+    int color_space = parameters["color-space"].as<int>();
+    int slab = std::max(1, parameters["slab"].as<int>());
+    int threads = parameters["threads"].as<int>();
+    std::string label_extension = IOUtil::getLabelExtension(parameters["format"].as<std::string>());
+    
+    std::vector<boost::filesystem::path> files;
+    BatchProcessing::listImages(inputfile, files);
+    BatchProcessing::checkUniqueStems(files);
+    
+    if (files.empty()) {
+        std::cout << "No frames found." << std::endl;
+        return 1;
+    }
+    
+    std::vector<std::string> stores = {store_contour, store_mean, store_random, store_labels};
+    for (unsigned int i = 0; i < stores.size(); ++i) {
+        if (!stores[i].empty() && !boost::filesystem::is_directory(stores[i])) {
+            boost::filesystem::create_directories(stores[i]);
+        }
+    }
+    
+    if (step <= 0) {
+        step = SuperpixelTools::computeRegionSizeFromSuperpixels(
+                cv::imread(files[0].string()), superpixels);
+    }
+    
+    // Only the current slab is kept in memory; the buffers of the supervoxel
+    // engine are reused across slabs.
+    SLICSupervoxels supervoxels(step, compactness, iterations, color_space, 
+            threads);
+    
+    std::vector<cv::Mat> images(slab);
+    std::vector<unsigned int> frames;
+    std::vector<int> slab_labels;
+    
+    int label_offset = 0;
+    double seconds = 0;
+    
+    for (unsigned int start = 0; start < files.size(); start += slab) {
+        int depth = std::min((int) files.size() - (int) start, slab);
+        
+        for (int z = 0; z < depth; ++z) {
+            images[z] = cv::imread(files[start + z].string());
+            LOG_IF(FATAL, images[z].empty()) << "Could not read " << files[start + z] << ".";
+            LOG_IF(FATAL, images[z].size() != images[0].size()) << "All frames need to be of the same size.";
+        }
+        
+        int width = images[0].cols;
+        int height = images[0].rows;
+        
+        frames.resize(width*height*depth);
+        slab_labels.resize(width*height*depth);
+        
+        for (int z = 0; z < depth; ++z) {
+            for (int i = 0; i < height; ++i) {
+                const cv::Vec3b* row = images[z].ptr<cv::Vec3b>(i);
+                unsigned int* packed = &frames[(z*height + i)*width];
+                
+                for (int j = 0; j < width; ++j) {
+                    packed[j] = 0xFF000000 | (row[j][2] << 16) | (row[j][1] << 8) | row[j][0];
+                }
+            }
+        }
+        
+        std::chrono::high_resolution_clock::time_point begin 
+                = std::chrono::high_resolution_clock::now();
+        
+        int count = supervoxels.computeSupervoxels(&frames[0], width, height, 
+                depth, &slab_labels[0]);
+        
+        seconds += std::chrono::duration<double>(
+                std::chrono::high_resolution_clock::now() - begin).count();
+        
+        for (int z = 0; z < depth; ++z) {
+            cv::Mat labels(height, width, CV_32SC1, &slab_labels[z*width*height]);
+            labels += label_offset;
+            
+            boost::filesystem::path file = files[start + z];
+            
+            if (!store_contour.empty()) {
+                cv::Mat blackima = cv::Mat::zeros(images[z].size(), CV_8UC3);
+                
+                cv::Mat image_contours;
+                Visualization::drawContours(blackima, labels, image_contours);
+                cv::imwrite((boost::filesystem::path(store_contour) / (file.stem().string() + "_contours.png")).string(), image_contours);
+            }
+            
+            if (!store_mean.empty()) {
+                cv::Mat image_means;
+                Visualization::drawMeans(images[z], labels, image_means);
+                cv::imwrite((boost::filesystem::path(store_mean) / (file.stem().string() + "_mean.png")).string(), image_means);
+            }
+            
+            if (!store_random.empty()) {
+                cv::Mat image_random;
+                Visualization::drawRandom(labels, image_random);
+                cv::imwrite((boost::filesystem::path(store_random) / (file.stem().string() + "_random.png")).string(), image_random);
+            }
+            
+            if (!store_labels.empty()) {
+                IOUtil::writeLabels(boost::filesystem::path(store_labels) / (file.stem().string() + label_extension), labels);
+            }
+        }
+        
+        label_offset += count;
+    }
+    
+    std::cout << "Frames: " << files.size() << std::endl;
+    std::cout << "Supervoxels: " << label_offset << std::endl;
+    std::cout << "Frames per second (supervoxels only): " << files.size()/seconds << std::endl;
+    
+    return 0;
+}
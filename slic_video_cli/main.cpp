@@ -0,0 +1,169 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <chrono>
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include "slic_opencv.h"
+#include "io_util.h"
+#include "batch_processing.h"
+#include "superpixel_tools.h"
+#include "visualization.h"
+
+/** \brief Command line tool for running SLIC on a sequence of video frames.
+ * 
+ * The frames are processed in the order of their file names; each frame after
+ * the first starts from the centroids of the previous one.
+ * 
+ * Usage:
+ * \code{sh}
+ *   $ ../bin/slic_video_cli --help
+ *   Allowed options:
+ *     -h [ --help ]                         produce help message
+ *     -i [ --input ] arg                    directory, glob pattern or list 
+ *                                           (.txt) of the frames to process
+ *     -s [ --superpixels ] arg (=400)       number of superpixles
+ *     -c [ --compactness ] arg (=40)        compactness
+ *     -p [ --perturb-seeds ] arg (=1)       perturb seeds on the first frame: 
+ *                                           > 0 yes, = 0 no
+ *     -t [ --iterations ] arg (=10)         iterations on the first frame and 
+ *                                           on key frames
+ *     -w [ --warm-iterations ] arg (=2)     iterations on the following frames
+ *     -k [ --key-frames ] arg (=0)          start from the grid every k frames 
+ *                                           (0 for never)
+ *     -r [ --color-space ] arg (=1)         color space: 0 = RGB, > 0 = Lab
+ *     --slic-threads arg (=1)               number of threads used by SLIC (0 
+ *                                           for all cores)
+ *     --convergence-displacement arg (=-1)  stop early once no centroid moves 
+ *                                           more than this many pixels 
+ *                                           (negative to disable)
+ *     --convergence-changed arg (=-1)       stop early once at most this 
+ *                                           fraction of labels changes 
+ *                                           (negative to disable)
+ *     --oc arg (=output)                    directory for contour pictures
+ *     --om arg (=output)                    directory for mean pictures
+ *     --or arg (=output)                    directory for random pictures
+ *     --ol arg                              directory for label files
+ *     --format arg (=csv)                   format of the label files: csv, 
+ *                                           bin or rle
+ *     --prefetch arg (=4)                   number of frames to read ahead
+ * \endcode
+ * \author David Stutz
+ */
+int main(int argc, const char** argv) {
+    
+    boost::program_options::options_description desc("Allowed options");
+    desc.add_options()
+        ("help,h", "produce help message")
+        ("input,i", boost::program_options::value<std::string>(), "directory, glob pattern or list (.txt) of the frames to process")
+        ("superpixels,s", boost::program_options::value<int>()->default_value(400), "number of superpixles")
+        ("compactness,c", boost::program_options::value<double>()->default_value(40.), "compactness")
+        ("perturb-seeds,p", boost::program_options::value<int>()->default_value(1), "perturb seeds on the first frame: > 0 yes, = 0 no")
+        ("iterations,t", boost::program_options::value<int>()->default_value(10), "iterations on the first frame and on key frames")
+        ("warm-iterations,w", boost::program_options::value<int>()->default_value(2), "iterations on the following frames")
+        ("key-frames,k", boost::program_options::value<int>()->default_value(0), "start from the grid every k frames (0 for never)")
+        ("color-space,r", boost::program_options::value<int>()->default_value(1), "color space: 0 = RGB, > 0 = Lab")
+        ("slic-threads", boost::program_options::value<int>()->default_value(1), "number of threads used by SLIC (0 for all cores)")
+        ("convergence-displacement", boost::program_options::value<float>()->default_value(-1), "stop early once no centroid moves more than this many pixels (negative to disable)")
+        ("convergence-changed", boost::program_options::value<float>()->default_value(-1), "stop early once at most this fraction of labels changes (negative to disable)")
+        ("oc", boost::program_options::value<std::string>()->default_value("output"), "directory for contour pictures")
+        ("om", boost::program_options::value<std::string>()->default_value("output"), "directory for mean pictures")  
+        ("or", boost::program_options::value<std::string>()->default_value("output"), "directory for random pictures")
+        ("ol", boost::program_options::value<std::string>()->default_value(""), "directory for label files")
+        ("format", boost::program_options::value<std::string>()->default_value("csv"), "format of the label files: csv, bin or rle")
+        ("prefetch", boost::program_options::value<int>()->default_value(4), "number of frames to read ahead");
+         
+    boost::program_options::positional_options_description positionals;
+    positionals.add("input", 1);
+    
+    boost::program_options::variables_map parameters;
+    boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).positional(positionals).run(), parameters);
+    boost::program_options::notify(parameters);
+
+    if (parameters.find("help") != parameters.end()) {
+        std::cout << desc << std::endl;
+        return 1;
+    }
+    
+    std::string inputfile = parameters["input"].as<std::string>();
+    std::string store_contour = parameters["oc"].as<std::string>();
+    std::string store_labels = parameters["ol"].as<std::string>();
+    std::string store_mean = parameters["om"].as<std::string>();    
+    std::string store_random = parameters["or"].as<std::string>();    
+    int superpixels = parameters["superpixels"].as<int>();
+    double compactness = parameters["compactness"].as<double>();
+    int iterations = parameters["iterations"].as<int>();
+    int warm_iterations = parameters["warm-iterations"].as<int>();
+    int key_frames = parameters["key-frames"].as<int>();
+    int perturb_seeds_int = parameters["perturb-seeds"].as<int>();
+    bool perturb_seeds = perturb_seeds_int > 0 ? true : false;
+    int color_space = parameters["color-space"].as<int> ();
+    int slic_threads = parameters["slic-threads"].as<int>();
+    
+    SLICVideo_OpenCV slic_video(compactness, iterations, warm_iterations, 
+            perturb_seeds, color_space, slic_threads, key_frames);
+    slic_video.setConvergence(parameters["convergence-displacement"].as<float>(),
+            parameters["convergence-changed"].as<float>());
+    
+    // Frames depend on each other, so they are processed by a single worker
+    // in order while the next frames are read ahead.
+    BatchProcessing batch_processing(store_contour, store_mean, store_random, store_labels);
+    batch_processing.setFormat(parameters["format"].as<std::string>());
+    batch_processing.setThreads(1);
+    batch_processing.setPrefetch(parameters["prefetch"].as<int>());
+    
+    int frames = 0;
+    int used_iterations = 0;
+    double seconds = 0;
+    
+    batch_processing.process(inputfile, [&](cv::Mat &image, cv::Mat &labels) {
+        int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image,
+                superpixels);
+        
+        std::chrono::high_resolution_clock::time_point start 
+                = std::chrono::high_resolution_clock::now();
+        
+        used_iterations += slic_video.computeSuperpixels(image, region_size, labels);
+        
+        seconds += std::chrono::duration<double>(
+                std::chrono::high_resolution_clock::now() - start).count();
+        ++frames;
+    });
+    
+    if (frames > 0) {
+        std::cout << "Frames: " << frames << std::endl;
+        std::cout << "Average iterations: " << ((float) used_iterations)/frames << std::endl;
+        std::cout << "Frames per second (SLIC only): " << frames/seconds << std::endl;
+    }
+    
+    return 0;
+}
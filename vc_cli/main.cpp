@@ -36,6 +36,7 @@
 #include <boost/timer.hpp>
 #include "vc_opencv.h"
 #include "io_util.h"
+#include "batch_processing.h"
 #include "superpixel_tools.h"
 #include "visualization.h"
 
@@ -67,7 +68,7 @@ int main (int argc, char ** argv) {
     boost::program_options::options_description desc("Allowed options");
     desc.add_options()
         ("help,h", "produce help message")
-        ("input,i", boost::program_options::value<std::string>(), "folder containing the images to process")
+        ("input,i", boost::program_options::value<std::string>(), "image, directory, glob pattern or image list (.txt) to process")
         ("superpixels,s", boost::program_options::value<int>()->default_value(400), "number superpixels")
         ("weight,c", boost::program_options::value<double>()->default_value(5.0), "number superpixels")
         ("radius,g", boost::program_options::value<int>()->default_value(3), "radius")
@@ -75,8 +76,12 @@ int main (int argc, char ** argv) {
         ("direct-neighbors,d", boost::program_options::value<int>()->default_value(4), "number of direct neighbors")
         ("threshold,t", boost::program_options::value<int>()->default_value(10), "threshold influencing the number of iterations")
         ("color-space,r", boost::program_options::value<int>()->default_value(1), "color space; 0 for RGB, > 0 for Lab")
-        ("oc", boost::program_options::value<std::string>()->default_value("output"), "name of the contour picture")
-        ("om", boost::program_options::value<std::string>()->default_value("output"), "name of the mean picture");   
+        ("oc", boost::program_options::value<std::string>()->default_value("output"), "name of the contour picture (directory for batches)")
+        ("om", boost::program_options::value<std::string>()->default_value("output"), "name of the mean picture (directory for batches)")
+        ("ol", boost::program_options::value<std::string>()->default_value(""), "name of the label file (.csv, .bin or .rle; directory for batches)")
+        ("format", boost::program_options::value<std::string>()->default_value("csv"), "format of the label files for batches: csv, bin or rle")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of images to process in parallel for batches (0 for all cores)")
+        ("prefetch", boost::program_options::value<int>()->default_value(4), "number of images to read ahead for batches");
     
     boost::program_options::positional_options_description positionals;
     positionals.add("input", 1);
@@ -92,6 +97,7 @@ int main (int argc, char ** argv) {
     
     std::string inputfile = parameters["input"].as<std::string>();
     std::string store_contour = parameters["oc"].as<std::string>();
+    std::string store_labels = parameters["ol"].as<std::string>();
     std::string store_mean = parameters["om"].as<std::string>();                  
     int superpixels = parameters["superpixels"].as<int>();
     double weight = parameters["weight"].as<double>();
@@ -100,28 +106,22 @@ int main (int argc, char ** argv) {
     int direct_neighbors = parameters["direct-neighbors"].as<int>();
     int threshold = parameters["threshold"].as<int>();
            
-    cv::Mat image = cv::imread(inputfile);
-    cv::Mat labels;
-        
-    VC_OpenCV::computeSuperpixels(image, superpixels, weight, radius, 
-                neighboring_clusters, direct_neighbors, threshold, labels);
-        
-    int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
-    int merged_unconnected_components = SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, labels, unconnected_components);
-        
-    int size = (float) (image.rows*image.cols)/superpixels/10;
-    int merged_small_components = SuperpixelTools::enforceMinimumSuperpixelSize(image, labels, size);
-    SuperpixelTools::relabelSuperpixels(labels);
-        
-    cv::Mat blackima = cv::Mat::zeros(cv::Size(image.cols, image.rows), CV_8UC3);
+    BatchProcessing batch_processing(store_contour, store_mean, "", store_labels);
+    batch_processing.setFormat(parameters["format"].as<std::string>());
+    batch_processing.setThreads(parameters["threads"].as<int>());
+    batch_processing.setPrefetch(parameters["prefetch"].as<int>());
     
-    cv::Mat image_contours;
-    Visualization::drawContours(blackima, labels, image_contours);
-    cv::imwrite(store_contour, image_contours);
+    batch_processing.process(inputfile, [&](cv::Mat &image, cv::Mat &labels) {
+        VC_OpenCV::computeSuperpixels(image, superpixels, weight, radius,
+                    neighboring_clusters, direct_neighbors, threshold, labels);
 
-    cv::Mat image_means;
-    Visualization::drawMeans(image, labels, image_means);
-    cv::imwrite(store_mean, image_means);  
+        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
+        int merged_unconnected_components = SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, labels, unconnected_components);
+
+        int size = (float) (image.rows*image.cols)/superpixels/10;
+        int merged_small_components = SuperpixelTools::enforceMinimumSuperpixelSize(image, labels, size);
+        SuperpixelTools::relabelSuperpixels(labels);
+    });
     
     return 0;
 }
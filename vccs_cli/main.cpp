@@ -72,6 +72,7 @@
  *     -n [ --normal-weight ] arg (=0.200000003)
  *                                           normal weight
  *     -o [ --csv ] arg                      save segmentation as CSV file
+ *     --format arg (=csv)                   label format: csv, bin or rle
  *     -v [ --vis ] arg                      visualize contours
  *     -x [ --prefix ] arg                   output file prefix
  *     -w [ --wordy ]                        verbose/wordy/debug
@@ -97,6 +98,7 @@ int main(int argc, const char** argv) {
         ("spatial-weight,p", boost::program_options::value<float>()->default_value(0.3f), "spatial weight")
         ("normal-weight,n", boost::program_options::value<float>()->default_value(0.2f), "normal weight")
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "save segmentation as CSV file")
+        ("format", boost::program_options::value<std::string>()->default_value("csv"), "label format: csv, bin or rle")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
         ("wordy,w", "verbose/wordy/debug");
@@ -114,6 +116,8 @@ int main(int argc, const char** argv) {
         return 1;
     }
     
+    std::string label_extension = IOUtil::getLabelExtension(parameters["format"].as<std::string>());
+    
     boost::filesystem::path output_dir(parameters["csv"].as<std::string>());
     if (!output_dir.empty()) {
         if (!boost::filesystem::is_directory(output_dir)) {
@@ -252,8 +256,8 @@ int main(int argc, const char** argv) {
         
         if (!output_dir.empty()) {
             boost::filesystem::path csv_file(output_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+                    / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+            IOUtil::writeLabels(csv_file, labels);
         }
         
         if (!vis_dir.empty()) {
@@ -20,8 +20,10 @@
  *     -c [ --compactness ] arg (=40)        compactness = regularization trades off
  *                                           color for spatial closeness
  *     -t [ --iterations ] arg (=10)         iterations
+ *     --threads arg (=1)                    number of threads (0 for all cores)
  *     -o [ --csv ] arg                      specify the output directory (default 
  *                                           is ./output)
+ *     --format arg (=csv)                   label format: csv, bin or rle
  *     -v [ --vis ] arg                      visualize contours
  *     -x [ --prefix ] arg                   output file prefix
  *     -w [ --wordy ]                        verbose/wordy/debug
@@ -38,7 +40,9 @@ int main(int argc, const char** argv) {
         ("minimum-region-size,m", boost::program_options::value<int>()->default_value(1), "minimum region size allowed")
         ("compactness,c", boost::program_options::value<double>()->default_value(40.0), "compactness = regularization trades off color for spatial closeness")
         ("iterations,t", boost::program_options::value<int>()->default_value(10), "iterations")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of threads (0 for all cores)")
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "specify the output directory (default is ./output)")
+        ("format", boost::program_options::value<std::string>()->default_value("csv"), "label format: csv, bin or rle")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
         ("wordy,w", "verbose/wordy/debug");
@@ -55,6 +59,8 @@ int main(int argc, const char** argv) {
         return 1;
     }
     
+    std::string label_extension = IOUtil::getLabelExtension(parameters["format"].as<std::string>());
+    
     boost::filesystem::path output_dir(parameters["csv"].as<std::string>());
     if (!output_dir.empty()) {
         if (!boost::filesystem::is_directory(output_dir)) {
@@ -86,6 +92,7 @@ int main(int argc, const char** argv) {
     double regularization = parameters["compactness"].as<double>();
     int iterations = parameters["iterations"].as<int>();
     int min_region_size = parameters["minimum-region-size"].as<int>();
+    int threads = parameters["threads"].as<int>();
     
     // To be comparable to oriSLIC, see lib_slic/README.md and lib_vlfeat/README2.md!
     regularization *= regularization;
@@ -107,7 +114,7 @@ int main(int argc, const char** argv) {
         
         boost::timer timer;
         VLSLIC_OpenCV::computeSuperpixels(image, region_size, regularization, 
-                min_region_size, iterations, labels);
+                min_region_size, iterations, labels, threads);
         float elapsed = timer.elapsed();
         total += elapsed;
         
@@ -121,8 +128,8 @@ int main(int argc, const char** argv) {
         
         if (!output_dir.empty()) {
             boost::filesystem::path csv_file(output_dir 
-                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+                    / boost::filesystem::path(prefix + it->second.stem().string() + label_extension));
+            IOUtil::writeLabels(csv_file, labels);
         }
         
         if (!vis_dir.empty()) {